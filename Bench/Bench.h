@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Minimal microbenchmark registry for MEngineBench. A benchmark is a function that sets up its
+// own data, times what it cares about and reports one or more named results. What it computes is
+// checked against a reference with Check(), and any mismatch fails the run:
+//
+//   MENGINE_BENCHMARK(JobSystem_EmptyJobs)
+//   {
+//       ...
+//       context.Report("throughput", jobs / seconds, "jobs/s");
+//       context.Check("jobs not run", jobs - jobsRun);
+//   }
+
+class FBenchContext
+{
+public:
+    explicit FBenchContext(bool quick) : mQuick(quick) {}
+
+    // --quick: benchmarks should shrink their problem sizes (smoke runs, CI).
+    bool IsQuick() const { return mQuick; }
+    uint32_t Scale(uint32_t full, uint32_t quick) const { return mQuick ? quick : full; }
+
+    void Report(const char* metric, double value, const char* unit) const
+    {
+        std::printf("  %-32s %14.3f %s\n", metric, value, unit);
+    }
+
+    void Report(const char* metric, const char* text) const
+    {
+        std::printf("  %-32s %14s\n", metric, text);
+    }
+
+    // Reports mismatchCount like a result, and fails the benchmark unless it is 0.
+    void Check(const char* name, uint64_t mismatchCount)
+    {
+        std::printf("  %-32s %14llu%s\n", name, static_cast<unsigned long long>(mismatchCount), mismatchCount == 0 ? "" : "  FAILED");
+        mFailedCheckCount += mismatchCount == 0 ? 0 : 1;
+    }
+
+    // Checks failed since the last call, which clears the count.
+    uint32_t TakeFailedCheckCount()
+    {
+        const uint32_t count = mFailedCheckCount;
+        mFailedCheckCount = 0;
+        return count;
+    }
+
+    template<typename F>
+    static double MeasureMs(F&& func)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    // Best of repeatCount runs, which filters out scheduling noise for short kernels.
+    template<typename F>
+    static double MeasureBestMs(uint32_t repeatCount, F&& func)
+    {
+        double best = 0.0;
+        for (uint32_t i = 0; i < repeatCount; ++i)
+        {
+            const double ms = MeasureMs(func);
+            best = (i == 0 || ms < best) ? ms : best;
+        }
+        return best;
+    }
+
+private:
+    bool mQuick;
+    uint32_t mFailedCheckCount = 0;
+};
+
+typedef void (*FBenchFunction)(FBenchContext& context);
+
+struct FBenchEntry
+{
+    const char* Name;
+    FBenchFunction Function;
+};
+
+inline std::vector<FBenchEntry>& GetBenchRegistry()
+{
+    static std::vector<FBenchEntry> registry;
+    return registry;
+}
+
+struct FBenchRegistrar
+{
+    FBenchRegistrar(const char* name, FBenchFunction function)
+    {
+        GetBenchRegistry().push_back({ name, function });
+    }
+};
+
+#define MENGINE_BENCHMARK(Name) \
+    static void Name(FBenchContext& context); \
+    static FBenchRegistrar Name##Registrar(#Name, &Name); \
+    static void Name(FBenchContext& context)
@@ -0,0 +1,88 @@
+// Microbenchmarks for engine systems that can be measured without a GPU.
+//
+//   MEngineBench [--quick] [--list] [filter...]
+//
+// Runs every registered benchmark whose name contains one of the filters (all of them by default).
+// Exits with 1 when a benchmark throws or one of its checks fails.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+
+int main(int argc, char** argv)
+{
+    bool quick = false;
+    bool listOnly = false;
+    std::vector<std::string> filters;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            quick = true;
+        }
+        else if (std::strcmp(argv[i], "--list") == 0)
+        {
+            listOnly = true;
+        }
+        else if (argv[i][0] == '-')
+        {
+            std::fprintf(stderr, "usage: %s [--quick] [--list] [filter...]\n", argv[0]);
+            return 1;
+        }
+        else
+        {
+            filters.push_back(argv[i]);
+        }
+    }
+
+    std::vector<FBenchEntry> entries = GetBenchRegistry();
+    std::sort(entries.begin(), entries.end(), [](const FBenchEntry& a, const FBenchEntry& b) { return std::strcmp(a.Name, b.Name) < 0; });
+
+    FBenchContext context(quick);
+    uint32_t runCount = 0;
+    uint32_t failedCount = 0;
+    for (const FBenchEntry& entry : entries)
+    {
+        const bool selected = filters.empty() || std::any_of(filters.begin(), filters.end(),
+            [&](const std::string& filter) { return std::strstr(entry.Name, filter.c_str()) != nullptr; });
+        if (!selected)
+        {
+            continue;
+        }
+
+        std::printf("%s\n", entry.Name);
+        if (listOnly)
+        {
+            continue;
+        }
+
+        try
+        {
+            entry.Function(context);
+        }
+        catch (const std::exception& e)
+        {
+            std::fprintf(stderr, "%s failed: %s\n", entry.Name, e.what());
+            return 1;
+        }
+        const uint32_t failedChecks = context.TakeFailedCheckCount();
+        if (failedChecks != 0)
+        {
+            std::fprintf(stderr, "%s failed: %u check(s)\n", entry.Name, failedChecks);
+            ++failedCount;
+        }
+        ++runCount;
+    }
+
+    if (!listOnly && runCount == 0)
+    {
+        std::fprintf(stderr, "No benchmark matched\n");
+        return 1;
+    }
+    return failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,265 @@
+// FBindlessSlotAllocator against the free-index queue BindlessAllocator used before it (every slot
+// pushed up front, a mutex around each allocate and free): construction, one thread, and several
+// threads loading and unloading assets at once. The allocator is checked as well: threads must never
+// be handed the same slot, a freed handle must die at once and not free twice, and a range freed
+// behind a fence must not be handed out again before that fence is released.
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "Render/BindlessSlotAllocator.h"
+
+namespace
+{
+    // The old BindlessAllocator without its descriptor heap.
+    class FQueueSlotAllocator
+    {
+    public:
+        explicit FQueueSlotAllocator(uint32_t capacity)
+        {
+            for (uint32_t i = 0; i < capacity; ++i)
+            {
+                mFreeIndices.push(i);
+            }
+        }
+
+        uint32_t Allocate()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const uint32_t index = mFreeIndices.front();
+            mFreeIndices.pop();
+            return index;
+        }
+
+        void Free(uint32_t index)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mFreeIndices.push(index);
+        }
+
+    private:
+        std::queue<uint32_t> mFreeIndices;
+        std::mutex mMutex;
+    };
+
+    // Each thread allocates a batch of descriptors (an asset's textures and buffers), then frees them.
+    const uint32_t BatchSize = 64;
+
+    template<typename F>
+    double RunThreads(uint32_t threadCount, F&& threadFunc)
+    {
+        return FBenchContext::MeasureMs([&]
+        {
+            std::vector<std::thread> threads;
+            for (uint32_t t = 0; t < threadCount; ++t)
+            {
+                threads.emplace_back([&threadFunc] { threadFunc(); });
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+        });
+    }
+
+    void ChurnQueue(FQueueSlotAllocator& allocator, uint32_t batchCount)
+    {
+        uint32_t indices[BatchSize];
+        for (uint32_t batch = 0; batch < batchCount; ++batch)
+        {
+            for (uint32_t& index : indices)
+            {
+                index = allocator.Allocate();
+            }
+            for (uint32_t index : indices)
+            {
+                allocator.Free(index);
+            }
+        }
+    }
+
+    void ChurnBitset(FBindlessSlotAllocator& allocator, uint32_t batchCount)
+    {
+        FBindlessHandle handles[BatchSize];
+        for (uint32_t batch = 0; batch < batchCount; ++batch)
+        {
+            for (FBindlessHandle& handle : handles)
+            {
+                handle = allocator.Allocate();
+            }
+            for (FBindlessHandle handle : handles)
+            {
+                allocator.Free(handle);
+            }
+        }
+    }
+
+    // ChurnBitset() with ranges of 1-4 slots and now and then one spanning words. Every slot a thread
+    // is handed is marked in owned until the thread frees it; one found marked already was handed to
+    // two threads at once. Returns how many were.
+    uint32_t ChurnBitsetChecked(FBindlessSlotAllocator& allocator, uint32_t batchCount, std::atomic<uint8_t>* owned)
+    {
+        FBindlessHandle handles[BatchSize];
+        uint32_t counts[BatchSize];
+        uint32_t collisions = 0;
+        for (uint32_t batch = 0; batch < batchCount; ++batch)
+        {
+            for (uint32_t i = 0; i < BatchSize; ++i)
+            {
+                counts[i] = (batch % 16 == 0 && i == 0) ? 100 : 1 + (batch + i) % 4;
+                handles[i] = allocator.AllocateRange(counts[i]);
+                for (uint32_t slot = 0; handles[i].IsValid() && slot < counts[i]; ++slot)
+                {
+                    collisions += owned[handles[i].Index + slot].exchange(1) != 0 ? 1 : 0;
+                }
+            }
+            for (uint32_t i = 0; i < BatchSize; ++i)
+            {
+                for (uint32_t slot = 0; handles[i].IsValid() && slot < counts[i]; ++slot)
+                {
+                    owned[handles[i].Index + slot].store(0);
+                }
+                allocator.Free(handles[i]);
+            }
+        }
+        return collisions;
+    }
+}
+
+MENGINE_BENCHMARK(BindlessAllocator_Construct)
+{
+    const uint32_t capacity = context.Scale(1000000, 100000);
+    const uint32_t repeatCount = context.Scale(5, 2);
+
+    const double queueMs = FBenchContext::MeasureBestMs(repeatCount, [capacity] { FQueueSlotAllocator allocator(capacity); });
+    const double bitsetMs = FBenchContext::MeasureBestMs(repeatCount, [capacity] { FBindlessSlotAllocator allocator(capacity); });
+
+    context.Report("slots", capacity, "");
+    context.Report("free-index queue", queueMs, "ms");
+    context.Report("bitset", bitsetMs, "ms");
+}
+
+MENGINE_BENCHMARK(BindlessAllocator_Churn)
+{
+    const uint32_t capacity = 100000;
+    const uint32_t batchCount = context.Scale(20000, 2000);
+    const uint32_t threadCount = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+
+    FQueueSlotAllocator queueAllocator(capacity);
+    FBindlessSlotAllocator bitsetAllocator(capacity);
+
+    // The engine always has its worker threads running. Until a process starts its first thread,
+    // glibc leaves the lock prefix off its mutex operations, which would flatter the queue.
+    std::thread([] {}).join();
+
+    const double queueMs = FBenchContext::MeasureBestMs(3, [&] { ChurnQueue(queueAllocator, batchCount); });
+    const double bitsetMs = FBenchContext::MeasureBestMs(3, [&] { ChurnBitset(bitsetAllocator, batchCount); });
+    const double queueThreadsMs = RunThreads(threadCount, [&] { ChurnQueue(queueAllocator, batchCount); });
+    const double bitsetThreadsMs = RunThreads(threadCount, [&] { ChurnBitset(bitsetAllocator, batchCount); });
+
+    std::unique_ptr<std::atomic<uint8_t>[]> owned(new std::atomic<uint8_t>[capacity]);
+    for (uint32_t slot = 0; slot < capacity; ++slot)
+    {
+        owned[slot].store(0, std::memory_order_relaxed);
+    }
+    std::atomic<uint32_t> collisions(0);
+    RunThreads(threadCount, [&] { collisions.fetch_add(ChurnBitsetChecked(bitsetAllocator, batchCount, owned.get())); });
+
+    // One operation is an allocate and its free.
+    const double operationCount = double(batchCount) * BatchSize;
+    context.Report("threads", threadCount, "");
+    context.Report("free-index queue, 1 thread", queueMs * 1e6 / operationCount, "ns/op");
+    context.Report("bitset, 1 thread", bitsetMs * 1e6 / operationCount, "ns/op");
+    context.Report("free-index queue, threads", queueThreadsMs * 1e6 / (operationCount * threadCount), "ns/op");
+    context.Report("bitset, threads", bitsetThreadsMs * 1e6 / (operationCount * threadCount), "ns/op");
+    context.Report("speedup (threads)", queueThreadsMs / bitsetThreadsMs, "x");
+    context.Check("slots handed out twice", collisions.load());
+}
+
+MENGINE_BENCHMARK(BindlessAllocator_Ranges)
+{
+    const uint32_t capacity = 100000;
+    const uint32_t roundCount = context.Scale(2000, 200);
+
+    // Descriptor tables of 1-16 slots kept over several rounds, freed behind a simulated fence two
+    // rounds late, plus an occasional large table. Outside the timing, the fence each freed slot
+    // waits for is tracked, and every slot handed out must be neither live nor still waiting.
+    uint32_t allocationCount = 0;
+    uint32_t failedCount = 0;
+    const auto runRounds = [&](FBindlessSlotAllocator& allocator, bool check, uint32_t* mismatches)
+    {
+        std::vector<std::pair<FBindlessHandle, uint32_t>> live;
+        std::vector<uint8_t> inUse(check ? capacity : 0, 0);
+        std::vector<uint64_t> pendingFence(check ? capacity : 0, 0);
+        std::vector<std::pair<FBindlessHandle, uint32_t>> pending;
+        for (uint32_t round = 1; round <= roundCount; ++round)
+        {
+            const uint64_t completedFence = round > 2 ? round - 2 : 0;
+            allocator.ReleaseRetired(completedFence);
+            if (check)
+            {
+                auto retired = std::partition(pending.begin(), pending.end(),
+                    [&](const std::pair<FBindlessHandle, uint32_t>& range) { return pendingFence[range.first.Index] > completedFence; });
+                for (auto range = retired; range != pending.end(); ++range)
+                {
+                    std::fill_n(&pendingFence[range->first.Index], range->second, 0);
+                }
+                pending.erase(retired, pending.end());
+            }
+
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                const uint32_t count = (i % 64 == 0) ? 200 : 1 + (i * 7 + round) % 16;
+                const FBindlessHandle handle = allocator.AllocateRange(count);
+                failedCount += handle.IsValid() || check ? 0 : 1;
+                if (handle.IsValid())
+                {
+                    allocationCount += check ? 0 : 1;
+                    for (uint32_t slot = handle.Index; check && slot < handle.Index + count; ++slot)
+                    {
+                        mismatches[0] += inUse[slot] != 0 ? 1 : 0;
+                        mismatches[1] += pendingFence[slot] != 0 ? 1 : 0;
+                        inUse[slot] = 1;
+                    }
+                    live.push_back({ handle, count });
+                }
+            }
+            // Keep the newest half; the rest are freed behind this round's fence.
+            const size_t keepCount = live.size() / 2;
+            for (size_t i = 0; i + keepCount < live.size(); ++i)
+            {
+                const FBindlessHandle handle = live[i].first;
+                const bool freed = allocator.Free(handle, round);
+                if (check)
+                {
+                    mismatches[2] += !freed || allocator.IsAlive(handle) || allocator.Free(handle, round) ? 1 : 0;
+                    std::fill_n(&inUse[handle.Index], live[i].second, 0);
+                    std::fill_n(&pendingFence[handle.Index], live[i].second, round);
+                    pending.push_back(live[i]);
+                }
+            }
+            live.erase(live.begin(), live.end() - keepCount);
+        }
+    };
+    FBindlessSlotAllocator allocator(capacity);
+    const double ms = FBenchContext::MeasureMs([&] { runRounds(allocator, false, nullptr); });
+
+    // Slots handed out while in use or pending, and frees that left the handle alive or took it twice.
+    FBindlessSlotAllocator checkedAllocator(capacity);
+    uint32_t mismatches[3] = {};
+    runRounds(checkedAllocator, true, mismatches);
+
+    context.Report("allocations", allocationCount, "");
+    context.Report("failed", failedCount, "");
+    context.Report("slots in use at end", allocator.GetUsedCount(), "");
+    context.Report("per allocate + free", ms * 1e6 / allocationCount, "ns");
+    context.Check("slots handed out while in use", mismatches[0]);
+    context.Check("slots reused before their fence", mismatches[1]);
+    context.Check("frees leaving the handle usable", mismatches[2]);
+}
@@ -0,0 +1,204 @@
+// FBvh over a 1024 x 1024 grid of instance boxes: build (alone and on the job system) and refit
+// times, then frustum, sphere and ray queries against testing every box.
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+#include "Bench.h"
+#include "Jobs/JobSystem.h"
+#include "Math/Bvh.h"
+#include "Math/FrustumCulling.h"
+#include "Math/TransformBatch.h"
+
+using namespace DirectX;
+
+namespace
+{
+    const float Spacing = 16.0f;
+
+    // The grid of FrustumCullingBench, with a small deterministic height jitter so the boxes are not
+    // all coplanar.
+    void MakeCityBoxes(uint32_t gridSize, FAabbArray& outBoxes)
+    {
+        const uint32_t count = gridSize * gridSize;
+        FAffineTransformArray transforms;
+        transforms.Resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            FMatrix4x4 model;
+            XMStoreFloat4x4(&model, XMMatrixTranslation((i % gridSize) * Spacing, float((i * 7919u) % 13u), (i / gridSize) * -Spacing));
+            transforms.Set(i, model);
+        }
+        ComputeWorldAabbs(transforms, FVector3(-6.0f, 0.0f, -6.0f), FVector3(6.0f, 20.0f, 6.0f), outBoxes);
+    }
+
+    // Entry distance of origin + t * direction into box i, or -1 on a miss.
+    float RaycastBox(const FAabbArray& boxes, uint32_t i, const float origin[3], const float invDirection[3], float maxDistance)
+    {
+        float tNear = 0.0f;
+        float tFar = maxDistance;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float center = boxes.GetStream(FAabbArray::CenterX + axis)[i];
+            const float extent = boxes.GetStream(FAabbArray::ExtentX + axis)[i];
+            const float t0 = (center - extent - origin[axis]) * invDirection[axis];
+            const float t1 = (center + extent - origin[axis]) * invDirection[axis];
+            tNear = std::max(tNear, std::min(t0, t1));
+            tFar = std::min(tFar, std::max(t0, t1));
+        }
+        return tNear <= tFar ? tNear : -1.0f;
+    }
+
+    // Instances in exactly one of the two lists, which are sorted in place.
+    uint32_t CountMismatches(uint32_t* pA, uint32_t countA, uint32_t* pB, uint32_t countB)
+    {
+        std::sort(pA, pA + countA);
+        std::sort(pB, pB + countB);
+        std::vector<uint32_t> difference;
+        std::set_symmetric_difference(pA, pA + countA, pB, pB + countB, std::back_inserter(difference));
+        return static_cast<uint32_t>(difference.size());
+    }
+}
+
+MENGINE_BENCHMARK(Bvh_BuildRefit)
+{
+    const uint32_t gridSize = context.Scale(1024, 128);
+    const uint32_t count = gridSize * gridSize;
+    const uint32_t repeatCount = context.Scale(5, 2);
+
+    FAabbArray boxes;
+    MakeCityBoxes(gridSize, boxes);
+
+    FBvh bvh;
+    const double buildMs = FBenchContext::MeasureBestMs(repeatCount, [&] { bvh.Build(boxes); });
+    FJobSystem jobSystem;
+    const double parallelBuildMs = FBenchContext::MeasureBestMs(repeatCount, [&] { bvh.Build(boxes, &jobSystem); });
+    const double refitMs = FBenchContext::MeasureBestMs(repeatCount, [&] { bvh.Refit(boxes); });
+
+    // One box in a hundred moved, spread over the grid.
+    std::vector<uint32_t> changed;
+    for (uint32_t i = 0; i < count; i += 100)
+    {
+        changed.push_back(i);
+    }
+    const double partialRefitMs = FBenchContext::MeasureBestMs(repeatCount, [&] { bvh.Refit(boxes, changed.data(), static_cast<uint32_t>(changed.size())); });
+
+    context.Report("instances", count, "");
+    context.Report("nodes", bvh.GetNodeCount(), "");
+    context.Report("build", buildMs, "ms");
+    context.Report("build, jobs", parallelBuildMs, "ms");
+    context.Report("refit", refitMs, "ms");
+    context.Report("refit 1%", partialRefitMs, "ms");
+}
+
+MENGINE_BENCHMARK(Bvh_Queries)
+{
+    const uint32_t gridSize = context.Scale(1024, 128);
+    const uint32_t count = gridSize * gridSize;
+    const uint32_t repeatCount = context.Scale(10, 3);
+    const uint32_t rayCount = context.Scale(256, 32);
+
+    FAabbArray boxes;
+    MakeCityBoxes(gridSize, boxes);
+    FBvh bvh;
+    bvh.Build(boxes);
+
+    // The camera of FrustumCullingBench.
+    const float center = gridSize * Spacing * 0.5f;
+    const FSimdMatrix view = XMMatrixLookAtRH(XMVectorSet(center, 40.0f, -center, 1.0f), XMVectorSet(center + 100.0f, 0.0f, -center - 100.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const FSimdMatrix projection = XMMatrixPerspectiveFovRH(0.8f, 16.0f / 9.0f, 1.0f, 1000.0f);
+    const FFrustum frustum = FFrustum::FromViewProjection(view, projection);
+
+    std::vector<uint32_t> reference(count);
+    std::vector<uint32_t> result(count);
+    uint32_t referenceCount = 0;
+    uint32_t resultCount = 0;
+    const double batchMs = FBenchContext::MeasureBestMs(repeatCount, [&] { referenceCount = CullAabbBatch(boxes, 0, count, frustum, reference.data()); });
+    const double frustumMs = FBenchContext::MeasureBestMs(repeatCount, [&] { resultCount = bvh.QueryFrustum(frustum, result.data()); });
+    uint32_t mismatches = CountMismatches(reference.data(), referenceCount, result.data(), resultCount);
+
+    // Streaming-style radius query around the camera.
+    const FVector3 sphereCenter(center, 0.0f, -center);
+    const float radius = 500.0f;
+    uint32_t sphereCount = 0;
+    const double sphereMs = FBenchContext::MeasureBestMs(repeatCount, [&] { sphereCount = bvh.QuerySphere(sphereCenter, radius, result.data()); });
+    uint32_t sphereReferenceCount = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        float distance = 0.0f;
+        const float c[3] = { sphereCenter.x, sphereCenter.y, sphereCenter.z };
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float boxCenter = boxes.GetStream(FAabbArray::CenterX + axis)[i];
+            const float extent = boxes.GetStream(FAabbArray::ExtentX + axis)[i];
+            const float d = std::max(std::max(boxCenter - extent - c[axis], c[axis] - boxCenter - extent), 0.0f);
+            distance += d * d;
+        }
+        if (distance <= radius * radius)
+        {
+            reference[sphereReferenceCount++] = i;
+        }
+    }
+    mismatches += CountMismatches(reference.data(), sphereReferenceCount, result.data(), sphereCount);
+
+    // Picking rays from above the grid, fanning out downwards.
+    std::vector<FVector3> directions(rayCount);
+    for (uint32_t i = 0; i < rayCount; ++i)
+    {
+        const float angle = 6.2831853f * i / rayCount;
+        directions[i] = FVector3(std::cos(angle), -0.05f - 0.3f * (i % 7) / 7.0f, std::sin(angle));
+    }
+    const FVector3 origin(center, 40.0f, -center);
+    const float maxDistance = 1.0e6f;
+
+    std::vector<float> bvhDistances(rayCount, -1.0f);
+    const double rayMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        for (uint32_t ray = 0; ray < rayCount; ++ray)
+        {
+            uint32_t hit;
+            float distance;
+            bvhDistances[ray] = bvh.Raycast(origin, directions[ray], maxDistance, hit, distance) ? distance : -1.0f;
+        }
+    });
+
+    std::vector<float> bruteDistances(rayCount, -1.0f);
+    const double bruteRayMs = FBenchContext::MeasureBestMs(1, [&]
+    {
+        const float o[3] = { origin.x, origin.y, origin.z };
+        for (uint32_t ray = 0; ray < rayCount; ++ray)
+        {
+            const float invDirection[3] = { 1.0f / directions[ray].x, 1.0f / directions[ray].y, 1.0f / directions[ray].z };
+            float nearest = maxDistance;
+            bool isHit = false;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const float distance = RaycastBox(boxes, i, o, invDirection, nearest);
+                if (distance >= 0.0f)
+                {
+                    nearest = distance;
+                    isHit = true;
+                }
+            }
+            bruteDistances[ray] = isHit ? nearest : -1.0f;
+        }
+    });
+    for (uint32_t ray = 0; ray < rayCount; ++ray)
+    {
+        mismatches += std::fabs(bvhDistances[ray] - bruteDistances[ray]) > 1.0e-3f * std::max(1.0f, bruteDistances[ray]) ? 1 : 0;
+    }
+
+    context.Report("instances", count, "");
+    context.Report("kernel", FBvh::GetKernelName());
+    context.Report("in frustum", referenceCount, "");
+    context.Report("frustum, all boxes", batchMs, "ms");
+    context.Report("frustum, bvh", frustumMs, "ms");
+    context.Report("frustum speedup", batchMs / frustumMs, "x");
+    context.Report("in sphere", sphereCount, "");
+    context.Report("sphere, bvh", sphereMs * 1.0e3, "us");
+    context.Report("raycast, all boxes", bruteRayMs * 1.0e3 / rayCount, "us/ray");
+    context.Report("raycast, bvh", rayMs * 1.0e3 / rayCount, "us/ray");
+    context.Check("mismatches vs brute force", mismatches);
+}
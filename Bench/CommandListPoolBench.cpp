@@ -0,0 +1,137 @@
+// FCommandListPool under parallel recording: every frame a varying number of lists (1 to
+// MaxListsPerFrame) is recorded as jobs, each from an allocator of its own, and submitted together
+// with the simulated GPU two submissions behind. The baseline is a fixed set of allocators per frame
+// resource, which has to be sized for the most lists any frame records. Reports how many allocators
+// and lists the pool ends up with and what a frame's acquires and releases cost.
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "Jobs/JobSystem.h"
+#include "NullRHI/NullRHI.h"
+#include "Render/CommandListPool.h"
+
+namespace
+{
+    const uint32_t FrameResourceCount = 3;
+    const uint32_t LatencyFrames = 2;
+    const uint32_t MaxListsPerFrame = 8;
+    const uint32_t DrawsPerList = 64;
+
+    void RecordDraws(RHICommandList* list)
+    {
+        for (uint32_t draw = 0; draw < DrawsPerList; ++draw)
+        {
+            list->SetGraphicsRoot32BitConstants(3, 1, &draw, 0);
+            list->DrawIndexedInstanced(36, 1, 0, 0, 0);
+        }
+    }
+}
+
+MENGINE_BENCHMARK(CommandListPool_ParallelRecording)
+{
+    const uint32_t frameCount = context.Scale(2000, 200);
+
+    NullRHIDevice device;
+    NullRHICommandQueue* queue = device.GetNullQueue(ERHICommandListType::Direct);
+    queue->SetSimulatedLatency(LatencyFrames);
+
+    FJobSystemDesc jobSystemDesc;
+    jobSystemDesc.WorkerThreadCount = 4;
+    FJobSystem jobSystem(jobSystemDesc);
+
+    std::mt19937 random(7);
+    std::vector<uint32_t> listCounts(frameCount);
+    uint32_t totalLists = 0;
+    for (uint32_t& count : listCounts)
+    {
+        count = 1 + random() % MaxListsPerFrame;
+        totalLists += count;
+    }
+
+    // Every job takes its own allocator and list from the pool and records into it.
+    FCommandListPool pool(&device);
+    std::vector<RHICommandAllocator*> allocators(MaxListsPerFrame);
+    std::vector<RHICommandList*> lists(MaxListsPerFrame);
+    const double pooledMs = FBenchContext::MeasureMs([&]
+    {
+        for (uint32_t listCount : listCounts)
+        {
+            FCommandListPool* pPool = &pool;
+            RHICommandAllocator** pAllocators = allocators.data();
+            RHICommandList** pLists = lists.data();
+            FJobCounter counter;
+            for (uint32_t i = 0; i < listCount; ++i)
+            {
+                jobSystem.Run([pPool, pAllocators, pLists, i]()
+                {
+                    pAllocators[i] = pPool->AcquireAllocator(ERHICommandListType::Direct);
+                    pLists[i] = pPool->AcquireCommandList(pAllocators[i]);
+                    RecordDraws(pLists[i]);
+                }, &counter);
+            }
+            jobSystem.Wait(counter);
+
+            const uint64_t fence = queue->ExecuteCommandLists(listCount, lists.data());
+            for (uint32_t i = 0; i < listCount; ++i)
+            {
+                pool.ReleaseAllocator(allocators[i], fence);
+                pool.ReleaseCommandList(lists[i], fence);
+            }
+        }
+    });
+    queue->WaitForIdle();
+    const FCommandListPoolStats stats = pool.GetStats();
+
+    // MaxListsPerFrame allocators and lists per frame resource, whether a frame uses them or not;
+    // a frame waits for the frame resource's previous submission before resetting them.
+    std::vector<std::unique_ptr<RHICommandAllocator>> fixedAllocators;
+    std::vector<std::unique_ptr<RHICommandList>> fixedLists;
+    for (uint32_t i = 0; i < FrameResourceCount * MaxListsPerFrame; ++i)
+    {
+        fixedAllocators.push_back(device.CreateCommandAllocator(ERHICommandListType::Direct));
+        fixedLists.push_back(device.CreateCommandList(ERHICommandListType::Direct, fixedAllocators.back().get(), nullptr));
+        fixedLists.back()->Close();
+    }
+    std::vector<uint64_t> frameFences(FrameResourceCount, 0);
+    uint32_t frameResource = 0;
+    const double fixedMs = FBenchContext::MeasureMs([&]
+    {
+        for (uint32_t listCount : listCounts)
+        {
+            queue->WaitForFenceCPUBlocking(frameFences[frameResource]);
+            std::unique_ptr<RHICommandAllocator>* pAllocators = &fixedAllocators[frameResource * MaxListsPerFrame];
+            std::unique_ptr<RHICommandList>* pFixedLists = &fixedLists[frameResource * MaxListsPerFrame];
+            FJobCounter counter;
+            for (uint32_t i = 0; i < listCount; ++i)
+            {
+                jobSystem.Run([pAllocators, pFixedLists, i]()
+                {
+                    pAllocators[i]->Reset();
+                    pFixedLists[i]->Reset(pAllocators[i].get(), nullptr);
+                    RecordDraws(pFixedLists[i].get());
+                }, &counter);
+            }
+            jobSystem.Wait(counter);
+
+            for (uint32_t i = 0; i < listCount; ++i)
+            {
+                lists[i] = pFixedLists[i].get();
+            }
+            frameFences[frameResource] = queue->ExecuteCommandLists(listCount, lists.data());
+            frameResource = (frameResource + 1) % FrameResourceCount;
+        }
+    });
+    queue->WaitForIdle();
+
+    context.Report("frames", frameCount, "");
+    context.Report("lists / frame (average)", static_cast<double>(totalLists) / frameCount, "");
+    context.Report("fixed, allocators", static_cast<double>(fixedAllocators.size()), "");
+    context.Report("fixed", fixedMs * 1e3 / frameCount, "us/frame");
+    context.Report("pool, allocators", stats.AllocatorCount, "");
+    context.Report("pool, command lists", stats.CommandListCount, "");
+    context.Report("pool, allocators reused", 100.0 * stats.AllocatorReuseCount / stats.AllocatorAcquireCount, "%");
+    context.Report("pool", pooledMs * 1e3 / frameCount, "us/frame");
+}
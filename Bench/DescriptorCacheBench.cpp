@@ -0,0 +1,96 @@
+// FDescriptorTableCache over frames of draws that each bind a material's descriptor table, with the
+// simulated GPU two submissions behind. Without the cache every draw copies its table into the
+// shader-visible heap; with it, only the first use of a material (or one evicted since) copies.
+// The Null RHI copies nothing, so the copy counts stand for the work a D3D12 device would do, and are
+// the only figures reported: timing calls that do no work would say nothing about the cache.
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "NullRHI/NullRHI.h"
+#include "Render/DescriptorCache.h"
+
+namespace
+{
+    const uint32_t ViewsPerMaterial = 8;
+    const uint32_t DrawsPerFrame = 2000;
+    const uint32_t LatencyFrames = 2;
+}
+
+MENGINE_BENCHMARK(DescriptorCache_MaterialTables)
+{
+    const uint32_t frameCount = context.Scale(300, 30);
+    const uint32_t materialCount = 4096;
+    // Room for a quarter of the materials' tables: the ones drawn recently stay, the rest are evicted.
+    const uint32_t tableDescriptors = materialCount * ViewsPerMaterial / 4;
+
+    NullRHIDevice device;
+    NullRHICommandQueue* queue = device.GetNullQueue(ERHICommandListType::Direct);
+    queue->SetSimulatedLatency(LatencyFrames);
+    std::unique_ptr<RHICommandAllocator> allocator = device.CreateCommandAllocator(ERHICommandListType::Direct);
+    std::unique_ptr<RHICommandList> list = device.CreateCommandList(ERHICommandListType::Direct, allocator.get(), nullptr);
+    list->Close();
+    RHICommandList* lists[] = { list.get() };
+
+    FDescriptorStagingHeap stagingHeap(&device, ERHIDescriptorHeapType::CbvSrvUav, materialCount * ViewsPerMaterial);
+    std::vector<FBindlessHandle> views(materialCount * ViewsPerMaterial);
+    for (FBindlessHandle& view : views)
+    {
+        view = stagingHeap.Allocate();
+    }
+
+    // Draws favour a working set of materials that drifts from frame to frame.
+    std::vector<std::vector<uint32_t>> frames(frameCount);
+    std::mt19937 random(7);
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+    {
+        std::geometric_distribution<uint32_t> offset(0.004);
+        for (uint32_t draw = 0; draw < DrawsPerFrame; ++draw)
+        {
+            frames[frame].push_back((frame * 4 + offset(random)) % materialCount);
+        }
+    }
+
+    std::unique_ptr<RHIDescriptorHeap> uncachedHeap = device.CreateDescriptorHeap(ERHIDescriptorHeapType::CbvSrvUav, DrawsPerFrame * ViewsPerMaterial, true);
+    std::vector<FRHICpuDescriptor> sources(ViewsPerMaterial);
+    const uint64_t uncachedCopiesBefore = device.GetDescriptorsCopied();
+    for (const std::vector<uint32_t>& draws : frames)
+    {
+        for (uint32_t draw = 0; draw < draws.size(); ++draw)
+        {
+            for (uint32_t i = 0; i < ViewsPerMaterial; ++i)
+            {
+                sources[i] = stagingHeap.GetCpuHandle(views[draws[draw] * ViewsPerMaterial + i]);
+            }
+            device.CopyDescriptors(ViewsPerMaterial, sources.data(), uncachedHeap->GetCpuHandle(draw * ViewsPerMaterial), ERHIDescriptorHeapType::CbvSrvUav);
+        }
+        queue->ExecuteCommandLists(1, lists);
+    }
+    const uint64_t uncachedCopies = device.GetDescriptorsCopied() - uncachedCopiesBefore;
+
+    std::unique_ptr<RHIDescriptorHeap> tableHeap = device.CreateDescriptorHeap(ERHIDescriptorHeapType::CbvSrvUav, tableDescriptors, true);
+    FDescriptorTableCache cache(&device, queue, &stagingHeap, tableHeap.get(), 0, tableDescriptors);
+    const uint64_t cachedCopiesBefore = device.GetDescriptorsCopied();
+    for (const std::vector<uint32_t>& draws : frames)
+    {
+        for (uint32_t material : draws)
+        {
+            cache.GetTable(&views[material * ViewsPerMaterial], ViewsPerMaterial);
+        }
+        cache.OnSubmit(queue->ExecuteCommandLists(1, lists));
+    }
+    const uint64_t cachedCopies = device.GetDescriptorsCopied() - cachedCopiesBefore;
+
+    const FDescriptorTableCacheStats& stats = cache.GetStats();
+    const double drawCount = double(frameCount) * DrawsPerFrame;
+    context.Report("draws / frame", DrawsPerFrame, "");
+    context.Report("tables resident", stats.TableCount, "");
+    context.Report("hit rate", 100.0 * stats.HitCount / (stats.HitCount + stats.MissCount), "%");
+    context.Report("evictions", static_cast<double>(stats.EvictionCount), "");
+    context.Report("copied / frame, per draw", double(uncachedCopies) / frameCount, "descriptors");
+    context.Report("copied / frame, cached", double(cachedCopies) / frameCount, "descriptors");
+    context.Report("copied / draw, per draw", uncachedCopies / drawCount, "descriptors");
+    context.Report("copied / draw, cached", cachedCopies / drawCount, "descriptors");
+}
@@ -0,0 +1,183 @@
+// FDescriptorRing over frames of per-draw descriptor runs, with the simulated GPU two frames behind
+// and now and then a run large enough to force a wrap. Frames are replayed once more against a
+// reference that tracks which frame owns every slot: a run must never take a slot a frame in flight
+// still holds, must start where the ring's head is or wrap to slot 0 when it does not fit before the
+// end, and the used count must be the frames' runs plus the slots their wraps skipped. A run may
+// only be refused when those slots really leave no room for it.
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+#include "Bench.h"
+#include "Render/DescriptorRing.h"
+
+namespace
+{
+    const uint32_t Capacity = 4096;
+    const uint32_t LatencyFrames = 2;
+    const uint32_t RunsPerFrame = 48;
+
+    uint32_t RunSize(uint32_t frame, uint32_t run)
+    {
+        return (frame % 8 == 0 && run == 0) ? 700 : 1 + (frame * 13 + run * 7) % 32;
+    }
+
+    struct FRingMismatches
+    {
+        uint32_t Overlaps = 0;          // Runs taking a slot a frame in flight holds.
+        uint32_t Placements = 0;        // Runs not at the head, or not wrapped when they had to.
+        uint32_t UsedCounts = 0;        // Used counts other than runs plus skipped slots in flight.
+        uint32_t Refusals = 0;          // Runs refused though there was room.
+    };
+
+    // What the ring should do, slot by slot.
+    class FReferenceRing
+    {
+    public:
+        FReferenceRing() : mOwners(Capacity, 0), mHead(0), mUsedCount(0) {}
+
+        // Where a run of count should go and how many slots it skips; false when it does not fit.
+        bool Place(uint32_t count, uint32_t& start, uint32_t& padding) const
+        {
+            start = mHead + count > Capacity ? 0 : mHead;
+            padding = start == 0 && mHead != 0 ? Capacity - mHead : 0;
+            return mUsedCount + padding + count <= Capacity;
+        }
+
+        // Returns how many of the run's slots were still owned.
+        uint32_t Take(uint32_t frame, uint32_t start, uint32_t count, uint32_t padding)
+        {
+            uint32_t overlaps = 0;
+            for (uint32_t slot = start; slot < start + count && slot < Capacity; ++slot)
+            {
+                overlaps += mOwners[slot] != 0 ? 1 : 0;
+                mOwners[slot] = frame;
+            }
+            if (mFrames.empty() || mFrames.back().Frame != frame)
+            {
+                mFrames.push_back({ frame, 0, {} });
+            }
+            mFrames.back().Charge += padding + count;
+            mFrames.back().Runs.push_back({ start, count });
+            mHead = start + count;
+            mUsedCount += padding + count;
+            return overlaps;
+        }
+
+        // Frames are their own fence values.
+        void Release(uint64_t completedFrame)
+        {
+            while (!mFrames.empty() && mFrames.front().Frame <= completedFrame)
+            {
+                for (const FRun& run : mFrames.front().Runs)
+                {
+                    std::fill_n(mOwners.begin() + run.Start, run.Count, 0);
+                }
+                mUsedCount -= mFrames.front().Charge;
+                mFrames.pop_front();
+            }
+            if (mUsedCount == 0)
+            {
+                mHead = 0;
+            }
+        }
+
+        uint32_t GetUsedCount() const { return mUsedCount; }
+
+    private:
+        struct FRun
+        {
+            uint32_t Start;
+            uint32_t Count;
+        };
+
+        struct FFrame
+        {
+            uint32_t Frame;
+            uint32_t Charge;
+            std::vector<FRun> Runs;
+        };
+
+        std::vector<uint32_t> mOwners;      // The frame holding each slot, 0 when free.
+        std::deque<FFrame> mFrames;
+        uint32_t mHead;
+        uint32_t mUsedCount;
+    };
+
+    FRingMismatches CheckFrames(uint32_t frameCount, uint32_t& wrapCount, uint32_t& refusedCount)
+    {
+        FDescriptorRing ring(Capacity);
+        FReferenceRing reference;
+        FRingMismatches mismatches;
+        for (uint32_t frame = 1; frame <= frameCount; ++frame)
+        {
+            const uint64_t completedFrame = frame > LatencyFrames ? frame - LatencyFrames - 1 : 0;
+            ring.ReleaseRetired(completedFrame);
+            reference.Release(completedFrame);
+            mismatches.UsedCounts += ring.GetUsedCount() != reference.GetUsedCount() ? 1 : 0;
+
+            for (uint32_t run = 0; run < RunsPerFrame; ++run)
+            {
+                const uint32_t count = RunSize(frame, run);
+                uint32_t expectedStart = 0;
+                uint32_t padding = 0;
+                const bool fits = reference.Place(count, expectedStart, padding);
+                const uint32_t start = ring.Allocate(count);
+                if (start == FDescriptorRing::Invalid)
+                {
+                    mismatches.Refusals += fits ? 1 : 0;
+                    ++refusedCount;
+                    continue;
+                }
+                mismatches.Placements += !fits || start != expectedStart ? 1 : 0;
+                mismatches.Overlaps += reference.Take(frame, start, count, padding) + (start + count > Capacity ? 1 : 0);
+                wrapCount += padding != 0 ? 1 : 0;
+            }
+            mismatches.UsedCounts += ring.GetUsedCount() != reference.GetUsedCount() ? 1 : 0;
+            ring.EndFrame(frame);
+        }
+
+        // Everything retired: the whole range is free again, from slot 0.
+        ring.ReleaseRetired(frameCount);
+        mismatches.UsedCounts += ring.GetUsedCount() != 0 ? 1 : 0;
+        mismatches.Placements += ring.Allocate(Capacity) != 0 ? 1 : 0;
+        return mismatches;
+    }
+}
+
+MENGINE_BENCHMARK(DescriptorRing_Frames)
+{
+    const uint32_t frameCount = context.Scale(20000, 2000);
+
+    FDescriptorRing ring(Capacity);
+    uint32_t peakUsed = 0;
+    const double ms = FBenchContext::MeasureMs([&]
+    {
+        for (uint32_t frame = 1; frame <= frameCount; ++frame)
+        {
+            ring.ReleaseRetired(frame > LatencyFrames ? frame - LatencyFrames - 1 : 0);
+            for (uint32_t run = 0; run < RunsPerFrame; ++run)
+            {
+                ring.Allocate(RunSize(frame, run));
+            }
+            peakUsed = std::max(peakUsed, ring.GetUsedCount());
+            ring.EndFrame(frame);
+        }
+    });
+
+    uint32_t wrapCount = 0;
+    uint32_t refusedCount = 0;
+    const FRingMismatches mismatches = CheckFrames(frameCount, wrapCount, refusedCount);
+
+    context.Report("capacity", Capacity, "descriptors");
+    context.Report("runs / frame", RunsPerFrame, "");
+    context.Report("peak used", peakUsed, "descriptors");
+    context.Report("wraps", wrapCount, "");
+    context.Report("refused", refusedCount, "");
+    context.Report("per allocation", ms * 1e6 / (double(frameCount) * RunsPerFrame), "ns");
+    context.Check("runs over slots in flight", mismatches.Overlaps);
+    context.Check("runs misplaced", mismatches.Placements);
+    context.Check("used count mismatches", mismatches.UsedCounts);
+    context.Check("runs refused with room", mismatches.Refusals);
+}
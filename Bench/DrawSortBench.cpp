@@ -0,0 +1,85 @@
+// SortDrawItems on a million draws with a realistic spread of pipelines, materials and meshes:
+// the radix sort (single-threaded and on the job system) against std::stable_sort, and how many
+// pipeline and material changes the sorted order leaves compared to submission order.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "Jobs/JobSystem.h"
+#include "Render/DrawSort.h"
+
+namespace
+{
+    uint32_t CountStateChanges(const std::vector<FDrawItem>& items, uint32_t (*getState)(uint64_t))
+    {
+        uint32_t changes = 0;
+        for (size_t i = 1; i < items.size(); ++i)
+        {
+            changes += getState(items[i].Key) != getState(items[i - 1].Key) ? 1 : 0;
+        }
+        return changes;
+    }
+}
+
+MENGINE_BENCHMARK(DrawSort_RadixSort)
+{
+    const uint32_t count = context.Scale(1u << 20, 1u << 16);
+    const uint32_t repeatCount = context.Scale(10, 3);
+
+    std::mt19937 random(7);
+    std::vector<FDrawItem> input(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint32_t pass = random() % 3;
+        const uint32_t pipelineState = random() % 48;
+        const uint32_t material = random() % 2048;
+        const uint32_t mesh = random() % 512;
+        const float depth = std::uniform_real_distribution<float>(1.0f, 1000.0f)(random);
+        input[i].Key = FDrawKey::Make(pass, pipelineState, pipelineState / 8, material, mesh, FDrawKey::QuantizeDepth(depth, 1.0f, 1000.0f, pass == 2));
+        input[i].Index = i;
+    }
+
+    // Every sort starts from a copy of the input; this is what the copy costs.
+    std::vector<FDrawItem> items(count);
+    std::vector<FDrawItem> scratch(count);
+    const double copyMs = FBenchContext::MeasureBestMs(repeatCount, [&] { items = input; });
+    const double radixMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        items = input;
+        SortDrawItems(items.data(), scratch.data(), count);
+    });
+
+    FJobSystem jobSystem;
+    std::vector<FDrawItem> parallelItems(count);
+    const double parallelMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        parallelItems = input;
+        SortDrawItems(parallelItems.data(), scratch.data(), count, &jobSystem);
+    });
+
+    std::vector<FDrawItem> reference(count);
+    const double stdMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        reference = input;
+        std::stable_sort(reference.begin(), reference.end(), [](const FDrawItem& a, const FDrawItem& b) { return a.Key < b.Key; });
+    });
+
+    uint32_t mismatchCount = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        mismatchCount += (items[i].Index != reference[i].Index || parallelItems[i].Index != reference[i].Index) ? 1 : 0;
+    }
+
+    context.Report("draws", count, "");
+    context.Report("job threads", jobSystem.GetThreadCount(), "");
+    context.Report("radix sort", radixMs - copyMs, "ms");
+    context.Report("radix sort (jobs)", parallelMs - copyMs, "ms");
+    context.Report("std::stable_sort", stdMs - copyMs, "ms");
+    context.Check("mismatches", mismatchCount);
+    context.Report("pipeline changes unsorted", CountStateChanges(input, FDrawKey::GetPipelineState), "");
+    context.Report("pipeline changes sorted", CountStateChanges(items, FDrawKey::GetPipelineState), "");
+    context.Report("material changes unsorted", CountStateChanges(input, FDrawKey::GetMaterial), "");
+    context.Report("material changes sorted", CountStateChanges(items, FDrawKey::GetMaterial), "");
+}
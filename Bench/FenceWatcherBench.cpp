@@ -0,0 +1,116 @@
+// Releasing resources the GPU may still read, with the simulated GPU two submissions behind. Every
+// frame replaces ReleasesPerFrame buffers that its submission used. Blocking waits for the frame's
+// fence before destroying them, which on a real GPU drains the queue every frame; deferred hands
+// them to FFenceWatcher, whose thread destroys them once the fence completes. Frames start
+// FrameIntervalMs apart, which leaves the watcher thread time to run. Reports what releasing costs
+// the render thread per frame, its blocking waits, and how many frames later the buffers went.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "NullRHI/NullRHI.h"
+#include "Render/FenceWatcher.h"
+
+namespace
+{
+    const uint32_t LatencyFrames = 2;
+    const uint32_t ReleasesPerFrame = 8;
+    const uint64_t BufferSize = 64 * 1024;
+    const double FrameIntervalMs = 0.5;
+
+    struct FReleaseResult
+    {
+        double ReleaseUsPerFrame = 0.0;     // The render thread's release step.
+        double WaitsPerFrame = 0.0;
+        double LagFrames = 0.0;             // From a frame's submission to its buffers' release.
+        FFenceWatcherStats WatcherStats;
+    };
+
+    FReleaseResult RunFrames(bool deferred, uint32_t frameCount)
+    {
+        NullRHIDevice device;
+        NullRHICommandQueue* queue = device.GetNullQueue(ERHICommandListType::Direct);
+        queue->SetSimulatedLatency(LatencyFrames);
+        std::unique_ptr<RHICommandAllocator> allocator = device.CreateCommandAllocator(ERHICommandListType::Direct);
+        std::unique_ptr<RHICommandList> list = device.CreateCommandList(ERHICommandListType::Direct, allocator.get(), nullptr);
+        list->Close();
+
+        FRHIBufferDesc bufferDesc;
+        bufferDesc.SizeInBytes = BufferSize;
+
+        FReleaseResult result;
+        std::atomic<uint32_t> currentFrame(0);
+        std::atomic<uint64_t> lagFrames(0);
+        std::atomic<uint32_t>* pCurrentFrame = &currentFrame;
+        std::atomic<uint64_t>* pLagFrames = &lagFrames;
+        double releaseMs = 0.0;
+        {
+            FFenceWatcher watcher(&device);
+            for (uint32_t frame = 0; frame < frameCount; ++frame)
+            {
+                const auto frameBegin = std::chrono::steady_clock::now();
+
+                // A draw per buffer stands in for whatever reads them.
+                std::vector<std::unique_ptr<RHIResource>> buffers;
+                list->Reset(allocator.get(), nullptr);
+                for (uint32_t i = 0; i < ReleasesPerFrame; ++i)
+                {
+                    buffers.push_back(device.CreateBuffer(bufferDesc));
+                    list->DrawIndexedInstanced(36, 1, 0, 0, 0);
+                }
+                RHICommandList* pList = list.get();
+                const uint64_t fence = queue->ExecuteCommandLists(1, &pList);
+
+                releaseMs += FBenchContext::MeasureMs([&]
+                {
+                    if (deferred)
+                    {
+                        watcher.DeferRelease(fence, std::move(buffers));
+                        watcher.OnFenceComplete(fence, [pCurrentFrame, pLagFrames, frame]() { *pLagFrames += *pCurrentFrame - frame; });
+                    }
+                    else
+                    {
+                        queue->WaitForFenceCPUBlocking(fence);
+                        buffers.clear();
+                    }
+                });
+                currentFrame = frame + 1;
+
+                const double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameBegin).count();
+                if (frameMs < FrameIntervalMs)
+                {
+                    std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(FrameIntervalMs - frameMs));
+                }
+            }
+            result.WaitsPerFrame = static_cast<double>(queue->GetStats().BlockingWaits) / frameCount;
+            result.WatcherStats = watcher.GetStats();
+            // Destroying the watcher waits for the last LatencyFrames frames, which no later one retires.
+        }
+
+        result.ReleaseUsPerFrame = releaseMs * 1e3 / frameCount;
+        result.LagFrames = deferred ? static_cast<double>(lagFrames.load()) / frameCount : 0.0;
+        return result;
+    }
+}
+
+MENGINE_BENCHMARK(FenceWatcher_DeferredRelease)
+{
+    const uint32_t frameCount = context.Scale(1000, 100);
+
+    const FReleaseResult blocking = RunFrames(false, frameCount);
+    const FReleaseResult deferred = RunFrames(true, frameCount);
+
+    context.Report("frames", frameCount, "");
+    context.Report("buffers released / frame", ReleasesPerFrame, "");
+    context.Report("blocking", blocking.ReleaseUsPerFrame, "us/frame");
+    context.Report("blocking, waits / frame", blocking.WaitsPerFrame, "");
+    context.Report("deferred", deferred.ReleaseUsPerFrame, "us/frame");
+    context.Report("deferred, waits / frame", deferred.WaitsPerFrame, "");
+    context.Report("deferred, release lag", deferred.LagFrames, "frames");
+    context.Report("deferred, watcher wakes / frame", static_cast<double>(deferred.WatcherStats.WakeCount) / frameCount, "");
+    context.Report("deferred, most pending", deferred.WatcherStats.MaxPendingCount, "callbacks");
+}
@@ -0,0 +1,153 @@
+// Frustum culling of a 1024 x 1024 grid of instance boxes: a per-instance scalar test against
+// CullAabbBatch, alone and split into chunks over the job system.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Bench.h"
+#include "Jobs/JobSystem.h"
+#include "Math/FrustumCulling.h"
+#include "Math/TransformBatch.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // The straightforward version: one box at a time, leaving each plane loop early.
+    uint32_t CullScalar(const FAabbArray& boxes, const FFrustum& frustum, uint32_t* pOutVisible)
+    {
+        const float* cx = boxes.GetStream(FAabbArray::CenterX);
+        const float* cy = boxes.GetStream(FAabbArray::CenterY);
+        const float* cz = boxes.GetStream(FAabbArray::CenterZ);
+        const float* ex = boxes.GetStream(FAabbArray::ExtentX);
+        const float* ey = boxes.GetStream(FAabbArray::ExtentY);
+        const float* ez = boxes.GetStream(FAabbArray::ExtentZ);
+
+        uint32_t visibleCount = 0;
+        for (uint32_t i = 0; i < boxes.GetCount(); ++i)
+        {
+            bool visible = true;
+            for (uint32_t p = 0; p < FFrustum::PlaneCount && visible; ++p)
+            {
+                const FVector4& plane = frustum.Planes[p];
+                // Same order of operations as the SIMD kernel, so both agree on boxes touching a plane.
+                float distance = cx[i] * plane.x + plane.w;
+                distance += cy[i] * plane.y;
+                distance += cz[i] * plane.z;
+                distance += ex[i] * std::fabs(plane.x);
+                distance += ey[i] * std::fabs(plane.y);
+                distance += ez[i] * std::fabs(plane.z);
+                visible = distance >= 0.0f;
+            }
+            if (visible)
+            {
+                pOutVisible[visibleCount++] = i;
+            }
+        }
+        return visibleCount;
+    }
+
+    // Chunked like FSceneRenderer::CullCities: every chunk culls into its own slice, then the slices are packed.
+    uint32_t CullParallel(FJobSystem& jobSystem, const FAabbArray& boxes, const FFrustum& frustum, uint32_t* pOutVisible, std::vector<uint32_t>& chunkCounts)
+    {
+        const uint32_t chunkSize = 16384;
+        const uint32_t count = boxes.GetCount();
+        const uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+        chunkCounts.resize(chunkCount);
+        uint32_t* pChunkCounts = chunkCounts.data();
+
+        jobSystem.ParallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end, FJobContext&)
+        {
+            for (uint32_t chunk = begin; chunk < end; ++chunk)
+            {
+                const uint32_t first = chunk * chunkSize;
+                pChunkCounts[chunk] = CullAabbBatch(boxes, first, std::min(first + chunkSize, count), frustum, pOutVisible + first);
+            }
+        });
+
+        uint32_t visibleCount = pChunkCounts[0];
+        for (uint32_t chunk = 1; chunk < chunkCount; ++chunk)
+        {
+            std::memmove(pOutVisible + visibleCount, pOutVisible + chunk * chunkSize, pChunkCounts[chunk] * sizeof(uint32_t));
+            visibleCount += pChunkCounts[chunk];
+        }
+        return visibleCount;
+    }
+
+    // Instances in exactly one of the two sorted lists.
+    uint32_t CountMismatches(const uint32_t* pA, uint32_t countA, const uint32_t* pB, uint32_t countB)
+    {
+        uint32_t mismatches = 0;
+        uint32_t a = 0;
+        uint32_t b = 0;
+        while (a < countA && b < countB)
+        {
+            if (pA[a] == pB[b])
+            {
+                ++a;
+                ++b;
+            }
+            else
+            {
+                ++mismatches;
+                pA[a] < pB[b] ? ++a : ++b;
+            }
+        }
+        return mismatches + (countA - a) + (countB - b);
+    }
+}
+
+MENGINE_BENCHMARK(FrustumCulling_Instances)
+{
+    const uint32_t gridSize = context.Scale(1024, 128);
+    const uint32_t count = gridSize * gridSize;
+    const uint32_t repeatCount = context.Scale(10, 3);
+    const float spacing = 16.0f;
+
+    // The grid of FrameResource::SetCityPositions (without its per-city height offset, which puts most
+    // of a grid this size far above the camera), with a rough city-sized local box.
+    FAffineTransformArray transforms;
+    transforms.Resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        FMatrix4x4 model;
+        XMStoreFloat4x4(&model, XMMatrixTranslation((i % gridSize) * spacing, 0.0f, (i / gridSize) * -spacing));
+        transforms.Set(i, model);
+    }
+    FAabbArray boxes;
+    ComputeWorldAabbs(transforms, FVector3(-6.0f, 0.0f, -6.0f), FVector3(6.0f, 20.0f, 6.0f), boxes);
+
+    // In the middle of the grid looking along it, so part of the grid is in view.
+    const float center = gridSize * spacing * 0.5f;
+    const FSimdMatrix view = XMMatrixLookAtRH(XMVectorSet(center, 40.0f, -center, 1.0f), XMVectorSet(center + 100.0f, 0.0f, -center - 100.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const FSimdMatrix projection = XMMatrixPerspectiveFovRH(0.8f, 16.0f / 9.0f, 1.0f, 1000.0f);
+    const FFrustum frustum = FFrustum::FromViewProjection(view, projection);
+
+    std::vector<uint32_t> reference(count);
+    std::vector<uint32_t> result(count);
+    std::vector<uint32_t> chunkCounts;
+
+    uint32_t referenceCount = 0;
+    uint32_t batchCount = 0;
+    uint32_t parallelCount = 0;
+    const double scalarMs = FBenchContext::MeasureBestMs(repeatCount, [&] { referenceCount = CullScalar(boxes, frustum, reference.data()); });
+    const double batchMs = FBenchContext::MeasureBestMs(repeatCount, [&] { batchCount = CullAabbBatch(boxes, 0, count, frustum, result.data()); });
+    const uint32_t batchMismatches = CountMismatches(reference.data(), referenceCount, result.data(), batchCount);
+
+    FJobSystem jobSystem;
+    const double parallelMs = FBenchContext::MeasureBestMs(repeatCount, [&] { parallelCount = CullParallel(jobSystem, boxes, frustum, result.data(), chunkCounts); });
+    const uint32_t parallelMismatches = CountMismatches(reference.data(), referenceCount, result.data(), parallelCount);
+
+    const double nsPerMs = 1.0e6 / count;
+    context.Report("instances", count, "");
+    context.Report("kernel", GetFrustumCullingKernelName());
+    context.Report("visible", 100.0 * referenceCount / count, "%");
+    context.Report("scalar", scalarMs * nsPerMs, "ns/instance");
+    context.Report("batched", batchMs * nsPerMs, "ns/instance");
+    context.Report("batched, jobs", parallelMs * nsPerMs, "ns/instance");
+    context.Report("speedup (1 thread)", scalarMs / batchMs, "x");
+    context.Report("speedup (jobs)", scalarMs / parallelMs, "x");
+    context.Check("mismatches vs scalar", batchMismatches + parallelMismatches);
+}
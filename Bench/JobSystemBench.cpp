@@ -0,0 +1,146 @@
+// FJobSystem throughput (empty jobs, dependency chains, parallel-for) and latency (submit to start,
+// with the workers awake and asleep).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "Jobs/JobSystem.h"
+
+namespace
+{
+    typedef std::chrono::steady_clock FClock;
+
+    int64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(FClock::now().time_since_epoch()).count();
+    }
+
+    double Percentile(std::vector<double>& samples, double fraction)
+    {
+        std::sort(samples.begin(), samples.end());
+        const size_t index = static_cast<size_t>(fraction * (samples.size() - 1));
+        return samples[index];
+    }
+
+    // Submit a job from the owner thread and measure how long until a worker starts it. The owner
+    // spins instead of calling Wait(), which would run the job itself.
+    std::vector<double> MeasureStartLatencyUs(FJobSystem& jobSystem, uint32_t sampleCount, std::chrono::microseconds idleBeforeSubmit)
+    {
+        std::vector<double> samples;
+        samples.reserve(sampleCount);
+        std::atomic<int64_t> startNs(0);
+        std::atomic<int64_t>* pStartNs = &startNs;
+        for (uint32_t i = 0; i < sampleCount; ++i)
+        {
+            if (idleBeforeSubmit.count() > 0)
+            {
+                std::this_thread::sleep_for(idleBeforeSubmit);
+            }
+
+            startNs.store(0, std::memory_order_relaxed);
+            FJobCounter counter;
+            const int64_t submitNs = NowNs();
+            jobSystem.Run([pStartNs] { pStartNs->store(NowNs(), std::memory_order_release); }, &counter);
+            while (startNs.load(std::memory_order_acquire) == 0)
+            {
+                std::this_thread::yield();
+            }
+            jobSystem.Wait(counter);
+            samples.push_back((startNs.load(std::memory_order_relaxed) - submitNs) / 1000.0);
+        }
+        return samples;
+    }
+}
+
+MENGINE_BENCHMARK(JobSystem_EmptyJobs)
+{
+    FJobSystem jobSystem;
+    const uint32_t jobCount = context.Scale(1000000, 50000);
+
+    FJobCounter counter;
+    const double ms = FBenchContext::MeasureMs([&]
+    {
+        for (uint32_t i = 0; i < jobCount; ++i)
+        {
+            jobSystem.Run([] {}, &counter);
+        }
+        jobSystem.Wait(counter);
+    });
+
+    const FJobSystemStats stats = jobSystem.GetStats();
+    context.Report("threads", jobSystem.GetThreadCount(), "");
+    context.Report("throughput", jobCount / (ms / 1000.0), "jobs/s");
+    context.Report("cost per job", ms * 1.0e6 / jobCount, "ns");
+    context.Report("stolen", 100.0 * stats.JobsStolen / std::max<uint64_t>(stats.JobsExecuted, 1), "%");
+}
+
+MENGINE_BENCHMARK(JobSystem_DependencyChain)
+{
+    // Each job only becomes runnable when the previous one finishes: measures continuation overhead.
+    FJobSystem jobSystem;
+    const uint32_t chainLength = context.Scale(200000, 10000);
+    std::unique_ptr<FJobCounter[]> counters(new FJobCounter[chainLength]);
+
+    const double ms = FBenchContext::MeasureMs([&]
+    {
+        jobSystem.Run([] {}, &counters[0]);
+        for (uint32_t i = 1; i < chainLength; ++i)
+        {
+            jobSystem.RunAfter(counters[i - 1], [] {}, &counters[i]);
+        }
+        jobSystem.Wait(counters[chainLength - 1]);
+    });
+
+    context.Report("cost per link", ms * 1.0e6 / chainLength, "ns");
+}
+
+MENGINE_BENCHMARK(JobSystem_ParallelFor)
+{
+    FJobSystem jobSystem;
+    const uint32_t count = context.Scale(1 << 22, 1 << 18);
+    std::vector<float> values(count);
+    float* pValues = values.data();
+
+    auto kernel = [pValues](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const float x = static_cast<float>(i);
+            pValues[i] = std::sqrt(x) * std::sin(x) + std::cos(x * 0.5f);
+        }
+    };
+
+    const uint32_t repeatCount = context.Scale(10, 3);
+    const double serialMs = FBenchContext::MeasureBestMs(repeatCount, [&] { kernel(0, count); });
+    const double parallelMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        jobSystem.ParallelFor(count, 4096, [&](uint32_t begin, uint32_t end, FJobContext&) { kernel(begin, end); });
+    });
+
+    context.Report("threads", jobSystem.GetThreadCount(), "");
+    context.Report("serial", serialMs, "ms");
+    context.Report("parallel", parallelMs, "ms");
+    context.Report("speedup", serialMs / parallelMs, "x");
+}
+
+MENGINE_BENCHMARK(JobSystem_StartLatency)
+{
+    FJobSystem jobSystem;
+    const uint32_t sampleCount = context.Scale(2000, 200);
+
+    // Back to back: the workers are still spinning from the previous job.
+    std::vector<double> awake = MeasureStartLatencyUs(jobSystem, sampleCount, std::chrono::microseconds(0));
+    context.Report("awake p50", Percentile(awake, 0.5), "us");
+    context.Report("awake p99", Percentile(awake, 0.99), "us");
+
+    // After an idle gap long enough for the workers to go to sleep: includes the wake-up.
+    std::vector<double> asleep = MeasureStartLatencyUs(jobSystem, sampleCount / 10, std::chrono::microseconds(2000));
+    context.Report("asleep p50", Percentile(asleep, 0.5), "us");
+    context.Report("asleep p99", Percentile(asleep, 0.99), "us");
+}
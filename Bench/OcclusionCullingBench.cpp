@@ -0,0 +1,167 @@
+// Occlusion culling of a dense city grid seen from street level: frustum culling, then the nearest
+// cities drawn as occluder boxes into FOcclusionBuffer and the survivors tested against it. The result
+// is checked against a brute-force depth test of every pixel each box covers, which must never find
+// visible a box the buffer culled.
+
+#include <algorithm>
+#include <cfloat>
+#include <utility>
+#include <vector>
+
+#include "Bench.h"
+#include "Math/FrustumCulling.h"
+#include "Math/OcclusionCulling.h"
+#include "Math/TransformBatch.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // The box projected on its own, without FOcclusionBuffer's code, and its nearest depth compared
+    // with every pixel of the full-resolution buffer in its screen rectangle: visible when any of them
+    // is not nearer. Boxes reaching behind the near plane count as visible, as they do for the buffer.
+    bool IsBoxVisibleReference(const FOcclusionBuffer& buffer, const FMatrix4x4& viewProjection, const FVector3& center, const FVector3& extent)
+    {
+        const FSimdMatrix matrix = XMLoadFloat4x4(&viewProjection);
+        float minX = FLT_MAX;
+        float minY = FLT_MAX;
+        float maxX = -FLT_MAX;
+        float maxY = -FLT_MAX;
+        float minZ = FLT_MAX;
+        for (uint32_t corner = 0; corner < 8; ++corner)
+        {
+            const FSimdVector position = XMVectorSet(
+                (corner & 1) ? center.x + extent.x : center.x - extent.x,
+                (corner & 2) ? center.y + extent.y : center.y - extent.y,
+                (corner & 4) ? center.z + extent.z : center.z - extent.z, 1.0f);
+            FVector4 clip;
+            XMStoreFloat4(&clip, XMVector4Transform(position, matrix));
+            if (clip.z < 0.0f || clip.w <= 0.0f)
+            {
+                return true;
+            }
+            minX = std::min(minX, clip.x / clip.w);
+            maxX = std::max(maxX, clip.x / clip.w);
+            minY = std::min(minY, clip.y / clip.w);
+            maxY = std::max(maxY, clip.y / clip.w);
+            minZ = std::min(minZ, clip.z / clip.w);
+        }
+
+        const uint32_t width = buffer.GetWidth();
+        const uint32_t height = buffer.GetHeight();
+        const float left = std::max((minX + 1.0f) * 0.5f * width, 0.0f);
+        const float right = std::min((maxX + 1.0f) * 0.5f * width, float(width - 1));
+        const float top = std::max((1.0f - maxY) * 0.5f * height, 0.0f);
+        const float bottom = std::min((1.0f - minY) * 0.5f * height, float(height - 1));
+        for (uint32_t y = uint32_t(top); top <= bottom && y <= uint32_t(bottom); ++y)
+        {
+            for (uint32_t x = uint32_t(left); left <= right && x <= uint32_t(right); ++x)
+            {
+                if (buffer.GetDepth()[size_t(y) * width + x] >= minZ)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}
+
+MENGINE_BENCHMARK(OcclusionCulling_CityGrid)
+{
+    const uint32_t gridSize = context.Scale(256, 64);
+    const uint32_t count = gridSize * gridSize;
+    const uint32_t repeatCount = context.Scale(20, 5);
+    const uint32_t occluderCount = 32;
+    const float spacing = 16.0f;
+
+    // Cities with 2-unit streets between their bounds, and an occluder box inside each.
+    FAffineTransformArray transforms;
+    transforms.Resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        FMatrix4x4 model;
+        XMStoreFloat4x4(&model, XMMatrixTranslation((i % gridSize) * spacing, 0.0f, (i / gridSize) * -spacing));
+        transforms.Set(i, model);
+    }
+    FAabbArray bounds;
+    FAabbArray occluders;
+    ComputeWorldAabbs(transforms, FVector3(-7.0f, 0.0f, -7.0f), FVector3(7.0f, 24.0f, 7.0f), bounds);
+    ComputeWorldAabbs(transforms, FVector3(-6.0f, 0.0f, -6.0f), FVector3(6.0f, 20.0f, 6.0f), occluders);
+
+    // In a street near one edge at second-floor height, looking down the street: the blocks lining it
+    // hide the grid on both sides, the street itself stays open to the far plane.
+    const FSimdVector eye = XMVectorSet(spacing * 4.5f, 8.0f, -spacing * 4.5f, 1.0f);
+    const FSimdVector focus = XMVectorSet(spacing * 4.5f + 20.0f, 8.0f, -spacing * gridSize, 1.0f);
+    FMatrix4x4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, XMMatrixLookAtRH(eye, focus, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * XMMatrixPerspectiveFovRH(0.8f, 16.0f / 9.0f, 1.0f, 5000.0f));
+    const FFrustum frustum = FFrustum::FromViewProjection(viewProjection);
+
+    std::vector<uint32_t> frustumVisible(count);
+    const uint32_t frustumVisibleCount = CullAabbBatch(bounds, 0, count, frustum, frustumVisible.data());
+
+    // Nearest occluders first, as FSceneRenderer picks them.
+    std::vector<std::pair<float, uint32_t>> candidates;
+    for (uint32_t i = 0; i < frustumVisibleCount; ++i)
+    {
+        const uint32_t city = frustumVisible[i];
+        const float depth = occluders.GetStream(FAabbArray::CenterX)[city] * viewProjection._14 + occluders.GetStream(FAabbArray::CenterY)[city] * viewProjection._24
+            + occluders.GetStream(FAabbArray::CenterZ)[city] * viewProjection._34 + viewProjection._44;
+        candidates.emplace_back(depth, city);
+    }
+    const size_t usedOccluderCount = std::min<size_t>(occluderCount, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + usedOccluderCount, candidates.end());
+
+    FOcclusionBuffer buffer;
+    const double renderMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        buffer.Clear(viewProjection);
+        for (size_t i = 0; i < usedOccluderCount; ++i)
+        {
+            const uint32_t city = candidates[i].second;
+            buffer.RenderOccluderBox(
+                FVector3(occluders.GetStream(FAabbArray::CenterX)[city], occluders.GetStream(FAabbArray::CenterY)[city], occluders.GetStream(FAabbArray::CenterZ)[city]),
+                FVector3(occluders.GetStream(FAabbArray::ExtentX)[city], occluders.GetStream(FAabbArray::ExtentY)[city], occluders.GetStream(FAabbArray::ExtentZ)[city]));
+        }
+        buffer.BuildHierarchy();
+    });
+
+    std::vector<uint32_t> visible;
+    uint32_t visibleCount = 0;
+    const double testMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        visible = frustumVisible;
+        visibleCount = buffer.CullOccludedAabbs(bounds, visible.data(), frustumVisibleCount);
+    });
+
+    // Conservative: every box the reference sees must have been kept.
+    std::vector<bool> kept(count, false);
+    for (uint32_t i = 0; i < visibleCount; ++i)
+    {
+        kept[visible[i]] = true;
+    }
+    uint32_t referenceVisibleCount = 0;
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < frustumVisibleCount; ++i)
+    {
+        const uint32_t city = frustumVisible[i];
+        const bool referenceVisible = IsBoxVisibleReference(buffer, viewProjection,
+            FVector3(bounds.GetStream(FAabbArray::CenterX)[city], bounds.GetStream(FAabbArray::CenterY)[city], bounds.GetStream(FAabbArray::CenterZ)[city]),
+            FVector3(bounds.GetStream(FAabbArray::ExtentX)[city], bounds.GetStream(FAabbArray::ExtentY)[city], bounds.GetStream(FAabbArray::ExtentZ)[city]));
+        referenceVisibleCount += referenceVisible ? 1 : 0;
+        mismatches += referenceVisible && !kept[city] ? 1 : 0;
+    }
+
+    context.Report("instances", count, "");
+    context.Report("kernel", FOcclusionBuffer::GetKernelName());
+    context.Report("buffer pixels", buffer.GetWidth() * buffer.GetHeight(), "");
+    context.Report("in frustum", frustumVisibleCount, "");
+    context.Report("visible after occlusion", visibleCount, "");
+    context.Report("visible, brute force", referenceVisibleCount, "");
+    context.Check("culled but visible vs brute force", mismatches);
+    context.Report("occluded", 100.0 * (frustumVisibleCount - visibleCount) / std::max(frustumVisibleCount, 1u), "%");
+    context.Report("occluders", usedOccluderCount, "");
+    context.Report("rasterized triangles", buffer.GetRasterizedTriangleCount(), "");
+    context.Report("render + hierarchy", renderMs, "ms");
+    context.Report("test", testMs * 1.0e6 / std::max(frustumVisibleCount, 1u), "ns/box");
+}
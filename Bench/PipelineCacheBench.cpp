@@ -0,0 +1,246 @@
+// FPipelineCache while a level streams in new materials, each with its own pipeline, on the Null RHI
+// with a simulated driver compile. Compiling on the render thread stalls the frame that first draws
+// a material; compiling on the job system draws it with a fallback pipeline meanwhile. A second
+// run loads every pipeline from the library the first one saved. The key hash, the entry lookup and
+// the compile and library counts are checked along the way; any mismatch fails the run.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "Jobs/JobSystem.h"
+#include "NullRHI/NullRHI.h"
+#include "Render/PipelineCache.h"
+
+namespace
+{
+    const uint32_t CompileMicroseconds = 2000;
+    const uint32_t NewMaterialsPerFrame = 8;
+    const double FrameIntervalMs = 4.0;
+    const size_t ShaderBytecodeSize = 16 * 1024;
+
+    const FRHIInputElement VertexElements[] =
+    {
+        { "POSITION", 0, ERHIFormat::R32G32B32Float, 0, 0,  ERHIInputClassification::PerVertex, 0 },
+        { "TEXCOORD", 0, ERHIFormat::R32G32Float,    0, 12, ERHIInputClassification::PerVertex, 0 },
+    };
+
+    // One pixel shader per material, as permutations of an uber-shader would be; one vertex shader.
+    struct FMaterialShaders
+    {
+        std::vector<uint8_t> VertexShader;
+        std::vector<std::vector<uint8_t>> PixelShaders;
+        std::vector<FRHIGraphicsPipelineDesc> Descs;
+    };
+
+    void MakeMaterials(uint32_t materialCount, RHIRootSignature* rootSignature, FMaterialShaders& shaders)
+    {
+        shaders.VertexShader.assign(ShaderBytecodeSize, 0x11);
+        shaders.PixelShaders.resize(materialCount);
+        for (uint32_t material = 0; material < materialCount; ++material)
+        {
+            shaders.PixelShaders[material].assign(ShaderBytecodeSize, static_cast<uint8_t>(material));
+            shaders.PixelShaders[material][0] = static_cast<uint8_t>(material >> 8);
+
+            FRHIGraphicsPipelineDesc desc;
+            desc.RootSignature = rootSignature;
+            desc.VS = { shaders.VertexShader.data(), shaders.VertexShader.size() };
+            desc.PS = { shaders.PixelShaders[material].data(), shaders.PixelShaders[material].size() };
+            desc.InputElements = VertexElements;
+            desc.NumInputElements = 2;
+            shaders.Descs.push_back(desc);
+        }
+    }
+
+    // A desc equal to base in storage of its own must hash the same as it; one that differs from it
+    // in bytecode, input layout, root signature or raster state must not.
+    uint32_t CountHashMismatches(const FRHIGraphicsPipelineDesc& base, RHIRootSignature* otherRootSignature)
+    {
+        const uint64_t baseHash = FPipelineCache::HashDesc(base);
+        const uint8_t* pixelShader = static_cast<const uint8_t*>(base.PS.pShaderBytecode);
+        std::vector<uint8_t> pixelShaderCopy(pixelShader, pixelShader + base.PS.BytecodeLength);
+        std::vector<FRHIInputElement> elementsCopy(base.InputElements, base.InputElements + base.NumInputElements);
+        const std::string semanticCopy = elementsCopy[0].SemanticName;
+        elementsCopy[0].SemanticName = semanticCopy.c_str();
+
+        FRHIGraphicsPipelineDesc equal = base;
+        equal.PS = { pixelShaderCopy.data(), pixelShaderCopy.size() };
+        equal.InputElements = elementsCopy.data();
+        uint32_t mismatches = FPipelineCache::HashDesc(equal) != baseHash ? 1 : 0;
+
+        std::vector<FRHIGraphicsPipelineDesc> different;
+        std::vector<uint8_t> otherPixelShader = pixelShaderCopy;
+        otherPixelShader[otherPixelShader.size() / 2] ^= 0xFF;
+        different.push_back(equal);
+        different.back().PS = { otherPixelShader.data(), otherPixelShader.size() };
+        std::vector<FRHIInputElement> otherElements = elementsCopy;
+        otherElements[1].AlignedByteOffset += 4;
+        different.push_back(equal);
+        different.back().InputElements = otherElements.data();
+        different.push_back(equal);
+        different.back().NumInputElements = 1;
+        different.push_back(equal);
+        different.back().RootSignature = otherRootSignature;
+        different.push_back(equal);
+        different.back().CullMode = base.CullMode == ERHICullMode::None ? ERHICullMode::Back : ERHICullMode::None;
+        different.push_back(equal);
+        different.back().DepthWrite = !base.DepthWrite;
+        different.push_back(equal);
+        different.back().BlendEnable = !base.BlendEnable;
+        for (const FRHIGraphicsPipelineDesc& desc : different)
+        {
+            mismatches += FPipelineCache::HashDesc(desc) == baseHash ? 1 : 0;
+        }
+        return mismatches;
+    }
+
+    struct FStreamingResult
+    {
+        double WorstFrameMs = 0.0;
+        double TotalMs = 0.0;
+        uint32_t FrameCount = 0;
+    };
+
+    // Each frame a few more materials are first drawn, and every material so far is drawn once. Frames
+    // start FrameIntervalMs apart, as they would under vsync, unless one runs long.
+    FStreamingResult StreamMaterials(FPipelineCache& cache, const FMaterialShaders& shaders, RHIPipelineState* fallback)
+    {
+        const uint32_t materialCount = static_cast<uint32_t>(shaders.Descs.size());
+        std::vector<FPipelineCacheEntry*> entries;
+        FStreamingResult result;
+        for (bool allReady = false; !allReady; ++result.FrameCount)
+        {
+            const double frameMs = FBenchContext::MeasureMs([&]
+            {
+                const uint32_t newCount = std::min(NewMaterialsPerFrame, materialCount - static_cast<uint32_t>(entries.size()));
+                for (uint32_t i = 0; i < newCount; ++i)
+                {
+                    entries.push_back(cache.Request(shaders.Descs[entries.size()]));
+                }
+                allReady = entries.size() == materialCount;
+                for (FPipelineCacheEntry* entry : entries)
+                {
+                    allReady = (fallback ? cache.Get(entry, fallback) : cache.Wait(entry)) != fallback && allReady;
+                }
+            });
+            result.WorstFrameMs = std::max(result.WorstFrameMs, frameMs);
+            result.TotalMs += frameMs;
+            if (frameMs < FrameIntervalMs)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(FrameIntervalMs - frameMs));
+            }
+        }
+        return result;
+    }
+}
+
+MENGINE_BENCHMARK(PipelineCache_Streaming)
+{
+    const uint32_t materialCount = context.Scale(256, 64);
+    const std::filesystem::path libraryPath = std::filesystem::temp_directory_path() / "MEnginePipelineCacheBench.bin";
+    std::filesystem::remove(libraryPath);
+
+    NullRHIDevice device;
+    device.SetSimulatedPipelineCompileTime(CompileMicroseconds);
+    std::unique_ptr<RHIRootSignature> rootSignature = device.CreateRootSignature(1);
+    std::unique_ptr<RHIPipelineState> fallback = device.CreatePipelineState();
+    FMaterialShaders shaders;
+    MakeMaterials(materialCount, rootSignature.get(), shaders);
+
+    FPipelineCacheDesc blockingDesc;
+    blockingDesc.Device = &device;
+    FPipelineCache blockingCache(blockingDesc);
+    const FStreamingResult blocking = StreamMaterials(blockingCache, shaders, nullptr);
+
+    FJobSystemDesc jobSystemDesc;
+    jobSystemDesc.WorkerThreadCount = 4;
+    FJobSystem jobSystem(jobSystemDesc);
+    FPipelineCacheDesc asyncDesc;
+    asyncDesc.Device = &device;
+    asyncDesc.JobSystem = &jobSystem;
+    asyncDesc.LibraryPath = libraryPath;
+    FStreamingResult async;
+    FPipelineCacheStats asyncStats;
+    uint32_t requestMismatches = 0;
+    {
+        FPipelineCache asyncCache(asyncDesc);
+        async = StreamMaterials(asyncCache, shaders, fallback.get());
+        asyncStats = asyncCache.GetStats();
+        for (const FRHIGraphicsPipelineDesc& desc : shaders.Descs)
+        {
+            FRHIGraphicsPipelineDesc copy = desc;
+            const std::vector<uint8_t> pixelShader(static_cast<const uint8_t*>(desc.PS.pShaderBytecode),
+                static_cast<const uint8_t*>(desc.PS.pShaderBytecode) + desc.PS.BytecodeLength);
+            copy.PS = { pixelShader.data(), pixelShader.size() };
+            requestMismatches += asyncCache.Request(desc) != asyncCache.Request(copy) ? 1 : 0;
+        }
+        requestMismatches += asyncCache.GetStats().PipelineCount != materialCount ? 1 : 0;
+        asyncCache.Save();
+    }
+
+    FStreamingResult warm;
+    FPipelineCacheStats warmStats;
+    {
+        FPipelineCache warmCache(asyncDesc);
+        warm = StreamMaterials(warmCache, shaders, fallback.get());
+        warmStats = warmCache.GetStats();
+    }
+    std::filesystem::remove(libraryPath);
+
+    // A compile far longer than the gap between Request() and Get() must still be pending at Get().
+    uint32_t pendingMismatches = 0;
+    {
+        device.SetSimulatedPipelineCompileTime(100 * 1000);
+        FPipelineCacheDesc pendingDesc;
+        pendingDesc.Device = &device;
+        pendingDesc.JobSystem = &jobSystem;
+        FPipelineCache pendingCache(pendingDesc);
+        FPipelineCacheEntry* entry = pendingCache.Request(shaders.Descs[0]);
+        pendingMismatches += pendingCache.Get(entry, fallback.get()) != fallback.get() ? 1 : 0;
+        RHIPipelineState* pipeline = pendingCache.Wait(entry);
+        pendingMismatches += pipeline == nullptr || pipeline == fallback.get() ? 1 : 0;
+        pendingMismatches += pendingCache.Get(entry, fallback.get()) != pipeline ? 1 : 0;
+    }
+
+    std::unique_ptr<RHIRootSignature> otherRootSignature = device.CreateRootSignature(2);
+    uint32_t hashMismatches = 0;
+    for (const FRHIGraphicsPipelineDesc& desc : shaders.Descs)
+    {
+        hashMismatches += CountHashMismatches(desc, otherRootSignature.get());
+    }
+
+    const uint32_t countMismatches =
+        (blockingCache.GetStats().CompileCount != materialCount ? 1 : 0) +
+        (asyncStats.CompileCount != materialCount ? 1 : 0) +
+        (warmStats.CompileCount != 0 ? 1 : 0) +
+        (warmStats.LibraryLoadCount != materialCount ? 1 : 0);
+
+    uint64_t hashes = 0;
+    const double hashMs = FBenchContext::MeasureBestMs(3, [&]
+    {
+        for (const FRHIGraphicsPipelineDesc& desc : shaders.Descs)
+        {
+            hashes ^= FPipelineCache::HashDesc(desc);
+        }
+    });
+
+    context.Report("materials", materialCount, "");
+    context.Report("compile (simulated)", CompileMicroseconds / 1000.0, "ms");
+    context.Report("blocking, worst frame", blocking.WorstFrameMs, "ms");
+    context.Report("blocking, frames to all ready", blocking.FrameCount, "");
+    context.Report("async, worst frame", async.WorstFrameMs, "ms");
+    context.Report("async, frames to all ready", async.FrameCount, "");
+    context.Report("async, fallback draws", static_cast<double>(asyncStats.FallbackCount), "");
+    context.Report("library, worst frame", warm.WorstFrameMs, "ms");
+    context.Report("library, compiles", static_cast<double>(warmStats.CompileCount), "");
+    context.Report("library, loads", static_cast<double>(warmStats.LibraryLoadCount), "");
+    context.Check("key hash mismatches", hashMismatches);
+    context.Check("request mismatches (equal desc)", requestMismatches);
+    context.Check("compile/load count mismatches", countMismatches);
+    context.Check("get mismatches (compile pending)", pendingMismatches);
+    context.Report("key hash (16 KB + 16 KB shaders)", hashMs * 1e3 / materialCount, "us");
+}
@@ -0,0 +1,292 @@
+// FRenderGraph::Compile on a deferred 1080p frame: G-buffer, SSAO, lighting, a bloom chain, tone
+// mapping into the back buffer, and a debug view nothing reads. Reports how many passes survive,
+// the barriers they need, and how much aliasing saves over giving every transient its own memory.
+// The compiled graph is checked as well: the debug view must be the only pass culled, transients
+// alive at the same time must not share heap memory, and executing the graph twice on the same
+// resources must find every resource where each barrier and pass expects it.
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Bench.h"
+#include "NullRHI/NullRHI.h"
+#include "Render/RenderGraph.h"
+
+namespace
+{
+    const uint32_t Width = 1920;
+    const uint32_t Height = 1080;
+    const uint32_t BloomLevelCount = 6;
+
+    struct FDeclaredAccess
+    {
+        uint32_t Pass;
+        FRenderGraphResource Resource;
+        ERHIResourceState State;
+        bool IsWrite;
+    };
+
+    // What BuildDeferredFrame declared, for the checks.
+    struct FDeferredFrame
+    {
+        std::vector<std::string> Names;
+        std::vector<FRenderGraphResource> Resources;
+        std::vector<uint64_t> Sizes;                // 0 for the imported back buffer.
+        std::vector<FDeclaredAccess> Accesses;
+        uint32_t DebugPass = 0;
+    };
+
+    FRenderGraphTransientDesc Target(const char* name, uint32_t width, uint32_t height, uint32_t bytesPerPixel)
+    {
+        FRenderGraphTransientDesc desc;
+        desc.Name = name;
+        desc.SizeInBytes = uint64_t(width) * height * bytesPerPixel;
+        return desc;
+    }
+
+    void BuildDeferredFrame(FRenderGraph& graph, FDeferredFrame& frame)
+    {
+        graph.Reset();
+        frame.Resources.clear();
+        frame.Sizes.clear();
+        frame.Accesses.clear();
+        auto transient = [&](const FRenderGraphTransientDesc& desc)
+        {
+            frame.Resources.push_back(graph.CreateTransient(desc));
+            frame.Sizes.push_back(desc.SizeInBytes);
+            return frame.Resources.back();
+        };
+        auto read = [&](uint32_t pass, FRenderGraphResource resource, ERHIResourceState state)
+        {
+            graph.Read(pass, resource, state);
+            frame.Accesses.push_back({ pass, resource, state, false });
+        };
+        auto write = [&](uint32_t pass, FRenderGraphResource resource, ERHIResourceState state)
+        {
+            graph.Write(pass, resource, state);
+            frame.Accesses.push_back({ pass, resource, state, true });
+        };
+
+        const FRenderGraphResource backBuffer = graph.ImportResource("Back buffer", RHI_STATE_PRESENT, RHI_STATE_PRESENT);
+        frame.Resources.push_back(backBuffer);
+        frame.Sizes.push_back(0);
+        const FRenderGraphResource albedo = transient(Target("Albedo", Width, Height, 4));
+        const FRenderGraphResource normals = transient(Target("Normals", Width, Height, 8));
+        const FRenderGraphResource material = transient(Target("Material", Width, Height, 4));
+        const FRenderGraphResource depth = transient(Target("Depth", Width, Height, 4));
+        const FRenderGraphResource ao = transient(Target("AO", Width / 2, Height / 2, 1));
+        const FRenderGraphResource aoBlurred = transient(Target("AO blurred", Width / 2, Height / 2, 1));
+        const FRenderGraphResource hdr = transient(Target("HDR", Width, Height, 8));
+        const FRenderGraphResource debugView = transient(Target("Debug view", Width, Height, 4));
+
+        const uint32_t gbuffer = graph.AddPass("G-buffer");
+        write(gbuffer, albedo, RHI_STATE_RENDER_TARGET);
+        write(gbuffer, normals, RHI_STATE_RENDER_TARGET);
+        write(gbuffer, material, RHI_STATE_RENDER_TARGET);
+        write(gbuffer, depth, RHI_STATE_DEPTH_WRITE);
+
+        const uint32_t ssao = graph.AddPass("SSAO");
+        read(ssao, depth, RHI_STATE_NON_PIXEL_SHADER_RESOURCE);
+        read(ssao, normals, RHI_STATE_NON_PIXEL_SHADER_RESOURCE);
+        write(ssao, ao, RHI_STATE_UNORDERED_ACCESS);
+
+        const uint32_t ssaoBlur = graph.AddPass("SSAO blur");
+        read(ssaoBlur, ao, RHI_STATE_NON_PIXEL_SHADER_RESOURCE);
+        write(ssaoBlur, aoBlurred, RHI_STATE_UNORDERED_ACCESS);
+
+        const uint32_t lighting = graph.AddPass("Lighting");
+        read(lighting, albedo, RHI_STATE_PIXEL_SHADER_RESOURCE);
+        read(lighting, normals, RHI_STATE_PIXEL_SHADER_RESOURCE);
+        read(lighting, material, RHI_STATE_PIXEL_SHADER_RESOURCE);
+        read(lighting, depth, RHI_STATE_PIXEL_SHADER_RESOURCE);
+        read(lighting, aoBlurred, RHI_STATE_PIXEL_SHADER_RESOURCE);
+        write(lighting, hdr, RHI_STATE_RENDER_TARGET);
+
+        // Downsample chain, then back up, each level read by the next.
+        frame.Names.clear();
+        frame.Names.reserve(BloomLevelCount * 2);
+        std::vector<FRenderGraphResource> down;
+        FRenderGraphResource source = hdr;
+        for (uint32_t level = 0; level < BloomLevelCount; ++level)
+        {
+            frame.Names.push_back("Bloom down " + std::to_string(level));
+            const FRenderGraphResource target = transient(Target(frame.Names.back().c_str(), Width >> (level + 1), Height >> (level + 1), 8));
+            const uint32_t pass = graph.AddPass(frame.Names.back().c_str());
+            read(pass, source, RHI_STATE_PIXEL_SHADER_RESOURCE);
+            write(pass, target, RHI_STATE_RENDER_TARGET);
+            down.push_back(target);
+            source = target;
+        }
+        for (uint32_t level = BloomLevelCount - 1; level > 0; --level)
+        {
+            frame.Names.push_back("Bloom up " + std::to_string(level));
+            const FRenderGraphResource target = transient(Target(frame.Names.back().c_str(), Width >> level, Height >> level, 8));
+            const uint32_t pass = graph.AddPass(frame.Names.back().c_str());
+            read(pass, source, RHI_STATE_PIXEL_SHADER_RESOURCE);
+            read(pass, down[level - 1], RHI_STATE_PIXEL_SHADER_RESOURCE);
+            write(pass, target, RHI_STATE_RENDER_TARGET);
+            source = target;
+        }
+
+        const uint32_t tonemap = graph.AddPass("Tone map");
+        read(tonemap, hdr, RHI_STATE_PIXEL_SHADER_RESOURCE);
+        read(tonemap, source, RHI_STATE_PIXEL_SHADER_RESOURCE);
+        write(tonemap, backBuffer, RHI_STATE_RENDER_TARGET);
+
+        // Left enabled by mistake: nothing reads it, so the graph drops it.
+        frame.DebugPass = graph.AddPass("Debug normals");
+        read(frame.DebugPass, normals, RHI_STATE_PIXEL_SHADER_RESOURCE);
+        write(frame.DebugPass, debugView, RHI_STATE_RENDER_TARGET);
+    }
+
+    // Follows the state of every resource through the barriers recorded into it, and counts the
+    // transitions whose before state is not the one the resource is in.
+    class FStateCheckList : public NullRHICommandList
+    {
+    public:
+        FStateCheckList() : NullRHICommandList(ERHICommandListType::Direct, nullptr, nullptr), mMismatchCount(0) {}
+
+        void ResourceBarrier(uint32_t numBarriers, const FRHIResourceBarrier* barriers) override
+        {
+            for (uint32_t i = 0; i < numBarriers; ++i)
+            {
+                if (barriers[i].Type == ERHIBarrierType::Transition)
+                {
+                    ERHIResourceState& state = mStates[barriers[i].Resource];
+                    mMismatchCount += state != barriers[i].StateBefore ? 1 : 0;
+                    state = barriers[i].StateAfter;
+                }
+            }
+            NullRHICommandList::ResourceBarrier(numBarriers, barriers);
+        }
+
+        void SetState(RHIResource* resource, ERHIResourceState state) { mStates[resource] = state; }
+        ERHIResourceState GetState(RHIResource* resource) { return mStates[resource]; }
+        uint32_t GetMismatchCount() const { return mMismatchCount; }
+
+    private:
+        std::unordered_map<RHIResource*, ERHIResourceState> mStates;
+        uint32_t mMismatchCount;
+    };
+
+    // Transients placed outside the heap, and pairs whose kept-pass lifetimes overlap but whose heap
+    // ranges do too.
+    uint32_t CountAliasingMismatches(const FRenderGraph& graph, const FDeferredFrame& frame)
+    {
+        auto isPlaced = [&](size_t i) { return frame.Sizes[i] != 0 && graph.GetFirstPass(frame.Resources[i]) != FRenderGraph::Invalid; };
+
+        uint32_t mismatches = 0;
+        for (size_t a = 0; a < frame.Resources.size(); ++a)
+        {
+            if (!isPlaced(a))
+            {
+                continue;
+            }
+            const FRenderGraphResource ra = frame.Resources[a];
+            const uint64_t offsetA = graph.GetTransientOffset(ra);
+            mismatches += offsetA + frame.Sizes[a] > graph.GetTransientHeapSize() ? 1 : 0;
+            for (size_t b = a + 1; b < frame.Resources.size(); ++b)
+            {
+                if (!isPlaced(b))
+                {
+                    continue;
+                }
+                const FRenderGraphResource rb = frame.Resources[b];
+                const uint64_t offsetB = graph.GetTransientOffset(rb);
+                const bool livesOverlap = graph.GetFirstPass(ra) <= graph.GetLastPass(rb) && graph.GetFirstPass(rb) <= graph.GetLastPass(ra);
+                const bool memoryOverlaps = offsetA < offsetB + frame.Sizes[b] && offsetB < offsetA + frame.Sizes[a];
+                mismatches += livesOverlap && memoryOverlaps ? 1 : 0;
+            }
+        }
+        return mismatches;
+    }
+
+    // Executes the graph frameCount times on the same resources, checking each barrier's before state,
+    // each kept pass's declared states when it runs, and where every resource ends the frame.
+    uint32_t CountStateMismatches(FRenderGraph& graph, const FDeferredFrame& frame, uint32_t frameCount)
+    {
+        NullRHIDevice device;
+        FRHIBufferDesc bufferDesc;
+        bufferDesc.SizeInBytes = 256;
+        std::vector<std::unique_ptr<RHIResource>> resources;
+        FStateCheckList list;
+        for (size_t i = 0; i < frame.Resources.size(); ++i)
+        {
+            resources.push_back(device.CreateBuffer(bufferDesc));
+            graph.SetResource(frame.Resources[i], resources.back().get());
+            list.SetState(resources.back().get(), frame.Sizes[i] == 0 ? RHI_STATE_PRESENT : graph.GetTransientInitialState(frame.Resources[i]));
+        }
+
+        uint32_t mismatches = 0;
+        for (uint32_t frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+        {
+            for (uint32_t pass = 0; pass < graph.GetPassCount(); ++pass)
+            {
+                if (graph.IsPassCulled(pass))
+                {
+                    continue;
+                }
+                graph.EmitPassBarriers(pass, &list);
+                for (const FDeclaredAccess& access : frame.Accesses)
+                {
+                    if (access.Pass == pass)
+                    {
+                        const ERHIResourceState state = list.GetState(resources[access.Resource.Index].get());
+                        mismatches += (access.IsWrite ? state != access.State : (state & access.State) != access.State) ? 1 : 0;
+                    }
+                }
+            }
+            graph.EmitFinalBarriers(&list);
+
+            for (size_t i = 0; i < frame.Resources.size(); ++i)
+            {
+                const ERHIResourceState expected = frame.Sizes[i] == 0 ? RHI_STATE_PRESENT : graph.GetTransientInitialState(frame.Resources[i]);
+                mismatches += graph.GetFirstPass(frame.Resources[i]) != FRenderGraph::Invalid && list.GetState(resources[i].get()) != expected ? 1 : 0;
+            }
+        }
+        return mismatches + list.GetMismatchCount();
+    }
+}
+
+MENGINE_BENCHMARK(RenderGraph_DeferredFrame)
+{
+    const uint32_t repeatCount = context.Scale(2000, 200);
+
+    FRenderGraph graph;
+    FDeferredFrame frame;
+    const double buildMs = FBenchContext::MeasureBestMs(repeatCount, [&] { BuildDeferredFrame(graph, frame); });
+    const double compileMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        BuildDeferredFrame(graph, frame);
+        graph.Compile();
+    });
+
+    const FRenderGraphStats& stats = graph.GetStats();
+    std::string culled;
+    uint32_t cullMismatches = 0;
+    for (uint32_t pass = 0; pass < graph.GetPassCount(); ++pass)
+    {
+        if (graph.IsPassCulled(pass))
+        {
+            culled += culled.empty() ? graph.GetPassName(pass) : std::string(", ") + graph.GetPassName(pass);
+        }
+        cullMismatches += graph.IsPassCulled(pass) != (pass == frame.DebugPass) ? 1 : 0;
+    }
+
+    context.Report("passes", stats.PassCount, "");
+    context.Report("culled", culled.c_str());
+    context.Report("barriers", stats.BarrierCount, "");
+    context.Report("barrier batches", stats.BarrierBatchCount, "");
+    context.Report("transients", stats.TransientCount, "");
+    context.Report("transient memory", stats.TransientBytes / (1024.0 * 1024.0), "MB");
+    context.Report("aliased heap", stats.TransientHeapBytes / (1024.0 * 1024.0), "MB");
+    context.Report("build + compile", compileMs * 1000.0, "us");
+    context.Report("compile", (compileMs - buildMs) * 1000.0, "us");
+    context.Check("culling mismatches", cullMismatches);
+    context.Check("aliasing mismatches", CountAliasingMismatches(graph, frame));
+    context.Check("state mismatches over 2 frames", CountStateMismatches(graph, frame, 2));
+}
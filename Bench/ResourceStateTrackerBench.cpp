@@ -0,0 +1,400 @@
+// RHIResourceStateTracker on a frame of 4096 render and compute passes recorded into four lists,
+// each pass reading what recent passes wrote. The baseline is what code without state tracking does:
+// transition every resource it uses out of COMMON before the pass and back after it, one barrier per
+// call. Reports the barriers and ResourceBarrier calls each way and the tracker's recording cost.
+//
+// The tracked frame is checked by replaying its barriers in submission order, once with folding
+// only and once with split transitions begun two passes ahead of the reads that need them: every
+// barrier must start from the state the resource is in, every pass must find its resources in the
+// states it asked for, and the usage states left by ResolvePendingBarriers() must be where the
+// frame leaves the resources. A list that ends inside a split must be refused at submission.
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "Bench.h"
+#include "NullRHI/NullRHI.h"
+#include "RHIResourceStateTracker.h"
+
+namespace
+{
+    const uint32_t ResourceCount = 128;
+    const uint32_t ListCount = 4;
+
+    struct FUse
+    {
+        uint32_t Resource;
+        ERHIResourceState State;
+    };
+
+    struct FPass
+    {
+        uint32_t FirstUse;
+        uint32_t UseCount;
+    };
+
+    void BuildPasses(uint32_t passCount, std::vector<FPass>& passes, std::vector<FUse>& uses)
+    {
+        std::mt19937 random(11);
+        std::vector<uint32_t> recentWrites;
+        for (uint32_t pass = 0; pass < passCount; ++pass)
+        {
+            const uint32_t firstUse = static_cast<uint32_t>(uses.size());
+            const uint32_t readCount = recentWrites.empty() ? 0 : 2 + random() % 3;
+            for (uint32_t i = 0; i < readCount; ++i)
+            {
+                const uint32_t resource = recentWrites[recentWrites.size() - 1 - random() % std::min<size_t>(recentWrites.size(), 16)];
+                uses.push_back({ resource, random() % 4 == 0 ? RHI_STATE_NON_PIXEL_SHADER_RESOURCE : RHI_STATE_PIXEL_SHADER_RESOURCE });
+            }
+            const uint32_t writeCount = 1 + random() % 2;
+            for (uint32_t i = 0; i < writeCount; ++i)
+            {
+                const uint32_t resource = random() % ResourceCount;
+                uses.push_back({ resource, random() % 4 == 0 ? RHI_STATE_UNORDERED_ACCESS : RHI_STATE_RENDER_TARGET });
+                recentWrites.push_back(resource);
+            }
+            passes.push_back({ firstUse, static_cast<uint32_t>(uses.size()) - firstUse });
+        }
+    }
+
+    // Keeps the barriers recorded into it, and where each pass's work went, for FReplay.
+    class FReplayList : public NullRHICommandList
+    {
+    public:
+        struct FEvent
+        {
+            uint32_t Pass;                  // ~0u for a barrier.
+            FRHIResourceBarrier Barrier;
+        };
+
+        FReplayList() : NullRHICommandList(ERHICommandListType::Direct, nullptr, nullptr) {}
+
+        void ResourceBarrier(uint32_t numBarriers, const FRHIResourceBarrier* barriers) override
+        {
+            for (uint32_t i = 0; i < numBarriers; ++i)
+            {
+                mEvents.push_back({ ~0u, barriers[i] });
+            }
+            NullRHICommandList::ResourceBarrier(numBarriers, barriers);
+        }
+
+        void MarkPass(uint32_t pass) { mEvents.push_back({ pass, FRHIResourceBarrier() }); }
+        const std::vector<FEvent>& GetEvents() const { return mEvents; }
+
+    private:
+        std::vector<FEvent> mEvents;
+    };
+
+    // Follows each resource's state through replayed barriers, as the GPU would.
+    class FReplay
+    {
+    public:
+        uint32_t BarrierMismatches = 0;     // Transitions from a state the resource is not in.
+        uint32_t PassMismatches = 0;        // Uses of a resource not in the requested state, or mid-split.
+
+        void SetState(RHIResource* resource, ERHIResourceState state) { mStates[resource] = { state, false }; }
+
+        void Barrier(const FRHIResourceBarrier& barrier)
+        {
+            if (barrier.Type != ERHIBarrierType::Transition)
+            {
+                return;
+            }
+            FState& state = mStates[barrier.Resource];
+            const bool isEnd = barrier.Flags == ERHIBarrierFlags::EndOnly;
+            BarrierMismatches += state.State != barrier.StateBefore || state.Splitting != isEnd ? 1 : 0;
+            state.Splitting = barrier.Flags == ERHIBarrierFlags::BeginOnly;
+            state.State = state.Splitting ? barrier.StateBefore : barrier.StateAfter;
+        }
+
+        void Use(RHIResource* resource, ERHIResourceState requested, bool isWrite)
+        {
+            const FState& state = mStates[resource];
+            const bool covered = isWrite ? state.State == requested : (state.State & requested) == requested;
+            PassMismatches += state.Splitting || !covered ? 1 : 0;
+        }
+
+        bool IsInState(RHIResource* resource, ERHIResourceState state) { return !mStates[resource].Splitting && mStates[resource].State == state; }
+
+    private:
+        struct FState
+        {
+            ERHIResourceState State;
+            bool Splitting;
+        };
+
+        std::unordered_map<RHIResource*, FState> mStates;
+    };
+
+    bool IsWriteState(ERHIResourceState state)
+    {
+        return state == RHI_STATE_RENDER_TARGET || state == RHI_STATE_UNORDERED_ACCESS;
+    }
+
+    struct FReplayResult
+    {
+        uint32_t BarrierMismatches = 0;
+        uint32_t PassMismatches = 0;
+        uint32_t UsageStateMismatches = 0;
+        uint32_t SplitCount = 0;
+    };
+
+    // Records the frame with a tracker per list as the timed run does, beginning split transitions for
+    // the reads two passes ahead in the same list when splitAhead is set, resolves it, and replays it.
+    FReplayResult ReplayFrame(NullRHIDevice& device, const std::vector<FPass>& passes, const std::vector<FUse>& uses, bool splitAhead)
+    {
+        std::vector<std::unique_ptr<RHIResource>> resources;
+        for (uint32_t i = 0; i < ResourceCount; ++i)
+        {
+            FRHIBufferDesc desc;
+            desc.SizeInBytes = 64 * 1024;
+            resources.push_back(device.CreateBuffer(desc));
+            resources.back()->SetUsageState(RHI_STATE_COMMON);
+        }
+
+        const uint32_t passCount = static_cast<uint32_t>(passes.size());
+        FReplayList lists[ListCount];
+        RHIResourceStateTracker trackers[ListCount];
+        for (uint32_t i = 0; i < ListCount; ++i)
+        {
+            trackers[i].Reset(i == 0);
+        }
+        for (uint32_t pass = 0; pass < passCount; ++pass)
+        {
+            const uint32_t listIndex = pass * ListCount / passCount;
+            RHIResourceStateTracker& tracker = trackers[listIndex];
+            const FUse* passUses = uses.data() + passes[pass].FirstUse;
+            for (uint32_t i = 0; i < passes[pass].UseCount; ++i)
+            {
+                tracker.TransitionResource(resources[passUses[i].Resource].get(), passUses[i].State);
+            }
+            tracker.FlushBarriers(&lists[listIndex]);
+            lists[listIndex].MarkPass(pass);
+
+            const uint32_t aheadPass = pass + 2;
+            if (splitAhead && aheadPass < passCount && aheadPass * ListCount / passCount == listIndex)
+            {
+                const FUse* aheadUses = uses.data() + passes[aheadPass].FirstUse;
+                for (uint32_t i = 0; i < passes[aheadPass].UseCount; ++i)
+                {
+                    if (!IsWriteState(aheadUses[i].State))
+                    {
+                        tracker.BeginTransition(resources[aheadUses[i].Resource].get(), aheadUses[i].State);
+                    }
+                }
+            }
+        }
+        // Submission: each list's first uses resolved at the end of the list before it.
+        for (uint32_t i = 0; i < ListCount; ++i)
+        {
+            std::vector<FRHIResourceBarrier> pendingBarriers;
+            trackers[i].ResolvePendingBarriers(pendingBarriers);
+            if (!pendingBarriers.empty())
+            {
+                lists[i - 1].ResourceBarrier(static_cast<uint32_t>(pendingBarriers.size()), pendingBarriers.data());
+            }
+        }
+
+        FReplayResult result;
+        FReplay replay;
+        for (const std::unique_ptr<RHIResource>& resource : resources)
+        {
+            replay.SetState(resource.get(), RHI_STATE_COMMON);
+        }
+        for (const FReplayList& list : lists)
+        {
+            for (const FReplayList::FEvent& event : list.GetEvents())
+            {
+                if (event.Pass == ~0u)
+                {
+                    replay.Barrier(event.Barrier);
+                    result.SplitCount += event.Barrier.Flags == ERHIBarrierFlags::BeginOnly ? 1 : 0;
+                    continue;
+                }
+                // A pass that asks for a resource twice gets the state it asked for last.
+                const FUse* passUses = uses.data() + passes[event.Pass].FirstUse;
+                const uint32_t useCount = passes[event.Pass].UseCount;
+                for (uint32_t i = 0; i < useCount; ++i)
+                {
+                    const auto isLastUse = [&](const FUse& later) { return later.Resource != passUses[i].Resource; };
+                    if (!std::all_of(passUses + i + 1, passUses + useCount, isLastUse))
+                    {
+                        continue;
+                    }
+                    replay.Use(resources[passUses[i].Resource].get(), passUses[i].State, IsWriteState(passUses[i].State));
+                }
+            }
+        }
+        for (const std::unique_ptr<RHIResource>& resource : resources)
+        {
+            result.UsageStateMismatches += replay.IsInState(resource.get(), resource->GetUsageState()) ? 0 : 1;
+        }
+        result.BarrierMismatches = replay.BarrierMismatches;
+        result.PassMismatches = replay.PassMismatches;
+        return result;
+    }
+
+    // A list that begins a split and ends without ending it must be refused at submission.
+    uint32_t CountUnendedSplitsAccepted(NullRHIDevice& device)
+    {
+        FRHIBufferDesc desc;
+        desc.SizeInBytes = 64 * 1024;
+        std::unique_ptr<RHIResource> resource = device.CreateBuffer(desc);
+        resource->SetUsageState(RHI_STATE_COMMON);
+
+        FReplayList list;
+        RHIResourceStateTracker tracker;
+        tracker.Reset(true);
+        tracker.TransitionResource(resource.get(), RHI_STATE_RENDER_TARGET);
+        tracker.FlushBarriers(&list);
+        tracker.BeginTransition(resource.get(), RHI_STATE_PIXEL_SHADER_RESOURCE);
+        tracker.FlushBarriers(&list);
+
+        std::vector<FRHIResourceBarrier> pendingBarriers;
+        try
+        {
+            tracker.ResolvePendingBarriers(pendingBarriers);
+        }
+        catch (const std::runtime_error&)
+        {
+            return resource->GetUsageState() == RHI_STATE_COMMON ? 0 : 1;
+        }
+        return 1;
+    }
+}
+
+MENGINE_BENCHMARK(ResourceStateTracker_Frame)
+{
+    const uint32_t passCount = context.Scale(4096, 512);
+    const uint32_t repeatCount = context.Scale(50, 5);
+
+    std::vector<FPass> passes;
+    std::vector<FUse> uses;
+    BuildPasses(passCount, passes, uses);
+
+    NullRHIDevice device;
+    std::vector<std::unique_ptr<RHIResource>> resources;
+    for (uint32_t i = 0; i < ResourceCount; ++i)
+    {
+        FRHIBufferDesc desc;
+        desc.SizeInBytes = 64 * 1024;
+        resources.push_back(device.CreateBuffer(desc));
+    }
+    std::unique_ptr<RHICommandAllocator> allocators[ListCount];
+    std::unique_ptr<RHICommandList> lists[ListCount];
+    RHIResourceStateTracker trackers[ListCount];
+    for (uint32_t i = 0; i < ListCount; ++i)
+    {
+        allocators[i] = device.CreateCommandAllocator(ERHICommandListType::Direct);
+        lists[i] = device.CreateCommandList(ERHICommandListType::Direct, allocators[i].get(), nullptr);
+    }
+
+    auto resetLists = [&]
+    {
+        for (uint32_t i = 0; i < ListCount; ++i)
+        {
+            lists[i]->Close();
+            lists[i]->Reset(allocators[i].get(), nullptr);
+        }
+        for (const std::unique_ptr<RHIResource>& resource : resources)
+        {
+            resource->SetUsageState(RHI_STATE_COMMON);
+        }
+    };
+
+    const double naiveMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        resetLists();
+        for (uint32_t pass = 0; pass < passCount; ++pass)
+        {
+            RHICommandList* list = lists[pass * ListCount / passCount].get();
+            const FUse* passUses = uses.data() + passes[pass].FirstUse;
+            for (uint32_t i = 0; i < passes[pass].UseCount; ++i)
+            {
+                list->TransitionResource(resources[passUses[i].Resource].get(), RHI_STATE_COMMON, passUses[i].State);
+            }
+            for (uint32_t i = 0; i < passes[pass].UseCount; ++i)
+            {
+                list->TransitionResource(resources[passUses[i].Resource].get(), passUses[i].State, RHI_STATE_COMMON);
+            }
+        }
+    });
+    uint32_t naiveBarrierCount = 0;
+    for (uint32_t i = 0; i < ListCount; ++i)
+    {
+        naiveBarrierCount += static_cast<NullRHICommandList*>(lists[i].get())->GetCommandCount(ENullRHICommand::TransitionResource);
+    }
+
+    uint32_t fixupCount = 0;
+    std::vector<FRHIResourceBarrier> pendingBarriers;
+    const double trackedMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        resetLists();
+        for (uint32_t i = 0; i < ListCount; ++i)
+        {
+            // Only the first list is recorded after everything before it was submitted.
+            trackers[i].Reset(i == 0);
+        }
+        for (uint32_t pass = 0; pass < passCount; ++pass)
+        {
+            const uint32_t listIndex = pass * ListCount / passCount;
+            RHIResourceStateTracker& tracker = trackers[listIndex];
+            const FUse* passUses = uses.data() + passes[pass].FirstUse;
+            for (uint32_t i = 0; i < passes[pass].UseCount; ++i)
+            {
+                tracker.TransitionResource(resources[passUses[i].Resource].get(), passUses[i].State);
+            }
+            tracker.FlushBarriers(lists[listIndex].get());
+        }
+
+        // Submission, in list order; each list's first uses are resolved at the end of the list
+        // before it (the first list started from the usage states and has none).
+        fixupCount = 0;
+        for (uint32_t i = 0; i < ListCount; ++i)
+        {
+            pendingBarriers.clear();
+            trackers[i].ResolvePendingBarriers(pendingBarriers);
+            if (!pendingBarriers.empty())
+            {
+                lists[i - 1]->ResourceBarrier(static_cast<uint32_t>(pendingBarriers.size()), pendingBarriers.data());
+                fixupCount += static_cast<uint32_t>(pendingBarriers.size());
+            }
+        }
+    });
+
+    uint32_t requestCount = 0;
+    uint32_t skippedCount = 0;
+    uint32_t trackedBarrierCount = 0;
+    uint32_t trackedCallCount = 0;
+    for (uint32_t i = 0; i < ListCount; ++i)
+    {
+        const NullRHICommandList* list = static_cast<NullRHICommandList*>(lists[i].get());
+        requestCount += trackers[i].GetRequestCount();
+        skippedCount += trackers[i].GetSkippedCount();
+        trackedBarrierCount += list->GetBarrierCount();
+        trackedCallCount += list->GetCommandCount(ENullRHICommand::ResourceBarrier);
+    }
+
+    context.Report("passes", passCount, "");
+    context.Report("state requests", requestCount, "");
+    context.Report("barriers untracked", naiveBarrierCount, "");
+    context.Report("barrier calls untracked", naiveBarrierCount, "");
+    context.Report("barriers tracked", trackedBarrierCount, "");
+    context.Report("barrier calls tracked", trackedCallCount, "");
+    context.Report("redundant requests skipped", skippedCount, "");
+    context.Report("resolved at submission", fixupCount, "");
+    context.Report("record untracked", naiveMs * 1000.0, "us");
+    context.Report("record tracked", trackedMs * 1000.0, "us");
+    context.Report("record tracked per request", trackedMs * 1e6 / requestCount, "ns");
+
+    const FReplayResult folded = ReplayFrame(device, passes, uses, false);
+    const FReplayResult split = ReplayFrame(device, passes, uses, true);
+    context.Report("split transitions (checked run)", split.SplitCount, "");
+    context.Check("barrier state mismatches", folded.BarrierMismatches + split.BarrierMismatches);
+    context.Check("pass state mismatches", folded.PassMismatches + split.PassMismatches);
+    context.Check("usage state mismatches", folded.UsageStateMismatches + split.UsageStateMismatches);
+    context.Check("unended split accepted", CountUnendedSplitsAccepted(device));
+}
@@ -0,0 +1,81 @@
+// FSamplerCache under material loads running on several threads, each material asking for one of a
+// handful of sampler descriptions. Creating a sampler per material would need one descriptor each,
+// past the 2048 a shader-visible sampler heap can hold; the cache creates each distinct one once.
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "NullRHI/NullRHI.h"
+#include "Render/SamplerCache.h"
+
+namespace
+{
+    // Filter x address mode x anisotropy: the variety a material library actually uses.
+    std::vector<FRHISamplerDesc> MakeSamplerDescs()
+    {
+        const ERHIFilter filters[] = { ERHIFilter::MinMagMipLinear, ERHIFilter::MinMagMipPoint, ERHIFilter::Anisotropic };
+        const ERHITextureAddressMode addressModes[] = { ERHITextureAddressMode::Wrap, ERHITextureAddressMode::Clamp, ERHITextureAddressMode::Mirror };
+        std::vector<FRHISamplerDesc> descs;
+        for (ERHIFilter filter : filters)
+        {
+            for (ERHITextureAddressMode addressMode : addressModes)
+            {
+                FRHISamplerDesc desc;
+                desc.Filter = filter;
+                desc.AddressU = desc.AddressV = desc.AddressW = addressMode;
+                desc.MaxAnisotropy = filter == ERHIFilter::Anisotropic ? 8 : 1;
+                descs.push_back(desc);
+            }
+        }
+        return descs;
+    }
+}
+
+MENGINE_BENCHMARK(SamplerCache_MaterialLoads)
+{
+    const uint32_t materialCount = context.Scale(200000, 20000);
+    const uint32_t threadCount = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+    const std::vector<FRHISamplerDesc> descs = MakeSamplerDescs();
+
+    NullRHIDevice device;
+    FDescriptorStagingHeap stagingHeap(&device, ERHIDescriptorHeapType::Sampler, 2048);
+    FSamplerCache cache(&device, &stagingHeap);
+
+    // Each thread loads every threadCount-th material, so all threads race for the same samplers.
+    std::vector<uint32_t> samplerIndices(materialCount);
+    const double ms = FBenchContext::MeasureMs([&]
+    {
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                for (uint32_t material = t; material < materialCount; material += threadCount)
+                {
+                    samplerIndices[material] = cache.GetSamplerIndex(descs[(material * 7) % descs.size()]);
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    });
+
+    // Materials with the same description must have been given the same index.
+    uint32_t mismatchCount = 0;
+    for (uint32_t material = 0; material < materialCount; ++material)
+    {
+        mismatchCount += samplerIndices[material] != samplerIndices[material % descs.size()] ? 1 : 0;
+    }
+
+    context.Report("threads", threadCount, "");
+    context.Report("materials", materialCount, "");
+    context.Report("samplers, one per material", materialCount, "");
+    context.Report("samplers, cached", cache.GetSamplerCount(), "");
+    context.Report("samplers created", static_cast<double>(device.GetSamplersCreated()), "");
+    context.Check("index mismatches", mismatchCount);
+    context.Report("per lookup", ms * 1e6 / materialCount, "ns");
+}
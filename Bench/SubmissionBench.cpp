@@ -0,0 +1,230 @@
+// Command list submission from several recording jobs at once, on the Null RHI with each
+// ExecuteCommandLists + Signal costing the driver a few microseconds. Three ways to submit:
+//   - serialized: one execute and one signal per submission under a lock, as a queue that takes a
+//     mutex to signal its fence does;
+//   - concurrent ExecuteCommandLists: submitters take fence values from the atomic counter and
+//     whoever flushes executes everything submitted meanwhile in one batch;
+//   - SubmitCommandLists: the jobs only queue their lists, and the frame flushes once.
+// Reports submissions per second and how many batches reached the (simulated) GPU per frame. A second
+// run submits several lists at a time from each thread while another one flushes, and checks that no
+// batch holds part of a submission only.
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "Jobs/JobSystem.h"
+#include "NullRHI/NullRHI.h"
+
+namespace
+{
+    const uint32_t RecorderCount = 4;
+    const uint32_t ListsPerRecorder = 16;       // Per frame.
+    const uint32_t ExecuteMicroseconds = 20;
+
+    enum class ESubmitMode
+    {
+        Serialized,
+        Execute,
+        Submit,
+    };
+
+    struct FRecorders
+    {
+        std::vector<std::unique_ptr<RHICommandAllocator>> Allocators;
+        std::vector<std::unique_ptr<RHICommandList>> Lists;        // ListsPerRecorder per recorder.
+    };
+
+    struct FSubmitContext
+    {
+        NullRHICommandQueue* Queue;
+        FRecorders* Recorders;
+        std::mutex* SerializeMutex;
+        ESubmitMode Mode;
+    };
+
+    // One recorder's frame: reopen each of its lists, record a draw into it and submit it on its own.
+    void RecordAndSubmit(const FSubmitContext& context, uint32_t recorder)
+    {
+        for (uint32_t i = 0; i < ListsPerRecorder; ++i)
+        {
+            RHICommandList* list = context.Recorders->Lists[recorder * ListsPerRecorder + i].get();
+            list->Reset(context.Recorders->Allocators[recorder].get(), nullptr);
+            list->DrawIndexedInstanced(36, 1, 0, 0, 0);
+            if (context.Mode == ESubmitMode::Serialized)
+            {
+                std::lock_guard<std::mutex> lock(*context.SerializeMutex);
+                context.Queue->ExecuteCommandLists(1, &list);
+            }
+            else if (context.Mode == ESubmitMode::Execute)
+            {
+                context.Queue->ExecuteCommandLists(1, &list);
+            }
+            else
+            {
+                context.Queue->SubmitCommandLists(1, &list);
+            }
+        }
+    }
+
+    struct FModeResult
+    {
+        double SubmissionsPerSecond = 0.0;
+        double BatchesPerFrame = 0.0;
+    };
+
+    FModeResult RunFrames(FJobSystem& jobSystem, ESubmitMode mode, uint32_t frameCount)
+    {
+        NullRHIDevice device;
+        NullRHICommandQueue* queue = device.GetNullQueue(ERHICommandListType::Direct);
+        queue->SetSimulatedExecuteTime(ExecuteMicroseconds);
+
+        FRecorders recorders;
+        for (uint32_t recorder = 0; recorder < RecorderCount; ++recorder)
+        {
+            recorders.Allocators.push_back(device.CreateCommandAllocator(ERHICommandListType::Direct));
+            for (uint32_t i = 0; i < ListsPerRecorder; ++i)
+            {
+                recorders.Lists.push_back(device.CreateCommandList(ERHICommandListType::Direct, recorders.Allocators.back().get(), nullptr));
+                recorders.Lists.back()->Close();
+            }
+        }
+
+        std::mutex serializeMutex;
+        const FSubmitContext context = { queue, &recorders, &serializeMutex, mode };
+        const FSubmitContext* pContext = &context;
+        const double ms = FBenchContext::MeasureMs([&]
+        {
+            for (uint32_t frame = 0; frame < frameCount; ++frame)
+            {
+                FJobCounter counter;
+                for (uint32_t recorder = 0; recorder < RecorderCount; ++recorder)
+                {
+                    jobSystem.Run([pContext, recorder]() { RecordAndSubmit(*pContext, recorder); }, &counter);
+                }
+                jobSystem.Wait(counter);
+                // The lists are reopened next frame, so the queued ones must reach the GPU first.
+                queue->Flush();
+            }
+        });
+        queue->WaitForIdle();
+
+        FModeResult result;
+        const double submissionCount = double(frameCount) * RecorderCount * ListsPerRecorder;
+        result.SubmissionsPerSecond = submissionCount / (ms / 1000.0);
+        result.BatchesPerFrame = double(queue->GetStats().Submissions) / frameCount;
+        return result;
+    }
+
+    // A list of a multi-list submission, as RHISubmissionBatcher sees it: an opaque pointer.
+    struct FSubmittedList
+    {
+        uint32_t Index;     // In its submission.
+        uint32_t Count;     // Of its submission.
+    };
+
+    struct FPublishResult
+    {
+        uint64_t Batches = 0;
+        uint64_t SplitSubmissions = 0;
+        uint64_t Lists = 0;
+    };
+
+    // Submitters enqueue 1 to 4 lists at a time straight into a batcher while a flusher calls
+    // FlushUntil() on the values handed out so far. Each batch must start and end on a boundary.
+    FPublishResult PublishMultiListSubmissions(uint32_t submissionsPerThread)
+    {
+        const uint32_t MaxListsPerSubmission = 4;
+        std::vector<FSubmittedList> lists;
+        for (uint32_t count = 1; count <= MaxListsPerSubmission; ++count)
+        {
+            for (uint32_t index = 0; index < count; ++index)
+            {
+                lists.push_back({ index, count });
+            }
+        }
+
+        FPublishResult result;
+        RHISubmissionBatcher batcher(1, [&](uint32_t count, void* const* batch, uint64_t)
+        {
+            uint32_t expected = 0;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                const FSubmittedList* list = static_cast<const FSubmittedList*>(batch[i]);
+                result.SplitSubmissions += list->Index != expected ? 1 : 0;
+                expected = list->Index + 1 == list->Count ? 0 : list->Index + 1;
+            }
+            result.SplitSubmissions += expected != 0 ? 1 : 0;
+            result.Lists += count;
+            ++result.Batches;
+        });
+
+        std::atomic<uint32_t> running(RecorderCount);
+        std::vector<std::thread> submitters;
+        for (uint32_t thread = 0; thread < RecorderCount; ++thread)
+        {
+            submitters.emplace_back([&, thread]
+            {
+                for (uint32_t i = 0; i < submissionsPerThread; ++i)
+                {
+                    const uint32_t count = 1 + (i + thread) % MaxListsPerSubmission;
+                    const uint32_t first = count * (count - 1) / 2;
+                    void* submission[MaxListsPerSubmission];
+                    for (uint32_t list = 0; list < count; ++list)
+                    {
+                        submission[list] = &lists[first + list];
+                    }
+                    batcher.Enqueue(count, submission);
+                }
+                running.fetch_sub(1);
+            });
+        }
+        while (running.load() != 0)
+        {
+            batcher.FlushUntil(batcher.GetNextFenceValue() - 1);
+        }
+        for (std::thread& submitter : submitters)
+        {
+            submitter.join();
+        }
+        batcher.FlushUntil(batcher.GetNextFenceValue() - 1);
+        return result;
+    }
+}
+
+MENGINE_BENCHMARK(Submission_Contention)
+{
+    const uint32_t frameCount = context.Scale(200, 20);
+
+    FJobSystemDesc jobSystemDesc;
+    jobSystemDesc.WorkerThreadCount = RecorderCount;
+    FJobSystem jobSystem(jobSystemDesc);
+
+    const FModeResult serialized = RunFrames(jobSystem, ESubmitMode::Serialized, frameCount);
+    const FModeResult execute = RunFrames(jobSystem, ESubmitMode::Execute, frameCount);
+    const FModeResult submit = RunFrames(jobSystem, ESubmitMode::Submit, frameCount);
+
+    context.Report("recorders", RecorderCount, "");
+    context.Report("submissions / frame", RecorderCount * ListsPerRecorder, "");
+    context.Report("execute + signal (simulated)", ExecuteMicroseconds, "us");
+    context.Report("serialized", serialized.SubmissionsPerSecond, "submissions/s");
+    context.Report("serialized, batches / frame", serialized.BatchesPerFrame, "");
+    context.Report("concurrent execute", execute.SubmissionsPerSecond, "submissions/s");
+    context.Report("concurrent execute, batches / frame", execute.BatchesPerFrame, "");
+    context.Report("submit + flush", submit.SubmissionsPerSecond, "submissions/s");
+    context.Report("submit + flush, batches / frame", submit.BatchesPerFrame, "");
+}
+
+MENGINE_BENCHMARK(Submission_MultiListPublish)
+{
+    const uint32_t submissionsPerThread = context.Scale(100000, 10000);
+    const FPublishResult result = PublishMultiListSubmissions(submissionsPerThread);
+
+    context.Report("submitting threads", RecorderCount, "");
+    context.Report("lists", static_cast<double>(result.Lists), "");
+    context.Report("batches", static_cast<double>(result.Batches), "");
+    context.Check("split submissions", result.SplitSubmissions);
+}
@@ -0,0 +1,124 @@
+// Per-instance MVP update: the original FrameResource::UpdateConstantBuffers loop (load 4x4, two
+// matrix multiplies, transpose, memcpy) against ComputeTransposedMvpBatch, with cached and streaming
+// stores, and spread over the job system.
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Bench.h"
+#include "Jobs/JobSystem.h"
+#include "Math/TransformBatch.h"
+
+using namespace DirectX;
+
+namespace
+{
+    // Same layout as the per-draw constants: each FrameResource::SceneConstantBuffer at the start of a
+    // 256-byte root CBV slot.
+    struct alignas(256) FBenchConstantBuffer
+    {
+        FMatrix4x4 mvp;
+        float padding[48];
+    };
+
+    struct FTransformScene
+    {
+        std::vector<FMatrix4x4> ModelMatrices;
+        FAffineTransformArray ModelTransforms;
+        FSimdMatrix View;
+        FSimdMatrix Projection;
+    };
+
+    void BuildScene(uint32_t count, FTransformScene& scene)
+    {
+        scene.ModelMatrices.resize(count);
+        scene.ModelTransforms.Resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float x = static_cast<float>(i % 256) * 16.0f;
+            const float z = static_cast<float>(i / 256) * -16.0f;
+            const FSimdMatrix model = XMMatrixScaling(1.0f + (i % 3) * 0.5f, 1.0f, 1.0f) * XMMatrixRotationY(0.01f * i) * XMMatrixTranslation(x, 0.02f * i, z);
+            XMStoreFloat4x4(&scene.ModelMatrices[i], model);
+            scene.ModelTransforms.Set(i, scene.ModelMatrices[i]);
+        }
+        scene.View = XMMatrixLookAtRH(XMVectorSet(0.0f, 15.0f, 50.0f, 1.0f), XMVectorSet(100.0f, 0.0f, -100.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        scene.Projection = XMMatrixPerspectiveFovRH(0.8f, 16.0f / 9.0f, 1.0f, 1000.0f);
+    }
+
+    // The loop FrameResource::UpdateConstantBuffers used before the batch kernel.
+    void UpdateLegacy(const FTransformScene& scene, FBenchConstantBuffer* pConstantBuffers)
+    {
+        FMatrix4x4 mvp;
+        for (size_t i = 0; i < scene.ModelMatrices.size(); ++i)
+        {
+            const FSimdMatrix model = XMLoadFloat4x4(&scene.ModelMatrices[i]);
+            XMStoreFloat4x4(&mvp, XMMatrixTranspose(model * scene.View * scene.Projection));
+            std::memcpy(&pConstantBuffers[i], &mvp, sizeof(mvp));
+        }
+    }
+
+    double MaxRelativeError(const std::vector<FBenchConstantBuffer>& reference, const std::vector<FBenchConstantBuffer>& result)
+    {
+        double maxError = 0.0;
+        for (size_t i = 0; i < reference.size(); ++i)
+        {
+            for (uint32_t r = 0; r < 4; ++r)
+            {
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    const double expected = reference[i].mvp.m[r][c];
+                    const double error = std::fabs(expected - result[i].mvp.m[r][c]) / (std::fabs(expected) + 1.0);
+                    maxError = error > maxError ? error : maxError;
+                }
+            }
+        }
+        return maxError;
+    }
+}
+
+MENGINE_BENCHMARK(TransformBatch_UpdateConstantBuffers)
+{
+    const uint32_t count = context.Scale(1 << 20, 1 << 15);
+    const uint32_t repeatCount = context.Scale(10, 3);
+
+    FTransformScene scene;
+    BuildScene(count, scene);
+
+    FMatrix4x4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, scene.View * scene.Projection);
+
+    std::vector<FBenchConstantBuffer> reference(count);
+    std::vector<FBenchConstantBuffer> result(count);
+    FBenchConstantBuffer* pResult = result.data();
+
+    const double legacyMs = FBenchContext::MeasureBestMs(repeatCount, [&] { UpdateLegacy(scene, reference.data()); });
+    const double cachedMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        ComputeTransposedMvpBatch(scene.ModelTransforms, 0, count, viewProjection, pResult, sizeof(FBenchConstantBuffer), false);
+    });
+    const double streamingMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        ComputeTransposedMvpBatch(scene.ModelTransforms, 0, count, viewProjection, pResult, sizeof(FBenchConstantBuffer), true);
+    });
+
+    FJobSystem jobSystem;
+    const double parallelMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        jobSystem.ParallelFor(count, 256, [&](uint32_t begin, uint32_t end, FJobContext&)
+        {
+            ComputeTransposedMvpBatch(scene.ModelTransforms, begin, end, viewProjection, pResult, sizeof(FBenchConstantBuffer), true);
+        });
+    });
+
+    const double nsPerMs = 1.0e6 / count;
+    context.Report("instances", count, "");
+    context.Report("kernel", GetTransformBatchKernelName());
+    context.Report("legacy loop", legacyMs * nsPerMs, "ns/instance");
+    context.Report("batched, cached stores", cachedMs * nsPerMs, "ns/instance");
+    context.Report("batched, streaming stores", streamingMs * nsPerMs, "ns/instance");
+    context.Report("batched, streaming, jobs", parallelMs * nsPerMs, "ns/instance");
+    context.Report("speedup (1 thread)", legacyMs / streamingMs, "x");
+    context.Report("speedup (jobs)", legacyMs / parallelMs, "x");
+    context.Report("max relative error", MaxRelativeError(reference, result), "");
+}
@@ -0,0 +1,193 @@
+// FTransformStore with a million instances: recomputing the world matrices of the 1% that moved
+// against recomputing all of them. A smaller store is then moved, rotated, scaled, destroyed and
+// refilled for a few frames, and after each dirty update its world matrices are checked against a
+// store built from the same values and recomputed in full. Handles to destroyed slots that were
+// reused must no longer be alive, and setting or destroying through them must change nothing.
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Bench.h"
+#include "Math/TransformStore.h"
+
+namespace
+{
+    struct FStoreMismatches
+    {
+        uint32_t WorldTransforms = 0;   // Slots whose matrix differs from the full recompute.
+        uint32_t UpdatedSlots = 0;      // Updates recomputing other than the slots changed since the last.
+        uint32_t StaleHandles = 0;      // Stale handles still alive, or changing the slot's new instance.
+    };
+
+    // A store holding what store's live slots hold, slot for slot, with every matrix recomputed.
+    uint32_t CountWorldMismatches(const FTransformStore& store, const std::vector<FTransformHandle>& slots)
+    {
+        FTransformStore reference;
+        std::vector<FTransformHandle> referenceHandles;
+        for (const FTransformHandle& handle : slots)
+        {
+            referenceHandles.push_back(reference.Create(store.GetPosition(handle), store.GetRotation(handle), store.GetScale(handle)));
+        }
+        for (uint32_t slot = 0; slot < slots.size(); ++slot)
+        {
+            if (!store.IsAlive(slots[slot]))
+            {
+                reference.Destroy(referenceHandles[slot]);
+            }
+        }
+        reference.UpdateWorldTransforms();
+
+        uint32_t mismatches = 0;
+        for (uint32_t element = 0; element < FAffineTransformArray::ElementCount; ++element)
+        {
+            const float* world = store.GetWorldTransforms().GetStream(element);
+            const float* expected = reference.GetWorldTransforms().GetStream(element);
+            for (uint32_t slot = 0; slot < slots.size(); ++slot)
+            {
+                mismatches += std::memcmp(&world[slot], &expected[slot], sizeof(float)) != 0 ? 1 : 0;
+            }
+        }
+        return mismatches;
+    }
+
+    FStoreMismatches CheckStore(uint32_t count, uint32_t frameCount)
+    {
+        FTransformStore store;
+        std::vector<FTransformHandle> slots;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float angle = 0.001f * i;
+            slots.push_back(store.Create(FVector3(float(i % 128), 0.0f, -float(i / 128)), FVector4(0.0f, std::sin(angle), 0.0f, std::cos(angle)),
+                FVector3(1.0f + 0.01f * (i % 7), 1.0f, 1.0f)));
+        }
+        store.UpdateWorldTransforms();
+
+        FStoreMismatches mismatches;
+        for (uint32_t frame = 1; frame <= frameCount; ++frame)
+        {
+            std::vector<bool> changed(count, false);
+            for (uint32_t i = frame; i < count; i += 97)
+            {
+                FVector3 position = store.GetPosition(slots[i]);
+                position.y = std::sin(0.1f * frame + i);
+                store.SetPosition(slots[i], position);
+                changed[i] = true;
+            }
+            for (uint32_t i = 2 * frame; i < count; i += 211)
+            {
+                const float angle = 0.3f * frame;
+                store.SetRotation(slots[i], FVector4(std::sin(angle), 0.0f, 0.0f, std::cos(angle)));
+                changed[i] = true;
+            }
+            for (uint32_t i = 5 * frame; i < count; i += 263)
+            {
+                store.SetScale(slots[i], FVector3(1.0f, 0.5f + 0.1f * frame, 1.0f));
+                changed[i] = true;
+            }
+
+            // Destroyed and refilled in the same frame, so the new instances take the freed slots.
+            std::vector<FTransformHandle> destroyed;
+            for (uint32_t i = 3 * frame; i < count; i += 331)
+            {
+                destroyed.push_back(slots[i]);
+                store.Destroy(slots[i]);
+                changed[i] = true;
+            }
+            for (size_t i = 0; i < destroyed.size(); ++i)
+            {
+                const FTransformHandle handle = store.Create(FVector3(-1.0f, float(frame), 1.0f));
+                slots[handle.Index] = handle;
+                changed[handle.Index] = true;
+            }
+            for (const FTransformHandle& stale : destroyed)
+            {
+                const FTransformHandle handle = slots[stale.Index];
+                const uint32_t aliveCount = store.GetAliveCount();
+                const FVector3 position = store.GetPosition(handle);
+                store.SetPosition(stale, FVector3(7.0f, 7.0f, 7.0f));
+                store.SetRotation(stale, FVector4(1.0f, 0.0f, 0.0f, 0.0f));
+                store.SetScale(stale, FVector3(3.0f, 3.0f, 3.0f));
+                store.Destroy(stale);
+                const FVector3 after = store.GetPosition(handle);
+                mismatches.StaleHandles += store.IsAlive(stale) || !store.IsAlive(handle) || handle == stale ? 1 : 0;
+                mismatches.StaleHandles += store.GetAliveCount() != aliveCount || after.x != position.x || after.y != position.y || after.z != position.z ? 1 : 0;
+                mismatches.StaleHandles += store.GetScale(handle).x != 1.0f || store.GetRotation(handle).w != 1.0f ? 1 : 0;
+            }
+
+            const std::vector<uint32_t>& updated = store.UpdateWorldTransforms();
+            uint32_t changedCount = 0;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                changedCount += changed[i] ? 1 : 0;
+            }
+            mismatches.UpdatedSlots += updated.size() != changedCount ? 1 : 0;
+            for (uint32_t slot : updated)
+            {
+                mismatches.UpdatedSlots += slot >= count || !changed[slot] ? 1 : 0;
+            }
+            mismatches.WorldTransforms += CountWorldMismatches(store, slots);
+        }
+        return mismatches;
+    }
+}
+
+MENGINE_BENCHMARK(TransformStore_DirtyUpdate)
+{
+    const uint32_t count = context.Scale(1u << 20, 1u << 16);
+    const uint32_t movedCount = count / 100;
+    const uint32_t repeatCount = context.Scale(10, 3);
+
+    FTransformStore store;
+    std::vector<FTransformHandle> handles(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        handles[i] = store.Create(FVector3(float(i % 1024) * 16.0f, 0.0f, float(i / 1024) * -16.0f));
+    }
+    store.UpdateWorldTransforms();
+
+    // Spread over the whole store, like unrelated objects moving.
+    uint32_t frame = 0;
+    const uint32_t step = count / movedCount;
+    auto moveSome = [&]
+    {
+        ++frame;
+        for (uint32_t i = 0; i < movedCount; ++i)
+        {
+            const FTransformHandle handle = handles[(i * step + frame) % count];
+            FVector3 position = store.GetPosition(handle);
+            position.y = std::sin(0.1f * frame);
+            store.SetPosition(handle, position);
+        }
+    };
+
+    uint32_t updatedCount = 0;
+    const double dirtyMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        moveSome();
+        updatedCount = static_cast<uint32_t>(store.UpdateWorldTransforms().size());
+    });
+    const double moveMs = FBenchContext::MeasureBestMs(repeatCount, moveSome);
+    store.UpdateWorldTransforms();
+
+    // Everything dirty: what a store without change tracking pays every frame.
+    const double fullMs = FBenchContext::MeasureBestMs(repeatCount, [&]
+    {
+        for (const FTransformHandle& handle : handles)
+        {
+            store.SetScale(handle, FVector3(1.0f, 1.0f, 1.0f));
+        }
+        store.UpdateWorldTransforms();
+    });
+
+    context.Report("instances", count, "");
+    context.Report("moved per frame", updatedCount, "");
+    context.Report("set positions", moveMs, "ms");
+    context.Report("update moved", dirtyMs - moveMs, "ms");
+    context.Report("update all", fullMs, "ms");
+
+    const FStoreMismatches mismatches = CheckStore(context.Scale(1u << 14, 1u << 12), 8);
+    context.Check("world matrix mismatches", mismatches.WorldTransforms);
+    context.Check("updated slot mismatches", mismatches.UpdatedSlots);
+    context.Check("stale handle mismatches", mismatches.StaleHandles);
+}
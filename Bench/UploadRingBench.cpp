@@ -0,0 +1,111 @@
+// FUploadRing over frames of per-draw constants and a few larger structured-buffer updates, with the
+// simulated GPU two submissions behind. The baseline is what code without a ring does: a committed
+// upload buffer per allocation, kept until its frame's fence completes. Reports what the ring grew to
+// and what an allocation costs each way.
+
+#include <deque>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Bench.h"
+#include "NullRHI/NullRHI.h"
+#include "Render/UploadRing.h"
+
+namespace
+{
+    const uint32_t ConstantsPerFrame = 1024;
+    const uint32_t ConstantSize = 256;
+    const uint32_t LatencyFrames = 2;
+
+    // Sizes of one frame's allocations: the constants, then a few buffer updates of 4-64 KB.
+    std::vector<uint32_t> FrameSizes(uint32_t frame)
+    {
+        std::mt19937 random(frame);
+        std::vector<uint32_t> sizes(ConstantsPerFrame, ConstantSize);
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            sizes.push_back(4096 << (random() % 5));
+        }
+        return sizes;
+    }
+}
+
+MENGINE_BENCHMARK(UploadRing_Frames)
+{
+    const uint32_t frameCount = context.Scale(500, 50);
+
+    NullRHIDevice device;
+    NullRHICommandQueue* queue = device.GetNullQueue(ERHICommandListType::Direct);
+    queue->SetSimulatedLatency(LatencyFrames);
+    std::unique_ptr<RHICommandAllocator> allocator = device.CreateCommandAllocator(ERHICommandListType::Direct);
+    std::unique_ptr<RHICommandList> list = device.CreateCommandList(ERHICommandListType::Direct, allocator.get(), nullptr);
+    list->Close();
+    RHICommandList* lists[] = { list.get() };
+
+    std::vector<std::vector<uint32_t>> frames;
+    uint64_t bytesPerFrame = 0;
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+    {
+        frames.push_back(FrameSizes(frame));
+    }
+    for (uint32_t size : frames[0])
+    {
+        bytesPerFrame += size;
+    }
+
+    // One buffer per allocation, released once the frame that used it has completed.
+    std::deque<std::pair<uint64_t, std::vector<std::unique_ptr<RHIResource>>>> inFlight;
+    uint32_t allocationCount = 0;
+    const double committedMs = FBenchContext::MeasureBestMs(1, [&]
+    {
+        allocationCount = 0;
+        for (const std::vector<uint32_t>& sizes : frames)
+        {
+            std::vector<std::unique_ptr<RHIResource>> buffers;
+            for (uint32_t size : sizes)
+            {
+                FRHIBufferDesc desc;
+                desc.SizeInBytes = size;
+                desc.HeapType = ERHIHeapType::Upload;
+                buffers.push_back(device.CreateBuffer(desc));
+                static_cast<uint8_t*>(buffers.back()->Map())[0] = 1;
+                ++allocationCount;
+            }
+            inFlight.emplace_back(queue->ExecuteCommandLists(1, lists), std::move(buffers));
+            while (!inFlight.empty() && queue->IsFenceComplete(inFlight.front().first))
+            {
+                inFlight.pop_front();
+            }
+        }
+        queue->WaitForFenceCPUBlocking(queue->GetNextFenceValue() - 1);
+        inFlight.clear();
+    });
+
+    std::unique_ptr<FUploadRing> ring;
+    const double ringMs = FBenchContext::MeasureBestMs(1, [&]
+    {
+        ring = std::make_unique<FUploadRing>(&device, queue, 256 * 1024);
+        for (const std::vector<uint32_t>& sizes : frames)
+        {
+            ring->Reclaim();
+            for (uint32_t size : sizes)
+            {
+                static_cast<uint8_t*>(ring->Allocate(size).CpuAddress)[0] = 1;
+            }
+            ring->OnSubmit(queue->ExecuteCommandLists(1, lists));
+        }
+        queue->WaitForFenceCPUBlocking(queue->GetNextFenceValue() - 1);
+    });
+
+    const FUploadRingStats& stats = ring->GetStats();
+    context.Report("frames", frameCount, "");
+    context.Report("allocations / frame", allocationCount / frameCount, "");
+    context.Report("first frame", bytesPerFrame / 1024.0, "KB");
+    context.Report("ring pages", stats.PageCount, "");
+    context.Report("ring capacity", stats.CapacityBytes / 1024.0, "KB");
+    context.Report("ring high water", stats.HighWaterBytes / 1024.0, "KB");
+    context.Report("per allocation committed", committedMs * 1e6 / allocationCount, "ns");
+    context.Report("per allocation ring", ringMs * 1e6 / stats.AllocationCount, "ns");
+}
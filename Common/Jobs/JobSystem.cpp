@@ -0,0 +1,259 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace
+{
+	struct FJobThreadState
+	{
+		const FJobSystem* JobSystem = nullptr;
+		int32_t ThreadIndex = -1;
+	};
+
+	thread_local FJobThreadState t_JobThreadState;
+
+	// Spin this many times (yielding) before a worker goes to sleep; keeps wake-up latency low
+	// between back-to-back batches without burning a core when the pool is idle.
+	const uint32_t WorkerSpinCount = 64;
+}
+
+FJobSystem::FJobSystem(const FJobSystemDesc& desc) :
+	mQueuedJobCount(0),
+	mSleepingWorkerCount(0),
+	mWorkerSleeps(0),
+	mIsExiting(false),
+	mOwnerThreadId(std::this_thread::get_id())
+{
+	uint32_t workerCount = desc.WorkerThreadCount;
+	if (workerCount == 0)
+	{
+		const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (uint32_t i = 0; i < workerCount + 1; ++i)
+	{
+		mSlots.push_back(std::make_unique<FWorkerSlot>(desc.ScratchBytesPerWorker));
+	}
+
+	mThreads.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		mThreads.emplace_back(&FJobSystem::WorkerMain, this, i);
+	}
+}
+
+FJobSystem::~FJobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mIsExiting = true;
+	}
+	mWakeCondition.notify_all();
+	for (std::thread& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+int32_t FJobSystem::GetCurrentThreadIndex() const
+{
+	if (t_JobThreadState.JobSystem == this)
+	{
+		return t_JobThreadState.ThreadIndex;
+	}
+	if (std::this_thread::get_id() == mOwnerThreadId)
+	{
+		return static_cast<int32_t>(mSlots.size() - 1);
+	}
+	return -1;
+}
+
+void FJobSystem::Submit(const FJob& job)
+{
+	// Our own threads push to their own deque; anyone else feeds the creating thread's deque,
+	// which the workers steal from like any other.
+	const int32_t threadIndex = GetCurrentThreadIndex();
+	FWorkerSlot& slot = *mSlots[threadIndex >= 0 ? threadIndex : mSlots.size() - 1];
+
+	// Counted before it is visible, so a thief can never take the count below zero.
+	mQueuedJobCount.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(slot.QueueMutex);
+		slot.Queue.push_back(job);
+	}
+
+	// Pairs with the sleeper's increment-then-check; both sides are seq_cst so one of them sees the other.
+	if (mSleepingWorkerCount.load() > 0)
+	{
+		// Taking the lock orders this notify after a sleeper's predicate check.
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mWakeCondition.notify_one();
+	}
+}
+
+void FJobSystem::SubmitAfter(FJobCounter& dependency, const FJob& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(dependency.mContinuationMutex);
+		if (!dependency.IsDone())
+		{
+			dependency.mContinuations.push_back(job);
+			return;
+		}
+	}
+	Submit(job);
+}
+
+bool FJobSystem::TryGetJob(uint32_t threadIndex, FJob& outJob)
+{
+	if (mQueuedJobCount.load(std::memory_order_acquire) == 0)
+	{
+		return false;
+	}
+
+	// Own deque first, newest job.
+	{
+		FWorkerSlot& slot = *mSlots[threadIndex];
+		std::lock_guard<std::mutex> lock(slot.QueueMutex);
+		if (!slot.Queue.empty())
+		{
+			outJob = slot.Queue.back();
+			slot.Queue.pop_back();
+			mQueuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	// Steal the oldest job from the others, starting after ourselves so thieves spread out.
+	const uint32_t slotCount = static_cast<uint32_t>(mSlots.size());
+	for (uint32_t offset = 1; offset < slotCount; ++offset)
+	{
+		FWorkerSlot& victim = *mSlots[(threadIndex + offset) % slotCount];
+		std::unique_lock<std::mutex> lock(victim.QueueMutex, std::try_to_lock);
+		if (!lock.owns_lock() || victim.Queue.empty())
+		{
+			continue;
+		}
+		outJob = victim.Queue.front();
+		victim.Queue.pop_front();
+		mQueuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+		mSlots[threadIndex]->JobsStolen.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+void FJobSystem::Execute(FJob& job, uint32_t threadIndex)
+{
+	FWorkerSlot& slot = *mSlots[threadIndex];
+	const size_t scratchMarker = slot.Scratch.GetMarker();
+
+	FJobContext context = { this, threadIndex, slot.Scratch };
+	job.Invoke(job.Storage, context);
+
+	slot.Scratch.Rewind(scratchMarker);
+	slot.JobsExecuted.fetch_add(1, std::memory_order_relaxed);
+	CompleteJob(job.Counter);
+}
+
+void FJobSystem::CompleteJob(FJobCounter* counter)
+{
+	if (!counter)
+	{
+		return;
+	}
+
+	// Not the last job: a plain decrement.
+	uint32_t pending = counter->mPending.load(std::memory_order_relaxed);
+	while (pending > 1)
+	{
+		if (counter->mPending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel))
+		{
+			return;
+		}
+	}
+
+	// Probably the last one. The count reaches zero under the continuation lock, so a waiter that
+	// sees zero (and may then destroy the counter) cannot get past its own lock until we are done.
+	std::vector<FJob> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->mContinuationMutex);
+		if (counter->mPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			continuations.swap(counter->mContinuations);
+		}
+	}
+	for (const FJob& continuation : continuations)
+	{
+		Submit(continuation);
+	}
+}
+
+void FJobSystem::Wait(FJobCounter& counter)
+{
+	const int32_t threadIndex = GetCurrentThreadIndex();
+	FJob job;
+	while (!counter.IsDone())
+	{
+		if (threadIndex >= 0 && TryGetJob(static_cast<uint32_t>(threadIndex), job))
+		{
+			Execute(job, static_cast<uint32_t>(threadIndex));
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// The last CompleteJob may still hold the counter's lock; the caller is free to destroy the
+	// counter once we return, so wait for it to let go.
+	std::lock_guard<std::mutex> lock(counter.mContinuationMutex);
+}
+
+void FJobSystem::WorkerMain(uint32_t threadIndex)
+{
+	t_JobThreadState.JobSystem = this;
+	t_JobThreadState.ThreadIndex = static_cast<int32_t>(threadIndex);
+
+	FJob job;
+	uint32_t idleSpins = 0;
+	for (;;)
+	{
+		if (TryGetJob(threadIndex, job))
+		{
+			Execute(job, threadIndex);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < WorkerSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		idleSpins = 0;
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mSleepingWorkerCount.fetch_add(1);
+		mWorkerSleeps.fetch_add(1, std::memory_order_relaxed);
+		mWakeCondition.wait(lock, [this] { return mIsExiting || mQueuedJobCount.load() > 0; });
+		mSleepingWorkerCount.fetch_sub(1);
+		if (mIsExiting)
+		{
+			return;
+		}
+	}
+}
+
+FJobSystemStats FJobSystem::GetStats() const
+{
+	FJobSystemStats stats;
+	for (const std::unique_ptr<FWorkerSlot>& slot : mSlots)
+	{
+		stats.JobsExecuted += slot->JobsExecuted.load(std::memory_order_relaxed);
+		stats.JobsStolen += slot->JobsStolen.load(std::memory_order_relaxed);
+	}
+	stats.WorkerSleeps = mWorkerSleeps.load(std::memory_order_relaxed);
+	return stats;
+}
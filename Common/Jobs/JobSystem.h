@@ -0,0 +1,226 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ScratchAllocator.h"
+
+// Work-stealing job scheduler.
+//
+// Every worker thread owns a deque: it pushes and pops its own jobs at the back (LIFO, cache-warm)
+// and idle workers steal from the front of the others (FIFO, oldest and usually biggest work first).
+// The thread that creates the FJobSystem gets a deque of its own and executes jobs while it waits,
+// so it is never just blocked on the pool. Any other thread may submit jobs and wait on counters.
+//
+// Jobs are small trivially copyable callables (capture indices and pointers/references, not
+// containers), taking either no arguments or an FJobContext&, and must not throw. Completion is
+// tracked with FJobCounter, which is also how dependencies are expressed (RunAfter).
+
+class FJobSystem;
+class FJobCounter;
+
+struct FJobContext
+{
+	FJobSystem* JobSystem;
+	uint32_t WorkerIndex;           // 0..GetThreadCount()-1; stable for the duration of the job.
+	FScratchAllocator& Scratch;     // Rewound when the job returns.
+};
+
+struct FJob
+{
+	static constexpr size_t StorageSize = 48;
+
+	void (*Invoke)(const void* storage, FJobContext& context) = nullptr;
+	FJobCounter* Counter = nullptr;
+	alignas(std::max_align_t) unsigned char Storage[StorageSize];
+
+	template<typename F>
+	static FJob Make(F&& func, FJobCounter* counter)
+	{
+		using FFunc = typename std::decay<F>::type;
+		static_assert(std::is_trivially_copyable<FFunc>::value, "Job callables must be trivially copyable; capture by reference or pointer");
+		static_assert(sizeof(FFunc) <= StorageSize && alignof(FFunc) <= alignof(std::max_align_t), "Job callable is too large; capture a pointer to a struct instead");
+
+		FJob job;
+		new (job.Storage) FFunc(std::forward<F>(func));
+		job.Counter = counter;
+		job.Invoke = [](const void* storage, FJobContext& context)
+		{
+			const FFunc& f = *static_cast<const FFunc*>(storage);
+			if constexpr (std::is_invocable<const FFunc&, FJobContext&>::value)
+			{
+				f(context);
+			}
+			else
+			{
+				f();
+			}
+		};
+		return job;
+	}
+};
+
+// Counts unfinished jobs. Jobs added with RunAfter(counter, ...) are submitted when it reaches zero.
+// A counter must outlive every job that references it and must not be destroyed while busy.
+class FJobCounter
+{
+public:
+	FJobCounter() : mPending(0) {}
+	FJobCounter(const FJobCounter&) = delete;
+	FJobCounter& operator=(const FJobCounter&) = delete;
+
+	bool IsDone() const { return mPending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class FJobSystem;
+
+	std::atomic<uint32_t> mPending;
+	std::mutex mContinuationMutex;
+	std::vector<FJob> mContinuations;
+};
+
+struct FJobSystemDesc
+{
+	// Worker threads besides the creating thread; 0 picks hardware_concurrency() - 1 (at least 1).
+	uint32_t WorkerThreadCount = 0;
+	size_t ScratchBytesPerWorker = 256 * 1024;
+};
+
+struct FJobSystemStats
+{
+	uint64_t JobsExecuted = 0;
+	uint64_t JobsStolen = 0;
+	uint64_t WorkerSleeps = 0;
+};
+
+class FJobSystem
+{
+public:
+	explicit FJobSystem(const FJobSystemDesc& desc = FJobSystemDesc());
+	~FJobSystem();
+
+	FJobSystem(const FJobSystem&) = delete;
+	FJobSystem& operator=(const FJobSystem&) = delete;
+
+	// Worker threads plus the creating thread.
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(mSlots.size()); }
+
+	// Queues func. counter (optional) is incremented now and decremented when func returns.
+	template<typename F>
+	void Run(F&& func, FJobCounter* counter = nullptr)
+	{
+		if (counter)
+		{
+			counter->mPending.fetch_add(1, std::memory_order_relaxed);
+		}
+		Submit(FJob::Make(std::forward<F>(func), counter));
+	}
+
+	// Queues func once dependency reaches zero (immediately if it already has).
+	template<typename F>
+	void RunAfter(FJobCounter& dependency, F&& func, FJobCounter* counter = nullptr)
+	{
+		if (counter)
+		{
+			counter->mPending.fetch_add(1, std::memory_order_relaxed);
+		}
+		SubmitAfter(dependency, FJob::Make(std::forward<F>(func), counter));
+	}
+
+	// Returns when counter reaches zero. Job system threads execute other jobs in the meantime.
+	void Wait(FJobCounter& counter);
+
+	// Calls func(begin, end, context) over [0, count) in batches of at least minBatchSize and
+	// returns when all batches are done. func only needs to live for the duration of the call.
+	template<typename F>
+	void ParallelFor(uint32_t count, uint32_t minBatchSize, const F& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		// A few batches per thread so stealing can even out uneven batches.
+		const uint32_t targetBatches = GetThreadCount() * 4;
+		uint32_t batchSize = (count + targetBatches - 1) / targetBatches;
+		batchSize = batchSize < minBatchSize ? minBatchSize : batchSize;
+		batchSize = batchSize == 0 ? 1 : batchSize;
+
+		FJobCounter counter;
+		const F* pFunc = &func;
+		for (uint32_t begin = batchSize; begin < count; begin += batchSize)
+		{
+			const uint32_t end = (count - begin) > batchSize ? begin + batchSize : count;
+			Run([pFunc, begin, end](FJobContext& context) { (*pFunc)(begin, end, context); }, &counter);
+		}
+
+		// The first batch runs right here rather than waiting for a worker to pick it up.
+		ExecuteInline([pFunc, batchSize, count](FJobContext& context) { (*pFunc)(0, batchSize < count ? batchSize : count, context); });
+		Wait(counter);
+	}
+
+	FJobSystemStats GetStats() const;
+
+	// Index of the calling thread in this job system, or -1 for threads it does not own.
+	int32_t GetCurrentThreadIndex() const;
+
+private:
+	struct FWorkerSlot
+	{
+		explicit FWorkerSlot(size_t scratchBytes) : Scratch(scratchBytes) {}
+
+		std::mutex QueueMutex;
+		std::deque<FJob> Queue;
+		FScratchAllocator Scratch;
+		std::atomic<uint64_t> JobsExecuted{ 0 };
+		std::atomic<uint64_t> JobsStolen{ 0 };
+	};
+
+	template<typename F>
+	void ExecuteInline(F&& func)
+	{
+		FJob job = FJob::Make(std::forward<F>(func), nullptr);
+		const int32_t threadIndex = GetCurrentThreadIndex();
+		if (threadIndex >= 0)
+		{
+			Execute(job, static_cast<uint32_t>(threadIndex));
+		}
+		else
+		{
+			// Not one of ours, so there is no scratch space to lend it: hand the batch to the pool.
+			FJobCounter counter;
+			counter.mPending.fetch_add(1, std::memory_order_relaxed);
+			job.Counter = &counter;
+			Submit(job);
+			Wait(counter);
+		}
+	}
+
+	void Submit(const FJob& job);
+	void SubmitAfter(FJobCounter& dependency, const FJob& job);
+	bool TryGetJob(uint32_t threadIndex, FJob& outJob);
+	void Execute(FJob& job, uint32_t threadIndex);
+	void CompleteJob(FJobCounter* counter);
+	void WorkerMain(uint32_t threadIndex);
+
+	// Slot i belongs to worker thread i; the last slot belongs to the creating thread.
+	std::vector<std::unique_ptr<FWorkerSlot>> mSlots;
+	std::vector<std::thread> mThreads;
+
+	std::atomic<uint32_t> mQueuedJobCount;
+	std::atomic<uint32_t> mSleepingWorkerCount;
+	std::atomic<uint64_t> mWorkerSleeps;
+	std::mutex mSleepMutex;
+	std::condition_variable mWakeCondition;
+	bool mIsExiting;
+	std::thread::id mOwnerThreadId;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+// Per-worker bump allocator for job-local temporaries. The job system saves the offset before a job
+// runs and rewinds to it afterwards, so allocations live until the end of the job that made them
+// (jobs run while waiting nest on the same thread, hence the marker rather than a full reset).
+class FScratchAllocator
+{
+public:
+	explicit FScratchAllocator(size_t capacity) :
+		mBuffer(new uint8_t[capacity]),
+		mCapacity(capacity),
+		mOffset(0)
+	{
+	}
+
+	// Throws std::bad_alloc when the scratch space is exhausted; size FJobSystemDesc::ScratchBytesPerWorker for the largest job.
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		const uintptr_t base = reinterpret_cast<uintptr_t>(mBuffer.get());
+		const uintptr_t aligned = (base + mOffset + alignment - 1) & ~uintptr_t(alignment - 1);
+		const size_t newOffset = size_t(aligned - base) + size;
+		if (newOffset > mCapacity)
+		{
+			throw std::bad_alloc();
+		}
+		mOffset = newOffset;
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	template<typename T>
+	T* AllocateArray(size_t count)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	size_t GetMarker() const { return mOffset; }
+	void Rewind(size_t marker) { mOffset = marker; }
+	size_t GetCapacity() const { return mCapacity; }
+
+private:
+	std::unique_ptr<uint8_t[]> mBuffer;
+	size_t mCapacity;
+	size_t mOffset;
+};
@@ -0,0 +1,174 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	static void SetError(std::string* outError, const std::string& msg)
+	{
+		if (outError)
+		{
+			*outError = msg;
+		}
+	}
+}
+
+FMappedFile::~FMappedFile()
+{
+	Close();
+}
+
+FMappedFile::FMappedFile(FMappedFile&& other) noexcept
+{
+	Swap(other);
+}
+
+FMappedFile& FMappedFile::operator=(FMappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		Swap(other);
+	}
+	return *this;
+}
+
+void FMappedFile::Swap(FMappedFile& other) noexcept
+{
+	std::swap(mData, other.mData);
+	std::swap(mSize, other.mSize);
+#ifdef _WIN32
+	std::swap(mFile, other.mFile);
+	std::swap(mMapping, other.mMapping);
+#endif
+}
+
+#ifdef _WIN32
+
+bool FMappedFile::Open(const std::filesystem::path& path, std::string* outError)
+{
+	Close();
+
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		SetError(outError, "Cannot open file: " + path.u8string());
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+	{
+		CloseHandle(file);
+		SetError(outError, "File is empty or its size cannot be read: " + path.u8string());
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		SetError(outError, "CreateFileMapping failed: " + path.u8string());
+		return false;
+	}
+
+	const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		SetError(outError, "MapViewOfFile failed: " + path.u8string());
+		return false;
+	}
+
+	mFile = file;
+	mMapping = mapping;
+	mData = static_cast<const uint8_t*>(data);
+	mSize = static_cast<uint64_t>(size.QuadPart);
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+	}
+	if (mMapping)
+	{
+		CloseHandle(static_cast<HANDLE>(mMapping));
+	}
+	if (mFile)
+	{
+		CloseHandle(static_cast<HANDLE>(mFile));
+	}
+	mData = nullptr;
+	mSize = 0;
+	mMapping = nullptr;
+	mFile = nullptr;
+}
+
+#else
+
+bool FMappedFile::Open(const std::filesystem::path& path, std::string* outError)
+{
+	Close();
+
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		SetError(outError, "Cannot open file: " + path.u8string());
+		return false;
+	}
+
+	struct stat st = {};
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		SetError(outError, "File is empty or its size cannot be read: " + path.u8string());
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file.
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		SetError(outError, "mmap failed: " + path.u8string());
+		return false;
+	}
+
+	// Mesh data is consumed front to back by the upload; let the kernel read ahead.
+	posix_madvise(data, static_cast<size_t>(st.st_size), POSIX_MADV_SEQUENTIAL);
+
+	mData = static_cast<const uint8_t*>(data);
+	mSize = static_cast<uint64_t>(st.st_size);
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (mData)
+	{
+		munmap(const_cast<uint8_t*>(mData), static_cast<size_t>(mSize));
+	}
+	mData = nullptr;
+	mSize = 0;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Read-only memory mapping of a whole file. The mapping stays valid until Close() or destruction,
+// so views into it (e.g. FCookedMesh) must not outlive the owning FMappedFile.
+class FMappedFile
+{
+public:
+	FMappedFile() = default;
+	~FMappedFile();
+
+	FMappedFile(const FMappedFile&) = delete;
+	FMappedFile& operator=(const FMappedFile&) = delete;
+	FMappedFile(FMappedFile&& other) noexcept;
+	FMappedFile& operator=(FMappedFile&& other) noexcept;
+
+	// Returns true on success; on failure, outError (if provided) will contain a readable reason.
+	bool Open(const std::filesystem::path& path, std::string* outError = nullptr);
+	void Close();
+
+	bool IsOpen() const { return mData != nullptr; }
+	const uint8_t* GetData() const { return mData; }
+	uint64_t GetSize() const { return mSize; }
+
+private:
+	void Swap(FMappedFile& other) noexcept;
+
+	const uint8_t* mData = nullptr;
+	uint64_t mSize = 0;
+#ifdef _WIN32
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
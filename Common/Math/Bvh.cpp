@@ -0,0 +1,894 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "FrustumCulling.h"
+#include "../Jobs/JobSystem.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MENGINE_BVH_SSE 1
+#include <xmmintrin.h>
+#endif
+
+static_assert(FBvh::NodeWidth == 4, "The node tests load one SSE register per bound");
+
+namespace
+{
+	// Subtrees at least this large are built as their own job.
+	const uint32_t ParallelBuildThreshold = 4096;
+	// Below this depth SAH picks the splits; deeper ranges are halved, which bounds the depth (and the
+	// traversal stacks) whatever the input.
+	const uint32_t MaxSahDepth = 48;
+	// Deepest possible collapsed tree times the slots a node can push, with room to spare.
+	const uint32_t TraversalStackSize = 256;
+
+	float SurfaceArea(const float* pMin, const float* pMax)
+	{
+		const float x = pMax[0] - pMin[0];
+		const float y = pMax[1] - pMin[1];
+		const float z = pMax[2] - pMin[2];
+		return x * y + y * z + z * x;
+	}
+
+	// Frustum plane with the box corners it is tested against: the corner farthest along the normal
+	// decides whether a box is outside, the nearest one whether it is entirely inside.
+	struct FPlaneTerms
+	{
+		float N[3];
+		float D;
+		uint32_t FarBound[3];   // Index into (MinX, MinY, MinZ, MaxX, MaxY, MaxZ).
+		uint32_t NearBound[3];
+	};
+
+	void GetPlaneTerms(const FFrustum& frustum, FPlaneTerms planes[FFrustum::PlaneCount])
+	{
+		for (uint32_t p = 0; p < FFrustum::PlaneCount; ++p)
+		{
+			const float n[3] = { frustum.Planes[p].x, frustum.Planes[p].y, frustum.Planes[p].z };
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				planes[p].N[axis] = n[axis];
+				planes[p].FarBound[axis] = n[axis] >= 0.0f ? axis + 3 : axis;
+				planes[p].NearBound[axis] = n[axis] >= 0.0f ? axis : axis + 3;
+			}
+			planes[p].D = frustum.Planes[p].w;
+		}
+	}
+
+	// Box as six floats (MinX, MinY, MinZ, MaxX, MaxY, MaxZ), which is how FBvh stores them.
+	bool IsBoxInFrustum(const float* pBounds, const FPlaneTerms* planes)
+	{
+		for (uint32_t p = 0; p < FFrustum::PlaneCount; ++p)
+		{
+			const FPlaneTerms& plane = planes[p];
+			const float distance = pBounds[plane.FarBound[0]] * plane.N[0] + pBounds[plane.FarBound[1]] * plane.N[1]
+				+ pBounds[plane.FarBound[2]] * plane.N[2] + plane.D;
+			if (distance < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	float SquaredDistanceToBox(const float* pBounds, const float center[3])
+	{
+		float distance = 0.0f;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const float d = std::max(std::max(pBounds[axis] - center[axis], center[axis] - pBounds[axis + 3]), 0.0f);
+			distance += d * d;
+		}
+		return distance;
+	}
+
+	// Ray with the reciprocal direction the slab tests need. Zero components become tiny ones so a
+	// slab the ray runs parallel to gives +/- huge distances instead of NaNs.
+	struct FRay
+	{
+		float Origin[3];
+		float InvDirection[3];
+	};
+
+	FRay MakeRay(const FVector3& origin, const FVector3& direction)
+	{
+		FRay ray;
+		const float o[3] = { origin.x, origin.y, origin.z };
+		const float d[3] = { direction.x, direction.y, direction.z };
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			ray.Origin[axis] = o[axis];
+			const float component = std::fabs(d[axis]) < 1.0e-20f ? std::copysign(1.0e-20f, d[axis]) : d[axis];
+			ray.InvDirection[axis] = 1.0f / component;
+		}
+		return ray;
+	}
+
+	// Entry distance of the ray into the box, or a negative value when it misses or the box lies
+	// beyond maxDistance.
+	float IntersectRayBox(const FRay& ray, const float* pBounds, float maxDistance)
+	{
+		float tNear = 0.0f;
+		float tFar = maxDistance;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const float t0 = (pBounds[axis] - ray.Origin[axis]) * ray.InvDirection[axis];
+			const float t1 = (pBounds[axis + 3] - ray.Origin[axis]) * ray.InvDirection[axis];
+			tNear = std::max(tNear, std::min(t0, t1));
+			tFar = std::min(tFar, std::max(t0, t1));
+		}
+		return tNear <= tFar ? tNear : -1.0f;
+	}
+
+#if MENGINE_BVH_SSE
+	struct FNodeBounds
+	{
+		__m128 Bounds[6];   // MinX, MinY, MinZ, MaxX, MaxY, MaxZ of the four slots.
+	};
+
+	inline FNodeBounds LoadNodeBounds(const float* pMinX)
+	{
+		// FNode keeps the six bound arrays back to back, NodeWidth floats each.
+		FNodeBounds node;
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			node.Bounds[i] = _mm_load_ps(pMinX + i * 4);
+		}
+		return node;
+	}
+
+	// Returns the slots intersecting the frustum; outInsideMask gets those entirely inside it.
+	inline uint32_t TestNodeFrustum(const float* pMinX, const FPlaneTerms* planes, uint32_t& outInsideMask)
+	{
+		const FNodeBounds node = LoadNodeBounds(pMinX);
+		const __m128 zero = _mm_setzero_ps();
+		__m128 outside = zero;
+		__m128 crossing = zero;
+		for (uint32_t p = 0; p < FFrustum::PlaneCount; ++p)
+		{
+			const FPlaneTerms& plane = planes[p];
+			const __m128 nx = _mm_set1_ps(plane.N[0]);
+			const __m128 ny = _mm_set1_ps(plane.N[1]);
+			const __m128 nz = _mm_set1_ps(plane.N[2]);
+			const __m128 d = _mm_set1_ps(plane.D);
+			__m128 farDistance = _mm_add_ps(_mm_mul_ps(node.Bounds[plane.FarBound[0]], nx), _mm_mul_ps(node.Bounds[plane.FarBound[1]], ny));
+			farDistance = _mm_add_ps(_mm_add_ps(farDistance, _mm_mul_ps(node.Bounds[plane.FarBound[2]], nz)), d);
+			__m128 nearDistance = _mm_add_ps(_mm_mul_ps(node.Bounds[plane.NearBound[0]], nx), _mm_mul_ps(node.Bounds[plane.NearBound[1]], ny));
+			nearDistance = _mm_add_ps(_mm_add_ps(nearDistance, _mm_mul_ps(node.Bounds[plane.NearBound[2]], nz)), d);
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(farDistance, zero));
+			crossing = _mm_or_ps(crossing, _mm_cmplt_ps(nearDistance, zero));
+		}
+		const uint32_t visibleMask = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xFu;
+		outInsideMask = visibleMask & ~static_cast<uint32_t>(_mm_movemask_ps(crossing));
+		return visibleMask;
+	}
+
+	inline uint32_t TestNodeSphere(const float* pMinX, const float center[3], float radiusSquared, uint32_t& outInsideMask)
+	{
+		const FNodeBounds node = LoadNodeBounds(pMinX);
+		const __m128 zero = _mm_setzero_ps();
+		__m128 nearest = zero;
+		__m128 farthest = zero;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const __m128 c = _mm_set1_ps(center[axis]);
+			const __m128 below = _mm_sub_ps(node.Bounds[axis], c);
+			const __m128 above = _mm_sub_ps(c, node.Bounds[axis + 3]);
+			const __m128 gap = _mm_max_ps(_mm_max_ps(below, above), zero);
+			const __m128 reach = _mm_max_ps(_mm_sub_ps(c, node.Bounds[axis]), _mm_sub_ps(node.Bounds[axis + 3], c));
+			nearest = _mm_add_ps(nearest, _mm_mul_ps(gap, gap));
+			farthest = _mm_add_ps(farthest, _mm_mul_ps(reach, reach));
+		}
+		const __m128 r2 = _mm_set1_ps(radiusSquared);
+		const uint32_t overlapMask = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(nearest, r2)));
+		outInsideMask = overlapMask & static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(farthest, r2)));
+		return overlapMask;
+	}
+
+	// Slots the ray enters before maxDistance, with their entry distances.
+	inline uint32_t TestNodeRay(const float* pMinX, const FRay& ray, float maxDistance, float outEntry[4])
+	{
+		const FNodeBounds node = LoadNodeBounds(pMinX);
+		__m128 tNear = _mm_setzero_ps();
+		__m128 tFar = _mm_set1_ps(maxDistance);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const __m128 origin = _mm_set1_ps(ray.Origin[axis]);
+			const __m128 invDirection = _mm_set1_ps(ray.InvDirection[axis]);
+			const __m128 t0 = _mm_mul_ps(_mm_sub_ps(node.Bounds[axis], origin), invDirection);
+			const __m128 t1 = _mm_mul_ps(_mm_sub_ps(node.Bounds[axis + 3], origin), invDirection);
+			tNear = _mm_max_ps(tNear, _mm_min_ps(t0, t1));
+			tFar = _mm_min_ps(tFar, _mm_max_ps(t0, t1));
+		}
+		_mm_storeu_ps(outEntry, tNear);
+		return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar)));
+	}
+
+	const char* const KernelName = "sse";
+#else
+	// Slot i of a node as six floats (MinX, ..., MaxZ), gathered from its SoA arrays.
+	inline void GetSlotBounds(const float* pMinX, uint32_t slot, float outBounds[6])
+	{
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			outBounds[i] = pMinX[i * 4 + slot];
+		}
+	}
+
+	inline uint32_t TestNodeFrustum(const float* pMinX, const FPlaneTerms* planes, uint32_t& outInsideMask)
+	{
+		uint32_t visibleMask = 0;
+		outInsideMask = 0;
+		for (uint32_t slot = 0; slot < 4; ++slot)
+		{
+			float bounds[6];
+			GetSlotBounds(pMinX, slot, bounds);
+			bool visible = true;
+			bool inside = true;
+			for (uint32_t p = 0; p < FFrustum::PlaneCount && visible; ++p)
+			{
+				const FPlaneTerms& plane = planes[p];
+				const float farDistance = bounds[plane.FarBound[0]] * plane.N[0] + bounds[plane.FarBound[1]] * plane.N[1]
+					+ bounds[plane.FarBound[2]] * plane.N[2] + plane.D;
+				const float nearDistance = bounds[plane.NearBound[0]] * plane.N[0] + bounds[plane.NearBound[1]] * plane.N[1]
+					+ bounds[plane.NearBound[2]] * plane.N[2] + plane.D;
+				visible = farDistance >= 0.0f;
+				inside = inside && nearDistance >= 0.0f;
+			}
+			visibleMask |= uint32_t(visible) << slot;
+			outInsideMask |= uint32_t(visible && inside) << slot;
+		}
+		return visibleMask;
+	}
+
+	inline uint32_t TestNodeSphere(const float* pMinX, const float center[3], float radiusSquared, uint32_t& outInsideMask)
+	{
+		uint32_t overlapMask = 0;
+		outInsideMask = 0;
+		for (uint32_t slot = 0; slot < 4; ++slot)
+		{
+			float bounds[6];
+			GetSlotBounds(pMinX, slot, bounds);
+			float farthest = 0.0f;
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				const float reach = std::max(center[axis] - bounds[axis], bounds[axis + 3] - center[axis]);
+				farthest += reach * reach;
+			}
+			const bool overlaps = SquaredDistanceToBox(bounds, center) <= radiusSquared;
+			overlapMask |= uint32_t(overlaps) << slot;
+			outInsideMask |= uint32_t(overlaps && farthest <= radiusSquared) << slot;
+		}
+		return overlapMask;
+	}
+
+	inline uint32_t TestNodeRay(const float* pMinX, const FRay& ray, float maxDistance, float outEntry[4])
+	{
+		uint32_t hitMask = 0;
+		for (uint32_t slot = 0; slot < 4; ++slot)
+		{
+			float bounds[6];
+			GetSlotBounds(pMinX, slot, bounds);
+			outEntry[slot] = IntersectRayBox(ray, bounds, maxDistance);
+			hitMask |= uint32_t(outEntry[slot] >= 0.0f) << slot;
+		}
+		return hitMask;
+	}
+
+	const char* const KernelName = "scalar";
+#endif
+
+	inline uint32_t AppendRange(const uint32_t* pIndices, uint32_t first, uint32_t count, uint32_t* pOut, uint32_t outCount)
+	{
+		std::memcpy(pOut + outCount, pIndices + first, count * sizeof(uint32_t));
+		return outCount + count;
+	}
+}
+
+// Binary node of the build; collapsed into FNode afterwards.
+struct FBvh::FBuildNode
+{
+	FBox Bounds;
+	uint32_t Left;      // Right is Left + 1. InvalidNode for a leaf.
+	uint32_t First;
+	uint32_t Count;
+};
+
+// Top-down binned SAH build into a preallocated array of binary nodes. The primitives themselves
+// (bounds, centroid and box index) are partitioned, so every pass over a range reads memory in order.
+// Children are allocated in pairs from an atomic counter so subtrees can be built by different jobs.
+struct FBvhBuilder
+{
+	typedef FBvh::FBox FBox;
+	typedef FBvh::FBuildNode FBuildNode;
+
+	struct FPrimitive
+	{
+		FBox Bounds;
+		float Centroid[3];
+		uint32_t Index;
+	};
+
+	FPrimitive* pPrimitives;
+	FBuildNode* pNodes;
+	std::atomic<uint32_t> NodeCount;
+	FJobSystem* pJobSystem;
+	FJobCounter Counter;
+
+	static void Grow(FBox& bounds, const FBox& other)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			bounds.Min[axis] = std::min(bounds.Min[axis], other.Min[axis]);
+			bounds.Max[axis] = std::max(bounds.Max[axis], other.Max[axis]);
+		}
+	}
+
+	void BuildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+	{
+		FBox bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+		FBox centroidBounds = bounds;
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			const FPrimitive& primitive = pPrimitives[i];
+			Grow(bounds, primitive.Bounds);
+			for (uint32_t axis = 0; axis < 3; ++axis)
+			{
+				centroidBounds.Min[axis] = std::min(centroidBounds.Min[axis], primitive.Centroid[axis]);
+				centroidBounds.Max[axis] = std::max(centroidBounds.Max[axis], primitive.Centroid[axis]);
+			}
+		}
+
+		FBuildNode& node = pNodes[nodeIndex];
+		node.Bounds = bounds;
+		node.First = first;
+		node.Count = count;
+		node.Left = FBvh::InvalidNode;
+		if (count <= FBvh::MaxLeafSize)
+		{
+			return;
+		}
+
+		const uint32_t mid = depth < MaxSahDepth ? PartitionSah(first, count, centroidBounds) : first + count / 2;
+		const uint32_t left = NodeCount.fetch_add(2, std::memory_order_relaxed);
+		node.Left = left;
+
+		if (pJobSystem && count >= ParallelBuildThreshold)
+		{
+			FBvhBuilder* pBuilder = this;
+			const uint32_t leftCount = mid - first;
+			pJobSystem->Run([pBuilder, left, first, leftCount, depth] { pBuilder->BuildNode(left, first, leftCount, depth + 1); }, &Counter);
+		}
+		else
+		{
+			BuildNode(left, first, mid - first, depth + 1);
+		}
+		BuildNode(left + 1, mid, first + count - mid, depth + 1);
+	}
+
+	// Reorders [first, first + count) around the cheapest binned split along the axis the centroids
+	// spread most on, and returns where the right side starts. Halves the range when every centroid
+	// is in one place. (Binning all three axes finds slightly better splits for three times the cost.)
+	uint32_t PartitionSah(uint32_t first, uint32_t count, const FBox& centroidBounds)
+	{
+		uint32_t axis = 0;
+		for (uint32_t a = 1; a < 3; ++a)
+		{
+			if (centroidBounds.Max[a] - centroidBounds.Min[a] > centroidBounds.Max[axis] - centroidBounds.Min[axis])
+			{
+				axis = a;
+			}
+		}
+		const float extent = centroidBounds.Max[axis] - centroidBounds.Min[axis];
+		if (!(extent > 0.0f))
+		{
+			return first + count / 2;
+		}
+
+		struct FBin
+		{
+			FBox Bounds;
+			uint32_t Count;
+		};
+		FBin bins[FBvh::BinCount];
+		for (FBin& bin : bins)
+		{
+			bin.Bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+			bin.Count = 0;
+		}
+		const float axisMin = centroidBounds.Min[axis];
+		const float scale = FBvh::BinCount / extent;
+		for (uint32_t i = first; i < first + count; ++i)
+		{
+			FBin& bin = bins[GetBin(pPrimitives[i], axis, axisMin, scale)];
+			Grow(bin.Bounds, pPrimitives[i].Bounds);
+			++bin.Count;
+		}
+
+		// Right-hand area * count for every split, then a left-to-right sweep for the total cost.
+		float rightCosts[FBvh::BinCount];
+		FBox accumulated = bins[FBvh::BinCount - 1].Bounds;
+		uint32_t accumulatedCount = 0;
+		for (uint32_t split = FBvh::BinCount - 1; split > 0; --split)
+		{
+			Grow(accumulated, bins[split].Bounds);
+			accumulatedCount += bins[split].Count;
+			rightCosts[split] = accumulatedCount ? SurfaceArea(accumulated.Min, accumulated.Max) * accumulatedCount : -1.0f;
+		}
+
+		float bestCost = FLT_MAX;
+		uint32_t bestSplit = 0;
+		accumulated = bins[0].Bounds;
+		accumulatedCount = 0;
+		for (uint32_t split = 1; split < FBvh::BinCount; ++split)
+		{
+			Grow(accumulated, bins[split - 1].Bounds);
+			accumulatedCount += bins[split - 1].Count;
+			if (accumulatedCount == 0 || rightCosts[split] < 0.0f)
+			{
+				continue;
+			}
+			const float cost = SurfaceArea(accumulated.Min, accumulated.Max) * accumulatedCount + rightCosts[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = split;
+			}
+		}
+		if (bestSplit == 0)
+		{
+			return first + count / 2;
+		}
+
+		FPrimitive* pMid = std::partition(pPrimitives + first, pPrimitives + first + count, [=](const FPrimitive& primitive)
+		{
+			return GetBin(primitive, axis, axisMin, scale) < bestSplit;
+		});
+		return static_cast<uint32_t>(pMid - pPrimitives);
+	}
+
+	static uint32_t GetBin(const FPrimitive& primitive, uint32_t axis, float axisMin, float scale)
+	{
+		const uint32_t bin = static_cast<uint32_t>((primitive.Centroid[axis] - axisMin) * scale);
+		return std::min(bin, FBvh::BinCount - 1);
+	}
+};
+
+FBvh::FBvh()
+{
+}
+
+void FBvh::Build(const FAabbArray& boxes, FJobSystem* pJobSystem)
+{
+	const uint32_t count = boxes.GetCount();
+	mNodes.clear();
+	mPrimitiveIndices.resize(count);
+	mPrimitiveBounds.resize(count);
+	mPrimitivePositions.resize(count);
+	mPrimitiveLeafNodes.assign(count, InvalidNode);
+	mRefitMarks.clear();
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::vector<FBvhBuilder::FPrimitive> primitives(count);
+	const float* streams[FAabbArray::StreamCount];
+	for (uint32_t stream = 0; stream < FAabbArray::StreamCount; ++stream)
+	{
+		streams[stream] = boxes.GetStream(stream);
+	}
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		FBvhBuilder::FPrimitive& primitive = primitives[i];
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			const float center = streams[FAabbArray::CenterX + axis][i];
+			const float extent = streams[FAabbArray::ExtentX + axis][i];
+			primitive.Bounds.Min[axis] = center - extent;
+			primitive.Bounds.Max[axis] = center + extent;
+			primitive.Centroid[axis] = center;
+		}
+		primitive.Index = i;
+	}
+
+	// A binary tree with leaves of at least one box has fewer than 2 * count nodes.
+	std::vector<FBuildNode> buildNodes(size_t(count) * 2);
+	FBvhBuilder builder;
+	builder.pPrimitives = primitives.data();
+	builder.pNodes = buildNodes.data();
+	builder.NodeCount.store(1, std::memory_order_relaxed);
+	builder.pJobSystem = pJobSystem;
+	builder.BuildNode(0, 0, count, 0);
+	if (pJobSystem)
+	{
+		pJobSystem->Wait(builder.Counter);
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		mPrimitiveIndices[i] = primitives[i].Index;
+		mPrimitiveBounds[i] = primitives[i].Bounds;
+		mPrimitivePositions[primitives[i].Index] = i;
+	}
+
+	mNodes.reserve(builder.NodeCount.load(std::memory_order_relaxed) / 2 + 1);
+	Collapse(buildNodes.data(), 0, InvalidNode);
+}
+
+// Turns the binary subtree at buildNode into one FNode by repeatedly opening the child with the
+// largest surface area until NodeWidth slots are used, then recurses into the remaining inner slots.
+uint32_t FBvh::Collapse(const FBuildNode* pBuildNodes, uint32_t buildNode, uint32_t parent)
+{
+	uint32_t slots[NodeWidth];
+	uint32_t slotCount = 0;
+	if (pBuildNodes[buildNode].Left == InvalidNode)
+	{
+		slots[slotCount++] = buildNode;
+	}
+	else
+	{
+		slots[slotCount++] = pBuildNodes[buildNode].Left;
+		slots[slotCount++] = pBuildNodes[buildNode].Left + 1;
+	}
+
+	while (slotCount < NodeWidth)
+	{
+		uint32_t widest = NodeWidth;
+		float widestArea = -1.0f;
+		for (uint32_t slot = 0; slot < slotCount; ++slot)
+		{
+			const FBuildNode& candidate = pBuildNodes[slots[slot]];
+			const float area = SurfaceArea(candidate.Bounds.Min, candidate.Bounds.Max);
+			if (candidate.Left != InvalidNode && area > widestArea)
+			{
+				widest = slot;
+				widestArea = area;
+			}
+		}
+		if (widest == NodeWidth)
+		{
+			break;
+		}
+		const uint32_t left = pBuildNodes[slots[widest]].Left;
+		slots[widest] = left;
+		slots[slotCount++] = left + 1;
+	}
+
+	const uint32_t nodeIndex = static_cast<uint32_t>(mNodes.size());
+	mNodes.emplace_back();
+	{
+		FNode& node = mNodes[nodeIndex];
+		const FBox empty = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+		for (uint32_t slot = 0; slot < NodeWidth; ++slot)
+		{
+			SetSlotBounds(node, slot, empty);
+			node.Child[slot] = InvalidNode;
+			node.First[slot] = 0;
+			node.Count[slot] = 0;
+		}
+		node.SlotMask = (1u << slotCount) - 1;
+		node.Parent = parent;
+	}
+
+	for (uint32_t slot = 0; slot < slotCount; ++slot)
+	{
+		const FBuildNode& source = pBuildNodes[slots[slot]];
+		uint32_t child = InvalidNode;
+		if (source.Left != InvalidNode)
+		{
+			// May grow mNodes, so the node is only looked up again afterwards.
+			child = Collapse(pBuildNodes, slots[slot], nodeIndex);
+		}
+		else
+		{
+			for (uint32_t i = source.First; i < source.First + source.Count; ++i)
+			{
+				mPrimitiveLeafNodes[mPrimitiveIndices[i]] = nodeIndex;
+			}
+		}
+
+		FNode& node = mNodes[nodeIndex];
+		SetSlotBounds(node, slot, source.Bounds);
+		node.Child[slot] = child;
+		node.First[slot] = source.First;
+		node.Count[slot] = source.Count;
+	}
+	return nodeIndex;
+}
+
+void FBvh::SetSlotBounds(FNode& node, uint32_t slot, const FBox& bounds)
+{
+	node.MinX[slot] = bounds.Min[0];
+	node.MinY[slot] = bounds.Min[1];
+	node.MinZ[slot] = bounds.Min[2];
+	node.MaxX[slot] = bounds.Max[0];
+	node.MaxY[slot] = bounds.Max[1];
+	node.MaxZ[slot] = bounds.Max[2];
+}
+
+void FBvh::Refit(const FAabbArray& boxes)
+{
+	const float* cx = boxes.GetStream(FAabbArray::CenterX);
+	const float* cy = boxes.GetStream(FAabbArray::CenterY);
+	const float* cz = boxes.GetStream(FAabbArray::CenterZ);
+	const float* ex = boxes.GetStream(FAabbArray::ExtentX);
+	const float* ey = boxes.GetStream(FAabbArray::ExtentY);
+	const float* ez = boxes.GetStream(FAabbArray::ExtentZ);
+	for (uint32_t i = 0; i < GetPrimitiveCount(); ++i)
+	{
+		const uint32_t box = mPrimitiveIndices[i];
+		FBox& bounds = mPrimitiveBounds[i];
+		bounds.Min[0] = cx[box] - ex[box];
+		bounds.Min[1] = cy[box] - ey[box];
+		bounds.Min[2] = cz[box] - ez[box];
+		bounds.Max[0] = cx[box] + ex[box];
+		bounds.Max[1] = cy[box] + ey[box];
+		bounds.Max[2] = cz[box] + ez[box];
+	}
+
+	for (uint32_t node = GetNodeCount(); node-- > 0;)
+	{
+		RefitNode(node);
+	}
+}
+
+void FBvh::Refit(const FAabbArray& boxes, const uint32_t* pChangedIndices, uint32_t changedCount)
+{
+	mRefitMarks.resize(mNodes.size(), 0);
+	mRefitNodes.clear();
+	for (uint32_t i = 0; i < changedCount; ++i)
+	{
+		const uint32_t box = pChangedIndices[i];
+		FBox& bounds = mPrimitiveBounds[mPrimitivePositions[box]];
+		bounds.Min[0] = boxes.GetStream(FAabbArray::CenterX)[box] - boxes.GetStream(FAabbArray::ExtentX)[box];
+		bounds.Min[1] = boxes.GetStream(FAabbArray::CenterY)[box] - boxes.GetStream(FAabbArray::ExtentY)[box];
+		bounds.Min[2] = boxes.GetStream(FAabbArray::CenterZ)[box] - boxes.GetStream(FAabbArray::ExtentZ)[box];
+		bounds.Max[0] = boxes.GetStream(FAabbArray::CenterX)[box] + boxes.GetStream(FAabbArray::ExtentX)[box];
+		bounds.Max[1] = boxes.GetStream(FAabbArray::CenterY)[box] + boxes.GetStream(FAabbArray::ExtentY)[box];
+		bounds.Max[2] = boxes.GetStream(FAabbArray::CenterZ)[box] + boxes.GetStream(FAabbArray::ExtentZ)[box];
+
+		// Each ancestor only needs to be queued once; the walk stops at the first one already queued.
+		for (uint32_t node = mPrimitiveLeafNodes[box]; node != InvalidNode && !mRefitMarks[node]; node = mNodes[node].Parent)
+		{
+			mRefitMarks[node] = 1;
+			mRefitNodes.push_back(node);
+		}
+	}
+
+	// Children have larger indices than their parents.
+	std::sort(mRefitNodes.begin(), mRefitNodes.end(), [](uint32_t a, uint32_t b) { return a > b; });
+	for (uint32_t node : mRefitNodes)
+	{
+		RefitNode(node);
+		mRefitMarks[node] = 0;
+	}
+}
+
+void FBvh::RefitNode(uint32_t nodeIndex)
+{
+	FNode& node = mNodes[nodeIndex];
+	for (uint32_t slot = 0; slot < NodeWidth; ++slot)
+	{
+		if (!(node.SlotMask & (1u << slot)))
+		{
+			continue;
+		}
+
+		FBox bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+		if (node.Child[slot] == InvalidNode)
+		{
+			for (uint32_t i = node.First[slot]; i < node.First[slot] + node.Count[slot]; ++i)
+			{
+				for (uint32_t axis = 0; axis < 3; ++axis)
+				{
+					bounds.Min[axis] = std::min(bounds.Min[axis], mPrimitiveBounds[i].Min[axis]);
+					bounds.Max[axis] = std::max(bounds.Max[axis], mPrimitiveBounds[i].Max[axis]);
+				}
+			}
+		}
+		else
+		{
+			const FNode& child = mNodes[node.Child[slot]];
+			for (uint32_t childSlot = 0; childSlot < NodeWidth; ++childSlot)
+			{
+				if (child.SlotMask & (1u << childSlot))
+				{
+					bounds.Min[0] = std::min(bounds.Min[0], child.MinX[childSlot]);
+					bounds.Min[1] = std::min(bounds.Min[1], child.MinY[childSlot]);
+					bounds.Min[2] = std::min(bounds.Min[2], child.MinZ[childSlot]);
+					bounds.Max[0] = std::max(bounds.Max[0], child.MaxX[childSlot]);
+					bounds.Max[1] = std::max(bounds.Max[1], child.MaxY[childSlot]);
+					bounds.Max[2] = std::max(bounds.Max[2], child.MaxZ[childSlot]);
+				}
+			}
+		}
+		SetSlotBounds(node, slot, bounds);
+	}
+}
+
+uint32_t FBvh::QueryFrustum(const FFrustum& frustum, uint32_t* pOut) const
+{
+	if (mNodes.empty())
+	{
+		return 0;
+	}
+
+	FPlaneTerms planes[FFrustum::PlaneCount];
+	GetPlaneTerms(frustum, planes);
+
+	uint32_t stack[TraversalStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	uint32_t outCount = 0;
+	while (stackSize > 0)
+	{
+		const FNode& node = mNodes[stack[--stackSize]];
+		uint32_t insideMask;
+		const uint32_t visibleMask = TestNodeFrustum(node.MinX, planes, insideMask) & node.SlotMask;
+		for (uint32_t slot = 0; slot < NodeWidth; ++slot)
+		{
+			const uint32_t bit = 1u << slot;
+			if (!(visibleMask & bit))
+			{
+				continue;
+			}
+			if (insideMask & bit)
+			{
+				outCount = AppendRange(mPrimitiveIndices.data(), node.First[slot], node.Count[slot], pOut, outCount);
+			}
+			else if (node.Child[slot] != InvalidNode)
+			{
+				stack[stackSize++] = node.Child[slot];
+			}
+			else
+			{
+				for (uint32_t i = node.First[slot]; i < node.First[slot] + node.Count[slot]; ++i)
+				{
+					pOut[outCount] = mPrimitiveIndices[i];
+					outCount += IsBoxInFrustum(mPrimitiveBounds[i].Min, planes) ? 1 : 0;
+				}
+			}
+		}
+	}
+	return outCount;
+}
+
+uint32_t FBvh::QuerySphere(const FVector3& center, float radius, uint32_t* pOut) const
+{
+	if (mNodes.empty())
+	{
+		return 0;
+	}
+
+	const float c[3] = { center.x, center.y, center.z };
+	const float radiusSquared = radius * radius;
+
+	uint32_t stack[TraversalStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	uint32_t outCount = 0;
+	while (stackSize > 0)
+	{
+		const FNode& node = mNodes[stack[--stackSize]];
+		uint32_t insideMask;
+		const uint32_t overlapMask = TestNodeSphere(node.MinX, c, radiusSquared, insideMask) & node.SlotMask;
+		for (uint32_t slot = 0; slot < NodeWidth; ++slot)
+		{
+			const uint32_t bit = 1u << slot;
+			if (!(overlapMask & bit))
+			{
+				continue;
+			}
+			if (insideMask & bit)
+			{
+				outCount = AppendRange(mPrimitiveIndices.data(), node.First[slot], node.Count[slot], pOut, outCount);
+			}
+			else if (node.Child[slot] != InvalidNode)
+			{
+				stack[stackSize++] = node.Child[slot];
+			}
+			else
+			{
+				for (uint32_t i = node.First[slot]; i < node.First[slot] + node.Count[slot]; ++i)
+				{
+					pOut[outCount] = mPrimitiveIndices[i];
+					outCount += SquaredDistanceToBox(mPrimitiveBounds[i].Min, c) <= radiusSquared ? 1 : 0;
+				}
+			}
+		}
+	}
+	return outCount;
+}
+
+bool FBvh::Raycast(const FVector3& origin, const FVector3& direction, float maxDistance, uint32_t& outIndex, float& outDistance) const
+{
+	if (mNodes.empty())
+	{
+		return false;
+	}
+
+	const FRay ray = MakeRay(origin, direction);
+	float nearest = maxDistance;
+	uint32_t nearestPosition = InvalidNode;
+
+	// Nodes with the distance at which the ray enters them, nearest on top, so once a hit is found
+	// everything farther is skipped.
+	struct FEntry
+	{
+		uint32_t Node;
+		float Distance;
+	};
+	FEntry stack[TraversalStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+	while (stackSize > 0)
+	{
+		const FEntry entry = stack[--stackSize];
+		if (entry.Distance > nearest)
+		{
+			continue;
+		}
+
+		const FNode& node = mNodes[entry.Node];
+		float entryDistances[NodeWidth];
+		const uint32_t hitMask = TestNodeRay(node.MinX, ray, nearest, entryDistances) & node.SlotMask;
+
+		FEntry children[NodeWidth];
+		uint32_t childCount = 0;
+		for (uint32_t slot = 0; slot < NodeWidth; ++slot)
+		{
+			if (!(hitMask & (1u << slot)))
+			{
+				continue;
+			}
+			if (node.Child[slot] != InvalidNode)
+			{
+				children[childCount++] = { node.Child[slot], entryDistances[slot] };
+				continue;
+			}
+			for (uint32_t i = node.First[slot]; i < node.First[slot] + node.Count[slot]; ++i)
+			{
+				const float distance = IntersectRayBox(ray, mPrimitiveBounds[i].Min, nearest);
+				if (distance >= 0.0f && (distance < nearest || nearestPosition == InvalidNode))
+				{
+					nearest = distance;
+					nearestPosition = i;
+				}
+			}
+		}
+
+		// Farthest pushed first (an insertion sort of at most NodeWidth entries).
+		for (uint32_t i = 1; i < childCount; ++i)
+		{
+			const FEntry child = children[i];
+			uint32_t j = i;
+			for (; j > 0 && children[j - 1].Distance < child.Distance; --j)
+			{
+				children[j] = children[j - 1];
+			}
+			children[j] = child;
+		}
+		for (uint32_t i = 0; i < childCount; ++i)
+		{
+			stack[stackSize++] = children[i];
+		}
+	}
+
+	if (nearestPosition == InvalidNode)
+	{
+		return false;
+	}
+	outIndex = mPrimitiveIndices[nearestPosition];
+	outDistance = nearest;
+	return true;
+}
+
+const char* FBvh::GetKernelName()
+{
+	return KernelName;
+}
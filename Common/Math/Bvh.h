@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../MathTypes.h"
+
+class FAabbArray;
+class FJobSystem;
+struct FFrustum;
+
+// Bounding volume hierarchy over the boxes of an FAabbArray, for visibility, picking and distance
+// queries that should not visit every instance.
+//
+// Build() splits top-down with binned SAH into a binary tree, then collapses it into a 4-wide tree
+// whose nodes keep their children's bounds as SoA, so one SSE test covers a whole node. The boxes of
+// every subtree are contiguous in GetPrimitiveIndices(): a node entirely inside a query volume emits
+// its range without visiting anything below it.
+//
+// Refit() recomputes the bounds after boxes moved, keeping the topology. The tree degrades as boxes
+// drift away from where it was built, so rebuild after large changes. Queries are const and may run
+// concurrently with each other, not with Build() or Refit().
+class FBvh
+{
+public:
+	// Children per node.
+	static const uint32_t NodeWidth = 4;
+	// Most boxes in a leaf.
+	static const uint32_t MaxLeafSize = 4;
+	// SAH candidate splits per axis and node.
+	static const uint32_t BinCount = 16;
+
+	FBvh();
+
+	// Builds over every box of boxes. With a job system, large subtrees are split as jobs.
+	void Build(const FAabbArray& boxes, FJobSystem* pJobSystem = nullptr);
+
+	// Recomputes all node bounds from boxes, which must have the count of the last Build().
+	void Refit(const FAabbArray& boxes);
+	// Same, but only for the leaves holding pChangedIndices[0, changedCount) and their ancestors.
+	void Refit(const FAabbArray& boxes, const uint32_t* pChangedIndices, uint32_t changedCount);
+
+	uint32_t GetPrimitiveCount() const { return static_cast<uint32_t>(mPrimitiveIndices.size()); }
+	uint32_t GetNodeCount() const { return static_cast<uint32_t>(mNodes.size()); }
+	// Box indices in tree order.
+	const uint32_t* GetPrimitiveIndices() const { return mPrimitiveIndices.data(); }
+
+	// Write the indices of the boxes intersecting the volume to pOut, in tree order, and return how
+	// many were written. pOut must have room for GetPrimitiveCount() indices.
+	uint32_t QueryFrustum(const FFrustum& frustum, uint32_t* pOut) const;
+	uint32_t QuerySphere(const FVector3& center, float radius, uint32_t* pOut) const;
+
+	// Nearest box hit by origin + t * direction with 0 <= t <= maxDistance. On a hit, outIndex is the
+	// box and outDistance its t (0 when origin is inside it).
+	bool Raycast(const FVector3& origin, const FVector3& direction, float maxDistance, uint32_t& outIndex, float& outDistance) const;
+
+	// Name of the node test kernel ("sse" or "scalar").
+	static const char* GetKernelName();
+
+private:
+	friend struct FBvhBuilder;
+
+	// Marks a leaf slot in FNode::Child, and the missing parent of the root.
+	static constexpr uint32_t InvalidNode = ~0u;
+
+	struct FBox
+	{
+		float Min[3];
+		float Max[3];
+	};
+
+	struct alignas(16) FNode
+	{
+		float MinX[NodeWidth];
+		float MinY[NodeWidth];
+		float MinZ[NodeWidth];
+		float MaxX[NodeWidth];
+		float MaxY[NodeWidth];
+		float MaxZ[NodeWidth];
+		uint32_t Child[NodeWidth];  // Child node, or InvalidNode for a leaf.
+		uint32_t First[NodeWidth];  // The slot's subtree is mPrimitiveIndices[First, First + Count).
+		uint32_t Count[NodeWidth];
+		uint32_t SlotMask;          // Bit i is set when slot i is used.
+		uint32_t Parent;
+	};
+
+	struct FBuildNode;
+	uint32_t Collapse(const FBuildNode* pBuildNodes, uint32_t buildNode, uint32_t parent);
+	void SetSlotBounds(FNode& node, uint32_t slot, const FBox& bounds);
+	void RefitNode(uint32_t nodeIndex);
+
+	// Root first; children are always stored after their parent, so a reverse walk is bottom-up.
+	std::vector<FNode> mNodes;
+	std::vector<uint32_t> mPrimitiveIndices;
+	// Bounds of mPrimitiveIndices[i], in tree order.
+	std::vector<FBox> mPrimitiveBounds;
+	// Per box index: its position in mPrimitiveIndices and the node whose leaf slot holds it.
+	std::vector<uint32_t> mPrimitivePositions;
+	std::vector<uint32_t> mPrimitiveLeafNodes;
+	// Partial refit scratch.
+	std::vector<uint8_t> mRefitMarks;
+	std::vector<uint32_t> mRefitNodes;
+};
@@ -0,0 +1,342 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+
+#include "TransformBatch.h"
+
+#if defined(__AVX__)
+#define MENGINE_FRUSTUM_CULLING_AVX 1
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MENGINE_FRUSTUM_CULLING_SSE 1
+#include <xmmintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// Widest kernel width.
+	const uint32_t StreamPadding = 8;
+
+	uint32_t RoundUp(uint32_t value, uint32_t multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	// Appends base + lane for every set bit of visibleMask. Always writes a slot and advances only
+	// for visible lanes, so there is no branch on the (unpredictable) test result.
+	inline uint32_t AppendVisible(uint32_t visibleMask, uint32_t base, uint32_t laneCount, uint32_t* pOut, uint32_t outCount)
+	{
+		for (uint32_t lane = 0; lane < laneCount; ++lane)
+		{
+			pOut[outCount] = base + lane;
+			outCount += (visibleMask >> lane) & 1;
+		}
+		return outCount;
+	}
+
+	// (a, b, c, d) and (|a|, |b|, |c|) of one plane.
+	struct FPlaneTerms
+	{
+		float N[3];
+		float AbsN[3];
+		float D;
+	};
+
+	void GetPlaneTerms(const FFrustum& frustum, FPlaneTerms planes[FFrustum::PlaneCount])
+	{
+		for (uint32_t p = 0; p < FFrustum::PlaneCount; ++p)
+		{
+			const FVector4& plane = frustum.Planes[p];
+			planes[p].N[0] = plane.x;
+			planes[p].N[1] = plane.y;
+			planes[p].N[2] = plane.z;
+			planes[p].AbsN[0] = std::fabs(plane.x);
+			planes[p].AbsN[1] = std::fabs(plane.y);
+			planes[p].AbsN[2] = std::fabs(plane.z);
+			planes[p].D = plane.w;
+		}
+	}
+
+#if MENGINE_FRUSTUM_CULLING_AVX
+	// Plane terms broadcast to every lane once per CullAabbBatch call.
+	struct FPlaneVectors
+	{
+		__m256 N[3];
+		__m256 AbsN[3];
+		__m256 D;
+	};
+
+	inline void BroadcastPlane(const FPlaneTerms& plane, FPlaneVectors& out)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			out.N[axis] = _mm256_set1_ps(plane.N[axis]);
+			out.AbsN[axis] = _mm256_set1_ps(plane.AbsN[axis]);
+		}
+		out.D = _mm256_set1_ps(plane.D);
+	}
+
+	// A box is outside when it is entirely behind one plane: n.c + |n|.e + d < 0. Most boxes of a
+	// large scene fail the first plane or two, so the block stops once all of its lanes are out.
+	inline uint32_t TestBlock(const float* const* streams, uint32_t index, const FPlaneVectors* planes)
+	{
+		const __m256 cx = _mm256_loadu_ps(streams[FAabbArray::CenterX] + index);
+		const __m256 cy = _mm256_loadu_ps(streams[FAabbArray::CenterY] + index);
+		const __m256 cz = _mm256_loadu_ps(streams[FAabbArray::CenterZ] + index);
+		const __m256 ex = _mm256_loadu_ps(streams[FAabbArray::ExtentX] + index);
+		const __m256 ey = _mm256_loadu_ps(streams[FAabbArray::ExtentY] + index);
+		const __m256 ez = _mm256_loadu_ps(streams[FAabbArray::ExtentZ] + index);
+
+		__m256 outside = _mm256_setzero_ps();
+		for (uint32_t p = 0; p < FFrustum::PlaneCount; ++p)
+		{
+			const FPlaneVectors& plane = planes[p];
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, plane.N[0]), plane.D);
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(cy, plane.N[1]));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, plane.N[2]));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ex, plane.AbsN[0]));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ey, plane.AbsN[1]));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(ez, plane.AbsN[2]));
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+			if (_mm256_movemask_ps(outside) == 0xFF)
+			{
+				return 0;
+			}
+		}
+		return ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & 0xFFu;
+	}
+
+	const uint32_t BlockWidth = 8;
+	const char* const KernelName = "avx";
+#elif MENGINE_FRUSTUM_CULLING_SSE
+	struct FPlaneVectors
+	{
+		__m128 N[3];
+		__m128 AbsN[3];
+		__m128 D;
+	};
+
+	inline void BroadcastPlane(const FPlaneTerms& plane, FPlaneVectors& out)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			out.N[axis] = _mm_set1_ps(plane.N[axis]);
+			out.AbsN[axis] = _mm_set1_ps(plane.AbsN[axis]);
+		}
+		out.D = _mm_set1_ps(plane.D);
+	}
+
+	inline uint32_t TestBlock(const float* const* streams, uint32_t index, const FPlaneVectors* planes)
+	{
+		const __m128 cx = _mm_loadu_ps(streams[FAabbArray::CenterX] + index);
+		const __m128 cy = _mm_loadu_ps(streams[FAabbArray::CenterY] + index);
+		const __m128 cz = _mm_loadu_ps(streams[FAabbArray::CenterZ] + index);
+		const __m128 ex = _mm_loadu_ps(streams[FAabbArray::ExtentX] + index);
+		const __m128 ey = _mm_loadu_ps(streams[FAabbArray::ExtentY] + index);
+		const __m128 ez = _mm_loadu_ps(streams[FAabbArray::ExtentZ] + index);
+
+		__m128 outside = _mm_setzero_ps();
+		for (uint32_t p = 0; p < FFrustum::PlaneCount; ++p)
+		{
+			const FPlaneVectors& plane = planes[p];
+			__m128 distance = _mm_add_ps(_mm_mul_ps(cx, plane.N[0]), plane.D);
+			distance = _mm_add_ps(distance, _mm_mul_ps(cy, plane.N[1]));
+			distance = _mm_add_ps(distance, _mm_mul_ps(cz, plane.N[2]));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ex, plane.AbsN[0]));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ey, plane.AbsN[1]));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ez, plane.AbsN[2]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+			if (_mm_movemask_ps(outside) == 0xF)
+			{
+				return 0;
+			}
+		}
+		return ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xFu;
+	}
+
+	const uint32_t BlockWidth = 4;
+	const char* const KernelName = "sse";
+#else
+	typedef FPlaneTerms FPlaneVectors;
+
+	inline void BroadcastPlane(const FPlaneTerms& plane, FPlaneVectors& out)
+	{
+		out = plane;
+	}
+
+	inline uint32_t TestBlock(const float* const* streams, uint32_t index, const FPlaneVectors* planes)
+	{
+		for (uint32_t p = 0; p < FFrustum::PlaneCount; ++p)
+		{
+			const FPlaneTerms& plane = planes[p];
+			float distance = streams[FAabbArray::CenterX][index] * plane.N[0] + plane.D;
+			distance += streams[FAabbArray::CenterY][index] * plane.N[1];
+			distance += streams[FAabbArray::CenterZ][index] * plane.N[2];
+			distance += streams[FAabbArray::ExtentX][index] * plane.AbsN[0];
+			distance += streams[FAabbArray::ExtentY][index] * plane.AbsN[1];
+			distance += streams[FAabbArray::ExtentZ][index] * plane.AbsN[2];
+			if (distance < 0.0f)
+			{
+				return 0;
+			}
+		}
+		return 1;
+	}
+
+	const uint32_t BlockWidth = 1;
+	const char* const KernelName = "scalar";
+#endif
+}
+
+FFrustum FFrustum::FromViewProjection(const FMatrix4x4& viewProjection)
+{
+	// Clip coordinates are p * M, so each clip component is a dot product with a column of M.
+	const FMatrix4x4& m = viewProjection;
+	const FVector4 x(m._11, m._21, m._31, m._41);
+	const FVector4 y(m._12, m._22, m._32, m._42);
+	const FVector4 z(m._13, m._23, m._33, m._43);
+	const FVector4 w(m._14, m._24, m._34, m._44);
+
+	FFrustum frustum;
+	frustum.Planes[Left] = FVector4(w.x + x.x, w.y + x.y, w.z + x.z, w.w + x.w);      // -w <= x
+	frustum.Planes[Right] = FVector4(w.x - x.x, w.y - x.y, w.z - x.z, w.w - x.w);     // x <= w
+	frustum.Planes[Bottom] = FVector4(w.x + y.x, w.y + y.y, w.z + y.z, w.w + y.w);    // -w <= y
+	frustum.Planes[Top] = FVector4(w.x - y.x, w.y - y.y, w.z - y.z, w.w - y.w);       // y <= w
+	frustum.Planes[Near] = z;                                                          // 0 <= z
+	frustum.Planes[Far] = FVector4(w.x - z.x, w.y - z.y, w.z - z.z, w.w - z.w);       // z <= w
+	return frustum;
+}
+
+FFrustum XM_CALLCONV FFrustum::FromViewProjection(FXMMATRIX view, CXMMATRIX projection)
+{
+	FMatrix4x4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+	return FromViewProjection(viewProjection);
+}
+
+void FAabbArray::Resize(uint32_t count)
+{
+	const uint32_t newCapacity = RoundUp(count, StreamPadding) + StreamPadding;
+	if (newCapacity != mCapacity)
+	{
+		std::vector<float> storage(size_t(newCapacity) * StreamCount, 0.0f);
+		const uint32_t keep = count < mCount ? count : mCount;
+		for (uint32_t s = 0; s < StreamCount; ++s)
+		{
+			for (uint32_t i = 0; i < keep; ++i)
+			{
+				storage[size_t(s) * newCapacity + i] = GetStream(s)[i];
+			}
+		}
+		mStorage.swap(storage);
+		mCapacity = newCapacity;
+	}
+	else
+	{
+		for (uint32_t s = 0; s < StreamCount; ++s)
+		{
+			for (uint32_t i = count; i < mCount; ++i)
+			{
+				GetStream(s)[i] = 0.0f;
+			}
+		}
+	}
+	mCount = count;
+}
+
+void FAabbArray::Set(uint32_t index, const FVector3& boundsMin, const FVector3& boundsMax)
+{
+	GetStream(CenterX)[index] = 0.5f * (boundsMin.x + boundsMax.x);
+	GetStream(CenterY)[index] = 0.5f * (boundsMin.y + boundsMax.y);
+	GetStream(CenterZ)[index] = 0.5f * (boundsMin.z + boundsMax.z);
+	GetStream(ExtentX)[index] = 0.5f * (boundsMax.x - boundsMin.x);
+	GetStream(ExtentY)[index] = 0.5f * (boundsMax.y - boundsMin.y);
+	GetStream(ExtentZ)[index] = 0.5f * (boundsMax.z - boundsMin.z);
+}
+
+void ComputeWorldAabbs(const FAffineTransformArray& transforms, const FVector3& localMin, const FVector3& localMax, FAabbArray& outBoxes)
+{
+	const uint32_t count = transforms.GetCount();
+	outBoxes.Resize(count);
+
+	const float localCenter[3] = { 0.5f * (localMin.x + localMax.x), 0.5f * (localMin.y + localMax.y), 0.5f * (localMin.z + localMax.z) };
+	const float localExtent[3] = { 0.5f * (localMax.x - localMin.x), 0.5f * (localMax.y - localMin.y), 0.5f * (localMax.z - localMin.z) };
+
+	// Row vectors: world = local.x * row0 + local.y * row1 + local.z * row2 + row3, per output axis c.
+	// The loops run over whole streams so the compiler can vectorize them.
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		const float* row0 = transforms.GetStream(FAffineTransformArray::ElementIndex(0, c));
+		const float* row1 = transforms.GetStream(FAffineTransformArray::ElementIndex(1, c));
+		const float* row2 = transforms.GetStream(FAffineTransformArray::ElementIndex(2, c));
+		const float* row3 = transforms.GetStream(FAffineTransformArray::ElementIndex(3, c));
+		float* center = outBoxes.GetStream(FAabbArray::CenterX + c);
+		float* extent = outBoxes.GetStream(FAabbArray::ExtentX + c);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			center[i] = localCenter[0] * row0[i] + localCenter[1] * row1[i] + localCenter[2] * row2[i] + row3[i];
+			extent[i] = localExtent[0] * std::fabs(row0[i]) + localExtent[1] * std::fabs(row1[i]) + localExtent[2] * std::fabs(row2[i]);
+		}
+	}
+}
+
+void UpdateWorldAabbs(const FAffineTransformArray& transforms, const FVector3& localMin, const FVector3& localMax, const uint32_t* pIndices, uint32_t count, FAabbArray& boxes)
+{
+	const float localCenter[3] = { 0.5f * (localMin.x + localMax.x), 0.5f * (localMin.y + localMax.y), 0.5f * (localMin.z + localMax.z) };
+	const float localExtent[3] = { 0.5f * (localMax.x - localMin.x), 0.5f * (localMax.y - localMin.y), 0.5f * (localMax.z - localMin.z) };
+
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		const float* row0 = transforms.GetStream(FAffineTransformArray::ElementIndex(0, c));
+		const float* row1 = transforms.GetStream(FAffineTransformArray::ElementIndex(1, c));
+		const float* row2 = transforms.GetStream(FAffineTransformArray::ElementIndex(2, c));
+		const float* row3 = transforms.GetStream(FAffineTransformArray::ElementIndex(3, c));
+		float* center = boxes.GetStream(FAabbArray::CenterX + c);
+		float* extent = boxes.GetStream(FAabbArray::ExtentX + c);
+		for (uint32_t n = 0; n < count; ++n)
+		{
+			const uint32_t i = pIndices[n];
+			center[i] = localCenter[0] * row0[i] + localCenter[1] * row1[i] + localCenter[2] * row2[i] + row3[i];
+			extent[i] = localExtent[0] * std::fabs(row0[i]) + localExtent[1] * std::fabs(row1[i]) + localExtent[2] * std::fabs(row2[i]);
+		}
+	}
+}
+
+uint32_t CullAabbBatch(const FAabbArray& boxes, uint32_t first, uint32_t end, const FFrustum& frustum, uint32_t* pOutVisible)
+{
+	end = end < boxes.GetCount() ? end : boxes.GetCount();
+
+	FPlaneTerms planeTerms[FFrustum::PlaneCount];
+	GetPlaneTerms(frustum, planeTerms);
+	FPlaneVectors planes[FFrustum::PlaneCount];
+	for (uint32_t p = 0; p < FFrustum::PlaneCount; ++p)
+	{
+		BroadcastPlane(planeTerms[p], planes[p]);
+	}
+
+	const float* streams[FAabbArray::StreamCount];
+	for (uint32_t s = 0; s < FAabbArray::StreamCount; ++s)
+	{
+		streams[s] = boxes.GetStream(s);
+	}
+
+	uint32_t visibleCount = 0;
+	uint32_t index = first;
+	for (; index + BlockWidth <= end; index += BlockWidth)
+	{
+		visibleCount = AppendVisible(TestBlock(streams, index, planes), index, BlockWidth, pOutVisible, visibleCount);
+	}
+	if (index < end)
+	{
+		// Reads past end land in the padding; only the live lanes are appended.
+		visibleCount = AppendVisible(TestBlock(streams, index, planes), index, end - index, pOutVisible, visibleCount);
+	}
+	return visibleCount;
+}
+
+const char* GetFrustumCullingKernelName()
+{
+	return KernelName;
+}
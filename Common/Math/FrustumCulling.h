@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../MathTypes.h"
+
+class FAffineTransformArray;
+
+// View frustum as six planes (a, b, c, d); a point p is inside a plane when a*p.x + b*p.y + c*p.z + d >= 0.
+// The planes are not normalized: the box test only needs the sign.
+struct FFrustum
+{
+	enum EPlane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+	FVector4 Planes[PlaneCount];
+
+	// Planes of a row-vector view * projection (D3D clip space, 0 <= z <= w), e.g. from
+	// FCamera::GetViewMatrix() and FCamera::GetProjectionMatrix().
+	static FFrustum FromViewProjection(const FMatrix4x4& viewProjection);
+	static FFrustum XM_CALLCONV FromViewProjection(DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection);
+};
+
+// Axis-aligned boxes as center/extent SoA streams, padded like FAffineTransformArray so the culling
+// kernel may read a full SIMD width beyond the last box.
+class FAabbArray
+{
+public:
+	enum EStream { CenterX, CenterY, CenterZ, ExtentX, ExtentY, ExtentZ, StreamCount };
+
+	FAabbArray() : mCount(0), mCapacity(0) {}
+
+	// New boxes are empty (zero extent at the origin).
+	void Resize(uint32_t count);
+	uint32_t GetCount() const { return mCount; }
+
+	void Set(uint32_t index, const FVector3& boundsMin, const FVector3& boundsMax);
+
+	const float* GetStream(uint32_t stream) const { return mStorage.data() + size_t(stream) * mCapacity; }
+	float* GetStream(uint32_t stream) { return mStorage.data() + size_t(stream) * mCapacity; }
+
+private:
+	uint32_t mCount;
+	uint32_t mCapacity;
+	std::vector<float> mStorage;
+};
+
+// World bounds of every instance in transforms: the local box [localMin, localMax] transformed by
+// each instance's affine transform (conservative, via the absolute rotation/scale). outBoxes is
+// resized to transforms.GetCount().
+void ComputeWorldAabbs(const FAffineTransformArray& transforms, const FVector3& localMin, const FVector3& localMax, FAabbArray& outBoxes);
+
+// Same, for the instances pIndices[0, count) only, e.g. the ones whose transform changed. boxes must
+// already hold a box for every instance.
+void UpdateWorldAabbs(const FAffineTransformArray& transforms, const FVector3& localMin, const FVector3& localMax, const uint32_t* pIndices, uint32_t count, FAabbArray& boxes);
+
+// Tests boxes [first, end) against frustum, 8 (AVX) or 4 (SSE) at a time, and writes the indices of
+// the boxes that intersect it to pOutVisible in ascending order. Returns how many were written.
+// pOutVisible must have room for end - first indices: slots past the returned count may be written.
+uint32_t CullAabbBatch(const FAabbArray& boxes, uint32_t first, uint32_t end, const FFrustum& frustum, uint32_t* pOutVisible);
+
+// Name of the kernel CullAabbBatch was compiled with ("avx", "sse" or "scalar").
+const char* GetFrustumCullingKernelName();
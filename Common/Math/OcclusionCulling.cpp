@@ -0,0 +1,360 @@
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "FrustumCulling.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MENGINE_OCCLUSION_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	uint32_t RoundUp(uint32_t value, uint32_t multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	// Corner i of a box has x = +extent when bit 0 is set, y when bit 1 is set, z when bit 2 is set.
+	const uint32_t BoxCornerCount = 8;
+	const uint32_t BoxIndices[36] =
+	{
+		0, 1, 3, 0, 3, 2,    // -z
+		4, 6, 7, 4, 7, 5,    // +z
+		0, 4, 5, 0, 5, 1,    // -y
+		2, 3, 7, 2, 7, 6,    // +y
+		0, 2, 6, 0, 6, 4,    // -x
+		1, 5, 7, 1, 7, 3,    // +x
+	};
+
+	// Screen-space vertex: pixel coordinates (y down) and depth.
+	struct FScreenVertex
+	{
+		float X, Y, Z;
+	};
+
+	// Edge function of a -> b, positive on the inside of a triangle with positive area:
+	// E(x, y) = A * x + B * y + C.
+	struct FEdge
+	{
+		float A, B, C;
+
+		FEdge(const FScreenVertex& a, const FScreenVertex& b)
+		{
+			A = a.Y - b.Y;
+			B = b.X - a.X;
+			C = -(A * a.X + B * a.Y);
+		}
+	};
+}
+
+FOcclusionBuffer::FOcclusionBuffer(uint32_t width, uint32_t height) :
+	mWidth(RoundUp(std::max(width, 1u), TileSize)),
+	mHeight(RoundUp(std::max(height, 1u), TileSize)),
+	mTileColumnCount(mWidth / TileSize),
+	mTileRowCount(mHeight / TileSize),
+	mViewProjection(),
+	mDepth(size_t(mWidth) * mHeight, 1.0f),
+	mTileMaxDepth(size_t(mTileColumnCount) * mTileRowCount, 1.0f),
+	mRasterizedTriangleCount(0)
+{
+}
+
+void FOcclusionBuffer::Clear(const FMatrix4x4& viewProjection)
+{
+	mViewProjection = viewProjection;
+	std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+	std::fill(mTileMaxDepth.begin(), mTileMaxDepth.end(), 1.0f);
+	mRasterizedTriangleCount = 0;
+}
+
+FOcclusionBuffer::FClipVertex FOcclusionBuffer::TransformToClip(float x, float y, float z) const
+{
+	const FMatrix4x4& m = mViewProjection;
+	FClipVertex v;
+	v.X = x * m._11 + y * m._21 + z * m._31 + m._41;
+	v.Y = x * m._12 + y * m._22 + z * m._32 + m._42;
+	v.Z = x * m._13 + y * m._23 + z * m._33 + m._43;
+	v.W = x * m._14 + y * m._24 + z * m._34 + m._44;
+	return v;
+}
+
+void FOcclusionBuffer::RenderOccluderBox(const FVector3& center, const FVector3& extent)
+{
+	FClipVertex corners[BoxCornerCount];
+	for (uint32_t i = 0; i < BoxCornerCount; ++i)
+	{
+		corners[i] = TransformToClip(
+			center.x + ((i & 1) ? extent.x : -extent.x),
+			center.y + ((i & 2) ? extent.y : -extent.y),
+			center.z + ((i & 4) ? extent.z : -extent.z));
+	}
+	for (uint32_t i = 0; i < 36; i += 3)
+	{
+		RasterizeTriangle(corners[BoxIndices[i]], corners[BoxIndices[i + 1]], corners[BoxIndices[i + 2]]);
+	}
+}
+
+void FOcclusionBuffer::RenderOccluderTriangles(const FVector3* pVertices, const uint32_t* pIndices, uint32_t triangleCount)
+{
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		FClipVertex clip[3];
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			const FVector3& v = pVertices[pIndices[t * 3 + k]];
+			clip[k] = TransformToClip(v.x, v.y, v.z);
+		}
+		RasterizeTriangle(clip[0], clip[1], clip[2]);
+	}
+}
+
+void FOcclusionBuffer::RasterizeTriangle(const FClipVertex& c0, const FClipVertex& c1, const FClipVertex& c2)
+{
+	// In front of the near plane only; see the class comment.
+	if (c0.Z < 0.0f || c1.Z < 0.0f || c2.Z < 0.0f || c0.W <= 0.0f || c1.W <= 0.0f || c2.W <= 0.0f)
+	{
+		return;
+	}
+
+	const float halfWidth = 0.5f * mWidth;
+	const float halfHeight = 0.5f * mHeight;
+	FScreenVertex v[3];
+	const FClipVertex* clip[3] = { &c0, &c1, &c2 };
+	for (uint32_t k = 0; k < 3; ++k)
+	{
+		const float invW = 1.0f / clip[k]->W;
+		v[k].X = (clip[k]->X * invW + 1.0f) * halfWidth;
+		v[k].Y = (1.0f - clip[k]->Y * invW) * halfHeight;
+		v[k].Z = clip[k]->Z * invW;
+	}
+
+	// Either winding: both faces of a closed occluder are drawn and the nearer one wins.
+	float area = (v[1].X - v[0].X) * (v[2].Y - v[0].Y) - (v[1].Y - v[0].Y) * (v[2].X - v[0].X);
+	if (area < 0.0f)
+	{
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+	if (!(area > 0.0f))
+	{
+		return;
+	}
+
+	// Pixel bounds, clamped in float first so far-off vertices cannot overflow the conversion.
+	const float minX = std::max(std::min(std::min(v[0].X, v[1].X), v[2].X), 0.0f);
+	const float maxX = std::min(std::max(std::max(v[0].X, v[1].X), v[2].X), float(mWidth - 1));
+	const float minY = std::max(std::min(std::min(v[0].Y, v[1].Y), v[2].Y), 0.0f);
+	const float maxY = std::min(std::max(std::max(v[0].Y, v[1].Y), v[2].Y), float(mHeight - 1));
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+	const int32_t x0 = static_cast<int32_t>(minX);
+	const int32_t x1 = static_cast<int32_t>(maxX);
+	const int32_t y0 = static_cast<int32_t>(minY);
+	const int32_t y1 = static_cast<int32_t>(maxY);
+
+	// Edge k is opposite vertex k, so E_k / area is vertex k's barycentric weight and depth is a plane too.
+	const FEdge e0(v[1], v[2]);
+	const FEdge e1(v[2], v[0]);
+	const FEdge e2(v[0], v[1]);
+	const float invArea = 1.0f / area;
+	const float zA = (e0.A * v[0].Z + e1.A * v[1].Z + e2.A * v[2].Z) * invArea;
+	const float zB = (e0.B * v[0].Z + e1.B * v[1].Z + e2.B * v[2].Z) * invArea;
+	const float zC = (e0.C * v[0].Z + e1.C * v[1].Z + e2.C * v[2].Z) * invArea;
+
+	++mRasterizedTriangleCount;
+
+#if MENGINE_OCCLUSION_SSE
+	// Four pixels per step. Rows are a multiple of TileSize wide, so aligned groups never leave the row,
+	// and pixels of a group outside the triangle's bounds are outside the triangle.
+	const __m128 laneCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 a0 = _mm_set1_ps(e0.A);
+	const __m128 a1 = _mm_set1_ps(e1.A);
+	const __m128 a2 = _mm_set1_ps(e2.A);
+	const __m128 za = _mm_set1_ps(zA);
+	const int32_t groupX0 = x0 & ~3;
+	for (int32_t y = y0; y <= y1; ++y)
+	{
+		const float py = y + 0.5f;
+		const __m128 row0 = _mm_set1_ps(e0.B * py + e0.C);
+		const __m128 row1 = _mm_set1_ps(e1.B * py + e1.C);
+		const __m128 row2 = _mm_set1_ps(e2.B * py + e2.C);
+		const __m128 rowZ = _mm_set1_ps(zB * py + zC);
+		float* pRow = mDepth.data() + size_t(y) * mWidth;
+		for (int32_t x = groupX0; x <= x1; x += 4)
+		{
+			const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), laneCenters);
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, px), row0), zero);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, px), row1), zero));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, px), row2), zero));
+			if (_mm_movemask_ps(inside) == 0)
+			{
+				continue;
+			}
+
+			const __m128 depth = _mm_add_ps(_mm_mul_ps(za, px), rowZ);
+			const __m128 old = _mm_loadu_ps(pRow + x);
+			const __m128 nearer = _mm_min_ps(old, depth);
+			_mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+		}
+	}
+#else
+	for (int32_t y = y0; y <= y1; ++y)
+	{
+		const float py = y + 0.5f;
+		float* pRow = mDepth.data() + size_t(y) * mWidth;
+		for (int32_t x = x0; x <= x1; ++x)
+		{
+			const float px = x + 0.5f;
+			if (e0.A * px + e0.B * py + e0.C >= 0.0f && e1.A * px + e1.B * py + e1.C >= 0.0f && e2.A * px + e2.B * py + e2.C >= 0.0f)
+			{
+				pRow[x] = std::min(pRow[x], zA * px + zB * py + zC);
+			}
+		}
+	}
+#endif
+}
+
+void FOcclusionBuffer::BuildHierarchy()
+{
+	for (uint32_t ty = 0; ty < mTileRowCount; ++ty)
+	{
+		for (uint32_t tx = 0; tx < mTileColumnCount; ++tx)
+		{
+			const float* pTile = mDepth.data() + size_t(ty) * TileSize * mWidth + tx * TileSize;
+#if MENGINE_OCCLUSION_SSE
+			__m128 farthest = _mm_setzero_ps();
+			for (uint32_t row = 0; row < TileSize; ++row)
+			{
+				const float* pRow = pTile + size_t(row) * mWidth;
+				farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(pRow), _mm_loadu_ps(pRow + 4)));
+			}
+			farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+			farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+			mTileMaxDepth[ty * mTileColumnCount + tx] = _mm_cvtss_f32(farthest);
+#else
+			float farthest = 0.0f;
+			for (uint32_t row = 0; row < TileSize; ++row)
+			{
+				for (uint32_t column = 0; column < TileSize; ++column)
+				{
+					farthest = std::max(farthest, pTile[size_t(row) * mWidth + column]);
+				}
+			}
+			mTileMaxDepth[ty * mTileColumnCount + tx] = farthest;
+#endif
+		}
+	}
+}
+
+bool FOcclusionBuffer::IsBoxVisible(const FVector3& center, const FVector3& extent) const
+{
+	// Screen rectangle and nearest depth of the box's corners.
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+	float minZ = FLT_MAX;
+	for (uint32_t i = 0; i < BoxCornerCount; ++i)
+	{
+		const FClipVertex corner = TransformToClip(
+			center.x + ((i & 1) ? extent.x : -extent.x),
+			center.y + ((i & 2) ? extent.y : -extent.y),
+			center.z + ((i & 4) ? extent.z : -extent.z));
+		if (corner.Z < 0.0f || corner.W <= 0.0f)
+		{
+			return true;
+		}
+
+		const float invW = 1.0f / corner.W;
+		const float x = corner.X * invW;
+		const float y = corner.Y * invW;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, corner.Z * invW);
+	}
+
+	// To pixels (y flips), covering every pixel the rectangle touches.
+	const float halfWidth = 0.5f * mWidth;
+	const float halfHeight = 0.5f * mHeight;
+	const float left = std::max((minX + 1.0f) * halfWidth, 0.0f);
+	const float right = std::min((maxX + 1.0f) * halfWidth, float(mWidth - 1));
+	const float top = std::max((1.0f - maxY) * halfHeight, 0.0f);
+	const float bottom = std::min((1.0f - minY) * halfHeight, float(mHeight - 1));
+	if (left > right || top > bottom)
+	{
+		return false;
+	}
+	const uint32_t x0 = static_cast<uint32_t>(left);
+	const uint32_t x1 = static_cast<uint32_t>(right);
+	const uint32_t y0 = static_cast<uint32_t>(top);
+	const uint32_t y1 = static_cast<uint32_t>(bottom);
+
+	// A tile whose farthest occluder is nearer than the box hides its part of the box; otherwise
+	// look at the pixels of the tile the box covers.
+	for (uint32_t ty = y0 / TileSize; ty <= y1 / TileSize; ++ty)
+	{
+		for (uint32_t tx = x0 / TileSize; tx <= x1 / TileSize; ++tx)
+		{
+			if (mTileMaxDepth[ty * mTileColumnCount + tx] < minZ)
+			{
+				continue;
+			}
+
+			const uint32_t px0 = std::max(x0, tx * TileSize);
+			const uint32_t px1 = std::min(x1, tx * TileSize + TileSize - 1);
+			const uint32_t py0 = std::max(y0, ty * TileSize);
+			const uint32_t py1 = std::min(y1, ty * TileSize + TileSize - 1);
+			for (uint32_t py = py0; py <= py1; ++py)
+			{
+				const float* pRow = mDepth.data() + size_t(py) * mWidth;
+				for (uint32_t px = px0; px <= px1; ++px)
+				{
+					if (pRow[px] >= minZ)
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+uint32_t FOcclusionBuffer::CullOccludedAabbs(const FAabbArray& boxes, uint32_t* pIndices, uint32_t count) const
+{
+	const float* cx = boxes.GetStream(FAabbArray::CenterX);
+	const float* cy = boxes.GetStream(FAabbArray::CenterY);
+	const float* cz = boxes.GetStream(FAabbArray::CenterZ);
+	const float* ex = boxes.GetStream(FAabbArray::ExtentX);
+	const float* ey = boxes.GetStream(FAabbArray::ExtentY);
+	const float* ez = boxes.GetStream(FAabbArray::ExtentZ);
+
+	uint32_t visibleCount = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t box = pIndices[i];
+		if (IsBoxVisible(FVector3(cx[box], cy[box], cz[box]), FVector3(ex[box], ey[box], ez[box])))
+		{
+			pIndices[visibleCount++] = box;
+		}
+	}
+	return visibleCount;
+}
+
+const char* FOcclusionBuffer::GetKernelName()
+{
+#if MENGINE_OCCLUSION_SSE
+	return "sse";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../MathTypes.h"
+
+class FAabbArray;
+
+// Low-resolution software depth buffer for CPU occlusion culling. A frame renders a few large
+// occluders into it, builds the tile hierarchy, then tests boxes against it before any draw is
+// recorded:
+//
+//	buffer.Clear(viewProjection);
+//	buffer.RenderOccluderBox(...);   // a few times
+//	buffer.BuildHierarchy();
+//	visibleCount = buffer.CullOccludedAabbs(boxes, pVisible, visibleCount);
+//
+// Depth is D3D clip z / w (0 near, 1 far) and keeps the nearest occluder per pixel. Occluders must lie
+// inside the geometry they stand for (a box inside a building, not its bounds), otherwise visible
+// objects behind the gaps get culled. Triangles crossing the near plane are skipped, which only
+// makes the buffer see less, never more.
+class FOcclusionBuffer
+{
+public:
+	// The hierarchy keeps the farthest depth of each TileSize x TileSize block of pixels.
+	static const uint32_t TileSize = 8;
+
+	// width and height are rounded up to whole tiles.
+	FOcclusionBuffer(uint32_t width = 256, uint32_t height = 128);
+
+	// Resets every pixel to the far plane and sets the row-vector view * projection used by the
+	// render and test calls that follow.
+	void Clear(const FMatrix4x4& viewProjection);
+
+	// Rasterizes the 12 triangles of a world-space box (center +/- extent).
+	void RenderOccluderBox(const FVector3& center, const FVector3& extent);
+	// Rasterizes an indexed world-space triangle list.
+	void RenderOccluderTriangles(const FVector3* pVertices, const uint32_t* pIndices, uint32_t triangleCount);
+
+	// Must be called after the last occluder and before the first test.
+	void BuildHierarchy();
+
+	// False when every pixel the box covers has an occluder in front of it. Boxes crossing the near
+	// plane are always visible.
+	bool IsBoxVisible(const FVector3& center, const FVector3& extent) const;
+
+	// Keeps the entries of pIndices[0, count) whose box in boxes is visible, compacted in place and
+	// in order. Returns how many were kept.
+	uint32_t CullOccludedAabbs(const FAabbArray& boxes, uint32_t* pIndices, uint32_t count) const;
+
+	uint32_t GetWidth() const { return mWidth; }
+	uint32_t GetHeight() const { return mHeight; }
+	const float* GetDepth() const { return mDepth.data(); }
+	uint32_t GetRasterizedTriangleCount() const { return mRasterizedTriangleCount; }
+
+	// Name of the rasterizer kernel ("sse" or "scalar").
+	static const char* GetKernelName();
+
+private:
+	struct FClipVertex
+	{
+		float X, Y, Z, W;
+	};
+
+	FClipVertex TransformToClip(float x, float y, float z) const;
+	void RasterizeTriangle(const FClipVertex& v0, const FClipVertex& v1, const FClipVertex& v2);
+
+	uint32_t mWidth;
+	uint32_t mHeight;
+	uint32_t mTileColumnCount;
+	uint32_t mTileRowCount;
+	FMatrix4x4 mViewProjection;
+	std::vector<float> mDepth;        // mWidth * mHeight, row-major, top row first.
+	std::vector<float> mTileMaxDepth; // mTileColumnCount * mTileRowCount.
+	uint32_t mRasterizedTriangleCount;
+};
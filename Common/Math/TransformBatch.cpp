@@ -0,0 +1,352 @@
+#include "TransformBatch.h"
+
+#include <cstring>
+
+#if defined(__AVX__)
+#define MENGINE_TRANSFORM_BATCH_AVX 1
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MENGINE_TRANSFORM_BATCH_SSE 1
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	// Widest kernel width plus the over-read of a tail block that starts anywhere.
+	const uint32_t StreamPadding = 8;
+
+	uint32_t RoundUp(uint32_t value, uint32_t multiple)
+	{
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+#if MENGINE_TRANSFORM_BATCH_SSE || MENGINE_TRANSFORM_BATCH_AVX
+	inline void Store4(float* dst, __m128 value, bool streaming)
+	{
+		if (streaming)
+		{
+			_mm_stream_ps(dst, value);
+		}
+		else
+		{
+			_mm_storeu_ps(dst, value);
+		}
+	}
+
+	// Four instances' results, with mvp[c][r] holding MVP[r][c] per lane. Transposes each column into
+	// the instances' rows of the transposed matrix, then stores one instance at a time so every 64-byte
+	// line is written completely before the next one (a full write-combining buffer per instance).
+	inline void StoreInstances4(__m128 mvp[4][4], uint8_t* pOut, size_t outStride, uint32_t laneCount, bool streaming)
+	{
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			_MM_TRANSPOSE4_PS(mvp[c][0], mvp[c][1], mvp[c][2], mvp[c][3]);
+		}
+		for (uint32_t lane = 0; lane < laneCount; ++lane)
+		{
+			float* pInstance = reinterpret_cast<float*>(pOut + lane * outStride);
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				Store4(pInstance + c * 4, mvp[c][lane], streaming);
+			}
+		}
+	}
+#endif
+
+#if MENGINE_TRANSFORM_BATCH_AVX
+	inline __m256 MulAdd(__m256 a, __m256 b, __m256 c)
+	{
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+		return _mm256_fmadd_ps(a, b, c);
+#else
+		return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+	}
+
+	void ComputeBlock(const float* const* streams, uint32_t index, const FMatrix4x4& vp, uint8_t* pOut, size_t outStride, uint32_t laneCount, bool streaming)
+	{
+		__m256 m[4][3];
+		for (uint32_t r = 0; r < 4; ++r)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				m[r][k] = _mm256_loadu_ps(streams[FAffineTransformArray::ElementIndex(r, k)] + index);
+			}
+		}
+
+		__m128 low[4][4];
+		__m128 high[4][4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			const __m256 vp0 = _mm256_set1_ps(vp.m[0][c]);
+			const __m256 vp1 = _mm256_set1_ps(vp.m[1][c]);
+			const __m256 vp2 = _mm256_set1_ps(vp.m[2][c]);
+			const __m256 vp3 = _mm256_set1_ps(vp.m[3][c]);
+
+			for (uint32_t r = 0; r < 4; ++r)
+			{
+				__m256 value = MulAdd(m[r][2], vp2, (r == 3) ? vp3 : _mm256_setzero_ps());
+				value = MulAdd(m[r][1], vp1, value);
+				value = MulAdd(m[r][0], vp0, value);
+				low[c][r] = _mm256_castps256_ps128(value);
+				high[c][r] = _mm256_extractf128_ps(value, 1);
+			}
+		}
+
+		// Lanes 0-3, then 4-7.
+		StoreInstances4(low, pOut, outStride, laneCount < 4 ? laneCount : 4, streaming);
+		if (laneCount > 4)
+		{
+			StoreInstances4(high, pOut + 4 * outStride, outStride, laneCount - 4, streaming);
+		}
+	}
+
+	const uint32_t BlockWidth = 8;
+	const char* const KernelName = "avx";
+#elif MENGINE_TRANSFORM_BATCH_SSE
+	void ComputeBlock(const float* const* streams, uint32_t index, const FMatrix4x4& vp, uint8_t* pOut, size_t outStride, uint32_t laneCount, bool streaming)
+	{
+		__m128 m[4][3];
+		for (uint32_t r = 0; r < 4; ++r)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				m[r][k] = _mm_loadu_ps(streams[FAffineTransformArray::ElementIndex(r, k)] + index);
+			}
+		}
+
+		__m128 mvp[4][4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			const __m128 vp0 = _mm_set1_ps(vp.m[0][c]);
+			const __m128 vp1 = _mm_set1_ps(vp.m[1][c]);
+			const __m128 vp2 = _mm_set1_ps(vp.m[2][c]);
+
+			for (uint32_t r = 0; r < 4; ++r)
+			{
+				mvp[c][r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[r][0], vp0), _mm_mul_ps(m[r][1], vp1)), _mm_mul_ps(m[r][2], vp2));
+			}
+			mvp[c][3] = _mm_add_ps(mvp[c][3], _mm_set1_ps(vp.m[3][c]));
+		}
+
+		StoreInstances4(mvp, pOut, outStride, laneCount, streaming);
+	}
+
+	const uint32_t BlockWidth = 4;
+	const char* const KernelName = "sse";
+#endif
+
+#if MENGINE_TRANSFORM_BATCH_SSE || MENGINE_TRANSFORM_BATCH_AVX
+	void GetStreams(const FAffineTransformArray& models, const float* streams[FAffineTransformArray::ElementCount])
+	{
+		for (uint32_t e = 0; e < FAffineTransformArray::ElementCount; ++e)
+		{
+			streams[e] = models.GetStream(e);
+		}
+	}
+
+	// Copies the transforms of up to BlockWidth indexed instances into a block the contiguous kernel
+	// can read; unused lanes stay zero and are never stored.
+	struct FGatheredBlock
+	{
+		alignas(32) float Elements[FAffineTransformArray::ElementCount][BlockWidth];
+		const float* Streams[FAffineTransformArray::ElementCount];
+
+		FGatheredBlock(const FAffineTransformArray& models, const uint32_t* pIndices, uint32_t laneCount)
+		{
+			for (uint32_t e = 0; e < FAffineTransformArray::ElementCount; ++e)
+			{
+				const float* stream = models.GetStream(e);
+				for (uint32_t lane = 0; lane < BlockWidth; ++lane)
+				{
+					Elements[e][lane] = lane < laneCount ? stream[pIndices[lane]] : 0.0f;
+				}
+				Streams[e] = Elements[e];
+			}
+		}
+	};
+#else
+	// One instance at a time, for targets without SSE.
+	void ComputeTransposedMvpScalar(const FAffineTransformArray& models, uint32_t index, const FMatrix4x4& vp, float* out)
+	{
+		float m[4][3];
+		for (uint32_t r = 0; r < 4; ++r)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				m[r][c] = models.GetStream(FAffineTransformArray::ElementIndex(r, c))[index];
+			}
+		}
+
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			for (uint32_t r = 0; r < 4; ++r)
+			{
+				float value = m[r][0] * vp.m[0][c] + m[r][1] * vp.m[1][c] + m[r][2] * vp.m[2][c];
+				value += (r == 3) ? vp.m[3][c] : 0.0f;
+				out[c * 4 + r] = value;
+			}
+		}
+	}
+
+	const char* const KernelName = "scalar";
+#endif
+}
+
+void FAffineTransformArray::Resize(uint32_t count)
+{
+	const uint32_t newCapacity = RoundUp(count, StreamPadding) + StreamPadding;
+	if (newCapacity > mCapacity)
+	{
+		Reallocate(newCapacity, count < mCount ? count : mCount);
+	}
+	else
+	{
+		// Reset the slots the shrink released to identity, so the padding guarantee holds.
+		FMatrix4x4 identity = {};
+		identity.m[0][0] = identity.m[1][1] = identity.m[2][2] = identity.m[3][3] = 1.0f;
+		for (uint32_t i = count; i < mCount; ++i)
+		{
+			Set(i, identity);
+		}
+	}
+	mCount = count;
+}
+
+void FAffineTransformArray::Reserve(uint32_t count)
+{
+	const uint32_t newCapacity = RoundUp(count, StreamPadding) + StreamPadding;
+	if (newCapacity > mCapacity)
+	{
+		Reallocate(newCapacity, mCount);
+	}
+}
+
+void FAffineTransformArray::Reallocate(uint32_t newCapacity, uint32_t keep)
+{
+	// Room for the 32-byte alignment of the base pointer.
+	std::vector<float> storage(size_t(newCapacity) * ElementCount + 8, 0.0f);
+	const uintptr_t base = reinterpret_cast<uintptr_t>(storage.data());
+	float* newBase = reinterpret_cast<float*>((base + 31) & ~uintptr_t(31));
+
+	// Identity everywhere, then keep what survives the resize.
+	for (uint32_t r = 0; r < 3; ++r)
+	{
+		float* stream = newBase + size_t(ElementIndex(r, r)) * newCapacity;
+		for (uint32_t i = 0; i < newCapacity; ++i)
+		{
+			stream[i] = 1.0f;
+		}
+	}
+	for (uint32_t e = 0; e < ElementCount && keep > 0; ++e)
+	{
+		std::memcpy(newBase + size_t(e) * newCapacity, GetStream(e), keep * sizeof(float));
+	}
+
+	mStorage.swap(storage);
+	mCapacity = newCapacity;
+}
+
+const float* FAffineTransformArray::GetBase() const
+{
+	const uintptr_t base = reinterpret_cast<uintptr_t>(mStorage.data());
+	return reinterpret_cast<const float*>((base + 31) & ~uintptr_t(31));
+}
+
+void FAffineTransformArray::Set(uint32_t index, const FMatrix4x4& matrix)
+{
+	for (uint32_t r = 0; r < 4; ++r)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			GetStream(ElementIndex(r, c))[index] = matrix.m[r][c];
+		}
+	}
+}
+
+FMatrix4x4 FAffineTransformArray::Get(uint32_t index) const
+{
+	FMatrix4x4 matrix = {};
+	for (uint32_t r = 0; r < 4; ++r)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			matrix.m[r][c] = GetStream(ElementIndex(r, c))[index];
+		}
+	}
+	matrix.m[3][3] = 1.0f;
+	return matrix;
+}
+
+void ComputeTransposedMvpBatch(const FAffineTransformArray& models, uint32_t first, uint32_t end,
+	const FMatrix4x4& viewProjection, void* pOut, size_t outStride, bool useStreamingStores)
+{
+	end = end < models.GetCount() ? end : models.GetCount();
+	uint8_t* pBytes = static_cast<uint8_t*>(pOut);
+
+#if MENGINE_TRANSFORM_BATCH_SSE || MENGINE_TRANSFORM_BATCH_AVX
+	// Non-temporal stores need 16-byte aligned destinations.
+	const bool aligned = ((reinterpret_cast<uintptr_t>(pOut) | outStride) & 15) == 0;
+	const bool streaming = useStreamingStores && aligned;
+
+	const float* streams[FAffineTransformArray::ElementCount];
+	GetStreams(models, streams);
+
+	uint32_t index = first;
+	for (; index + BlockWidth <= end; index += BlockWidth)
+	{
+		ComputeBlock(streams, index, viewProjection, pBytes + size_t(index) * outStride, outStride, BlockWidth, streaming);
+	}
+	if (index < end)
+	{
+		// Reads past end land in the identity padding; only the live lanes are stored.
+		ComputeBlock(streams, index, viewProjection, pBytes + size_t(index) * outStride, outStride, end - index, streaming);
+	}
+
+	if (streaming)
+	{
+		_mm_sfence();
+	}
+#else
+	(void)useStreamingStores;
+	for (uint32_t index = first; index < end; ++index)
+	{
+		ComputeTransposedMvpScalar(models, index, viewProjection, reinterpret_cast<float*>(pBytes + size_t(index) * outStride));
+	}
+#endif
+}
+
+void ComputeTransposedMvpGather(const FAffineTransformArray& models, const uint32_t* pIndices, uint32_t count,
+	const FMatrix4x4& viewProjection, void* pOut, size_t outStride, bool useStreamingStores)
+{
+	uint8_t* pBytes = static_cast<uint8_t*>(pOut);
+
+#if MENGINE_TRANSFORM_BATCH_SSE || MENGINE_TRANSFORM_BATCH_AVX
+	const bool aligned = ((reinterpret_cast<uintptr_t>(pOut) | outStride) & 15) == 0;
+	const bool streaming = useStreamingStores && aligned;
+
+	for (uint32_t i = 0; i < count; i += BlockWidth)
+	{
+		const uint32_t laneCount = (count - i) < BlockWidth ? (count - i) : BlockWidth;
+		const FGatheredBlock block(models, pIndices + i, laneCount);
+		ComputeBlock(block.Streams, 0, viewProjection, pBytes + size_t(i) * outStride, outStride, laneCount, streaming);
+	}
+
+	if (streaming)
+	{
+		_mm_sfence();
+	}
+#else
+	(void)useStreamingStores;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		ComputeTransposedMvpScalar(models, pIndices[i], viewProjection, reinterpret_cast<float*>(pBytes + size_t(i) * outStride));
+	}
+#endif
+}
+
+const char* GetTransformBatchKernelName()
+{
+	return KernelName;
+}
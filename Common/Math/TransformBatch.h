@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../MathTypes.h"
+
+// Affine transforms (row-vector convention, last column implicitly 0,0,0,1) stored as twelve float
+// streams, one per matrix element, so SIMD code can process several instances per instruction.
+// Streams are 32-byte aligned and padded past GetCount() with identity transforms, so kernels may
+// read a full SIMD width beyond the last instance.
+class FAffineTransformArray
+{
+public:
+	// Element index of row r (0..3), column c (0..2) in the stream layout.
+	static constexpr uint32_t ElementIndex(uint32_t row, uint32_t column) { return row * 3 + column; }
+	static constexpr uint32_t ElementCount = 12;
+
+	FAffineTransformArray() : mCount(0), mCapacity(0) {}
+
+	// New transforms are identity. Shrinking keeps the storage.
+	void Resize(uint32_t count);
+	// Makes room for count transforms without changing GetCount(), so Resize() up to it does not reallocate.
+	void Reserve(uint32_t count);
+	uint32_t GetCount() const { return mCount; }
+
+	// Column 3 of matrix is ignored.
+	void Set(uint32_t index, const FMatrix4x4& matrix);
+	FMatrix4x4 Get(uint32_t index) const;
+
+	const float* GetStream(uint32_t element) const { return GetBase() + size_t(element) * mCapacity; }
+	float* GetStream(uint32_t element) { return GetBase() + size_t(element) * mCapacity; }
+
+private:
+	void Reallocate(uint32_t newCapacity, uint32_t keep);
+	const float* GetBase() const;
+	float* GetBase() { return const_cast<float*>(static_cast<const FAffineTransformArray*>(this)->GetBase()); }
+
+	uint32_t mCount;
+	uint32_t mCapacity;         // Per stream, a multiple of the widest SIMD width with room to over-read.
+	std::vector<float> mStorage;
+};
+
+// Writes transpose(model[i] * viewProjection), i.e. the column-major MVP HLSL expects, as 16 floats
+// at (uint8_t*)pOut + i * outStride for every i in [first, end).
+//
+// Instances are processed 8 (AVX) or 4 (SSE) at a time. With useStreamingStores the results bypass
+// the cache with non-temporal stores, which is what write-combined upload heaps want; the call ends
+// with a store fence so the data is globally visible before the caller signals completion. pOut and
+// outStride must be 16-byte aligned for the SIMD store paths (they fall back to unaligned stores).
+void ComputeTransposedMvpBatch(const FAffineTransformArray& models, uint32_t first, uint32_t end,
+	const FMatrix4x4& viewProjection, void* pOut, size_t outStride, bool useStreamingStores = true);
+
+// Like ComputeTransposedMvpBatch, for an index list: writes the MVP of instance pIndices[i] at
+// (uint8_t*)pOut + i * outStride for every i in [0, count), e.g. to compact the visible instances.
+void ComputeTransposedMvpGather(const FAffineTransformArray& models, const uint32_t* pIndices, uint32_t count,
+	const FMatrix4x4& viewProjection, void* pOut, size_t outStride, bool useStreamingStores = true);
+
+// Name of the kernel ComputeTransposedMvpBatch was compiled with ("avx", "sse" or "scalar").
+const char* GetTransformBatchKernelName();
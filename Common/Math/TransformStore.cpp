@@ -0,0 +1,208 @@
+#include "TransformStore.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	const uint32_t BitsPerWord = 64;
+
+	inline uint32_t CountTrailingZeros(uint64_t word)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(word));
+#endif
+	}
+}
+
+FTransformHandle FTransformStore::Create(const FVector3& position, const FVector4& rotation, const FVector3& scale)
+{
+	uint32_t index;
+	if (!mFreeSlots.empty())
+	{
+		index = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else
+	{
+		index = mSlotCount++;
+		if (index >= mGenerations.size())
+		{
+			// Grow geometrically: the world transforms move to new storage on every growth.
+			const size_t capacity = std::max<size_t>(64, mGenerations.size() * 2);
+			for (std::vector<float>& stream : mStreams)
+			{
+				stream.resize(capacity, 0.0f);
+			}
+			mGenerations.resize(capacity, 0);
+			mAliveBits.resize((capacity + BitsPerWord - 1) / BitsPerWord, 0);
+			mDirtyBits.resize(mAliveBits.size(), 0);
+			mWorldTransforms.Reserve(static_cast<uint32_t>(capacity));
+		}
+		mWorldTransforms.Resize(mSlotCount);
+	}
+
+	mAliveBits[index / BitsPerWord] |= uint64_t(1) << (index % BitsPerWord);
+	++mAliveCount;
+
+	const FTransformHandle handle = { index, mGenerations[index] };
+	SetPosition(handle, position);
+	SetRotation(handle, rotation);
+	SetScale(handle, scale);
+	return handle;
+}
+
+void FTransformStore::Destroy(FTransformHandle handle)
+{
+	if (!IsAlive(handle))
+	{
+		return;
+	}
+
+	// Stale handles to this slot stop matching, and the zero matrix takes effect at the next update.
+	++mGenerations[handle.Index];
+	mAliveBits[handle.Index / BitsPerWord] &= ~(uint64_t(1) << (handle.Index % BitsPerWord));
+	--mAliveCount;
+	mFreeSlots.push_back(handle.Index);
+	MarkDirty(handle.Index);
+}
+
+void FTransformStore::SetPosition(FTransformHandle handle, const FVector3& position)
+{
+	if (IsAlive(handle))
+	{
+		mStreams[PositionX][handle.Index] = position.x;
+		mStreams[PositionY][handle.Index] = position.y;
+		mStreams[PositionZ][handle.Index] = position.z;
+		MarkDirty(handle.Index);
+	}
+}
+
+void FTransformStore::SetRotation(FTransformHandle handle, const FVector4& rotation)
+{
+	if (IsAlive(handle))
+	{
+		mStreams[RotationX][handle.Index] = rotation.x;
+		mStreams[RotationY][handle.Index] = rotation.y;
+		mStreams[RotationZ][handle.Index] = rotation.z;
+		mStreams[RotationW][handle.Index] = rotation.w;
+		MarkDirty(handle.Index);
+	}
+}
+
+void FTransformStore::SetScale(FTransformHandle handle, const FVector3& scale)
+{
+	if (IsAlive(handle))
+	{
+		mStreams[ScaleX][handle.Index] = scale.x;
+		mStreams[ScaleY][handle.Index] = scale.y;
+		mStreams[ScaleZ][handle.Index] = scale.z;
+		MarkDirty(handle.Index);
+	}
+}
+
+FVector3 FTransformStore::GetPosition(FTransformHandle handle) const
+{
+	if (!IsAlive(handle))
+	{
+		return FVector3(0.0f, 0.0f, 0.0f);
+	}
+	return FVector3(mStreams[PositionX][handle.Index], mStreams[PositionY][handle.Index], mStreams[PositionZ][handle.Index]);
+}
+
+FVector4 FTransformStore::GetRotation(FTransformHandle handle) const
+{
+	if (!IsAlive(handle))
+	{
+		return FVector4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+	return FVector4(mStreams[RotationX][handle.Index], mStreams[RotationY][handle.Index], mStreams[RotationZ][handle.Index], mStreams[RotationW][handle.Index]);
+}
+
+FVector3 FTransformStore::GetScale(FTransformHandle handle) const
+{
+	if (!IsAlive(handle))
+	{
+		return FVector3(1.0f, 1.0f, 1.0f);
+	}
+	return FVector3(mStreams[ScaleX][handle.Index], mStreams[ScaleY][handle.Index], mStreams[ScaleZ][handle.Index]);
+}
+
+const std::vector<uint32_t>& FTransformStore::UpdateWorldTransforms()
+{
+	mUpdatedSlots.clear();
+	if (mDirtyCount == 0)
+	{
+		return mUpdatedSlots;
+	}
+
+	mUpdatedSlots.reserve(mDirtyCount);
+	const uint32_t wordCount = (mSlotCount + BitsPerWord - 1) / BitsPerWord;
+	for (uint32_t word = 0; word < wordCount; ++word)
+	{
+		uint64_t bits = mDirtyBits[word];
+		mDirtyBits[word] = 0;
+		while (bits)
+		{
+			const uint32_t index = word * BitsPerWord + CountTrailingZeros(bits);
+			bits &= bits - 1;
+			ComputeWorldTransform(index);
+			mUpdatedSlots.push_back(index);
+		}
+	}
+	mDirtyCount = 0;
+	return mUpdatedSlots;
+}
+
+void FTransformStore::MarkDirty(uint32_t index)
+{
+	uint64_t& word = mDirtyBits[index / BitsPerWord];
+	const uint64_t bit = uint64_t(1) << (index % BitsPerWord);
+	mDirtyCount += (word & bit) ? 0 : 1;
+	word |= bit;
+}
+
+// Row-vector scale * rotation * translation, written straight into the world transform streams.
+void FTransformStore::ComputeWorldTransform(uint32_t index)
+{
+	float rows[4][3] = {};
+	if (mAliveBits[index / BitsPerWord] & (uint64_t(1) << (index % BitsPerWord)))
+	{
+		const float x = mStreams[RotationX][index];
+		const float y = mStreams[RotationY][index];
+		const float z = mStreams[RotationZ][index];
+		const float w = mStreams[RotationW][index];
+		const float sx = mStreams[ScaleX][index];
+		const float sy = mStreams[ScaleY][index];
+		const float sz = mStreams[ScaleZ][index];
+
+		// XMMatrixRotationQuaternion, each row scaled by its axis.
+		rows[0][0] = sx * (1.0f - 2.0f * (y * y + z * z));
+		rows[0][1] = sx * (2.0f * (x * y + z * w));
+		rows[0][2] = sx * (2.0f * (x * z - y * w));
+		rows[1][0] = sy * (2.0f * (x * y - z * w));
+		rows[1][1] = sy * (1.0f - 2.0f * (x * x + z * z));
+		rows[1][2] = sy * (2.0f * (y * z + x * w));
+		rows[2][0] = sz * (2.0f * (x * z + y * w));
+		rows[2][1] = sz * (2.0f * (y * z - x * w));
+		rows[2][2] = sz * (1.0f - 2.0f * (x * x + y * y));
+		rows[3][0] = mStreams[PositionX][index];
+		rows[3][1] = mStreams[PositionY][index];
+		rows[3][2] = mStreams[PositionZ][index];
+	}
+
+	for (uint32_t r = 0; r < 4; ++r)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			mWorldTransforms.GetStream(FAffineTransformArray::ElementIndex(r, c))[index] = rows[r][c];
+		}
+	}
+}
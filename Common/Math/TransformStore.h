@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../MathTypes.h"
+#include "TransformBatch.h"
+
+// Refers to one instance of an FTransformStore. The generation tells a live instance from an
+// earlier one that was destroyed and whose slot was reused.
+struct FTransformHandle
+{
+	uint32_t Index = ~0u;
+	uint32_t Generation = 0;
+
+	bool operator==(const FTransformHandle& other) const { return Index == other.Index && Generation == other.Generation; }
+	bool operator!=(const FTransformHandle& other) const { return !(*this == other); }
+};
+
+// Instance transforms as separate position, rotation (quaternion) and scale streams, with the world
+// matrices derived from them in an FAffineTransformArray for the batch kernels. Setters only mark
+// the instance dirty; UpdateWorldTransforms() recomputes the dirty matrices, so a frame costs in
+// proportion to what moved rather than to the scene size.
+//
+// An instance's index (its slot) never changes while it is alive, so it can be used to index
+// per-instance data kept elsewhere (constant buffers, bounds). Destroyed slots are reused by later
+// Create() calls; until then their world matrix is all zeros, which collapses anything drawn with it.
+// Calls with a stale handle do nothing (getters return identity values).
+class FTransformStore
+{
+public:
+	enum EStream { PositionX, PositionY, PositionZ, RotationX, RotationY, RotationZ, RotationW, ScaleX, ScaleY, ScaleZ, StreamCount };
+
+	FTransformStore() : mSlotCount(0), mAliveCount(0), mDirtyCount(0) {}
+
+	FTransformHandle Create(const FVector3& position, const FVector4& rotation = FVector4(0.0f, 0.0f, 0.0f, 1.0f), const FVector3& scale = FVector3(1.0f, 1.0f, 1.0f));
+	void Destroy(FTransformHandle handle);
+	bool IsAlive(FTransformHandle handle) const { return handle.Index < mSlotCount && mGenerations[handle.Index] == handle.Generation; }
+
+	void SetPosition(FTransformHandle handle, const FVector3& position);
+	// rotation is a unit quaternion (x, y, z, w).
+	void SetRotation(FTransformHandle handle, const FVector4& rotation);
+	void SetScale(FTransformHandle handle, const FVector3& scale);
+
+	FVector3 GetPosition(FTransformHandle handle) const;
+	FVector4 GetRotation(FTransformHandle handle) const;
+	FVector3 GetScale(FTransformHandle handle) const;
+
+	// Slots in use or freed, i.e. the size of the world transform array. Index i < GetSlotCount().
+	uint32_t GetSlotCount() const { return mSlotCount; }
+	uint32_t GetAliveCount() const { return mAliveCount; }
+	uint32_t GetDirtyCount() const { return mDirtyCount; }
+
+	const float* GetStream(uint32_t stream) const { return mStreams[stream].data(); }
+
+	// Recomputes the world matrix of every dirty slot and clears the dirty bits. Returns the slots that
+	// were recomputed, in ascending order; valid until the next call.
+	const std::vector<uint32_t>& UpdateWorldTransforms();
+
+	// World matrices (scale, then rotation, then translation) as of the last UpdateWorldTransforms().
+	const FAffineTransformArray& GetWorldTransforms() const { return mWorldTransforms; }
+
+private:
+	void MarkDirty(uint32_t index);
+	void ComputeWorldTransform(uint32_t index);
+
+	std::vector<float> mStreams[StreamCount];
+	std::vector<uint32_t> mGenerations;
+	std::vector<uint32_t> mFreeSlots;
+	std::vector<uint64_t> mAliveBits;
+	std::vector<uint64_t> mDirtyBits;
+	std::vector<uint32_t> mUpdatedSlots;
+	FAffineTransformArray mWorldTransforms;
+	uint32_t mSlotCount;
+	uint32_t mAliveCount;
+	uint32_t mDirtyCount;
+};
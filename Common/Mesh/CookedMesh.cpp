@@ -0,0 +1,273 @@
+#include "CookedMesh.h"
+
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace
+{
+	static void SetError(std::string* outError, const std::string& msg)
+	{
+		if (outError)
+		{
+			*outError = msg;
+		}
+	}
+
+	static uint64_t AlignUp(uint64_t value)
+	{
+		return (value + CookedMeshAlignment - 1) & ~uint64_t(CookedMeshAlignment - 1);
+	}
+
+	static bool IsBlockInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+	{
+		return (offset % CookedMeshAlignment) == 0 && offset <= fileSize && size <= fileSize - offset;
+	}
+
+	class FStringTableBuilder
+	{
+	public:
+		FCookedMeshString Add(const std::string& str)
+		{
+			FCookedMeshString entry;
+			entry.Offset = static_cast<uint32_t>(Data.size());
+			entry.Length = static_cast<uint32_t>(str.size());
+			Data.insert(Data.end(), str.begin(), str.end());
+			Data.push_back('\0');
+			return entry;
+		}
+
+		std::vector<char> Data;
+	};
+}
+
+bool FCookedMesh::Write(const FStaticMesh& mesh, const std::filesystem::path& path, std::string* outError)
+{
+	if (!mesh.IsValid())
+	{
+		SetError(outError, "Cannot cook an empty mesh");
+		return false;
+	}
+
+	FStringTableBuilder strings;
+
+	std::vector<FCookedMeshSection> sections;
+	sections.reserve(mesh.Sections.size());
+	for (const FStaticMeshSection& section : mesh.Sections)
+	{
+		if (uint64_t(section.IndexStart) + section.IndexCount > mesh.Indices.size())
+		{
+			SetError(outError, "Section '" + section.Name + "' references indices past the end of the index buffer");
+			return false;
+		}
+
+		FCookedMeshSection cooked;
+		cooked.Name = strings.Add(section.Name);
+		cooked.MaterialIndex = section.MaterialIndex;
+		cooked.IndexStart = section.IndexStart;
+		cooked.IndexCount = section.IndexCount;
+		cooked.VertexBase = section.VertexBase;
+		sections.push_back(cooked);
+	}
+
+	std::vector<FCookedMeshString> materials;
+	materials.reserve(mesh.MaterialNames.size());
+	for (const std::string& name : mesh.MaterialNames)
+	{
+		materials.push_back(strings.Add(name));
+	}
+
+	FCookedMeshHeader header;
+	header.VertexCount = static_cast<uint32_t>(mesh.Vertices.size());
+	header.IndexCount = static_cast<uint32_t>(mesh.Indices.size());
+	header.SectionCount = static_cast<uint32_t>(sections.size());
+	header.MaterialCount = static_cast<uint32_t>(materials.size());
+	header.BoundsMin = mesh.BoundsMin;
+	header.BoundsMax = mesh.BoundsMax;
+
+	header.VertexDataOffset = AlignUp(sizeof(FCookedMeshHeader));
+	header.IndexDataOffset = AlignUp(header.VertexDataOffset + uint64_t(header.VertexCount) * sizeof(FStaticMeshVertex));
+	header.SectionDataOffset = AlignUp(header.IndexDataOffset + uint64_t(header.IndexCount) * sizeof(uint32_t));
+	header.MaterialDataOffset = AlignUp(header.SectionDataOffset + uint64_t(header.SectionCount) * sizeof(FCookedMeshSection));
+	header.StringDataOffset = AlignUp(header.MaterialDataOffset + uint64_t(header.MaterialCount) * sizeof(FCookedMeshString));
+	header.StringDataSize = strings.Data.size();
+	header.FileSize = AlignUp(header.StringDataOffset + header.StringDataSize);
+
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			SetError(outError, "Cannot create file: " + tempPath.u8string());
+			return false;
+		}
+
+		uint64_t written = 0;
+		auto writeBlock = [&](uint64_t offset, const void* data, uint64_t size)
+		{
+			static const char padding[CookedMeshAlignment] = {};
+			out.write(padding, static_cast<std::streamsize>(offset - written));
+			out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			written = offset + size;
+		};
+
+		writeBlock(0, &header, sizeof(header));
+		writeBlock(header.VertexDataOffset, mesh.Vertices.data(), uint64_t(header.VertexCount) * sizeof(FStaticMeshVertex));
+		writeBlock(header.IndexDataOffset, mesh.Indices.data(), uint64_t(header.IndexCount) * sizeof(uint32_t));
+		writeBlock(header.SectionDataOffset, sections.data(), uint64_t(header.SectionCount) * sizeof(FCookedMeshSection));
+		writeBlock(header.MaterialDataOffset, materials.data(), uint64_t(header.MaterialCount) * sizeof(FCookedMeshString));
+		writeBlock(header.StringDataOffset, strings.Data.data(), header.StringDataSize);
+		writeBlock(header.FileSize, nullptr, 0);
+
+		if (!out)
+		{
+			SetError(outError, "Write failed: " + tempPath.u8string());
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		SetError(outError, "Cannot replace " + path.u8string());
+		return false;
+	}
+	return true;
+}
+
+bool FCookedMesh::Open(const std::filesystem::path& path, std::string* outError)
+{
+	Close();
+
+	if (!mFile.Open(path, outError))
+	{
+		return false;
+	}
+
+	if (!Validate(outError))
+	{
+		mFile.Close();
+		return false;
+	}
+
+	mHeader = reinterpret_cast<const FCookedMeshHeader*>(mFile.GetData());
+	return true;
+}
+
+void FCookedMesh::Close()
+{
+	mHeader = nullptr;
+	mFile.Close();
+}
+
+// Header and block ranges only: O(sections + materials), independent of the vertex/index counts.
+bool FCookedMesh::Validate(std::string* outError) const
+{
+	const uint64_t fileSize = mFile.GetSize();
+	if (fileSize < sizeof(FCookedMeshHeader))
+	{
+		SetError(outError, "Cooked mesh is truncated");
+		return false;
+	}
+
+	const FCookedMeshHeader& header = *reinterpret_cast<const FCookedMeshHeader*>(mFile.GetData());
+	if (header.Magic != CookedMeshMagic)
+	{
+		SetError(outError, "Not a cooked mesh");
+		return false;
+	}
+	if (header.Version != CookedMeshVersion || header.HeaderSize != sizeof(FCookedMeshHeader) || header.VertexStride != sizeof(FStaticMeshVertex))
+	{
+		SetError(outError, "Cooked mesh version " + std::to_string(header.Version) + " does not match the runtime (" + std::to_string(CookedMeshVersion) + "); re-cook it");
+		return false;
+	}
+	if (header.FileSize != fileSize)
+	{
+		SetError(outError, "Cooked mesh size does not match its header");
+		return false;
+	}
+
+	if (!IsBlockInFile(header.VertexDataOffset, uint64_t(header.VertexCount) * sizeof(FStaticMeshVertex), fileSize) ||
+		!IsBlockInFile(header.IndexDataOffset, uint64_t(header.IndexCount) * sizeof(uint32_t), fileSize) ||
+		!IsBlockInFile(header.SectionDataOffset, uint64_t(header.SectionCount) * sizeof(FCookedMeshSection), fileSize) ||
+		!IsBlockInFile(header.MaterialDataOffset, uint64_t(header.MaterialCount) * sizeof(FCookedMeshString), fileSize) ||
+		!IsBlockInFile(header.StringDataOffset, header.StringDataSize, fileSize))
+	{
+		SetError(outError, "Cooked mesh has a block outside the file");
+		return false;
+	}
+
+	const uint8_t* data = mFile.GetData();
+	auto isStringValid = [&](const FCookedMeshString& str)
+	{
+		return uint64_t(str.Offset) + str.Length < header.StringDataSize && data[header.StringDataOffset + str.Offset + str.Length] == '\0';
+	};
+
+	const FCookedMeshSection* sections = reinterpret_cast<const FCookedMeshSection*>(data + header.SectionDataOffset);
+	for (uint32_t i = 0; i < header.SectionCount; ++i)
+	{
+		if (uint64_t(sections[i].IndexStart) + sections[i].IndexCount > header.IndexCount || !isStringValid(sections[i].Name))
+		{
+			SetError(outError, "Cooked mesh section " + std::to_string(i) + " is corrupt");
+			return false;
+		}
+	}
+
+	const FCookedMeshString* materials = reinterpret_cast<const FCookedMeshString*>(data + header.MaterialDataOffset);
+	for (uint32_t i = 0; i < header.MaterialCount; ++i)
+	{
+		if (!isStringValid(materials[i]))
+		{
+			SetError(outError, "Cooked mesh material " + std::to_string(i) + " is corrupt");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::string_view FCookedMesh::GetString(const FCookedMeshString& str) const
+{
+	return std::string_view(reinterpret_cast<const char*>(mFile.GetData() + mHeader->StringDataOffset + str.Offset), str.Length);
+}
+
+std::string_view FCookedMesh::GetMaterialName(uint32_t materialIndex) const
+{
+	const FCookedMeshString* materials = reinterpret_cast<const FCookedMeshString*>(mFile.GetData() + mHeader->MaterialDataOffset);
+	return GetString(materials[materialIndex]);
+}
+
+void FCookedMesh::ToStaticMesh(FStaticMesh& outMesh) const
+{
+	outMesh.Clear();
+
+	outMesh.Vertices.assign(GetVertices(), GetVertices() + GetVertexCount());
+	outMesh.Indices.assign(GetIndices(), GetIndices() + GetIndexCount());
+
+	outMesh.Sections.reserve(GetSectionCount());
+	for (uint32_t i = 0; i < GetSectionCount(); ++i)
+	{
+		const FCookedMeshSection& cooked = GetSections()[i];
+		FStaticMeshSection section;
+		section.Name = std::string(GetSectionName(i));
+		section.MaterialIndex = cooked.MaterialIndex;
+		section.IndexStart = cooked.IndexStart;
+		section.IndexCount = cooked.IndexCount;
+		section.VertexBase = cooked.VertexBase;
+		outMesh.Sections.push_back(std::move(section));
+	}
+
+	outMesh.MaterialNames.reserve(GetMaterialCount());
+	for (uint32_t i = 0; i < GetMaterialCount(); ++i)
+	{
+		outMesh.MaterialNames.emplace_back(GetMaterialName(i));
+	}
+
+	outMesh.BoundsMin = GetBoundsMin();
+	outMesh.BoundsMax = GetBoundsMax();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include "../MappedFile.h"
+#include "FStaticMesh.h"
+
+// Cooked static mesh container (.mesh). Written offline by MEngineMeshCook, memory-mapped at runtime.
+// Every block starts on a CookedMeshAlignment boundary, so the runtime points its views straight
+// into the mapping: no parsing, no per-element copies.
+//
+//   FCookedMeshHeader
+//   FStaticMeshVertex    [VertexCount]
+//   uint32_t             [IndexCount]
+//   FCookedMeshSection   [SectionCount]
+//   FCookedMeshString    [MaterialCount]
+//   char                 [StringDataSize]   (names, each null terminated)
+//
+// All values are little endian. Bump CookedMeshVersion whenever a layout in this file changes.
+
+constexpr uint32_t CookedMeshMagic = 0x48534D43; // 'CMSH'
+constexpr uint32_t CookedMeshVersion = 1;
+constexpr uint32_t CookedMeshAlignment = 64;
+
+struct FCookedMeshString
+{
+	uint32_t Offset = 0;	// Into the string data block.
+	uint32_t Length = 0;	// Without the terminator.
+};
+
+struct FCookedMeshSection
+{
+	FCookedMeshString Name;
+	uint32_t MaterialIndex = 0;
+	uint32_t IndexStart = 0;
+	uint32_t IndexCount = 0;
+	int32_t VertexBase = 0;
+};
+
+struct FCookedMeshHeader
+{
+	uint32_t Magic = CookedMeshMagic;
+	uint32_t Version = CookedMeshVersion;
+	uint32_t HeaderSize = sizeof(FCookedMeshHeader);
+	uint32_t VertexStride = sizeof(FStaticMeshVertex);
+	uint64_t FileSize = 0;
+
+	uint32_t VertexCount = 0;
+	uint32_t IndexCount = 0;
+	uint32_t SectionCount = 0;
+	uint32_t MaterialCount = 0;
+
+	uint64_t VertexDataOffset = 0;
+	uint64_t IndexDataOffset = 0;
+	uint64_t SectionDataOffset = 0;
+	uint64_t MaterialDataOffset = 0;
+	uint64_t StringDataOffset = 0;
+	uint64_t StringDataSize = 0;
+
+	FVector3 BoundsMin = { 0,0,0 };
+	FVector3 BoundsMax = { 0,0,0 };
+};
+
+static_assert(sizeof(FCookedMeshString) == 8, "FCookedMeshString is part of the cooked mesh format");
+static_assert(sizeof(FCookedMeshSection) == 24, "FCookedMeshSection is part of the cooked mesh format");
+static_assert(sizeof(FCookedMeshHeader) == 112, "FCookedMeshHeader is part of the cooked mesh format");
+
+// Read-only view of a cooked mesh. Open() maps the file and validates the header; every getter
+// returns a pointer into the mapping, valid until Close() or destruction.
+class FCookedMesh
+{
+public:
+	// Writes mesh into a cooked container at path (via a temporary file, so readers never see a partial file).
+	// Returns true on success; on failure, outError (if provided) will contain a readable reason.
+	static bool Write(const FStaticMesh& mesh, const std::filesystem::path& path, std::string* outError = nullptr);
+
+	bool Open(const std::filesystem::path& path, std::string* outError = nullptr);
+	void Close();
+	bool IsOpen() const { return mHeader != nullptr; }
+
+	uint32_t GetVertexCount() const { return mHeader->VertexCount; }
+	uint32_t GetIndexCount() const { return mHeader->IndexCount; }
+	uint32_t GetSectionCount() const { return mHeader->SectionCount; }
+	uint32_t GetMaterialCount() const { return mHeader->MaterialCount; }
+
+	const FStaticMeshVertex* GetVertices() const { return reinterpret_cast<const FStaticMeshVertex*>(mFile.GetData() + mHeader->VertexDataOffset); }
+	const uint32_t* GetIndices() const { return reinterpret_cast<const uint32_t*>(mFile.GetData() + mHeader->IndexDataOffset); }
+	const FCookedMeshSection* GetSections() const { return reinterpret_cast<const FCookedMeshSection*>(mFile.GetData() + mHeader->SectionDataOffset); }
+
+	// Raw blocks, for uploading straight into GPU buffers.
+	const void* GetVertexData() const { return GetVertices(); }
+	uint64_t GetVertexDataSize() const { return uint64_t(mHeader->VertexCount) * sizeof(FStaticMeshVertex); }
+	const void* GetIndexData() const { return GetIndices(); }
+	uint64_t GetIndexDataSize() const { return uint64_t(mHeader->IndexCount) * sizeof(uint32_t); }
+
+	std::string_view GetSectionName(uint32_t sectionIndex) const { return GetString(GetSections()[sectionIndex].Name); }
+	std::string_view GetMaterialName(uint32_t materialIndex) const;
+
+	const FVector3& GetBoundsMin() const { return mHeader->BoundsMin; }
+	const FVector3& GetBoundsMax() const { return mHeader->BoundsMax; }
+
+	// Copies the cooked data back into an editable mesh (tools only; the runtime uses the views).
+	void ToStaticMesh(FStaticMesh& outMesh) const;
+
+private:
+	bool Validate(std::string* outError) const;
+	std::string_view GetString(const FCookedMeshString& str) const;
+
+	FMappedFile mFile;
+	const FCookedMeshHeader* mHeader = nullptr;
+};
@@ -5,7 +5,9 @@
 #include <vector>
 
 #include "../MathTypes.h"
+#ifdef _WIN32
 #include <d3d12.h>
+#endif
 
 
 struct FStaticMeshVertex
@@ -81,6 +83,7 @@ public:
 		return static_cast<uint32_t>(sizeof(FStaticMeshVertex));
 	}
 
+#ifdef _WIN32
 	static constexpr DXGI_FORMAT IndexFormat()
 	{
 		return DXGI_FORMAT_R32_UINT;
@@ -98,4 +101,5 @@ public:
 		outCount = static_cast<uint32_t>(_countof(layout));
 		return layout;
 	}
+#endif
 };
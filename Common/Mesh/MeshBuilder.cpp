@@ -1,7 +1,6 @@
-#include "../../src/stdafx.h"
-
 #include "MeshBuilder.h"
 #include "FStaticMesh.h"
+#include "Jobs/JobSystem.h"
 
 #include <cmath>
 #include <cstring>
@@ -93,7 +92,27 @@ namespace
 		}
 	}
 
-	static bool AppendAssimpMesh(const aiScene* scene, const CollectedMesh& cm, FStaticMesh& outMesh, bool applyTransform)
+	// Where one imported mesh lands in the merged vertex/index arrays. Laid out up front so the
+	// meshes can then be converted independently (and in parallel).
+	struct MeshPlacement
+	{
+		const CollectedMesh* Source = nullptr;
+		uint32_t BaseVertex = 0;
+		uint32_t StartIndex = 0;
+	};
+
+	static uint32_t CountTriangles(const aiMesh* mesh)
+	{
+		uint32_t count = 0;
+		for (unsigned f = 0; f < mesh->mNumFaces; ++f)
+		{
+			count += mesh->mFaces[f].mNumIndices == 3 ? 1 : 0;
+		}
+		return count;
+	}
+
+	// Reserves the mesh's ranges in outMesh and adds its section; the data is filled by ConvertAssimpMesh.
+	static bool PlaceAssimpMesh(const aiScene* scene, const CollectedMesh& cm, FStaticMesh& outMesh, std::vector<MeshPlacement>& placements)
 	{
 		aiMesh* mesh = cm.Mesh;
 		if (!mesh)
@@ -101,12 +120,49 @@ namespace
 			return false;
 		}
 
-		const uint32_t baseVertex = static_cast<uint32_t>(outMesh.Vertices.size());
-		const uint32_t startIndex = static_cast<uint32_t>(outMesh.Indices.size());
+		MeshPlacement placement;
+		placement.Source = &cm;
+		placement.BaseVertex = static_cast<uint32_t>(outMesh.Vertices.size());
+		placement.StartIndex = static_cast<uint32_t>(outMesh.Indices.size());
+		placements.push_back(placement);
+
+		// Indices: triangulated only.
+		const uint32_t indexCount = CountTriangles(mesh) * 3;
+		outMesh.Vertices.resize(outMesh.Vertices.size() + mesh->mNumVertices);
+		outMesh.Indices.resize(outMesh.Indices.size() + indexCount);
+
+		FStaticMeshSection sec;
+		sec.MaterialIndex = mesh->mMaterialIndex;
+		sec.IndexStart = placement.StartIndex;
+		sec.IndexCount = indexCount;
+		sec.VertexBase = 0;
+		sec.Name = mesh->mName.length ? std::string(mesh->mName.C_Str()) : std::string();
+		outMesh.Sections.push_back(std::move(sec));
+
+		// Material name cache (best-effort)
+		if (scene)
+		{
+			if (outMesh.MaterialNames.size() < scene->mNumMaterials)
+			{
+				outMesh.MaterialNames.resize(scene->mNumMaterials);
+			}
+			if (sec.MaterialIndex < outMesh.MaterialNames.size() && outMesh.MaterialNames[sec.MaterialIndex].empty())
+			{
+				outMesh.MaterialNames[sec.MaterialIndex] = GetMaterialName(scene, sec.MaterialIndex);
+			}
+		}
+
+		return true;
+	}
 
-		const aiMatrix4x4& xform = cm.GlobalTransform;
+	// Writes one mesh's vertices and indices into the ranges PlaceAssimpMesh reserved. Touches nothing else
+	// in outMesh, so different meshes may be converted concurrently.
+	static void ConvertAssimpMesh(const MeshPlacement& placement, FStaticMesh& outMesh, bool applyTransform)
+	{
+		const aiMesh* mesh = placement.Source->Mesh;
+		const aiMatrix4x4& xform = placement.Source->GlobalTransform;
 
-		outMesh.Vertices.reserve(outMesh.Vertices.size() + mesh->mNumVertices);
+		FStaticMeshVertex* outVertex = outMesh.Vertices.data() + placement.BaseVertex;
 		for (unsigned v = 0; v < mesh->mNumVertices; ++v)
 		{
 			const aiVector3D& pos = mesh->mVertices[v];
@@ -134,10 +190,10 @@ namespace
 			}
 			vert.UV0 = { uv.x, uv.y };
 
-			outMesh.Vertices.push_back(vert);
+			*outVertex++ = vert;
 		}
 
-		// Indices: triangulated only.
+		uint32_t* outIndex = outMesh.Indices.data() + placement.StartIndex;
 		for (unsigned f = 0; f < mesh->mNumFaces; ++f)
 		{
 			const aiFace& face = mesh->mFaces[f];
@@ -146,35 +202,10 @@ namespace
 				continue;
 			}
 
-			outMesh.Indices.push_back(baseVertex + static_cast<uint32_t>(face.mIndices[0]));
-			outMesh.Indices.push_back(baseVertex + static_cast<uint32_t>(face.mIndices[1]));
-			outMesh.Indices.push_back(baseVertex + static_cast<uint32_t>(face.mIndices[2]));
-		}
-
-		const uint32_t endIndex = static_cast<uint32_t>(outMesh.Indices.size());
-
-		FStaticMeshSection sec;
-		sec.MaterialIndex = mesh->mMaterialIndex;
-		sec.IndexStart = startIndex;
-		sec.IndexCount = endIndex - startIndex;
-		sec.VertexBase = 0;
-		sec.Name = mesh->mName.length ? std::string(mesh->mName.C_Str()) : std::string();
-		outMesh.Sections.push_back(std::move(sec));
-
-		// Material name cache (best-effort)
-		if (scene)
-		{
-			if (outMesh.MaterialNames.size() < scene->mNumMaterials)
-			{
-				outMesh.MaterialNames.resize(scene->mNumMaterials);
-			}
-			if (sec.MaterialIndex < outMesh.MaterialNames.size() && outMesh.MaterialNames[sec.MaterialIndex].empty())
-			{
-				outMesh.MaterialNames[sec.MaterialIndex] = GetMaterialName(scene, sec.MaterialIndex);
-			}
+			*outIndex++ = placement.BaseVertex + static_cast<uint32_t>(face.mIndices[0]);
+			*outIndex++ = placement.BaseVertex + static_cast<uint32_t>(face.mIndices[1]);
+			*outIndex++ = placement.BaseVertex + static_cast<uint32_t>(face.mIndices[2]);
 		}
-
-		return true;
 	}
 #endif
 }
@@ -236,19 +267,40 @@ bool MeshBuilder::LoadFromFBX(const std::filesystem::path& fbxPath, FStaticMesh&
 	}
 
 	bool any = false;
+	std::vector<MeshPlacement> placements;
+	placements.reserve(meshes.size());
 	for (const auto& cm : meshes)
 	{
 		if (!cm.Mesh || cm.Mesh->mPrimitiveTypes == 0)
 		{
 			continue;
 		}
-		any |= AppendAssimpMesh(scene, cm, outMesh, options.ApplyNodeTransforms);
+		any |= PlaceAssimpMesh(scene, cm, outMesh, placements);
 		if (!options.MergeMeshes && any)
 		{
 			break;
 		}
 	}
 
+	const bool applyTransform = options.ApplyNodeTransforms;
+	if (options.JobSystem)
+	{
+		options.JobSystem->ParallelFor(static_cast<uint32_t>(placements.size()), 1, [&](uint32_t begin, uint32_t end, FJobContext&)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				ConvertAssimpMesh(placements[i], outMesh, applyTransform);
+			}
+		});
+	}
+	else
+	{
+		for (const MeshPlacement& placement : placements)
+		{
+			ConvertAssimpMesh(placement, outMesh, applyTransform);
+		}
+	}
+
 	if (!any || !outMesh.IsValid())
 	{
 		SetError(outError, "No valid triangle meshes were imported");
@@ -4,6 +4,7 @@
 #include <string>
 
 class FStaticMesh;
+class FJobSystem;
 
 struct MeshImportOptions
 {
@@ -14,6 +15,8 @@ struct MeshImportOptions
 	bool Optimize = true;
 	bool MergeMeshes = true;
 	bool ApplyNodeTransforms = true;
+	// Optional. When set, the vertices and indices of the imported meshes are converted in parallel.
+	FJobSystem* JobSystem = nullptr;
 };
 
 class MeshBuilder
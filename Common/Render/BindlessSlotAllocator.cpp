@@ -0,0 +1,305 @@
+#include "BindlessSlotAllocator.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	const uint32_t BitsPerWord = 64;
+	const uint32_t InvalidIndex = ~0u;
+
+	inline uint32_t CountTrailingZeros(uint64_t word)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(word));
+#endif
+	}
+
+	inline uint32_t CountSetBits(uint64_t word)
+	{
+#if defined(_MSC_VER)
+		return static_cast<uint32_t>(__popcnt64(word));
+#else
+		return static_cast<uint32_t>(__builtin_popcountll(word));
+#endif
+	}
+
+	inline uint64_t LowBits(uint32_t count)
+	{
+		return count >= BitsPerWord ? ~0ull : (1ull << count) - 1;
+	}
+
+	// The lowest run of count set bits in word, as a mask, or 0. Each step doubles the length of the
+	// runs the surviving start bits are known to begin.
+	inline uint64_t FindRun(uint64_t word, uint32_t count)
+	{
+		uint64_t starts = word;
+		for (uint32_t length = 1; length < count && starts != 0;)
+		{
+			const uint32_t shift = std::min(length, count - length);
+			starts &= starts >> shift;
+			length += shift;
+		}
+		return starts != 0 ? LowBits(count) << CountTrailingZeros(starts) : 0;
+	}
+}
+
+FBindlessSlotAllocator::FBindlessSlotAllocator(uint32_t capacity) :
+	mCapacity(capacity),
+	mWordCount((capacity + BitsPerWord - 1) / BitsPerWord),
+	mSummaryCount((mWordCount + BitsPerWord - 1) / BitsPerWord),
+	mFreeBits(new std::atomic<uint64_t>[mWordCount]),
+	mSummaryBits(new std::atomic<uint64_t>[mSummaryCount]),
+	mGenerations(new std::atomic<uint32_t>[capacity]()),
+	mRangeCounts(new uint32_t[capacity])
+{
+	for (uint32_t word = 0; word < mWordCount; ++word)
+	{
+		mFreeBits[word].store(LowBits(std::min(BitsPerWord, capacity - word * BitsPerWord)), std::memory_order_relaxed);
+	}
+	for (uint32_t summary = 0; summary < mSummaryCount; ++summary)
+	{
+		mSummaryBits[summary].store(LowBits(std::min(BitsPerWord, mWordCount - summary * BitsPerWord)), std::memory_order_relaxed);
+	}
+}
+
+FBindlessHandle FBindlessSlotAllocator::AllocateRange(uint32_t count)
+{
+	FBindlessHandle handle;
+	if (count == 0 || count > mCapacity)
+	{
+		return handle;
+	}
+
+	uint32_t index = InvalidIndex;
+	if (count <= BitsPerWord)
+	{
+		// Every summary word once, from this thread's start word round to the word before it.
+		const uint32_t startWord = GetSearchStart();
+		const uint32_t firstSummary = startWord / BitsPerWord;
+		const uint64_t startMask = ~0ull << (startWord % BitsPerWord);
+		for (uint32_t i = 0; i <= mSummaryCount && index == InvalidIndex; ++i)
+		{
+			const uint32_t summaryIndex = firstSummary + i < mSummaryCount ? firstSummary + i : firstSummary + i - mSummaryCount;
+			uint64_t summary = mSummaryBits[summaryIndex].load(std::memory_order_acquire);
+			summary &= i == 0 ? startMask : (i == mSummaryCount ? ~startMask : ~0ull);
+			while (summary != 0 && index == InvalidIndex)
+			{
+				const uint32_t word = summaryIndex * BitsPerWord + CountTrailingZeros(summary);
+				summary &= summary - 1;
+				index = ClaimInWord(word, count);
+			}
+		}
+	}
+	else
+	{
+		const uint32_t wordSpan = (count + BitsPerWord - 1) / BitsPerWord;
+		for (uint32_t word = 0; word + wordSpan <= mWordCount && index == InvalidIndex; ++word)
+		{
+			index = ClaimWords(word, count);
+		}
+	}
+
+	if (index == InvalidIndex)
+	{
+		return handle;
+	}
+
+	// The slots are this thread's alone until the handle is handed out, so no read-modify-write here.
+	mRangeCounts[index] = count;
+	handle.Index = index;
+	handle.Generation = mGenerations[index].load(std::memory_order_relaxed) + 1;
+	mGenerations[index].store(handle.Generation, std::memory_order_release);
+	return handle;
+}
+
+bool FBindlessSlotAllocator::Free(FBindlessHandle handle, uint64_t fenceValue)
+{
+	if (handle.Index >= mCapacity || (handle.Generation & 1) == 0)
+	{
+		return false;
+	}
+
+	// Only one Free() of a handle gets past this, however many threads try.
+	uint32_t generation = handle.Generation;
+	if (!mGenerations[handle.Index].compare_exchange_strong(generation, generation + 1, std::memory_order_acq_rel))
+	{
+		return false;
+	}
+
+	const uint32_t count = mRangeCounts[handle.Index];
+	if (fenceValue == 0)
+	{
+		ReleaseSlots(handle.Index, count);
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(mPendingMutex);
+	mPendingFrees.push_back({ handle.Index, count, fenceValue });
+	return true;
+}
+
+void FBindlessSlotAllocator::ReleaseRetired(uint64_t completedFence)
+{
+	std::lock_guard<std::mutex> lock(mPendingMutex);
+	size_t keptCount = 0;
+	for (size_t i = 0; i < mPendingFrees.size(); ++i)
+	{
+		const FPendingFree pending = mPendingFrees[i];
+		if (pending.Fence <= completedFence)
+		{
+			ReleaseSlots(pending.Index, pending.Count);
+		}
+		else
+		{
+			mPendingFrees[keptCount++] = pending;
+		}
+	}
+	mPendingFrees.resize(keptCount);
+}
+
+uint32_t FBindlessSlotAllocator::GetUsedCount() const
+{
+	uint32_t freeCount = 0;
+	for (uint32_t word = 0; word < mWordCount; ++word)
+	{
+		freeCount += CountSetBits(mFreeBits[word].load(std::memory_order_relaxed));
+	}
+	return mCapacity - freeCount;
+}
+
+uint32_t FBindlessSlotAllocator::GetPendingFreeCount() const
+{
+	std::lock_guard<std::mutex> lock(mPendingMutex);
+	return static_cast<uint32_t>(mPendingFrees.size());
+}
+
+uint32_t FBindlessSlotAllocator::ClaimInWord(uint32_t word, uint32_t count)
+{
+	uint64_t bits = mFreeBits[word].load(std::memory_order_relaxed);
+	for (;;)
+	{
+		const uint64_t run = FindRun(bits, count);
+		if (run == 0)
+		{
+			if (bits == 0)
+			{
+				ClearSummaryIfEmpty(word);
+			}
+			return InvalidIndex;
+		}
+		if (mFreeBits[word].compare_exchange_weak(bits, bits & ~run, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			if ((bits & ~run) == 0)
+			{
+				ClearSummaryIfEmpty(word);
+			}
+			return word * BitsPerWord + CountTrailingZeros(run);
+		}
+	}
+}
+
+uint32_t FBindlessSlotAllocator::ClaimWords(uint32_t firstWord, uint32_t count)
+{
+	const uint32_t fullWordCount = count / BitsPerWord;
+	const uint64_t tailMask = LowBits(count % BitsPerWord);
+
+	// A plain look first: a range this long is rarely free at a given word.
+	for (uint32_t i = 0; i < fullWordCount; ++i)
+	{
+		if (mFreeBits[firstWord + i].load(std::memory_order_relaxed) != ~0ull)
+		{
+			return InvalidIndex;
+		}
+	}
+	if (tailMask != 0 && (mFreeBits[firstWord + fullWordCount].load(std::memory_order_relaxed) & tailMask) != tailMask)
+	{
+		return InvalidIndex;
+	}
+
+	// Word by word; should another thread take a slot first, give back what was claimed.
+	uint32_t claimedCount = 0;
+	bool claimed = true;
+	for (; claimedCount < fullWordCount && claimed; ++claimedCount)
+	{
+		uint64_t expected = ~0ull;
+		claimed = mFreeBits[firstWord + claimedCount].compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+	}
+	if (!claimed)
+	{
+		ReleaseSlots(firstWord * BitsPerWord, (claimedCount - 1) * BitsPerWord);
+		return InvalidIndex;
+	}
+	if (tailMask != 0)
+	{
+		std::atomic<uint64_t>& tail = mFreeBits[firstWord + fullWordCount];
+		uint64_t bits = tail.load(std::memory_order_relaxed);
+		do
+		{
+			if ((bits & tailMask) != tailMask)
+			{
+				ReleaseSlots(firstWord * BitsPerWord, fullWordCount * BitsPerWord);
+				return InvalidIndex;
+			}
+		} while (!tail.compare_exchange_weak(bits, bits & ~tailMask, std::memory_order_acq_rel, std::memory_order_relaxed));
+	}
+
+	for (uint32_t i = 0; i < fullWordCount + (tailMask != 0 ? 1 : 0); ++i)
+	{
+		ClearSummaryIfEmpty(firstWord + i);
+	}
+	return firstWord * BitsPerWord;
+}
+
+void FBindlessSlotAllocator::ReleaseSlots(uint32_t index, uint32_t count)
+{
+	for (uint32_t remaining = count; remaining > 0;)
+	{
+		const uint32_t bit = index % BitsPerWord;
+		const uint32_t bitCount = std::min(remaining, BitsPerWord - bit);
+		ReleaseBits(index / BitsPerWord, LowBits(bitCount) << bit);
+		index += bitCount;
+		remaining -= bitCount;
+	}
+}
+
+void FBindlessSlotAllocator::ReleaseBits(uint32_t word, uint64_t mask)
+{
+	// Bits before summary, and ClearSummaryIfEmpty() the other way round: whichever order the two
+	// interleave in, a word with free bits ends up with its summary bit set. The summary is mostly
+	// set already, and a load is much cheaper than another locked instruction.
+	std::atomic<uint64_t>& summary = mSummaryBits[word / BitsPerWord];
+	const uint64_t bit = 1ull << (word % BitsPerWord);
+	mFreeBits[word].fetch_or(mask);
+	if ((summary.load() & bit) == 0)
+	{
+		summary.fetch_or(bit);
+	}
+}
+
+void FBindlessSlotAllocator::ClearSummaryIfEmpty(uint32_t word)
+{
+	std::atomic<uint64_t>& summary = mSummaryBits[word / BitsPerWord];
+	const uint64_t bit = 1ull << (word % BitsPerWord);
+	summary.fetch_and(~bit);
+	if (mFreeBits[word].load() != 0)
+	{
+		summary.fetch_or(bit);
+	}
+}
+
+uint32_t FBindlessSlotAllocator::GetSearchStart() const
+{
+	// Fibonacci hashing spreads consecutive thread numbers over the heap, scaled to the word count
+	// with a multiply rather than a division; the first thread starts at 0.
+	static std::atomic<uint32_t> nextThread(0);
+	thread_local const uint32_t threadHash = nextThread.fetch_add(1, std::memory_order_relaxed) * 0x9E3779B9u;
+	return static_cast<uint32_t>((uint64_t(threadHash) * mWordCount) >> 32);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Refers to a slot, or the first slot of a range, handed out by an FBindlessSlotAllocator. The
+// generation tells a live allocation from an earlier one that was freed and whose slots were reused.
+struct FBindlessHandle
+{
+	uint32_t Index = ~0u;
+	uint32_t Generation = 0;
+
+	bool IsValid() const { return Index != ~0u; }
+	bool operator==(const FBindlessHandle& other) const { return Index == other.Index && Generation == other.Generation; }
+	bool operator!=(const FBindlessHandle& other) const { return !(*this == other); }
+};
+
+// Slots of a bindless descriptor heap, as a two-level bitset: a bit per slot (set while free) and a
+// summary bit per 64 slots (set while that word may have a free slot). Construction only fills the
+// bitsets, and Allocate() finds a free slot with two bit scans.
+//
+// Allocate(), AllocateRange() and Free() are lock-free and may be called from any thread: a slot is
+// claimed by clearing its bit with a compare-exchange. Each thread starts its search at a different
+// summary word, so threads loading assets in parallel rarely touch the same cache lines.
+//
+// A freed slot may still be read by commands in flight. Free() with a fence value keeps the slots
+// until ReleaseRetired() is called with a completed fence at or past it; only that path takes a lock.
+// The handle's generation is bumped by Free() itself, so IsAlive() turns false at once and a second
+// Free() of the same handle is refused. Fence values must all come from one queue.
+class FBindlessSlotAllocator
+{
+public:
+	explicit FBindlessSlotAllocator(uint32_t capacity);
+
+	// An invalid handle when the heap is full.
+	FBindlessHandle Allocate() { return AllocateRange(1); }
+
+	// count contiguous slots, starting at the handle's index, freed together by Free(). Ranges of up
+	// to 64 slots come from one bitset word; longer ones start on a 64-slot boundary. An invalid
+	// handle when there is no such run.
+	FBindlessHandle AllocateRange(uint32_t count);
+
+	// Frees the slots of handle once fenceValue has completed (see ReleaseRetired()), or right away
+	// for fence 0. Returns false, freeing nothing, for a handle that is not alive.
+	bool Free(FBindlessHandle handle, uint64_t fenceValue = 0);
+
+	// Returns the slots of every deferred free whose fence is at or before completedFence.
+	void ReleaseRetired(uint64_t completedFence);
+
+	bool IsAlive(FBindlessHandle handle) const
+	{
+		return handle.Index < mCapacity && (handle.Generation & 1) != 0 && mGenerations[handle.Index].load(std::memory_order_acquire) == handle.Generation;
+	}
+
+	uint32_t GetCapacity() const { return mCapacity; }
+	// Slots allocated, or freed but waiting for their fence. Counts the bitset, so not for every frame.
+	uint32_t GetUsedCount() const;
+	uint32_t GetPendingFreeCount() const;
+
+private:
+	struct FPendingFree
+	{
+		uint32_t Index;
+		uint32_t Count;
+		uint64_t Fence;
+	};
+
+	uint32_t ClaimInWord(uint32_t word, uint32_t count);
+	uint32_t ClaimWords(uint32_t firstWord, uint32_t count);
+	void ReleaseSlots(uint32_t index, uint32_t count);
+	void ReleaseBits(uint32_t word, uint64_t mask);
+	void ClearSummaryIfEmpty(uint32_t word);
+	uint32_t GetSearchStart() const;
+
+	uint32_t mCapacity;
+	uint32_t mWordCount;
+	uint32_t mSummaryCount;
+	std::unique_ptr<std::atomic<uint64_t>[]> mFreeBits;
+	std::unique_ptr<std::atomic<uint64_t>[]> mSummaryBits;
+	// Odd while an allocation starts at the slot: Allocate and Free each bump it.
+	std::unique_ptr<std::atomic<uint32_t>[]> mGenerations;
+	// Slots in the allocation that starts at a slot. Written before the generation is bumped, which
+	// publishes it to the thread that frees the handle.
+	std::unique_ptr<uint32_t[]> mRangeCounts;
+
+	mutable std::mutex mPendingMutex;
+	std::vector<FPendingFree> mPendingFrees;
+};
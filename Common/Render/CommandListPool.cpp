@@ -0,0 +1,103 @@
+#include "CommandListPool.h"
+
+#include <stdexcept>
+
+FCommandListPool::FCommandListPool(RHIDevice* device) :
+	mDevice(device)
+{
+	if (!mDevice)
+	{
+		throw std::runtime_error("FCommandListPool: no device");
+	}
+}
+
+RHICommandAllocator* FCommandListPool::AcquireAllocator(ERHICommandListType type)
+{
+	FTypePool& pool = GetTypePool(type);
+	RHICommandAllocator* allocator = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(pool.Mutex);
+		++pool.AllocatorAcquireCount;
+		if (!pool.ReleasedAllocators.empty() && IsRetired(pool.ReleasedAllocators.front().Fence))
+		{
+			allocator = pool.ReleasedAllocators.front().Allocator;
+			pool.ReleasedAllocators.pop_front();
+			++pool.AllocatorReuseCount;
+		}
+	}
+
+	if (allocator)
+	{
+		// Outside the lock: resetting hands the allocator's memory back to the driver.
+		allocator->Reset();
+		return allocator;
+	}
+
+	std::unique_ptr<RHICommandAllocator> created = mDevice->CreateCommandAllocator(type);
+	allocator = created.get();
+	std::lock_guard<std::mutex> lock(pool.Mutex);
+	pool.Allocators.push_back(std::move(created));
+	return allocator;
+}
+
+void FCommandListPool::ReleaseAllocator(RHICommandAllocator* allocator, uint64_t fenceValue)
+{
+	FTypePool& pool = GetTypePool(allocator->GetType());
+	std::lock_guard<std::mutex> lock(pool.Mutex);
+	pool.ReleasedAllocators.push_back({ allocator, fenceValue });
+}
+
+RHICommandList* FCommandListPool::AcquireCommandList(RHICommandAllocator* allocator, RHIPipelineState* initialState)
+{
+	const ERHICommandListType type = allocator->GetType();
+	FTypePool& pool = GetTypePool(type);
+	RHICommandList* list = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(pool.Mutex);
+		if (!pool.ReleasedCommandLists.empty() && IsRetired(pool.ReleasedCommandLists.front().Fence))
+		{
+			list = pool.ReleasedCommandLists.front().List;
+			pool.ReleasedCommandLists.pop_front();
+		}
+	}
+
+	if (list)
+	{
+		list->Reset(allocator, initialState);
+		return list;
+	}
+
+	// Created open, recording into allocator.
+	std::unique_ptr<RHICommandList> created = mDevice->CreateCommandList(type, allocator, initialState);
+	list = created.get();
+	std::lock_guard<std::mutex> lock(pool.Mutex);
+	pool.CommandLists.push_back(std::move(created));
+	return list;
+}
+
+void FCommandListPool::ReleaseCommandList(RHICommandList* list, uint64_t fenceValue)
+{
+	FTypePool& pool = GetTypePool(list->GetType());
+	std::lock_guard<std::mutex> lock(pool.Mutex);
+	pool.ReleasedCommandLists.push_back({ list, fenceValue });
+}
+
+FCommandListPoolStats FCommandListPool::GetStats() const
+{
+	FCommandListPoolStats stats;
+	for (const FTypePool& pool : mTypePools)
+	{
+		std::lock_guard<std::mutex> lock(pool.Mutex);
+		stats.AllocatorCount += static_cast<uint32_t>(pool.Allocators.size());
+		stats.CommandListCount += static_cast<uint32_t>(pool.CommandLists.size());
+		stats.AllocatorAcquireCount += pool.AllocatorAcquireCount;
+		stats.AllocatorReuseCount += pool.AllocatorReuseCount;
+	}
+	return stats;
+}
+
+// Fence values name their queue in the top byte (RHIGetFenceQueueType).
+bool FCommandListPool::IsRetired(uint64_t fenceValue)
+{
+	return fenceValue == 0 || mDevice->GetQueue(RHIGetFenceQueueType(fenceValue))->IsFenceComplete(fenceValue);
+}
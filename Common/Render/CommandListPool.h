@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../../RHI/RHIDevice.h"
+
+struct FCommandListPoolStats
+{
+	uint32_t AllocatorCount = 0;        // Created, of every type.
+	uint32_t CommandListCount = 0;
+	uint64_t AllocatorAcquireCount = 0;
+	uint64_t AllocatorReuseCount = 0;   // Acquires served by a retired allocator rather than a new one.
+};
+
+// Command allocators and command lists for every queue type, handed out to whichever thread is
+// recording and handed back once the recording is submitted, so there are as many of each as
+// recording ever needs at once rather than a fixed set per frame.
+//
+// An allocator is released with the fence value of the submission that ran the lists recorded
+// from it (for a bundle allocator, of the direct list that executed the bundles) and is reset and
+// handed out again only once that fence has completed, on the queue the fence value names. A
+// command list comes back with the fence value of its submission too: SubmitCommandLists() only
+// queues a list, which must not be reset before the queue has executed it, so a list is reset and
+// handed out again only once its fence has completed as well.
+//
+// Each type is used as a queue: the allocator or list released first is the one tried first, and a
+// new one is created when it is still in flight. Nothing is ever freed; the pool holds the most that were
+// in flight at once.
+//
+// Every method may be called from any thread. The pool owns what it hands out, so it must outlive
+// the GPU's use of it.
+class FCommandListPool
+{
+public:
+	explicit FCommandListPool(RHIDevice* device);
+
+	FCommandListPool(const FCommandListPool&) = delete;
+	FCommandListPool& operator=(const FCommandListPool&) = delete;
+
+	// A reset allocator for lists of type.
+	RHICommandAllocator* AcquireAllocator(ERHICommandListType type);
+	// fenceValue marks the completion of the last submission with lists from allocator in it; 0
+	// when nothing recorded from it was submitted.
+	void ReleaseAllocator(RHICommandAllocator* allocator, uint64_t fenceValue);
+
+	// A list of the allocator's type, reset against it and open for recording.
+	RHICommandList* AcquireCommandList(RHICommandAllocator* allocator, RHIPipelineState* initialState = nullptr);
+	// list must be closed: submitted, or closed by hand if it was never submitted. fenceValue is that
+	// of its submission, as for ReleaseAllocator(); 0 when it was never submitted.
+	void ReleaseCommandList(RHICommandList* list, uint64_t fenceValue);
+
+	FCommandListPoolStats GetStats() const;
+
+private:
+	struct FRetiringAllocator
+	{
+		RHICommandAllocator* Allocator;
+		uint64_t Fence;
+	};
+
+	struct FRetiringCommandList
+	{
+		RHICommandList* List;
+		uint64_t Fence;
+	};
+
+	// Everything of one command list type.
+	struct FTypePool
+	{
+		mutable std::mutex Mutex;
+		std::vector<std::unique_ptr<RHICommandAllocator>> Allocators;
+		std::vector<std::unique_ptr<RHICommandList>> CommandLists;
+		std::deque<FRetiringAllocator> ReleasedAllocators;     // Oldest release first.
+		std::deque<FRetiringCommandList> ReleasedCommandLists;  // Oldest release first.
+		uint64_t AllocatorAcquireCount = 0;
+		uint64_t AllocatorReuseCount = 0;
+	};
+
+	static const uint32_t TypeCount = 4;
+
+	FTypePool& GetTypePool(ERHICommandListType type) { return mTypePools[static_cast<uint32_t>(type)]; }
+	bool IsRetired(uint64_t fenceValue);
+
+	RHIDevice* mDevice;
+	FTypePool mTypePools[TypeCount];
+};
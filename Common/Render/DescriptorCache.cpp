@@ -0,0 +1,195 @@
+#include "DescriptorCache.h"
+
+#include <iterator>
+#include <stdexcept>
+
+namespace
+{
+	uint64_t ToKey(FBindlessHandle handle)
+	{
+		return (uint64_t(handle.Generation) << 32) | handle.Index;
+	}
+
+	// FNV-1a over the keys, a 64-bit word at a time.
+	uint64_t HashKeys(const std::vector<uint64_t>& keys)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (uint64_t key : keys)
+		{
+			hash = (hash ^ key) * 1099511628211ull;
+		}
+		return hash;
+	}
+}
+
+FDescriptorStagingHeap::FDescriptorStagingHeap(RHIDevice* device, ERHIDescriptorHeapType type, uint32_t capacity) :
+	mHeap(device->CreateDescriptorHeap(type, capacity, false)),
+	mSlots(capacity)
+{
+}
+
+FBindlessHandle FDescriptorStagingHeap::Allocate()
+{
+	const FBindlessHandle handle = mSlots.Allocate();
+	if (!handle.IsValid())
+	{
+		throw std::runtime_error("FDescriptorStagingHeap: heap full");
+	}
+	return handle;
+}
+
+void FDescriptorStagingHeap::Free(FBindlessHandle handle)
+{
+	if (!mSlots.Free(handle))
+	{
+		throw std::runtime_error("FDescriptorStagingHeap: view freed twice or never allocated");
+	}
+}
+
+FRHICpuDescriptor FDescriptorStagingHeap::GetCpuHandle(FBindlessHandle handle) const
+{
+	if (!mSlots.IsAlive(handle))
+	{
+		throw std::runtime_error("FDescriptorStagingHeap: view used after free");
+	}
+	return mHeap->GetCpuHandle(handle.Index);
+}
+
+FDescriptorTableCache::FDescriptorTableCache(RHIDevice* device, RHICommandQueue* queue, FDescriptorStagingHeap* stagingHeap,
+	RHIDescriptorHeap* shaderVisibleHeap, uint32_t firstDescriptor, uint32_t descriptorCount) :
+	mDevice(device),
+	mQueue(queue),
+	mStagingHeap(stagingHeap),
+	mShaderVisibleHeap(shaderVisibleHeap),
+	mFirstDescriptor(firstDescriptor),
+	mSlots(descriptorCount)
+{
+	if (stagingHeap->GetType() != shaderVisibleHeap->GetType() || !shaderVisibleHeap->IsShaderVisible() ||
+		uint64_t(firstDescriptor) + descriptorCount > shaderVisibleHeap->GetNumDescriptors())
+	{
+		throw std::runtime_error("FDescriptorTableCache: the range must lie in a shader-visible heap of the staging heap's type");
+	}
+}
+
+FRHIGpuDescriptor FDescriptorTableCache::GetTable(const FBindlessHandle* descriptors, uint32_t count, bool pin)
+{
+	if (count == 0)
+	{
+		throw std::runtime_error("FDescriptorTableCache: empty table");
+	}
+
+	uint64_t hash = 0;
+	FTableIterator table = Find(descriptors, count, hash);
+	if (table != mTables.end())
+	{
+		++mStats.HitCount;
+	}
+	else
+	{
+		// Staging handles are checked before anything is evicted for them.
+		mSources.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			mSources[i] = mStagingHeap->GetCpuHandle(descriptors[i]);
+		}
+
+		FBindlessHandle slots = mSlots.AllocateRange(count);
+		while (!slots.IsValid())
+		{
+			if (!EvictOne())
+			{
+				throw std::runtime_error("FDescriptorTableCache: no room for the table; every table is pinned or in flight");
+			}
+			slots = mSlots.AllocateRange(count);
+		}
+
+		mDevice->CopyDescriptors(count, mSources.data(), mShaderVisibleHeap->GetCpuHandle(mFirstDescriptor + slots.Index), mShaderVisibleHeap->GetType());
+
+		mTables.push_front({ hash, mKeys, slots, 0, false });
+		table = mTables.begin();
+		mLookup.emplace(hash, table);
+		++mStats.TableCount;
+		mStats.UsedDescriptors += count;
+		++mStats.MissCount;
+		mStats.DescriptorsCopied += count;
+	}
+
+	mTables.splice(mTables.begin(), mTables, table);
+	table->Fence = UnsubmittedFence;
+	table->Pinned = table->Pinned || pin;
+	return mShaderVisibleHeap->GetGpuHandle(mFirstDescriptor + table->Slots.Index);
+}
+
+void FDescriptorTableCache::OnSubmit(uint64_t fenceValue)
+{
+	// Returned tables are moved to the front, so the ones since the last call lead the list.
+	for (auto table = mTables.begin(); table != mTables.end() && table->Fence == UnsubmittedFence; ++table)
+	{
+		table->Fence = fenceValue;
+	}
+}
+
+void FDescriptorTableCache::Unpin(const FBindlessHandle* descriptors, uint32_t count)
+{
+	uint64_t hash = 0;
+	FTableIterator table = Find(descriptors, count, hash);
+	if (table != mTables.end())
+	{
+		table->Pinned = false;
+	}
+}
+
+FDescriptorTableCache::FTableIterator FDescriptorTableCache::Find(const FBindlessHandle* descriptors, uint32_t count, uint64_t& hash)
+{
+	mKeys.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		mKeys[i] = ToKey(descriptors[i]);
+	}
+	hash = HashKeys(mKeys);
+
+	auto range = mLookup.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second->Keys == mKeys)
+		{
+			return it->second;
+		}
+	}
+	return mTables.end();
+}
+
+bool FDescriptorTableCache::EvictOne()
+{
+	// From the least recently returned end. Fences only grow towards the front, so the first
+	// unpinned table still in flight means every one after it is too.
+	const uint64_t completedFence = mQueue->GetLastCompletedFence();
+	for (auto table = mTables.rbegin(); table != mTables.rend(); ++table)
+	{
+		if (table->Pinned)
+		{
+			continue;
+		}
+		if (table->Fence > completedFence)
+		{
+			return false;
+		}
+
+		auto range = mLookup.equal_range(table->Hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (&*it->second == &*table)
+			{
+				mLookup.erase(it);
+				break;
+			}
+		}
+		mSlots.Free(table->Slots);
+		--mStats.TableCount;
+		mStats.UsedDescriptors -= static_cast<uint32_t>(table->Keys.size());
+		++mStats.EvictionCount;
+		mTables.erase(std::next(table).base());
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "../../RHI/RHICommandQueue.h"
+#include "../../RHI/RHIDevice.h"
+#include "BindlessSlotAllocator.h"
+
+// A CPU-only descriptor heap holding the authoritative copy of each view. Views are created here
+// once, at load; what shaders see are copies that FDescriptorTableCache assembles into the
+// shader-visible heap. A slot can be rewritten or freed at any time without a GPU fence, since
+// copies are taken by value.
+//
+// Allocate() and Free() may be called from any thread (see FBindlessSlotAllocator).
+class FDescriptorStagingHeap
+{
+public:
+	FDescriptorStagingHeap(RHIDevice* device, ERHIDescriptorHeapType type, uint32_t capacity);
+
+	// Throws when the heap is full.
+	FBindlessHandle Allocate();
+	void Free(FBindlessHandle handle);
+	bool IsAlive(FBindlessHandle handle) const { return mSlots.IsAlive(handle); }
+
+	// Where to create the view. Throws for a freed handle.
+	FRHICpuDescriptor GetCpuHandle(FBindlessHandle handle) const;
+
+	RHIDescriptorHeap* GetHeap() const { return mHeap.get(); }
+	ERHIDescriptorHeapType GetType() const { return mHeap->GetType(); }
+
+private:
+	std::unique_ptr<RHIDescriptorHeap> mHeap;
+	FBindlessSlotAllocator mSlots;
+};
+
+struct FDescriptorTableCacheStats
+{
+	uint32_t TableCount = 0;            // Tables in the shader-visible heap now.
+	uint32_t UsedDescriptors = 0;       // Their descriptors, added up.
+	uint64_t HitCount = 0;
+	uint64_t MissCount = 0;             // Tables assembled, one CopyDescriptors call each.
+	uint64_t EvictionCount = 0;
+	uint64_t DescriptorsCopied = 0;
+};
+
+// Descriptor tables in a range of a shader-visible heap, assembled from FDescriptorStagingHeap
+// views and shared by every request for the same views in the same order. A table is keyed by its
+// staging handles, generations included: once a view is freed, tables that held it are never
+// returned again and age out.
+//
+// Each time a table is returned it is in flight until OnSubmit() tags it with the fence value of
+// the submission holding the commands that bind it (as with FUploadRing). When the range is full,
+// the least recently returned tables whose fence has completed are evicted to make room.
+// Pinned tables are never evicted; use them for tables that stay bound without being looked up
+// again, such as those a bundle records.
+//
+// Not thread-safe.
+class FDescriptorTableCache
+{
+public:
+	FDescriptorTableCache(RHIDevice* device, RHICommandQueue* queue, FDescriptorStagingHeap* stagingHeap,
+		RHIDescriptorHeap* shaderVisibleHeap, uint32_t firstDescriptor, uint32_t descriptorCount);
+
+	// The table holding the views of descriptors[0, count) in that order, assembled on first use.
+	// Throws for a freed view, or when every table in the range is pinned or still in flight.
+	FRHIGpuDescriptor GetTable(const FBindlessHandle* descriptors, uint32_t count, bool pin = false);
+
+	// Tags every table returned since the last call with fenceValue, what ExecuteCommandLists() or
+	// SubmitCommandLists() returned for the lists that bind them.
+	void OnSubmit(uint64_t fenceValue);
+
+	// Lets an earlier pinned table be evicted again.
+	void Unpin(const FBindlessHandle* descriptors, uint32_t count);
+
+	const FDescriptorTableCacheStats& GetStats() const { return mStats; }
+
+private:
+	struct FTable
+	{
+		uint64_t Hash;
+		std::vector<uint64_t> Keys;     // Generation << 32 | index of each staging view.
+		FBindlessHandle Slots;          // In the shader-visible range.
+		uint64_t Fence;
+		bool Pinned;
+	};
+
+	typedef std::list<FTable>::iterator FTableIterator;
+
+	// The fence of a table returned since the last OnSubmit().
+	static const uint64_t UnsubmittedFence = UINT64_MAX;
+
+	// The table for descriptors[0, count), or mTables.end(); mKeys holds their keys afterwards.
+	FTableIterator Find(const FBindlessHandle* descriptors, uint32_t count, uint64_t& hash);
+	bool EvictOne();
+
+	RHIDevice* mDevice;
+	RHICommandQueue* mQueue;
+	FDescriptorStagingHeap* mStagingHeap;
+	RHIDescriptorHeap* mShaderVisibleHeap;
+	uint32_t mFirstDescriptor;
+	FBindlessSlotAllocator mSlots;
+	// Most recently returned first, so the fences are in descending order too.
+	std::list<FTable> mTables;
+	std::unordered_multimap<uint64_t, FTableIterator> mLookup;
+	std::vector<uint64_t> mKeys;
+	std::vector<FRHICpuDescriptor> mSources;
+	FDescriptorTableCacheStats mStats;
+};
@@ -0,0 +1,67 @@
+#include "DescriptorRing.h"
+
+FDescriptorRing::FDescriptorRing(uint32_t capacity) :
+	mCapacity(capacity),
+	mHead(0),
+	mUsedCount(0),
+	mFrameCount(0)
+{
+}
+
+uint32_t FDescriptorRing::Allocate(uint32_t count)
+{
+	if (count == 0 || count > mCapacity)
+	{
+		return Invalid;
+	}
+
+	// The slots in use are the mUsedCount before mHead, possibly wrapped; as long as their total
+	// stays within the capacity, the head never runs into the oldest of them.
+	uint32_t start = mHead;
+	uint32_t padding = 0;
+	if (start + count > mCapacity)
+	{
+		padding = mCapacity - start;
+		start = 0;
+	}
+	if (mUsedCount + padding + count > mCapacity)
+	{
+		return Invalid;
+	}
+
+	mHead = start + count;
+	mUsedCount += padding + count;
+	mFrameCount += padding + count;
+	return start;
+}
+
+void FDescriptorRing::EndFrame(uint64_t fenceValue)
+{
+	if (mFrameCount > 0)
+	{
+		mFrames.push_back({ mFrameCount, fenceValue });
+		mFrameCount = 0;
+	}
+}
+
+void FDescriptorRing::ReleaseRetired(uint64_t completedFence)
+{
+	while (!mFrames.empty() && mFrames.front().Fence <= completedFence)
+	{
+		mUsedCount -= mFrames.front().Count;
+		mFrames.pop_front();
+	}
+	// Empty again: start over at slot 0, so a large allocation does not have to wrap.
+	if (mUsedCount == 0)
+	{
+		mHead = 0;
+	}
+}
+
+void FDescriptorRing::Reset()
+{
+	mFrames.clear();
+	mHead = 0;
+	mUsedCount = 0;
+	mFrameCount = 0;
+}
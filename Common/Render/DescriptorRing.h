@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Slots of a shader-visible descriptor range for descriptors that live one frame: per-draw CBVs, UI
+// and particle views. Allocations are carved in order out of the range, used as a ring. EndFrame()
+// tags what the frame allocated with the fence value of its submission, and ReleaseRetired() takes
+// frames back, oldest first, once their fence has completed, so the range only has to hold what is
+// in flight.
+//
+// An allocation is one contiguous run. One that does not fit before the end of the range starts
+// over at slot 0, and the slots it skips are charged to its frame and come back with it.
+//
+// Not thread-safe.
+class FDescriptorRing
+{
+public:
+	static const uint32_t Invalid = ~0u;
+
+	explicit FDescriptorRing(uint32_t capacity);
+
+	// The first of count slots, or Invalid when the frames in flight leave no room for them.
+	uint32_t Allocate(uint32_t count);
+
+	// Tags every allocation since the last call with the fence value of the submission using them.
+	void EndFrame(uint64_t fenceValue);
+
+	// Takes back the slots of every frame whose fence is at or before completedFence.
+	void ReleaseRetired(uint64_t completedFence);
+
+	// Forgets every allocation. Only while the GPU is idle.
+	void Reset();
+
+	uint32_t GetCapacity() const { return mCapacity; }
+	// Slots allocated and not taken back yet, skipped ones included.
+	uint32_t GetUsedCount() const { return mUsedCount; }
+
+private:
+	// What one frame took, skipped slots included, and the fence of its submission.
+	struct FFrame
+	{
+		uint32_t Count;
+		uint64_t Fence;
+	};
+
+	uint32_t mCapacity;
+	uint32_t mHead;             // Where the next allocation starts, unless it has to wrap.
+	uint32_t mUsedCount;        // The slots in use, which end at mHead.
+	uint32_t mFrameCount;       // Taken since the last EndFrame().
+	std::deque<FFrame> mFrames;     // Oldest first.
+};
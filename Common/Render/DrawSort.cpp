@@ -0,0 +1,136 @@
+#include "DrawSort.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "../Jobs/JobSystem.h"
+
+namespace
+{
+	const uint32_t DigitBits = 8;
+	const uint32_t RadixSize = 1u << DigitBits;
+	const uint32_t DigitCount = 64 / DigitBits;
+
+	// Fewer items than this are insertion sorted: the histograms would cost more than the sort.
+	const uint32_t InsertionSortThreshold = 64;
+	// Smallest slice worth a job of its own, and the most slices a pass is cut into.
+	const uint32_t MinItemsPerChunk = 16384;
+	const uint32_t MaxChunkCount = 64;
+
+	void InsertionSort(FDrawItem* pItems, uint32_t count)
+	{
+		for (uint32_t i = 1; i < count; ++i)
+		{
+			const FDrawItem item = pItems[i];
+			uint32_t j = i;
+			for (; j > 0 && pItems[j - 1].Key > item.Key; --j)
+			{
+				pItems[j] = pItems[j - 1];
+			}
+			pItems[j] = item;
+		}
+	}
+
+	// Splits [0, count) into chunkCount slices and runs func(chunk, begin, end) for each, as jobs when
+	// there is a job system.
+	template<typename F>
+	void ForEachChunk(FJobSystem* pJobSystem, uint32_t count, uint32_t chunkCount, const F& func)
+	{
+		auto runChunks = [count, chunkCount, &func](uint32_t firstChunk, uint32_t endChunk)
+		{
+			for (uint32_t chunk = firstChunk; chunk < endChunk; ++chunk)
+			{
+				const uint32_t begin = static_cast<uint32_t>(uint64_t(count) * chunk / chunkCount);
+				const uint32_t end = static_cast<uint32_t>(uint64_t(count) * (chunk + 1) / chunkCount);
+				func(chunk, begin, end);
+			}
+		};
+
+		if (pJobSystem && chunkCount > 1)
+		{
+			pJobSystem->ParallelFor(chunkCount, 1, [&runChunks](uint32_t begin, uint32_t end, FJobContext&) { runChunks(begin, end); });
+		}
+		else
+		{
+			runChunks(0, chunkCount);
+		}
+	}
+}
+
+void SortDrawItems(FDrawItem* pItems, FDrawItem* pScratch, uint32_t count, FJobSystem* pJobSystem)
+{
+	if (count < InsertionSortThreshold)
+	{
+		InsertionSort(pItems, count);
+		return;
+	}
+
+	// A digit only needs a pass when some key differs from the others in it.
+	uint64_t differingBits = 0;
+	const uint64_t firstKey = pItems[0].Key;
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		differingBits |= pItems[i].Key ^ firstKey;
+	}
+
+	uint32_t chunkCount = 1;
+	if (pJobSystem)
+	{
+		chunkCount = std::min(std::min(MaxChunkCount, pJobSystem->GetThreadCount() * 2), std::max(1u, count / MinItemsPerChunk));
+	}
+
+	// Per chunk and digit value: its count, then where the chunk writes its first item with that value.
+	// Scattering every chunk in order from those offsets keeps the sort stable.
+	std::vector<uint32_t> offsets(size_t(chunkCount) * RadixSize);
+	uint32_t* pOffsets = offsets.data();
+
+	FDrawItem* pSource = pItems;
+	FDrawItem* pDestination = pScratch;
+	for (uint32_t digit = 0; digit < DigitCount; ++digit)
+	{
+		const uint32_t shift = digit * DigitBits;
+		if (((differingBits >> shift) & (RadixSize - 1)) == 0)
+		{
+			continue;
+		}
+
+		ForEachChunk(pJobSystem, count, chunkCount, [pSource, pOffsets, shift](uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			uint32_t* pHistogram = pOffsets + size_t(chunk) * RadixSize;
+			memset(pHistogram, 0, sizeof(uint32_t) * RadixSize);
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				++pHistogram[(pSource[i].Key >> shift) & (RadixSize - 1)];
+			}
+		});
+
+		uint32_t offset = 0;
+		for (uint32_t value = 0; value < RadixSize; ++value)
+		{
+			for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				uint32_t& slot = pOffsets[size_t(chunk) * RadixSize + value];
+				const uint32_t chunkValueCount = slot;
+				slot = offset;
+				offset += chunkValueCount;
+			}
+		}
+
+		ForEachChunk(pJobSystem, count, chunkCount, [pSource, pDestination, pOffsets, shift](uint32_t chunk, uint32_t begin, uint32_t end)
+		{
+			uint32_t* pNext = pOffsets + size_t(chunk) * RadixSize;
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				pDestination[pNext[(pSource[i].Key >> shift) & (RadixSize - 1)]++] = pSource[i];
+			}
+		});
+
+		std::swap(pSource, pDestination);
+	}
+
+	if (pSource != pItems)
+	{
+		memcpy(pItems, pSource, sizeof(FDrawItem) * count);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+class FJobSystem;
+
+// 64-bit draw sort key. Fields from the most significant bit down, so sorting the keys groups draws
+// by the most expensive state first and orders the draws of one state by depth:
+//
+//   63..60  pass              (4 bits)
+//   59..48  pipeline state    (12 bits)
+//   47..42  root signature    (6 bits)
+//   41..26  material          (16 bits)
+//   25..16  mesh              (10 bits)
+//   15..0   quantized depth   (16 bits)
+//
+// The ids are small integers the caller assigns (e.g. an index into its PSO table); values wider
+// than their field are truncated.
+struct FDrawKey
+{
+	static const uint32_t PassBits = 4;
+	static const uint32_t PipelineStateBits = 12;
+	static const uint32_t RootSignatureBits = 6;
+	static const uint32_t MaterialBits = 16;
+	static const uint32_t MeshBits = 10;
+	static const uint32_t DepthBits = 16;
+
+	static const uint32_t DepthShift = 0;
+	static const uint32_t MeshShift = DepthShift + DepthBits;
+	static const uint32_t MaterialShift = MeshShift + MeshBits;
+	static const uint32_t RootSignatureShift = MaterialShift + MaterialBits;
+	static const uint32_t PipelineStateShift = RootSignatureShift + RootSignatureBits;
+	static const uint32_t PassShift = PipelineStateShift + PipelineStateBits;
+
+	static uint64_t Make(uint32_t pass, uint32_t pipelineState, uint32_t rootSignature, uint32_t material, uint32_t mesh, uint32_t depth)
+	{
+		return (Field(pass, PassBits) << PassShift) |
+			(Field(pipelineState, PipelineStateBits) << PipelineStateShift) |
+			(Field(rootSignature, RootSignatureBits) << RootSignatureShift) |
+			(Field(material, MaterialBits) << MaterialShift) |
+			(Field(mesh, MeshBits) << MeshShift) |
+			(Field(depth, DepthBits) << DepthShift);
+	}
+
+	static uint32_t GetPass(uint64_t key) { return Extract(key, PassShift, PassBits); }
+	static uint32_t GetPipelineState(uint64_t key) { return Extract(key, PipelineStateShift, PipelineStateBits); }
+	static uint32_t GetRootSignature(uint64_t key) { return Extract(key, RootSignatureShift, RootSignatureBits); }
+	static uint32_t GetMaterial(uint64_t key) { return Extract(key, MaterialShift, MaterialBits); }
+	static uint32_t GetMesh(uint64_t key) { return Extract(key, MeshShift, MeshBits); }
+	static uint32_t GetDepth(uint64_t key) { return Extract(key, DepthShift, DepthBits); }
+
+	// View depth mapped linearly from [nearZ, farZ] to the depth field, clamped. Front to back suits
+	// opaque passes (early depth rejection); backToFront inverts it for blended passes.
+	static uint32_t QuantizeDepth(float viewDepth, float nearZ, float farZ, bool backToFront = false)
+	{
+		const uint32_t maxDepth = (1u << DepthBits) - 1;
+		float t = (viewDepth - nearZ) / (farZ - nearZ);
+		t = t > 0.0f ? (t < 1.0f ? t : 1.0f) : 0.0f;  // Also maps NaN to 0.
+		const uint32_t depth = static_cast<uint32_t>(t * maxDepth + 0.5f);
+		return backToFront ? maxDepth - depth : depth;
+	}
+
+private:
+	static uint64_t Field(uint32_t value, uint32_t bits) { return uint64_t(value) & ((uint64_t(1) << bits) - 1); }
+	static uint32_t Extract(uint64_t key, uint32_t shift, uint32_t bits) { return static_cast<uint32_t>((key >> shift) & ((uint64_t(1) << bits) - 1)); }
+};
+
+// A draw to sort: its key and whatever index the caller records it from.
+struct FDrawItem
+{
+	uint64_t Key;
+	uint32_t Index;
+};
+
+// Sorts pItems[0, count) by key, stable, with an LSD radix sort of 8-bit digits. pScratch must have
+// room for count items; the result ends up in pItems. Digits every key shares are skipped, so keys
+// that only differ in a few fields sort in a few passes. With a job system, the histogram and scatter
+// of each pass are split into chunks run as jobs.
+void SortDrawItems(FDrawItem* pItems, FDrawItem* pScratch, uint32_t count, FJobSystem* pJobSystem = nullptr);
@@ -0,0 +1,148 @@
+#include "FenceWatcher.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+FFenceWatcher::FFenceWatcher(RHIDevice* device) :
+	mDevice(device),
+	mStopping(false)
+{
+	if (!mDevice)
+	{
+		throw std::runtime_error("FFenceWatcher: no device");
+	}
+
+	mEvent = mDevice->CreateFenceEvent();
+	std::fill(mArmedFenceValues, mArmedFenceValues + TypeCount, 0);
+	mThread = std::thread([this]() { Run(); });
+}
+
+FFenceWatcher::~FFenceWatcher()
+{
+	// Nothing may be released before the GPU is done with it, so wait for the last value of each
+	// queue here; the thread then runs what is left and stops.
+	uint64_t lastFenceValues[TypeCount] = {};
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (uint32_t type = 0; type < TypeCount; ++type)
+		{
+			if (!mPending[type].empty())
+			{
+				lastFenceValues[type] = mPending[type].rbegin()->first;
+			}
+		}
+	}
+	for (uint32_t type = 0; type < TypeCount; ++type)
+	{
+		if (lastFenceValues[type] != 0)
+		{
+			GetQueue(type)->WaitForFenceCPUBlocking(lastFenceValues[type]);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mEvent->Signal();
+	mThread.join();
+}
+
+void FFenceWatcher::OnFenceComplete(uint64_t fenceValue, std::function<void()> callback)
+{
+	const uint32_t type = static_cast<uint32_t>(RHIGetFenceQueueType(fenceValue));
+	if (type >= TypeCount || fenceValue >= GetQueue(type)->GetNextFenceValue())
+	{
+		throw std::runtime_error("FFenceWatcher::OnFenceComplete: fence value not submitted");
+	}
+
+	bool isLowest = false;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		const auto it = mPending[type].emplace(fenceValue, std::move(callback));
+		isLowest = it == mPending[type].begin();
+		mStats.PendingCount++;
+		mStats.MaxPendingCount = std::max(mStats.MaxPendingCount, mStats.PendingCount);
+	}
+
+	// A later value than the queue's lowest is seen when the lowest is reached; only a new lowest
+	// needs the event re-armed.
+	if (isLowest)
+	{
+		mEvent->Signal();
+	}
+}
+
+FFenceWatcherStats FFenceWatcher::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mStats;
+}
+
+void FFenceWatcher::Run()
+{
+	std::vector<std::function<void()>> ready;
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;)
+	{
+		uint64_t lowestFenceValues[TypeCount] = {};
+		for (uint32_t type = 0; type < TypeCount; ++type)
+		{
+			std::multimap<uint64_t, std::function<void()>>& pending = mPending[type];
+			if (pending.empty())
+			{
+				continue;
+			}
+
+			RHICommandQueue* queue = GetQueue(type);
+			auto reached = pending.begin();
+			while (reached != pending.end() && queue->IsFenceComplete(reached->first))
+			{
+				ready.push_back(std::move(reached->second));
+				++reached;
+			}
+			pending.erase(pending.begin(), reached);
+			if (!pending.empty())
+			{
+				lowestFenceValues[type] = pending.begin()->first;
+			}
+		}
+
+		if (!ready.empty())
+		{
+			const uint32_t readyCount = static_cast<uint32_t>(ready.size());
+			mStats.PendingCount -= readyCount;
+			lock.unlock();
+			for (std::function<void()>& callback : ready)
+			{
+				callback();
+			}
+			// Destroys what the callbacks captured, e.g. the objects given to DeferRelease().
+			ready.clear();
+			lock.lock();
+			mStats.CallbackCount += readyCount;
+			// Callbacks take time; check the fences again before sleeping.
+			continue;
+		}
+
+		if (mStopping && std::all_of(lowestFenceValues, lowestFenceValues + TypeCount, [](uint64_t value) { return value == 0; }))
+		{
+			return;
+		}
+
+		// Arming flushes the queue's submissions up to the value, so it is done outside the lock.
+		lock.unlock();
+		for (uint32_t type = 0; type < TypeCount; ++type)
+		{
+			if (lowestFenceValues[type] != 0 && lowestFenceValues[type] != mArmedFenceValues[type])
+			{
+				GetQueue(type)->SetEventOnCompletion(lowestFenceValues[type], mEvent.get());
+				mArmedFenceValues[type] = lowestFenceValues[type];
+			}
+		}
+		mEvent->Wait();
+		lock.lock();
+		mStats.WakeCount++;
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "../../RHI/RHIDevice.h"
+
+struct FFenceWatcherStats
+{
+	uint64_t CallbackCount = 0;     // Run so far.
+	uint32_t PendingCount = 0;      // Registered, fence not reached yet.
+	uint32_t MaxPendingCount = 0;
+	uint64_t WakeCount = 0;         // Times the watcher thread woke from its fence event.
+};
+
+// Runs callbacks once queue fences reach given values, on a thread of its own, so that the render
+// thread never blocks to find out. Pending callbacks wait in a map per queue, keyed by fence value.
+// The thread arms one RHIFenceEvent on the lowest pending value of every queue at once, sleeps until
+// any of them is reached (or a lower value is registered), then runs every callback whose value has
+// been reached, lowest values first.
+//
+// DeferRelease() is the deferred-release queue on top of it: an object the GPU may still read, such
+// as the upload buffers of a load or a resource replaced mid-run, is handed over with the fence value
+// of the last submission that uses it and destroyed on the watcher thread once that completes.
+//
+// Every method may be called from any thread, callbacks included. Callbacks must not throw or wait on
+// the GPU. Destroying the watcher waits for the values still pending and runs their callbacks.
+class FFenceWatcher
+{
+public:
+	explicit FFenceWatcher(RHIDevice* device);
+	~FFenceWatcher();
+
+	FFenceWatcher(const FFenceWatcher&) = delete;
+	FFenceWatcher& operator=(const FFenceWatcher&) = delete;
+
+	// fenceValue must have been submitted to the queue it names (RHIGetFenceQueueType); 0, nothing
+	// submitted, runs callback right away on the watcher thread.
+	void OnFenceComplete(uint64_t fenceValue, std::function<void()> callback);
+
+	// Keeps object (a std::unique_ptr, a ComPtr, ...) alive until fenceValue is reached.
+	template <typename T>
+	void DeferRelease(uint64_t fenceValue, T object)
+	{
+		std::shared_ptr<T> holder = std::make_shared<T>(std::move(object));
+		OnFenceComplete(fenceValue, [holder]() mutable { holder.reset(); });
+	}
+
+	FFenceWatcherStats GetStats() const;
+
+private:
+	static const uint32_t TypeCount = 4;
+
+	RHICommandQueue* GetQueue(uint32_t type) { return mDevice->GetQueue(static_cast<ERHICommandListType>(type)); }
+	void Run();
+
+	RHIDevice* mDevice;
+	std::unique_ptr<RHIFenceEvent> mEvent;
+	mutable std::mutex mMutex;
+	std::multimap<uint64_t, std::function<void()>> mPending[TypeCount];     // Indexed by ERHICommandListType.
+	uint64_t mArmedFenceValues[TypeCount];      // What mEvent was last armed on, per queue. Watcher thread only.
+	bool mStopping;
+	FFenceWatcherStats mStats;
+	std::thread mThread;
+};
@@ -0,0 +1,342 @@
+#include "PipelineCache.h"
+
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+// One pipeline: the desc it was requested with, deep-copied so that a compile can outlive the
+// caller's buffers, and the pipeline once there is one.
+class FPipelineCacheEntry
+{
+public:
+	FPipelineCacheEntry(const FRHIGraphicsPipelineDesc& desc, uint64_t hash) :
+		Desc(desc),
+		VS(static_cast<const uint8_t*>(desc.VS.pShaderBytecode), static_cast<const uint8_t*>(desc.VS.pShaderBytecode) + desc.VS.BytecodeLength),
+		PS(static_cast<const uint8_t*>(desc.PS.pShaderBytecode), static_cast<const uint8_t*>(desc.PS.pShaderBytecode) + desc.PS.BytecodeLength),
+		InputElements(desc.InputElements, desc.InputElements + desc.NumInputElements),
+		Done(false),
+		Stored(false)
+	{
+		SemanticNames.reserve(InputElements.size());
+		for (FRHIInputElement& element : InputElements)
+		{
+			SemanticNames.push_back(element.SemanticName ? element.SemanticName : "");
+			element.SemanticName = SemanticNames.back().c_str();
+		}
+		Desc.VS.pShaderBytecode = VS.data();
+		Desc.PS.pShaderBytecode = PS.data();
+		Desc.InputElements = InputElements.data();
+
+		// The library name: the hash in hex.
+		const wchar_t* digits = L"0123456789abcdef";
+		for (int shift = 60; shift >= 0; shift -= 4)
+		{
+			Name.push_back(digits[(hash >> shift) & 0xF]);
+		}
+	}
+
+	FRHIGraphicsPipelineDesc Desc;      // Points into the copies below.
+	std::vector<uint8_t> VS;
+	std::vector<uint8_t> PS;
+	std::vector<FRHIInputElement> InputElements;
+	std::vector<std::string> SemanticNames;
+	std::wstring Name;
+
+	// Written by the compile before Done is set, read only after.
+	std::unique_ptr<RHIPipelineState> Pipeline;
+	std::string Error;
+	std::atomic<bool> Done;
+
+	bool Stored;                        // In the library; guarded by the cache's mutex.
+	FJobCounter Compile;
+};
+
+namespace
+{
+	template<typename T>
+	uint64_t HashValue(const T& value, uint64_t hash)
+	{
+		return FPipelineCache::HashBytes(&value, sizeof(value), hash);
+	}
+
+	bool IsSameBytecode(const FRHIShaderBytecode& a, const FRHIShaderBytecode& b)
+	{
+		return a.BytecodeLength == b.BytecodeLength &&
+			(a.BytecodeLength == 0 || std::memcmp(a.pShaderBytecode, b.pShaderBytecode, a.BytecodeLength) == 0);
+	}
+
+	const char* GetSemanticName(const FRHIInputElement& element)
+	{
+		return element.SemanticName ? element.SemanticName : "";
+	}
+
+	// The same fields as HashDesc(), compared the same way.
+	bool IsSameDesc(const FRHIGraphicsPipelineDesc& a, const FRHIGraphicsPipelineDesc& b)
+	{
+		const uint64_t rootSignatureA = a.RootSignature ? a.RootSignature->GetHash() : 0;
+		const uint64_t rootSignatureB = b.RootSignature ? b.RootSignature->GetHash() : 0;
+		if (rootSignatureA != rootSignatureB || !IsSameBytecode(a.VS, b.VS) || !IsSameBytecode(a.PS, b.PS) ||
+			a.NumInputElements != b.NumInputElements || a.CullMode != b.CullMode || a.DepthEnable != b.DepthEnable ||
+			a.DepthWrite != b.DepthWrite || a.DepthFunc != b.DepthFunc || a.BlendEnable != b.BlendEnable ||
+			a.PrimitiveTopologyType != b.PrimitiveTopologyType || a.NumRenderTargets != b.NumRenderTargets ||
+			a.DepthStencilFormat != b.DepthStencilFormat || a.SampleCount != b.SampleCount)
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < a.NumInputElements; ++i)
+		{
+			const FRHIInputElement& elementA = a.InputElements[i];
+			const FRHIInputElement& elementB = b.InputElements[i];
+			if (std::strcmp(GetSemanticName(elementA), GetSemanticName(elementB)) != 0 || elementA.SemanticIndex != elementB.SemanticIndex ||
+				elementA.Format != elementB.Format || elementA.InputSlot != elementB.InputSlot || elementA.AlignedByteOffset != elementB.AlignedByteOffset ||
+				elementA.InputSlotClass != elementB.InputSlotClass || elementA.InstanceDataStepRate != elementB.InstanceDataStepRate)
+			{
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < a.NumRenderTargets && i < 8; ++i)
+		{
+			if (a.RenderTargetFormats[i] != b.RenderTargetFormats[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+FPipelineCache::FPipelineCache(const FPipelineCacheDesc& desc) :
+	mDevice(desc.Device),
+	mJobSystem(desc.JobSystem),
+	mLibraryPath(desc.LibraryPath),
+	mFallbackCount(0)
+{
+	if (!mDevice)
+	{
+		throw std::runtime_error("FPipelineCache: no device");
+	}
+	if (mLibraryPath.empty())
+	{
+		return;
+	}
+
+	// A missing or unreadable file is an empty library: every pipeline compiles this run.
+	std::vector<uint8_t> blob;
+	std::ifstream file(mLibraryPath, std::ios::binary);
+	if (file)
+	{
+		blob.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	mLibrary = mDevice->CreatePipelineLibrary(blob.data(), blob.size());
+}
+
+FPipelineCache::~FPipelineCache()
+{
+	WaitForCompiles();
+}
+
+uint64_t FPipelineCache::HashBytes(const void* data, size_t size, uint64_t hash)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+uint64_t FPipelineCache::HashDesc(const FRHIGraphicsPipelineDesc& desc)
+{
+	uint64_t hash = HashValue(desc.RootSignature ? desc.RootSignature->GetHash() : 0ull, 14695981039346656037ull);
+	hash = HashValue(desc.VS.BytecodeLength, hash);
+	hash = HashBytes(desc.VS.pShaderBytecode, desc.VS.BytecodeLength, hash);
+	hash = HashValue(desc.PS.BytecodeLength, hash);
+	hash = HashBytes(desc.PS.pShaderBytecode, desc.PS.BytecodeLength, hash);
+
+	hash = HashValue(desc.NumInputElements, hash);
+	for (uint32_t i = 0; i < desc.NumInputElements; ++i)
+	{
+		const FRHIInputElement& element = desc.InputElements[i];
+		const char* semanticName = GetSemanticName(element);
+		hash = HashBytes(semanticName, std::strlen(semanticName) + 1, hash);
+		hash = HashValue(element.SemanticIndex, hash);
+		hash = HashValue(element.Format, hash);
+		hash = HashValue(element.InputSlot, hash);
+		hash = HashValue(element.AlignedByteOffset, hash);
+		hash = HashValue(element.InputSlotClass, hash);
+		hash = HashValue(element.InstanceDataStepRate, hash);
+	}
+
+	// bools one byte each, whatever sizeof(bool) is.
+	hash = HashValue(desc.CullMode, hash);
+	hash = HashValue(uint8_t(desc.DepthEnable), hash);
+	hash = HashValue(uint8_t(desc.DepthWrite), hash);
+	hash = HashValue(desc.DepthFunc, hash);
+	hash = HashValue(uint8_t(desc.BlendEnable), hash);
+	hash = HashValue(desc.PrimitiveTopologyType, hash);
+	hash = HashValue(desc.NumRenderTargets, hash);
+	for (uint32_t i = 0; i < desc.NumRenderTargets && i < 8; ++i)
+	{
+		hash = HashValue(desc.RenderTargetFormats[i], hash);
+	}
+	hash = HashValue(desc.DepthStencilFormat, hash);
+	hash = HashValue(desc.SampleCount, hash);
+	return hash;
+}
+
+FPipelineCacheEntry* FPipelineCache::Request(const FRHIGraphicsPipelineDesc& desc)
+{
+	const uint64_t hash = HashDesc(desc);
+	std::lock_guard<std::mutex> lock(mMutex);
+	auto range = mEntries.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (IsSameDesc(it->second->Desc, desc))
+		{
+			++mStats.HitCount;
+			return it->second.get();
+		}
+	}
+
+	FPipelineCacheEntry* entry = mEntries.emplace(hash, std::make_unique<FPipelineCacheEntry>(desc, hash))->second.get();
+	if (mLibrary)
+	{
+		entry->Pipeline = mLibrary->LoadGraphicsPipeline(entry->Name.c_str(), entry->Desc);
+		if (entry->Pipeline)
+		{
+			entry->Stored = true;
+			entry->Done.store(true, std::memory_order_release);
+			++mStats.LibraryLoadCount;
+			return entry;
+		}
+	}
+
+	++mStats.CompileCount;
+	if (mJobSystem)
+	{
+		mJobSystem->Run([this, entry] { Compile(entry); }, &entry->Compile);
+	}
+	else
+	{
+		Compile(entry);
+	}
+	return entry;
+}
+
+RHIPipelineState* FPipelineCache::Get(FPipelineCacheEntry* entry, RHIPipelineState* fallback)
+{
+	if (!entry->Done.load(std::memory_order_acquire))
+	{
+		mFallbackCount.fetch_add(1, std::memory_order_relaxed);
+		return fallback;
+	}
+	if (!entry->Pipeline)
+	{
+		throw std::runtime_error("FPipelineCache: pipeline compile failed: " + entry->Error);
+	}
+	return entry->Pipeline.get();
+}
+
+RHIPipelineState* FPipelineCache::Wait(FPipelineCacheEntry* entry)
+{
+	if (!entry->Done.load(std::memory_order_acquire))
+	{
+		mJobSystem->Wait(entry->Compile);
+	}
+	return Get(entry, nullptr);
+}
+
+void FPipelineCache::WaitForCompiles()
+{
+	if (!mJobSystem)
+	{
+		return;
+	}
+
+	std::vector<FPipelineCacheEntry*> entries;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (auto& entry : mEntries)
+		{
+			entries.push_back(entry.second.get());
+		}
+	}
+	for (FPipelineCacheEntry* entry : entries)
+	{
+		mJobSystem->Wait(entry->Compile);
+	}
+}
+
+bool FPipelineCache::Save(std::string* outError)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (!mLibrary)
+	{
+		return true;
+	}
+
+	// Compiles still in flight are stored by the next Save().
+	for (auto& it : mEntries)
+	{
+		FPipelineCacheEntry& entry = *it.second;
+		if (!entry.Stored && entry.Done.load(std::memory_order_acquire) && entry.Pipeline)
+		{
+			mLibrary->StorePipeline(entry.Name.c_str(), entry.Pipeline.get());
+			entry.Stored = true;
+		}
+	}
+
+	const std::vector<uint8_t> blob = mLibrary->Serialize();
+	std::filesystem::path temporaryPath = mLibraryPath;
+	temporaryPath += ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+		if (!file)
+		{
+			if (outError)
+			{
+				*outError = "cannot write " + temporaryPath.string();
+			}
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, mLibraryPath, error);
+	if (error)
+	{
+		if (outError)
+		{
+			*outError = "cannot replace " + mLibraryPath.string() + ": " + error.message();
+		}
+		return false;
+	}
+	return true;
+}
+
+FPipelineCacheStats FPipelineCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	FPipelineCacheStats stats = mStats;
+	stats.PipelineCount = static_cast<uint32_t>(mEntries.size());
+	stats.FallbackCount = mFallbackCount.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void FPipelineCache::Compile(FPipelineCacheEntry* entry)
+{
+	// Jobs must not throw: a failure is kept and thrown by Get() or Wait().
+	try
+	{
+		entry->Pipeline = mDevice->CreateGraphicsPipelineState(entry->Desc);
+	}
+	catch (const std::exception& exception)
+	{
+		entry->Error = exception.what();
+	}
+	entry->Done.store(true, std::memory_order_release);
+}
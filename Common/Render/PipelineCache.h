@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../RHI/RHIDevice.h"
+#include "../Jobs/JobSystem.h"
+
+struct FPipelineCacheDesc
+{
+	RHIDevice* Device = nullptr;
+	// Compiles misses on its workers. Without one they compile on the thread that asks, one at a time.
+	FJobSystem* JobSystem = nullptr;
+	// Pipeline library file, read at construction and written by Save(). Empty keeps nothing on disk.
+	std::filesystem::path LibraryPath;
+};
+
+struct FPipelineCacheStats
+{
+	uint32_t PipelineCount = 0;
+	uint64_t HitCount = 0;
+	uint64_t LibraryLoadCount = 0;      // Misses found in the library.
+	uint64_t CompileCount = 0;          // Misses compiled.
+	uint64_t FallbackCount = 0;         // Times Get() returned the fallback.
+};
+
+class FPipelineCacheEntry;
+
+// Graphics pipelines keyed by a hash of everything they are created from (see HashDesc), so the
+// key is the same from run to run. A pipeline not yet in the cache is loaded from the pipeline
+// library when an earlier run stored it there, and compiled otherwise; Save() stores what was
+// compiled and writes the library back to disk.
+//
+// Compiles run as job system jobs. Request() starts one and returns at once; Get() then hands
+// back a fallback pipeline until it completes, so a new material never stalls a frame, and Wait()
+// blocks for it. Request() copies what the desc points at, so the caller's shader bytecode and
+// input layout may be freed once it returns.
+//
+// Every method may be called from any thread.
+class FPipelineCache
+{
+public:
+	explicit FPipelineCache(const FPipelineCacheDesc& desc);
+	// Waits for the compiles in flight. Does not Save().
+	~FPipelineCache();
+
+	FPipelineCache(const FPipelineCache&) = delete;
+	FPipelineCache& operator=(const FPipelineCache&) = delete;
+
+	// FNV-1a over the desc with its pointers followed: shader bytecode and semantic names by
+	// content, the root signature by GetHash().
+	static uint64_t HashDesc(const FRHIGraphicsPipelineDesc& desc);
+	static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+	// The entry for desc, with a library load or compile started if it is new. Entries live as
+	// long as the cache; keep the pointer rather than asking again every frame.
+	FPipelineCacheEntry* Request(const FRHIGraphicsPipelineDesc& desc);
+	// The pipeline, or fallback while it compiles. Throws if the compile failed.
+	RHIPipelineState* Get(FPipelineCacheEntry* entry, RHIPipelineState* fallback);
+	// The pipeline, once compiled. Job system threads run other jobs meanwhile.
+	RHIPipelineState* Wait(FPipelineCacheEntry* entry);
+	// Request() then Wait().
+	RHIPipelineState* GetPipeline(const FRHIGraphicsPipelineDesc& desc) { return Wait(Request(desc)); }
+
+	void WaitForCompiles();
+
+	// Stores the pipelines compiled so far in the library and writes it to LibraryPath, through a
+	// temporary file so an interrupted write leaves the old library. Returns true on success (or
+	// when there is no LibraryPath); on failure, outError (if provided) will contain a readable reason.
+	bool Save(std::string* outError = nullptr);
+
+	FPipelineCacheStats GetStats() const;
+
+private:
+	void Compile(FPipelineCacheEntry* entry);
+
+	RHIDevice* mDevice;
+	FJobSystem* mJobSystem;
+	std::filesystem::path mLibraryPath;
+
+	mutable std::mutex mMutex;
+	std::unique_ptr<RHIPipelineLibrary> mLibrary;
+	std::unordered_multimap<uint64_t, std::unique_ptr<FPipelineCacheEntry>> mEntries;
+	FPipelineCacheStats mStats;
+	std::atomic<uint64_t> mFallbackCount;
+};
@@ -0,0 +1,540 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Most barriers one emit call converts without touching the heap.
+	const uint32_t StackBarrierCount = 32;
+}
+
+FRenderGraph::FRenderGraph() :
+	mFirstFinalBarrier(0),
+	mHeapAlignment(1)
+{
+}
+
+void FRenderGraph::Reset()
+{
+	mResources.clear();
+	mPasses.clear();
+	mBarriers.clear();
+	mFirstFinalBarrier = 0;
+	mHeapAlignment = 1;
+	mStats = FRenderGraphStats();
+}
+
+FRenderGraphResource FRenderGraph::ImportResource(const char* name, ERHIResourceState initialState, ERHIResourceState finalState)
+{
+	FResource resource = {};
+	resource.Name = name;
+	resource.Imported = true;
+	resource.InitialState = initialState;
+	resource.FinalState = finalState;
+	resource.FirstPass = Invalid;
+	resource.LastPass = Invalid;
+	mResources.push_back(resource);
+
+	FRenderGraphResource handle;
+	handle.Index = static_cast<uint32_t>(mResources.size() - 1);
+	return handle;
+}
+
+FRenderGraphResource FRenderGraph::CreateTransient(const FRenderGraphTransientDesc& desc)
+{
+	FResource resource = {};
+	resource.Name = desc.Name;
+	resource.Imported = false;
+	resource.SizeInBytes = desc.SizeInBytes;
+	resource.Alignment = std::max<uint64_t>(desc.Alignment, 1);
+	resource.FirstPass = Invalid;
+	resource.LastPass = Invalid;
+	mResources.push_back(resource);
+
+	FRenderGraphResource handle;
+	handle.Index = static_cast<uint32_t>(mResources.size() - 1);
+	return handle;
+}
+
+uint32_t FRenderGraph::AddPass(const char* name, FExecuteFunction execute)
+{
+	FPass pass;
+	pass.Name = name;
+	pass.Execute = std::move(execute);
+	pass.SideEffect = false;
+	pass.Culled = false;
+	pass.FirstBarrier = 0;
+	pass.BarrierCount = 0;
+	mPasses.push_back(std::move(pass));
+	return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void FRenderGraph::Read(uint32_t pass, FRenderGraphResource resource, ERHIResourceState state)
+{
+	mPasses[pass].Accesses.push_back({ resource.Index, state, false });
+}
+
+void FRenderGraph::Write(uint32_t pass, FRenderGraphResource resource, ERHIResourceState state)
+{
+	mPasses[pass].Accesses.push_back({ resource.Index, state, true });
+}
+
+void FRenderGraph::SetSideEffect(uint32_t pass)
+{
+	mPasses[pass].SideEffect = true;
+}
+
+void FRenderGraph::Compile()
+{
+	CullPasses();
+	ComputeLifetimes();
+
+	// Barriers are gathered per pass, aliasing ones first so a newly placed resource owns its memory
+	// before anything else touches it, then flattened in pass order.
+	std::vector<std::vector<FBarrier>> passBarriers(mPasses.size() + 1);
+	PlaceTransients(passBarriers);
+	ComputeTransitions(passBarriers);
+
+	mBarriers.clear();
+	mStats.BarrierBatchCount = 0;
+	for (size_t pass = 0; pass <= mPasses.size(); ++pass)
+	{
+		const std::vector<FBarrier>& barriers = passBarriers[pass];
+		if (pass < mPasses.size())
+		{
+			mPasses[pass].FirstBarrier = static_cast<uint32_t>(mBarriers.size());
+			mPasses[pass].BarrierCount = static_cast<uint32_t>(barriers.size());
+		}
+		else
+		{
+			mFirstFinalBarrier = static_cast<uint32_t>(mBarriers.size());
+		}
+		mStats.BarrierBatchCount += barriers.empty() ? 0 : 1;
+		mBarriers.insert(mBarriers.end(), barriers.begin(), barriers.end());
+	}
+
+	mStats.PassCount = static_cast<uint32_t>(mPasses.size());
+	mStats.BarrierCount = static_cast<uint32_t>(mBarriers.size());
+}
+
+// Reference counting from the outputs back: a transient nobody reads makes its writers lose a
+// reference, and a writer left with none is culled, which releases what it reads in turn.
+void FRenderGraph::CullPasses()
+{
+	const uint32_t passCount = static_cast<uint32_t>(mPasses.size());
+	std::vector<uint32_t> writeCounts(passCount, 0);
+	std::vector<bool> rooted(passCount, false);
+	std::vector<std::vector<uint32_t>> writers(mResources.size());
+	for (FResource& resource : mResources)
+	{
+		resource.ReaderCount = 0;
+	}
+
+	auto writesResource = [](const FPass& pass, uint32_t resource)
+	{
+		for (const FAccess& access : pass.Accesses)
+		{
+			if (access.IsWrite && access.Resource == resource)
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	for (uint32_t passIndex = 0; passIndex < passCount; ++passIndex)
+	{
+		FPass& pass = mPasses[passIndex];
+		pass.Culled = false;
+		rooted[passIndex] = pass.SideEffect;
+		for (const FAccess& access : pass.Accesses)
+		{
+			FResource& resource = mResources[access.Resource];
+			if (access.IsWrite)
+			{
+				if (resource.Imported)
+				{
+					rooted[passIndex] = true;
+				}
+				else
+				{
+					++writeCounts[passIndex];
+					writers[access.Resource].push_back(passIndex);
+				}
+			}
+			else if (!writesResource(pass, access.Resource))
+			{
+				// Reading what the pass writes itself (in-place updates) does not keep it alive.
+				++resource.ReaderCount;
+			}
+		}
+	}
+
+	std::vector<uint32_t> unusedResources;
+	for (uint32_t i = 0; i < mResources.size(); ++i)
+	{
+		if (!mResources[i].Imported && mResources[i].ReaderCount == 0)
+		{
+			unusedResources.push_back(i);
+		}
+	}
+
+	auto cullPass = [&](uint32_t passIndex)
+	{
+		FPass& pass = mPasses[passIndex];
+		pass.Culled = true;
+		for (const FAccess& access : pass.Accesses)
+		{
+			FResource& resource = mResources[access.Resource];
+			if (!access.IsWrite && !writesResource(pass, access.Resource) && --resource.ReaderCount == 0 && !resource.Imported)
+			{
+				unusedResources.push_back(access.Resource);
+			}
+		}
+	};
+
+	for (uint32_t passIndex = 0; passIndex < passCount; ++passIndex)
+	{
+		if (!rooted[passIndex] && writeCounts[passIndex] == 0)
+		{
+			cullPass(passIndex);
+		}
+	}
+
+	while (!unusedResources.empty())
+	{
+		const uint32_t resource = unusedResources.back();
+		unusedResources.pop_back();
+		for (uint32_t writer : writers[resource])
+		{
+			if (!mPasses[writer].Culled && !rooted[writer] && --writeCounts[writer] == 0)
+			{
+				cullPass(writer);
+			}
+		}
+	}
+
+	mStats.CulledPassCount = 0;
+	for (const FPass& pass : mPasses)
+	{
+		mStats.CulledPassCount += pass.Culled ? 1 : 0;
+	}
+}
+
+void FRenderGraph::ComputeLifetimes()
+{
+	for (FResource& resource : mResources)
+	{
+		resource.FirstPass = Invalid;
+		resource.LastPass = Invalid;
+	}
+
+	for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex)
+	{
+		if (mPasses[passIndex].Culled)
+		{
+			continue;
+		}
+		for (const FAccess& access : mPasses[passIndex].Accesses)
+		{
+			FResource& resource = mResources[access.Resource];
+			resource.FirstPass = resource.FirstPass == Invalid ? passIndex : resource.FirstPass;
+			resource.LastPass = passIndex;
+		}
+	}
+}
+
+// Largest first, each at the lowest aligned offset that does not overlap a resource placed before it
+// with an overlapping lifetime.
+void FRenderGraph::PlaceTransients(std::vector<std::vector<FBarrier>>& passBarriers)
+{
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < mResources.size(); ++i)
+	{
+		if (!mResources[i].Imported && mResources[i].FirstPass != Invalid)
+		{
+			order.push_back(i);
+		}
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+	{
+		const FResource& ra = mResources[a];
+		const FResource& rb = mResources[b];
+		if (ra.SizeInBytes != rb.SizeInBytes)
+		{
+			return ra.SizeInBytes > rb.SizeInBytes;
+		}
+		return ra.FirstPass != rb.FirstPass ? ra.FirstPass < rb.FirstPass : a < b;
+	});
+
+	auto livesOverlap = [](const FResource& a, const FResource& b) { return a.FirstPass <= b.LastPass && b.FirstPass <= a.LastPass; };
+	auto memoryOverlaps = [](const FResource& a, const FResource& b) { return a.Offset < b.Offset + b.SizeInBytes && b.Offset < a.Offset + a.SizeInBytes; };
+
+	mHeapAlignment = 1;
+	mStats.TransientCount = static_cast<uint32_t>(order.size());
+	mStats.TransientBytes = 0;
+	mStats.TransientHeapBytes = 0;
+	std::vector<uint32_t> placed;
+	std::vector<std::pair<uint64_t, uint64_t>> occupied;
+	for (uint32_t index : order)
+	{
+		FResource& resource = mResources[index];
+		occupied.clear();
+		for (uint32_t other : placed)
+		{
+			if (livesOverlap(resource, mResources[other]))
+			{
+				occupied.emplace_back(mResources[other].Offset, mResources[other].Offset + mResources[other].SizeInBytes);
+			}
+		}
+		std::sort(occupied.begin(), occupied.end());
+
+		uint64_t offset = 0;
+		for (const std::pair<uint64_t, uint64_t>& range : occupied)
+		{
+			if (AlignUp(offset, resource.Alignment) + resource.SizeInBytes <= range.first)
+			{
+				break;
+			}
+			offset = std::max(offset, range.second);
+		}
+		resource.Offset = AlignUp(offset, resource.Alignment);
+		placed.push_back(index);
+
+		mHeapAlignment = std::max(mHeapAlignment, resource.Alignment);
+		mStats.TransientBytes += resource.SizeInBytes;
+		mStats.TransientHeapBytes = std::max(mStats.TransientHeapBytes, resource.Offset + resource.SizeInBytes);
+	}
+
+	// A resource reusing memory needs an aliasing barrier before its first pass. Naming the previous
+	// owner is only possible when there is exactly one; otherwise the barrier covers any of them.
+	for (uint32_t index : placed)
+	{
+		const FResource& resource = mResources[index];
+		uint32_t previous = Invalid;
+		uint32_t previousCount = 0;
+		for (uint32_t other : placed)
+		{
+			if (mResources[other].LastPass < resource.FirstPass && memoryOverlaps(resource, mResources[other]))
+			{
+				previous = other;
+				++previousCount;
+			}
+		}
+		if (previousCount > 0)
+		{
+			passBarriers[resource.FirstPass].push_back({ ERHIBarrierType::Aliasing, index, previousCount == 1 ? previous : Invalid, RHI_STATE_COMMON, RHI_STATE_COMMON });
+			continue;
+		}
+
+		// The first owner of its memory in the frame takes it back from the last owners of the frame
+		// before, when the graph is executed again on the same placed resources.
+		for (uint32_t other : placed)
+		{
+			if (mResources[other].FirstPass > resource.LastPass && memoryOverlaps(resource, mResources[other]))
+			{
+				passBarriers[resource.FirstPass].push_back({ ERHIBarrierType::Aliasing, index, Invalid, RHI_STATE_COMMON, RHI_STATE_COMMON });
+				break;
+			}
+		}
+	}
+}
+
+void FRenderGraph::ComputeTransitions(std::vector<std::vector<FBarrier>>& passBarriers)
+{
+	// Every resource's accesses by the kept passes, in pass order, with the accesses of one pass merged:
+	// a write takes its state, reads combine theirs.
+	struct FUse
+	{
+		uint32_t Pass;
+		uint32_t State;
+		bool IsWrite;
+	};
+	std::vector<std::vector<FUse>> uses(mResources.size());
+	for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex)
+	{
+		if (mPasses[passIndex].Culled)
+		{
+			continue;
+		}
+		for (const FAccess& access : mPasses[passIndex].Accesses)
+		{
+			std::vector<FUse>& resourceUses = uses[access.Resource];
+			if (!resourceUses.empty() && resourceUses.back().Pass == passIndex)
+			{
+				FUse& use = resourceUses.back();
+				if (access.IsWrite || use.IsWrite)
+				{
+					use.State = access.IsWrite ? access.State : use.State;
+					use.IsWrite = true;
+				}
+				else
+				{
+					use.State |= access.State;
+				}
+				continue;
+			}
+			resourceUses.push_back({ passIndex, static_cast<uint32_t>(access.State), access.IsWrite });
+		}
+	}
+
+	for (uint32_t index = 0; index < mResources.size(); ++index)
+	{
+		FResource& resource = mResources[index];
+		const std::vector<FUse>& resourceUses = uses[index];
+		bool known = resource.Imported;
+		uint32_t current = resource.InitialState;
+		bool previousWrite = false;
+		for (size_t i = 0; i < resourceUses.size(); ++i)
+		{
+			const FUse& use = resourceUses[i];
+			uint32_t target = use.State;
+			const bool readOnly = !use.IsWrite && RHIIsReadOnlyState(use.State);
+			if (readOnly)
+			{
+				if (known && RHIIsReadOnlyState(current) && (current & use.State) == use.State)
+				{
+					// Already readable this way, e.g. by an earlier transition to a combined read state.
+					previousWrite = false;
+					continue;
+				}
+				// One transition for the whole run of reads that follows.
+				for (size_t j = i + 1; j < resourceUses.size() && !resourceUses[j].IsWrite && RHIIsReadOnlyState(resourceUses[j].State); ++j)
+				{
+					target |= resourceUses[j].State;
+				}
+			}
+
+			if (!known)
+			{
+				// A transient is created in the state of its first use.
+				resource.InitialState = static_cast<ERHIResourceState>(target);
+				known = true;
+			}
+			else if (current != target)
+			{
+				passBarriers[use.Pass].push_back({ ERHIBarrierType::Transition, index, Invalid,
+					static_cast<ERHIResourceState>(current), static_cast<ERHIResourceState>(target) });
+			}
+			else if (target == RHI_STATE_UNORDERED_ACCESS && (previousWrite || use.IsWrite))
+			{
+				passBarriers[use.Pass].push_back({ ERHIBarrierType::UnorderedAccess, index, Invalid, RHI_STATE_COMMON, RHI_STATE_COMMON });
+			}
+			current = target;
+			previousWrite = use.IsWrite;
+		}
+
+		if (resource.Imported && current != static_cast<uint32_t>(resource.FinalState))
+		{
+			passBarriers[mPasses.size()].push_back({ ERHIBarrierType::Transition, index, Invalid,
+				static_cast<ERHIResourceState>(current), resource.FinalState });
+		}
+		else if (!resource.Imported && known && current != static_cast<uint32_t>(resource.InitialState))
+		{
+			// Back to the state it is created in, so that the next execution finds it there. Done
+			// before the next kept pass, ahead of the aliasing barrier of whatever takes its memory
+			// over, while the resource still owns it.
+			uint32_t nextPass = resource.LastPass + 1;
+			while (nextPass < mPasses.size() && mPasses[nextPass].Culled)
+			{
+				++nextPass;
+			}
+			std::vector<FBarrier>& barriers = passBarriers[nextPass];
+			barriers.insert(barriers.begin(), { ERHIBarrierType::Transition, index, Invalid,
+				static_cast<ERHIResourceState>(current), resource.InitialState });
+		}
+	}
+}
+
+void FRenderGraph::Execute(RHICommandList* commandList) const
+{
+	for (uint32_t passIndex = 0; passIndex < mPasses.size(); ++passIndex)
+	{
+		const FPass& pass = mPasses[passIndex];
+		if (pass.Culled)
+		{
+			continue;
+		}
+		EmitPassBarriers(passIndex, commandList);
+		if (pass.Execute)
+		{
+			pass.Execute(commandList);
+		}
+	}
+	EmitFinalBarriers(commandList);
+}
+
+void FRenderGraph::EmitPassBarriers(uint32_t pass, RHICommandList* commandList) const
+{
+	EmitBarriers(mBarriers.data() + mPasses[pass].FirstBarrier, mPasses[pass].BarrierCount, commandList);
+}
+
+void FRenderGraph::EmitFinalBarriers(RHICommandList* commandList) const
+{
+	EmitBarriers(mBarriers.data() + mFirstFinalBarrier, static_cast<uint32_t>(mBarriers.size()) - mFirstFinalBarrier, commandList);
+}
+
+void FRenderGraph::EmitPassBarriers(uint32_t pass, RHIResourceStateTracker& tracker) const
+{
+	EmitBarriers(mBarriers.data() + mPasses[pass].FirstBarrier, mPasses[pass].BarrierCount, tracker);
+}
+
+void FRenderGraph::EmitFinalBarriers(RHIResourceStateTracker& tracker) const
+{
+	EmitBarriers(mBarriers.data() + mFirstFinalBarrier, static_cast<uint32_t>(mBarriers.size()) - mFirstFinalBarrier, tracker);
+}
+
+void FRenderGraph::EmitBarriers(const FBarrier* barriers, uint32_t count, RHICommandList* commandList) const
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	FRHIResourceBarrier stackBarriers[StackBarrierCount];
+	std::vector<FRHIResourceBarrier> heapBarriers;
+	FRHIResourceBarrier* rhiBarriers = stackBarriers;
+	if (count > StackBarrierCount)
+	{
+		heapBarriers.resize(count);
+		rhiBarriers = heapBarriers.data();
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const FBarrier& barrier = barriers[i];
+		FRHIResourceBarrier& rhiBarrier = rhiBarriers[i];
+		rhiBarrier.Type = barrier.Type;
+		rhiBarrier.Resource = mResources[barrier.Resource].RhiResource;
+		rhiBarrier.ResourceBefore = barrier.ResourceBefore != Invalid ? mResources[barrier.ResourceBefore].RhiResource : nullptr;
+		rhiBarrier.StateBefore = barrier.StateBefore;
+		rhiBarrier.StateAfter = barrier.StateAfter;
+	}
+	commandList->ResourceBarrier(count, rhiBarriers);
+}
+
+void FRenderGraph::EmitBarriers(const FBarrier* barriers, uint32_t count, RHIResourceStateTracker& tracker) const
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const FBarrier& barrier = barriers[i];
+		RHIResource* resource = mResources[barrier.Resource].RhiResource;
+		switch (barrier.Type)
+		{
+		case ERHIBarrierType::Aliasing:
+			tracker.AliasingBarrier(barrier.ResourceBefore != Invalid ? mResources[barrier.ResourceBefore].RhiResource : nullptr, resource);
+			break;
+		case ERHIBarrierType::UnorderedAccess:
+			tracker.UavBarrier(resource);
+			break;
+		default:
+			tracker.TransitionResource(resource, barrier.StateAfter);
+			break;
+		}
+	}
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "../../RHI/RHICommandList.h"
+#include "../../RHI/RHIResourceStateTracker.h"
+
+// Refers to one resource of an FRenderGraph.
+struct FRenderGraphResource
+{
+	uint32_t Index = ~0u;
+
+	bool IsValid() const { return Index != ~0u; }
+};
+
+// A transient resource lives only within the frame and its memory may be shared with other transient
+// resources. Size and alignment are what the device reports for the resource description
+// (ID3D12Device::GetResourceAllocationInfo); the graph itself never looks at formats or dimensions.
+struct FRenderGraphTransientDesc
+{
+	const char* Name = nullptr;
+	uint64_t SizeInBytes = 0;
+	uint64_t Alignment = 64 * 1024;
+};
+
+struct FRenderGraphStats
+{
+	uint32_t PassCount = 0;
+	uint32_t CulledPassCount = 0;
+	uint32_t BarrierCount = 0;          // Transitions, aliasing and UAV barriers, including the final ones.
+	uint32_t BarrierBatchCount = 0;     // ResourceBarrier calls per execution.
+	uint32_t TransientCount = 0;        // Transient resources used by a pass that was kept.
+	uint64_t TransientBytes = 0;        // Their sizes added up, i.e. the memory without aliasing.
+	uint64_t TransientHeapBytes = 0;    // The shared heap they are placed in.
+};
+
+// Frame graph: passes declare the resources they read and write, and Compile() works out, on the
+// CPU only, what the frame needs:
+//
+// - Passes whose results nobody uses are culled: a pass is kept when it writes an imported resource,
+//   is marked with SetSideEffect(), or writes a transient that a kept pass reads.
+// - Every kept pass gets one batch of barriers that puts its resources in the declared states. A
+//   resource read by several passes in a row is transitioned once, to the union of their read states,
+//   and imported resources return to their final state after the last pass.
+// - Transient resources whose lifetimes (first to last kept pass using them) do not overlap are placed
+//   at overlapping offsets of one heap, with an aliasing barrier before the first pass of the newcomer.
+//   That pass must initialize the whole resource (clear, discard or full overwrite), as D3D12 requires
+//   of aliased placed resources; a transient is created in the state of its first use.
+// - Every transient is transitioned back to that state after its last pass, and the first resource in
+//   each range of the heap takes it over with an aliasing barrier from the last ones of the frame
+//   before, so an execution leaves the transients as the next one expects them.
+//
+// Passes run in the order they were added, which must be a valid order: a pass only reads what passes
+// added before it wrote. The results stay valid until the next Reset() or declaration, so a graph whose
+// shape does not change can be compiled once and executed every frame, with fresh resources bound or
+// the same placed resources again.
+class FRenderGraph
+{
+public:
+	typedef std::function<void(RHICommandList*)> FExecuteFunction;
+
+	// Marks a pass or resource absent.
+	static constexpr uint32_t Invalid = ~0u;
+
+	FRenderGraph();
+
+	// Forgets every pass and resource.
+	void Reset();
+
+	// A resource owned outside the graph (e.g. a swap chain buffer), in initialState when the frame
+	// starts and returned to finalState after it. Bind it with SetResource() before executing.
+	FRenderGraphResource ImportResource(const char* name, ERHIResourceState initialState, ERHIResourceState finalState);
+	FRenderGraphResource CreateTransient(const FRenderGraphTransientDesc& desc);
+
+	// Passes run in the order they are added. execute may be empty when the caller records the pass
+	// itself between EmitPassBarriers() calls.
+	uint32_t AddPass(const char* name, FExecuteFunction execute = FExecuteFunction());
+	// state is the one the pass needs the resource in: a combination of read states for Read(), a
+	// single writable state (render target, depth write, UAV, copy destination) for Write().
+	void Read(uint32_t pass, FRenderGraphResource resource, ERHIResourceState state);
+	void Write(uint32_t pass, FRenderGraphResource resource, ERHIResourceState state);
+	// Keeps the pass even when nothing uses what it writes (e.g. a readback or a GPU timer query).
+	void SetSideEffect(uint32_t pass);
+
+	void Compile();
+
+	uint32_t GetPassCount() const { return static_cast<uint32_t>(mPasses.size()); }
+	const char* GetPassName(uint32_t pass) const { return mPasses[pass].Name; }
+	bool IsPassCulled(uint32_t pass) const { return mPasses[pass].Culled; }
+	const FRenderGraphStats& GetStats() const { return mStats; }
+
+	// Transient placement: byte offset in the shared heap, and the state to create the resource in.
+	uint64_t GetTransientHeapSize() const { return mStats.TransientHeapBytes; }
+	uint64_t GetTransientHeapAlignment() const { return mHeapAlignment; }
+	uint64_t GetTransientOffset(FRenderGraphResource resource) const { return mResources[resource.Index].Offset; }
+	ERHIResourceState GetTransientInitialState(FRenderGraphResource resource) const { return mResources[resource.Index].InitialState; }
+	// First and last kept pass using the resource; Invalid for both when none does.
+	uint32_t GetFirstPass(FRenderGraphResource resource) const { return mResources[resource.Index].FirstPass; }
+	uint32_t GetLastPass(FRenderGraphResource resource) const { return mResources[resource.Index].LastPass; }
+
+	// The RHI resource standing for resource in the next executions: the imported resource, or the
+	// placed resource created at GetTransientOffset() in GetTransientInitialState().
+	void SetResource(FRenderGraphResource resource, RHIResource* rhiResource) { mResources[resource.Index].RhiResource = rhiResource; }
+
+	// Runs every kept pass on commandList, each after its barriers, then the final barriers.
+	void Execute(RHICommandList* commandList) const;
+	// The pieces of Execute(), for callers that record passes over several lists themselves.
+	void EmitPassBarriers(uint32_t pass, RHICommandList* commandList) const;
+	void EmitFinalBarriers(RHICommandList* commandList) const;
+	// The same barriers queued on a state tracker, which takes the transitions' before states from
+	// what the list has done rather than from the graph. Flush it to record them.
+	void EmitPassBarriers(uint32_t pass, RHIResourceStateTracker& tracker) const;
+	void EmitFinalBarriers(RHIResourceStateTracker& tracker) const;
+
+private:
+	struct FResource
+	{
+		const char* Name;
+		bool Imported;
+		ERHIResourceState InitialState;
+		ERHIResourceState FinalState;
+		uint64_t SizeInBytes;
+		uint64_t Alignment;
+		uint64_t Offset;
+		uint32_t FirstPass;
+		uint32_t LastPass;
+		uint32_t ReaderCount;   // Kept passes reading it, while culling.
+		RHIResource* RhiResource;
+	};
+
+	struct FAccess
+	{
+		uint32_t Resource;
+		ERHIResourceState State;
+		bool IsWrite;
+	};
+
+	struct FPass
+	{
+		const char* Name;
+		FExecuteFunction Execute;
+		std::vector<FAccess> Accesses;
+		bool SideEffect;
+		bool Culled;
+		uint32_t FirstBarrier;
+		uint32_t BarrierCount;
+	};
+
+	// A compiled barrier, by resource index; resolved to RHI resources when emitted.
+	struct FBarrier
+	{
+		ERHIBarrierType Type;
+		uint32_t Resource;
+		uint32_t ResourceBefore;
+		ERHIResourceState StateBefore;
+		ERHIResourceState StateAfter;
+	};
+
+	void CullPasses();
+	void ComputeLifetimes();
+	void PlaceTransients(std::vector<std::vector<FBarrier>>& passBarriers);
+	void ComputeTransitions(std::vector<std::vector<FBarrier>>& passBarriers);
+	void EmitBarriers(const FBarrier* barriers, uint32_t count, RHICommandList* commandList) const;
+	void EmitBarriers(const FBarrier* barriers, uint32_t count, RHIResourceStateTracker& tracker) const;
+
+	std::vector<FResource> mResources;
+	std::vector<FPass> mPasses;
+	// Every pass's batch, in pass order, then the final batch.
+	std::vector<FBarrier> mBarriers;
+	uint32_t mFirstFinalBarrier;
+	uint64_t mHeapAlignment;
+	FRenderGraphStats mStats;
+};
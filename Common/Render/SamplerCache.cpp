@@ -0,0 +1,128 @@
+#include "SamplerCache.h"
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+	const uint32_t InvalidIndex = ~0u;
+
+	// -0.0f compares equal to 0.0f but differs in its bits.
+	inline void NormalizeZero(float& value)
+	{
+		if (value == 0.0f)
+		{
+			value = 0.0f;
+		}
+	}
+}
+
+static_assert(sizeof(FRHISamplerDesc) % sizeof(uint32_t) == 0, "FSamplerCache keys FRHISamplerDesc by 32-bit words");
+
+FSamplerCache::FSamplerCache(RHIDevice* device, FDescriptorStagingHeap* stagingHeap) :
+	mDevice(device),
+	mStagingHeap(stagingHeap),
+	mLookupCount(0)
+{
+	if (stagingHeap->GetType() != ERHIDescriptorHeapType::Sampler)
+	{
+		throw std::runtime_error("FSamplerCache: the staging heap must be a sampler heap");
+	}
+}
+
+uint32_t FSamplerCache::GetSamplerIndex(const FRHISamplerDesc& desc)
+{
+	mLookupCount.fetch_add(1, std::memory_order_relaxed);
+	const FKey key = MakeKey(desc);
+	const uint64_t hash = HashKey(key);
+	{
+		std::shared_lock<std::shared_mutex> lock(mMutex);
+		const uint32_t index = Find(key, hash);
+		if (index != InvalidIndex)
+		{
+			return index;
+		}
+	}
+
+	// Another thread may have created it between the two locks.
+	std::unique_lock<std::shared_mutex> lock(mMutex);
+	uint32_t index = Find(key, hash);
+	if (index == InvalidIndex)
+	{
+		const FBindlessHandle view = mStagingHeap->Allocate();
+		mDevice->CreateSampler(desc, mStagingHeap->GetCpuHandle(view));
+		index = static_cast<uint32_t>(mSamplers.size());
+		mSamplers.push_back({ key, view });
+		mLookup.emplace(hash, index);
+	}
+	return index;
+}
+
+FBindlessHandle FSamplerCache::GetView(uint32_t samplerIndex) const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	if (samplerIndex >= mSamplers.size())
+	{
+		throw std::runtime_error("FSamplerCache: no sampler at this index");
+	}
+	return mSamplers[samplerIndex].View;
+}
+
+std::vector<FBindlessHandle> FSamplerCache::GetViews() const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	std::vector<FBindlessHandle> views;
+	views.reserve(mSamplers.size());
+	for (const FSampler& sampler : mSamplers)
+	{
+		views.push_back(sampler.View);
+	}
+	return views;
+}
+
+uint32_t FSamplerCache::GetSamplerCount() const
+{
+	std::shared_lock<std::shared_mutex> lock(mMutex);
+	return static_cast<uint32_t>(mSamplers.size());
+}
+
+FSamplerCache::FKey FSamplerCache::MakeKey(const FRHISamplerDesc& desc)
+{
+	FRHISamplerDesc normalized = desc;
+	NormalizeZero(normalized.MipLODBias);
+	for (float& channel : normalized.BorderColor)
+	{
+		NormalizeZero(channel);
+	}
+	NormalizeZero(normalized.MinLOD);
+	NormalizeZero(normalized.MaxLOD);
+
+	FKey key;
+	std::memcpy(key.data(), &normalized, sizeof(normalized));
+	return key;
+}
+
+uint64_t FSamplerCache::HashKey(const FKey& key)
+{
+	// FNV-1a, a word at a time.
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t word : key)
+	{
+		hash = (hash ^ word) * 1099511628211ull;
+	}
+	return hash;
+}
+
+uint32_t FSamplerCache::Find(const FKey& key, uint64_t hash) const
+{
+	auto range = mLookup.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (mSamplers[it->second].Key == key)
+		{
+			return it->second;
+		}
+	}
+	return InvalidIndex;
+}
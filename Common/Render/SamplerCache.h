@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "../../RHI/RHIDevice.h"
+#include "DescriptorCache.h"
+
+// One sampler per distinct FRHISamplerDesc, created in a sampler FDescriptorStagingHeap the first
+// time it is asked for. Materials ask for the sampler they want by description; however many ask,
+// the heap holds one copy.
+//
+// Each sampler gets an index in the order samplers are first created, and keeps it and its staging
+// view for the life of the cache. GetViews() lists the views in index order, so a table assembled
+// from it has every sampler at its index: g_sampler[GetSamplerIndex(desc)] in a shader.
+//
+// GetSamplerIndex() may be called from any thread, e.g. by material loads running as jobs. Lookups
+// of samplers that exist share a lock; only creation takes it exclusively.
+class FSamplerCache
+{
+public:
+	FSamplerCache(RHIDevice* device, FDescriptorStagingHeap* stagingHeap);
+
+	// Throws when a new sampler does not fit in the staging heap.
+	uint32_t GetSamplerIndex(const FRHISamplerDesc& desc);
+
+	FBindlessHandle GetView(uint32_t samplerIndex) const;
+	// Every sampler's staging view, by index.
+	std::vector<FBindlessHandle> GetViews() const;
+	uint32_t GetSamplerCount() const;
+
+	uint64_t GetLookupCount() const { return mLookupCount.load(std::memory_order_relaxed); }
+
+private:
+	// The description as 32-bit words, with -0.0f made 0.0f so that descriptions D3D12 treats as
+	// equal compare and hash equal.
+	typedef std::array<uint32_t, sizeof(FRHISamplerDesc) / sizeof(uint32_t)> FKey;
+
+	static FKey MakeKey(const FRHISamplerDesc& desc);
+	static uint64_t HashKey(const FKey& key);
+	// Index of the sampler for key, or ~0u; the caller holds mMutex.
+	uint32_t Find(const FKey& key, uint64_t hash) const;
+
+	struct FSampler
+	{
+		FKey Key;
+		FBindlessHandle View;
+	};
+
+	RHIDevice* mDevice;
+	FDescriptorStagingHeap* mStagingHeap;
+	mutable std::shared_mutex mMutex;
+	std::vector<FSampler> mSamplers;
+	std::unordered_multimap<uint64_t, uint32_t> mLookup;
+	std::atomic<uint64_t> mLookupCount;
+};
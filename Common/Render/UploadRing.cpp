@@ -0,0 +1,175 @@
+#include "UploadRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// Buffers are placed at 64 KB boundaries anyway; growing pages in that unit wastes nothing.
+	const uint64_t PageGranularity = 64 * 1024;
+}
+
+FUploadRing::FUploadRing(RHIDevice* device, RHICommandQueue* queue, uint64_t pageSize) :
+	mDevice(device),
+	mQueue(queue),
+	mPageSize(AlignUp(std::max<uint64_t>(pageSize, 1), PageGranularity)),
+	mCurrentPage(0)
+{
+	mCurrentPage = AddPage(mPageSize);
+}
+
+FUploadRing::~FUploadRing()
+{
+	for (FPage& page : mPages)
+	{
+		page.Buffer->Unmap();
+	}
+}
+
+FUploadAllocation FUploadRing::Allocate(uint64_t size, uint64_t alignment)
+{
+	// An empty allocation still gets an address of its own.
+	size = std::max<uint64_t>(size, 1);
+
+	uint64_t offset = 0;
+	if (!TryAllocate(mCurrentPage, size, alignment, offset))
+	{
+		Reclaim();
+		bool allocated = TryAllocate(mCurrentPage, size, alignment, offset);
+		for (uint32_t i = 1; !allocated && i < mPages.size(); ++i)
+		{
+			const uint32_t pageIndex = static_cast<uint32_t>((mCurrentPage + i) % mPages.size());
+			if (TryAllocate(pageIndex, size, alignment, offset))
+			{
+				mCurrentPage = pageIndex;
+				allocated = true;
+			}
+		}
+		if (!allocated)
+		{
+			mCurrentPage = AddPage(size);
+			TryAllocate(mCurrentPage, size, alignment, offset);
+		}
+	}
+
+	const FPage& page = mPages[mCurrentPage];
+	FUploadAllocation allocation;
+	allocation.CpuAddress = page.CpuBase + offset;
+	allocation.GpuAddress = page.GpuBase + offset;
+	allocation.Resource = page.Buffer.get();
+	allocation.Offset = offset;
+	allocation.Size = size;
+
+	++mStats.AllocationCount;
+	mStats.AllocatedBytes += size;
+	mStats.HighWaterBytes = std::max(mStats.HighWaterBytes, mStats.UsedBytes);
+	return allocation;
+}
+
+FUploadAllocation FUploadRing::Upload(const void* data, uint64_t size, uint64_t alignment)
+{
+	const FUploadAllocation allocation = Allocate(size, alignment);
+	memcpy(allocation.CpuAddress, data, size);
+	return allocation;
+}
+
+void FUploadRing::OnSubmit(uint64_t fenceValue)
+{
+	for (auto region = mRegions.rbegin(); region != mRegions.rend() && region->Fence == UnsubmittedFence; ++region)
+	{
+		region->Fence = fenceValue;
+	}
+}
+
+void FUploadRing::Reclaim()
+{
+	const uint64_t completedFence = mQueue->GetLastCompletedFence();
+	while (!mRegions.empty() && mRegions.front().Fence <= completedFence)
+	{
+		const FRegion& region = mRegions.front();
+		FPage& page = mPages[region.Page];
+		if (region.End < page.Begin)
+		{
+			// The region wrapped around, and Begin follows End to the start of the page.
+			page.Wrapped = false;
+		}
+		page.Begin = region.End;
+		page.UsedBytes -= region.Bytes;
+		mStats.UsedBytes -= region.Bytes;
+		mRegions.pop_front();
+	}
+}
+
+bool FUploadRing::TryAllocate(uint32_t pageIndex, uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	FPage& page = mPages[pageIndex];
+	if (page.UsedBytes == 0)
+	{
+		page.Begin = 0;
+		page.End = 0;
+		page.Wrapped = false;
+	}
+
+	// After the newest allocation, up to the end of the page or, once wrapped, to the oldest one;
+	// failing that, from the start of the page up to the oldest one.
+	const uint64_t oldEnd = page.End;
+	offset = AlignUp(page.End, alignment);
+	if (offset + size > (page.Wrapped ? page.Begin : page.Size))
+	{
+		if (page.Wrapped || size > page.Begin)
+		{
+			return false;
+		}
+		offset = 0;
+		page.Wrapped = true;
+	}
+	page.End = offset + size;
+
+	// Padding skipped at the end of the page belongs to the allocation that wrapped.
+	const uint64_t bytes = page.End > oldEnd ? page.End - oldEnd : page.Size - oldEnd + page.End;
+	page.UsedBytes += bytes;
+	mStats.UsedBytes += bytes;
+
+	if (!mRegions.empty() && mRegions.back().Page == pageIndex && mRegions.back().Fence == UnsubmittedFence)
+	{
+		mRegions.back().End = page.End;
+		mRegions.back().Bytes += bytes;
+	}
+	else
+	{
+		mRegions.push_back({ pageIndex, page.End, bytes, UnsubmittedFence });
+	}
+	return true;
+}
+
+uint32_t FUploadRing::AddPage(uint64_t minSize)
+{
+	FPage page;
+	page.Size = std::max(mPageSize, AlignUp(minSize, PageGranularity));
+
+	FRHIBufferDesc desc;
+	desc.SizeInBytes = page.Size;
+	desc.HeapType = ERHIHeapType::Upload;
+	desc.InitialState = RHI_STATE_GENERIC_READ;
+	desc.DebugName = L"FUploadRing page";
+	page.Buffer = mDevice->CreateBuffer(desc);
+
+	// Upload heaps stay mapped for their whole life; the CPU only ever writes them.
+	page.CpuBase = static_cast<uint8_t*>(page.Buffer->Map());
+	page.GpuBase = page.Buffer->GetGpuVirtualAddress();
+	page.Begin = 0;
+	page.End = 0;
+	page.UsedBytes = 0;
+	page.Wrapped = false;
+	mPages.push_back(std::move(page));
+
+	++mStats.PageCount;
+	mStats.CapacityBytes += mPages.back().Size;
+	return static_cast<uint32_t>(mPages.size() - 1);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "../../RHI/RHICommandQueue.h"
+#include "../../RHI/RHIDevice.h"
+
+// Where an FUploadRing allocation landed.
+struct FUploadAllocation
+{
+	void* CpuAddress = nullptr;         // Write-combined memory: write it in order and never read it back.
+	uint64_t GpuAddress = 0;
+	RHIResource* Resource = nullptr;    // The page holding it, for copies: the data starts at Offset.
+	uint64_t Offset = 0;
+	uint64_t Size = 0;
+};
+
+struct FUploadRingStats
+{
+	uint32_t PageCount = 0;
+	uint64_t CapacityBytes = 0;         // All pages.
+	uint64_t UsedBytes = 0;             // Allocated and not reclaimed yet, alignment padding included.
+	uint64_t HighWaterBytes = 0;        // The most UsedBytes has been.
+	uint64_t AllocationCount = 0;
+	uint64_t AllocatedBytes = 0;        // Every allocation since creation, added up.
+};
+
+// Upload heap memory for data the GPU reads for a short while: per-frame constants and instance
+// data, and the sources of buffer and texture copies. Allocations are carved in order out of
+// persistently mapped pages, each used as a ring. Allocations are tagged by OnSubmit() with the
+// fence value the queue returned for the submission holding the commands that read them, and their
+// space comes back once that fence completes. Until then they are never reclaimed.
+//
+// When no page has room for an allocation the ring grows by a page, at least pageSize bytes and
+// large enough for the allocation. Pages are never freed; the high-water mark in the stats tells
+// how large to make the first one.
+//
+// Not thread-safe.
+class FUploadRing
+{
+public:
+	FUploadRing(RHIDevice* device, RHICommandQueue* queue, uint64_t pageSize = 1024 * 1024);
+	~FUploadRing();
+
+	// alignment is a power of two up to 64 KB: 256 for constant buffers, 512 for texture copies.
+	FUploadAllocation Allocate(uint64_t size, uint64_t alignment = 256);
+	// Allocate() and copy size bytes of data into it.
+	FUploadAllocation Upload(const void* data, uint64_t size, uint64_t alignment = 256);
+
+	// Tags every allocation made since the last call with fenceValue, what ExecuteCommandLists() or
+	// SubmitCommandLists() returned for the lists that read them.
+	void OnSubmit(uint64_t fenceValue);
+
+	// Takes back the space of allocations whose fence has completed. Allocate() does this by itself
+	// when it runs out of room; calling it once a frame keeps UsedBytes current.
+	void Reclaim();
+
+	const FUploadRingStats& GetStats() const { return mStats; }
+
+private:
+	struct FPage
+	{
+		std::unique_ptr<RHIResource> Buffer;
+		uint8_t* CpuBase;
+		uint64_t GpuBase;
+		uint64_t Size;
+		uint64_t Begin;         // Start of the oldest allocation still in flight.
+		uint64_t End;           // End of the newest one; allocations continue from here.
+		uint64_t UsedBytes;     // Between Begin and End, with the padding skipped when wrapping.
+		bool Wrapped;           // End has wrapped around to the start of the page, behind Begin.
+	};
+
+	// Consecutive allocations on one page with one fence, oldest first. Retiring it moves the page's
+	// Begin to End. Regions not submitted yet are the newest, with Fence UnsubmittedFence.
+	static const uint64_t UnsubmittedFence = UINT64_MAX;
+
+	struct FRegion
+	{
+		uint32_t Page;
+		uint64_t End;
+		uint64_t Bytes;
+		uint64_t Fence;
+	};
+
+	bool TryAllocate(uint32_t pageIndex, uint64_t size, uint64_t alignment, uint64_t& offset);
+	uint32_t AddPage(uint64_t minSize);
+
+	RHIDevice* mDevice;
+	RHICommandQueue* mQueue;
+	uint64_t mPageSize;
+	std::vector<FPage> mPages;
+	std::deque<FRegion> mRegions;
+	uint32_t mCurrentPage;      // Where the last allocation went; tried first.
+	FUploadRingStats mStats;
+};
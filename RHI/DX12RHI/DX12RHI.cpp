@@ -0,0 +1,604 @@
+#include "../../src/stdafx.h"
+
+#include "DX12RHI.h"
+#include "../../src/DXSampleHelper.h"
+#include "../../src/D3D12QueueManger.h"
+#include "../../src/DescriptorHeapManagement.h"
+
+namespace
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE ToD3D12(FRHICpuDescriptor handle)
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE d3dHandle;
+		d3dHandle.ptr = static_cast<SIZE_T>(handle.ptr);
+		return d3dHandle;
+	}
+
+	D3D12_GPU_DESCRIPTOR_HANDLE ToD3D12(FRHIGpuDescriptor handle)
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE d3dHandle;
+		d3dHandle.ptr = handle.ptr;
+		return d3dHandle;
+	}
+
+	D3D12_HEAP_TYPE ToD3D12(ERHIHeapType heapType)
+	{
+		switch (heapType)
+		{
+		case ERHIHeapType::Upload:
+			return D3D12_HEAP_TYPE_UPLOAD;
+		case ERHIHeapType::Readback:
+			return D3D12_HEAP_TYPE_READBACK;
+		default:
+			return D3D12_HEAP_TYPE_DEFAULT;
+		}
+	}
+
+	static_assert(sizeof(FRHIVertexBufferView) == sizeof(D3D12_VERTEX_BUFFER_VIEW), "FRHIVertexBufferView must match D3D12_VERTEX_BUFFER_VIEW");
+	static_assert(sizeof(FRHIIndexBufferView) == sizeof(D3D12_INDEX_BUFFER_VIEW), "FRHIIndexBufferView must match D3D12_INDEX_BUFFER_VIEW");
+	static_assert(sizeof(FRHIViewport) == sizeof(D3D12_VIEWPORT), "FRHIViewport must match D3D12_VIEWPORT");
+	static_assert(sizeof(FRHIRect) == sizeof(D3D12_RECT), "FRHIRect must match D3D12_RECT");
+	static_assert(sizeof(FRHISamplerDesc) == sizeof(D3D12_SAMPLER_DESC), "FRHISamplerDesc must match D3D12_SAMPLER_DESC");
+	static_assert(sizeof(FRHICpuDescriptor) == sizeof(D3D12_CPU_DESCRIPTOR_HANDLE), "FRHICpuDescriptor must match D3D12_CPU_DESCRIPTOR_HANDLE");
+	static_assert(static_cast<UINT>(RHI_STATE_GENERIC_READ) == static_cast<UINT>(D3D12_RESOURCE_STATE_GENERIC_READ), "ERHIResourceState must mirror D3D12_RESOURCE_STATES");
+	static_assert(static_cast<UINT>(ERHIIndexFormat::Uint32) == static_cast<UINT>(DXGI_FORMAT_R32_UINT), "ERHIIndexFormat must mirror DXGI_FORMAT");
+	static_assert(static_cast<UINT>(ERHIFilter::MinMagMipLinear) == static_cast<UINT>(D3D12_FILTER_MIN_MAG_MIP_LINEAR), "ERHIFilter must mirror D3D12_FILTER");
+	static_assert(static_cast<UINT>(ERHIFilter::Anisotropic) == static_cast<UINT>(D3D12_FILTER_ANISOTROPIC), "ERHIFilter must mirror D3D12_FILTER");
+	static_assert(static_cast<UINT>(ERHITextureAddressMode::Clamp) == static_cast<UINT>(D3D12_TEXTURE_ADDRESS_MODE_CLAMP), "ERHITextureAddressMode must mirror D3D12_TEXTURE_ADDRESS_MODE");
+	static_assert(static_cast<UINT>(ERHIComparisonFunc::Always) == static_cast<UINT>(D3D12_COMPARISON_FUNC_ALWAYS), "ERHIComparisonFunc must mirror D3D12_COMPARISON_FUNC");
+	static_assert(static_cast<UINT>(ERHIPrimitiveTopology::TriangleList) == static_cast<UINT>(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST), "ERHIPrimitiveTopology must mirror D3D_PRIMITIVE_TOPOLOGY");
+	static_assert(sizeof(FRHIInputElement) == sizeof(D3D12_INPUT_ELEMENT_DESC), "FRHIInputElement must match D3D12_INPUT_ELEMENT_DESC");
+	static_assert(sizeof(FRHIShaderBytecode) == sizeof(D3D12_SHADER_BYTECODE), "FRHIShaderBytecode must match D3D12_SHADER_BYTECODE");
+	static_assert(static_cast<UINT>(ERHIFormat::R8G8B8A8Unorm) == static_cast<UINT>(DXGI_FORMAT_R8G8B8A8_UNORM), "ERHIFormat must mirror DXGI_FORMAT");
+	static_assert(static_cast<UINT>(ERHICullMode::None) == static_cast<UINT>(D3D12_CULL_MODE_NONE), "ERHICullMode must mirror D3D12_CULL_MODE");
+	static_assert(static_cast<UINT>(ERHIPrimitiveTopologyType::Triangle) == static_cast<UINT>(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE), "ERHIPrimitiveTopologyType must mirror D3D12_PRIMITIVE_TOPOLOGY_TYPE");
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC ToD3D12(const FRHIGraphicsPipelineDesc& desc)
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+		psoDesc.pRootSignature = desc.RootSignature ? static_cast<DX12RHIRootSignature*>(desc.RootSignature)->Get() : nullptr;
+		psoDesc.VS = CD3DX12_SHADER_BYTECODE(desc.VS.pShaderBytecode, desc.VS.BytecodeLength);
+		psoDesc.PS = CD3DX12_SHADER_BYTECODE(desc.PS.pShaderBytecode, desc.PS.BytecodeLength);
+		psoDesc.InputLayout = { reinterpret_cast<const D3D12_INPUT_ELEMENT_DESC*>(desc.InputElements), desc.NumInputElements };
+
+		CD3DX12_RASTERIZER_DESC rasterizerDesc(D3D12_DEFAULT);
+		rasterizerDesc.CullMode = static_cast<D3D12_CULL_MODE>(desc.CullMode);
+		psoDesc.RasterizerState = rasterizerDesc;
+
+		CD3DX12_BLEND_DESC blendDesc(D3D12_DEFAULT);
+		for (uint32_t i = 0; i < desc.NumRenderTargets && desc.BlendEnable; ++i)
+		{
+			blendDesc.RenderTarget[i].BlendEnable = TRUE;
+			blendDesc.RenderTarget[i].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+			blendDesc.RenderTarget[i].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+		}
+		psoDesc.BlendState = blendDesc;
+
+		CD3DX12_DEPTH_STENCIL_DESC depthStencilDesc(D3D12_DEFAULT);
+		depthStencilDesc.DepthEnable = desc.DepthEnable ? TRUE : FALSE;
+		depthStencilDesc.DepthWriteMask = desc.DepthWrite ? D3D12_DEPTH_WRITE_MASK_ALL : D3D12_DEPTH_WRITE_MASK_ZERO;
+		depthStencilDesc.DepthFunc = static_cast<D3D12_COMPARISON_FUNC>(desc.DepthFunc);
+		psoDesc.DepthStencilState = depthStencilDesc;
+
+		psoDesc.SampleMask = UINT_MAX;
+		psoDesc.PrimitiveTopologyType = static_cast<D3D12_PRIMITIVE_TOPOLOGY_TYPE>(desc.PrimitiveTopologyType);
+		psoDesc.NumRenderTargets = desc.NumRenderTargets;
+		for (uint32_t i = 0; i < desc.NumRenderTargets; ++i)
+		{
+			psoDesc.RTVFormats[i] = static_cast<DXGI_FORMAT>(desc.RenderTargetFormats[i]);
+		}
+		psoDesc.DSVFormat = static_cast<DXGI_FORMAT>(desc.DepthStencilFormat);
+		psoDesc.SampleDesc.Count = desc.SampleCount;
+		return psoDesc;
+	}
+}
+
+DX12RHIPipelineLibrary::DX12RHIPipelineLibrary(ID3D12PipelineLibrary* library, std::vector<uint8_t> blob)
+	: mLibrary(library), mBlob(std::move(blob))
+{
+}
+
+std::unique_ptr<RHIPipelineState> DX12RHIPipelineLibrary::LoadGraphicsPipeline(const wchar_t* name, const FRHIGraphicsPipelineDesc& desc)
+{
+	// E_INVALIDARG both when the name is missing and when it was stored from another desc.
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState;
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = ToD3D12(desc);
+	if (!mLibrary || FAILED(mLibrary->LoadGraphicsPipeline(name, &psoDesc, IID_PPV_ARGS(&pipelineState))))
+	{
+		return nullptr;
+	}
+	return std::make_unique<DX12RHIPipelineState>(pipelineState.Get());
+}
+
+bool DX12RHIPipelineLibrary::StorePipeline(const wchar_t* name, RHIPipelineState* pipelineState)
+{
+	return mLibrary && SUCCEEDED(mLibrary->StorePipeline(name, static_cast<DX12RHIPipelineState*>(pipelineState)->Get()));
+}
+
+std::vector<uint8_t> DX12RHIPipelineLibrary::Serialize() const
+{
+	std::vector<uint8_t> blob;
+	if (mLibrary)
+	{
+		blob.resize(mLibrary->GetSerializedSize());
+		ThrowIfFailed(mLibrary->Serialize(blob.data(), blob.size()));
+	}
+	return blob;
+}
+
+DX12RHIDescriptorHeap::DX12RHIDescriptorHeap(DescriptorHeap* heap)
+	: RHIDescriptorHeap(static_cast<ERHIDescriptorHeapType>(heap->GetType()), heap->GetNumDescriptors(), heap->IsShaderVisible()),
+	mHeap(heap)
+{
+}
+
+DX12RHIDescriptorHeap::DX12RHIDescriptorHeap(std::unique_ptr<DescriptorHeap> heap)
+	: RHIDescriptorHeap(static_cast<ERHIDescriptorHeapType>(heap->GetType()), heap->GetNumDescriptors(), heap->IsShaderVisible()),
+	mOwnedHeap(std::move(heap))
+{
+	mHeap = mOwnedHeap.get();
+}
+
+DX12RHIDescriptorHeap::~DX12RHIDescriptorHeap()
+{
+}
+
+FRHICpuDescriptor DX12RHIDescriptorHeap::GetCpuHandle(uint32_t index) const
+{
+	FRHICpuDescriptor handle;
+	handle.ptr = mHeap->GetCpuHandle(index).ptr;
+	return handle;
+}
+
+FRHIGpuDescriptor DX12RHIDescriptorHeap::GetGpuHandle(uint32_t index) const
+{
+	FRHIGpuDescriptor handle;
+	handle.ptr = mHeap->GetGpuHandle(index).ptr;
+	return handle;
+}
+
+uint32_t DX12RHIDescriptorHeap::GetDescriptorSize() const
+{
+	return mHeap->GetDescriptorSize();
+}
+
+ID3D12DescriptorHeap* DX12RHIDescriptorHeap::GetHeap() const
+{
+	return mHeap->GetHeap();
+}
+
+DX12RHICommandAllocator::DX12RHICommandAllocator(ID3D12Device* device, ERHICommandListType type)
+	: RHICommandAllocator(type)
+{
+	ThrowIfFailed(device->CreateCommandAllocator(static_cast<D3D12_COMMAND_LIST_TYPE>(type), IID_PPV_ARGS(&mAllocator)));
+}
+
+void DX12RHICommandAllocator::Reset()
+{
+	ThrowIfFailed(mAllocator->Reset());
+}
+
+DX12RHICommandList::DX12RHICommandList(ID3D12Device* device, ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState)
+	: RHICommandList(type)
+{
+	ID3D12PipelineState* pso = initialState ? static_cast<DX12RHIPipelineState*>(initialState)->Get() : nullptr;
+	ThrowIfFailed(device->CreateCommandList(0, static_cast<D3D12_COMMAND_LIST_TYPE>(type),
+		static_cast<DX12RHICommandAllocator*>(allocator)->Get(), pso, IID_PPV_ARGS(&mCommandList)));
+}
+
+void DX12RHICommandList::Reset(RHICommandAllocator* allocator, RHIPipelineState* initialState)
+{
+	ID3D12PipelineState* pso = initialState ? static_cast<DX12RHIPipelineState*>(initialState)->Get() : nullptr;
+	ThrowIfFailed(mCommandList->Reset(static_cast<DX12RHICommandAllocator*>(allocator)->Get(), pso));
+}
+
+void DX12RHICommandList::Close()
+{
+	ThrowIfFailed(mCommandList->Close());
+}
+
+void DX12RHICommandList::SetPipelineState(RHIPipelineState* pipelineState)
+{
+	mCommandList->SetPipelineState(static_cast<DX12RHIPipelineState*>(pipelineState)->Get());
+}
+
+void DX12RHICommandList::SetGraphicsRootSignature(RHIRootSignature* rootSignature)
+{
+	mCommandList->SetGraphicsRootSignature(static_cast<DX12RHIRootSignature*>(rootSignature)->Get());
+}
+
+void DX12RHICommandList::SetDescriptorHeaps(uint32_t numHeaps, RHIDescriptorHeap* const* heaps)
+{
+	// D3D12 allows at most one CBV/SRV/UAV heap and one sampler heap at a time.
+	ID3D12DescriptorHeap* ppHeaps[2] = {};
+	const UINT count = numHeaps < 2 ? numHeaps : 2;
+	for (UINT i = 0; i < count; ++i)
+	{
+		ppHeaps[i] = static_cast<DX12RHIDescriptorHeap*>(heaps[i])->GetHeap();
+	}
+	mCommandList->SetDescriptorHeaps(count, ppHeaps);
+}
+
+void DX12RHICommandList::IASetPrimitiveTopology(ERHIPrimitiveTopology topology)
+{
+	mCommandList->IASetPrimitiveTopology(static_cast<D3D_PRIMITIVE_TOPOLOGY>(topology));
+}
+
+void DX12RHICommandList::IASetIndexBuffer(const FRHIIndexBufferView* view)
+{
+	mCommandList->IASetIndexBuffer(reinterpret_cast<const D3D12_INDEX_BUFFER_VIEW*>(view));
+}
+
+void DX12RHICommandList::IASetVertexBuffers(uint32_t startSlot, uint32_t numViews, const FRHIVertexBufferView* views)
+{
+	mCommandList->IASetVertexBuffers(startSlot, numViews, reinterpret_cast<const D3D12_VERTEX_BUFFER_VIEW*>(views));
+}
+
+void DX12RHICommandList::SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues)
+{
+	mCommandList->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValues, data, destOffsetIn32BitValues);
+}
+
+void DX12RHICommandList::SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, FRHIGpuDescriptor baseDescriptor)
+{
+	mCommandList->SetGraphicsRootDescriptorTable(rootParameterIndex, ToD3D12(baseDescriptor));
+}
+
+void DX12RHICommandList::SetGraphicsRootConstantBufferView(uint32_t rootParameterIndex, uint64_t bufferLocation)
+{
+	mCommandList->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+}
+
+void DX12RHICommandList::SetGraphicsRootShaderResourceView(uint32_t rootParameterIndex, uint64_t bufferLocation)
+{
+	mCommandList->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+}
+
+void DX12RHICommandList::RSSetViewports(uint32_t numViewports, const FRHIViewport* viewports)
+{
+	mCommandList->RSSetViewports(numViewports, reinterpret_cast<const D3D12_VIEWPORT*>(viewports));
+}
+
+void DX12RHICommandList::RSSetScissorRects(uint32_t numRects, const FRHIRect* rects)
+{
+	mCommandList->RSSetScissorRects(numRects, reinterpret_cast<const D3D12_RECT*>(rects));
+}
+
+void DX12RHICommandList::OMSetRenderTargets(uint32_t numRenderTargets, const FRHICpuDescriptor* renderTargets, const FRHICpuDescriptor* depthStencil)
+{
+	mCommandList->OMSetRenderTargets(numRenderTargets, reinterpret_cast<const D3D12_CPU_DESCRIPTOR_HANDLE*>(renderTargets), FALSE,
+		reinterpret_cast<const D3D12_CPU_DESCRIPTOR_HANDLE*>(depthStencil));
+}
+
+void DX12RHICommandList::ClearRenderTargetView(FRHICpuDescriptor renderTarget, const float color[4])
+{
+	mCommandList->ClearRenderTargetView(ToD3D12(renderTarget), color, 0, nullptr);
+}
+
+void DX12RHICommandList::ClearDepthStencilView(FRHICpuDescriptor depthStencil, float depth, uint8_t stencil)
+{
+	mCommandList->ClearDepthStencilView(ToD3D12(depthStencil), D3D12_CLEAR_FLAG_DEPTH, depth, stencil, 0, nullptr);
+}
+
+void DX12RHICommandList::TransitionResource(RHIResource* resource, ERHIResourceState before, ERHIResourceState after)
+{
+	DX12RHIResource* dx12Resource = static_cast<DX12RHIResource*>(resource);
+	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(dx12Resource->GetResource(),
+		static_cast<D3D12_RESOURCE_STATES>(before), static_cast<D3D12_RESOURCE_STATES>(after)));
+	dx12Resource->SetUsageState(after);
+}
+
+void DX12RHICommandList::ResourceBarrier(uint32_t numBarriers, const FRHIResourceBarrier* barriers)
+{
+	// Batches of up to a few dozen barriers are the norm; only larger ones touch the heap.
+	const uint32_t StackBarrierCount = 32;
+	D3D12_RESOURCE_BARRIER stackBarriers[StackBarrierCount];
+	std::vector<D3D12_RESOURCE_BARRIER> heapBarriers;
+	D3D12_RESOURCE_BARRIER* d3dBarriers = stackBarriers;
+	if (numBarriers > StackBarrierCount)
+	{
+		heapBarriers.resize(numBarriers);
+		d3dBarriers = heapBarriers.data();
+	}
+
+	for (uint32_t i = 0; i < numBarriers; ++i)
+	{
+		const FRHIResourceBarrier& barrier = barriers[i];
+		DX12RHIResource* resource = static_cast<DX12RHIResource*>(barrier.Resource);
+		ID3D12Resource* d3dResource = resource ? resource->GetResource() : nullptr;
+		switch (barrier.Type)
+		{
+		case ERHIBarrierType::Aliasing:
+		{
+			DX12RHIResource* resourceBefore = static_cast<DX12RHIResource*>(barrier.ResourceBefore);
+			d3dBarriers[i] = CD3DX12_RESOURCE_BARRIER::Aliasing(resourceBefore ? resourceBefore->GetResource() : nullptr, d3dResource);
+			break;
+		}
+		case ERHIBarrierType::UnorderedAccess:
+			d3dBarriers[i] = CD3DX12_RESOURCE_BARRIER::UAV(d3dResource);
+			break;
+		default:
+			d3dBarriers[i] = CD3DX12_RESOURCE_BARRIER::Transition(d3dResource,
+				static_cast<D3D12_RESOURCE_STATES>(barrier.StateBefore), static_cast<D3D12_RESOURCE_STATES>(barrier.StateAfter),
+				D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, static_cast<D3D12_RESOURCE_BARRIER_FLAGS>(barrier.Flags));
+			break;
+		}
+	}
+
+	if (numBarriers > 0)
+	{
+		mCommandList->ResourceBarrier(numBarriers, d3dBarriers);
+	}
+}
+
+void DX12RHICommandList::DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation)
+{
+	mCommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void DX12RHICommandList::ExecuteBundle(RHICommandList* bundle)
+{
+	mCommandList->ExecuteBundle(static_cast<DX12RHICommandList*>(bundle)->Get());
+}
+
+void DX12RHICommandList::Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ)
+{
+	mCommandList->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+}
+
+void DX12RHICommandList::BeginEvent(const wchar_t* name)
+{
+	PIXBeginEvent(mCommandList.Get(), 0, name);
+}
+
+void DX12RHICommandList::EndEvent()
+{
+	PIXEndEvent(mCommandList.Get());
+}
+
+DX12RHIFenceEvent::DX12RHIFenceEvent()
+{
+	mEvent = CreateEventEx(NULL, false, false, EVENT_ALL_ACCESS);
+	if (!mEvent)
+	{
+		D3D_THROW("DX12RHIFenceEvent: CreateEventEx failed");
+	}
+}
+
+DX12RHIFenceEvent::~DX12RHIFenceEvent()
+{
+	CloseHandle(mEvent);
+}
+
+void DX12RHIFenceEvent::Signal()
+{
+	SetEvent(mEvent);
+}
+
+void DX12RHIFenceEvent::Wait()
+{
+	WaitForSingleObjectEx(mEvent, INFINITE, false);
+}
+
+DX12RHICommandQueue::DX12RHICommandQueue(Direct3DQueue* queue, Direct3DQueueManager* queueManager, ERHICommandListType type)
+	: RHICommandQueue(type),
+	mQueue(queue),
+	mQueueManager(queueManager)
+{
+}
+
+uint64_t DX12RHICommandQueue::ExecuteCommandLists(uint32_t count, RHICommandList* const* lists)
+{
+	return SubmitNative(count, lists, true);
+}
+
+uint64_t DX12RHICommandQueue::SubmitCommandLists(uint32_t count, RHICommandList* const* lists)
+{
+	return SubmitNative(count, lists, false);
+}
+
+void DX12RHICommandQueue::Flush()
+{
+	mQueue->Flush();
+}
+
+void DX12RHICommandQueue::InsertWait(uint64_t fenceValue)
+{
+	mQueueManager->InsertWaitForFence(mQueue, fenceValue);
+}
+
+void DX12RHICommandQueue::SetEventOnCompletion(uint64_t fenceValue, RHIFenceEvent* event)
+{
+	mQueue->SetEventOnCompletion(fenceValue, static_cast<DX12RHIFenceEvent*>(event)->Get());
+}
+
+uint64_t DX12RHICommandQueue::SubmitNative(uint32_t count, RHICommandList* const* lists, bool flush)
+{
+	if (!lists || count == 0)
+	{
+		D3D_THROW("DX12RHICommandQueue::ExecuteCommandLists: invalid lists/count");
+	}
+
+	ID3D12CommandList* ppCommandLists[64];
+	std::vector<ID3D12CommandList*> overflow;
+	ID3D12CommandList** nativeLists = ppCommandLists;
+	if (count > _countof(ppCommandLists))
+	{
+		overflow.resize(count);
+		nativeLists = overflow.data();
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		nativeLists[i] = static_cast<DX12RHICommandList*>(lists[i])->Get();
+	}
+	return flush ? mQueue->ExecuteCommandLists(count, nativeLists) : mQueue->SubmitCommandLists(count, nativeLists);
+}
+
+bool DX12RHICommandQueue::IsFenceComplete(uint64_t fenceValue)
+{
+	return mQueue->IsFenceComplete(fenceValue);
+}
+
+void DX12RHICommandQueue::WaitForFenceCPUBlocking(uint64_t fenceValue)
+{
+	mQueue->WaitForFenceCPUBlocking(fenceValue);
+}
+
+uint64_t DX12RHICommandQueue::GetLastCompletedFence()
+{
+	return mQueue->GetLastCompletedFence();
+}
+
+uint64_t DX12RHICommandQueue::GetNextFenceValue()
+{
+	return mQueue->GetNextFenceValue();
+}
+
+DX12RHIDevice::DX12RHIDevice(ID3D12Device* device, Direct3DQueueManager* queueManager)
+	: mDevice(device)
+{
+	mGraphicsQueue = std::make_unique<DX12RHICommandQueue>(queueManager->GetGraphicsQueue(), queueManager, ERHICommandListType::Direct);
+	mComputeQueue = std::make_unique<DX12RHICommandQueue>(queueManager->GetComputeQueue(), queueManager, ERHICommandListType::Compute);
+	mCopyQueue = std::make_unique<DX12RHICommandQueue>(queueManager->GetCopyQueue(), queueManager, ERHICommandListType::Copy);
+}
+
+DX12RHIDevice::~DX12RHIDevice()
+{
+}
+
+std::unique_ptr<RHIResource> DX12RHIDevice::CreateBuffer(const FRHIBufferDesc& desc)
+{
+	D3D12_RESOURCE_STATES initialState = static_cast<D3D12_RESOURCE_STATES>(desc.InitialState);
+	if (desc.HeapType == ERHIHeapType::Upload)
+	{
+		// Upload heaps must be created (and stay) in GENERIC_READ.
+		initialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+	}
+	else if (desc.HeapType == ERHIHeapType::Readback)
+	{
+		initialState = D3D12_RESOURCE_STATE_COPY_DEST;
+	}
+
+	ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(mDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(ToD3D12(desc.HeapType)),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(desc.SizeInBytes),
+		initialState,
+		nullptr,
+		IID_PPV_ARGS(&resource)));
+
+	if (desc.DebugName)
+	{
+		SetName(resource.Get(), desc.DebugName);
+	}
+
+	return std::make_unique<DX12RHIResource>(resource.Get(), initialState, ERHIResourceType::RHI_BufferType);
+}
+
+std::unique_ptr<RHIDescriptorHeap> DX12RHIDevice::CreateDescriptorHeap(ERHIDescriptorHeapType type, uint32_t numDescriptors, bool isShaderVisible)
+{
+	return std::make_unique<DX12RHIDescriptorHeap>(
+		std::make_unique<DescriptorHeap>(mDevice, static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(type), numDescriptors, isShaderVisible));
+}
+
+std::unique_ptr<RHICommandAllocator> DX12RHIDevice::CreateCommandAllocator(ERHICommandListType type)
+{
+	return std::make_unique<DX12RHICommandAllocator>(mDevice, type);
+}
+
+std::unique_ptr<RHICommandList> DX12RHIDevice::CreateCommandList(ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState)
+{
+	return std::make_unique<DX12RHICommandList>(mDevice, type, allocator, initialState);
+}
+
+std::unique_ptr<RHIPipelineState> DX12RHIDevice::CreateGraphicsPipelineState(const FRHIGraphicsPipelineDesc& desc)
+{
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = ToD3D12(desc);
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState;
+	ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)));
+	return std::make_unique<DX12RHIPipelineState>(pipelineState.Get());
+}
+
+std::unique_ptr<RHIPipelineLibrary> DX12RHIDevice::CreatePipelineLibrary(const void* blob, size_t size)
+{
+	// Pipeline libraries need ID3D12Device1. A blob from another driver or adapter is refused with
+	// D3D12_ERROR_DRIVER_VERSION_MISMATCH or D3D12_ERROR_ADAPTER_NOT_FOUND; start an empty one then.
+	std::vector<uint8_t> blobCopy(static_cast<const uint8_t*>(blob), static_cast<const uint8_t*>(blob) + size);
+	Microsoft::WRL::ComPtr<ID3D12Device1> device1;
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> library;
+	if (SUCCEEDED(mDevice->QueryInterface(IID_PPV_ARGS(&device1))))
+	{
+		if (blobCopy.empty() || FAILED(device1->CreatePipelineLibrary(blobCopy.data(), blobCopy.size(), IID_PPV_ARGS(&library))))
+		{
+			blobCopy.clear();
+			device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library));
+		}
+	}
+	return std::make_unique<DX12RHIPipelineLibrary>(library.Get(), std::move(blobCopy));
+}
+
+void DX12RHIDevice::CreateConstantBufferView(uint64_t bufferLocation, uint32_t sizeInBytes, FRHICpuDescriptor destDescriptor)
+{
+	D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
+	cbvDesc.BufferLocation = bufferLocation;
+	cbvDesc.SizeInBytes = sizeInBytes;
+	mDevice->CreateConstantBufferView(&cbvDesc, ToD3D12(destDescriptor));
+}
+
+void DX12RHIDevice::CreateSampler(const FRHISamplerDesc& desc, FRHICpuDescriptor destDescriptor)
+{
+	mDevice->CreateSampler(reinterpret_cast<const D3D12_SAMPLER_DESC*>(&desc), ToD3D12(destDescriptor));
+}
+
+void DX12RHIDevice::CopyDescriptors(uint32_t numDescriptors, const FRHICpuDescriptor* sources, FRHICpuDescriptor destStart, ERHIDescriptorHeapType type)
+{
+	if (numDescriptors == 0)
+	{
+		return;
+	}
+
+	// One destination range; sources that follow each other in their heap go in as one range.
+	const D3D12_DESCRIPTOR_HEAP_TYPE heapType = static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(type);
+	const uint64_t descriptorSize = mDevice->GetDescriptorHandleIncrementSize(heapType);
+	std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> sourceStarts;
+	std::vector<UINT> sourceSizes;
+	for (uint32_t i = 0; i < numDescriptors; ++i)
+	{
+		if (!sourceStarts.empty() && sources[i].ptr == sourceStarts.back().ptr + sourceSizes.back() * descriptorSize)
+		{
+			++sourceSizes.back();
+			continue;
+		}
+		sourceStarts.push_back(ToD3D12(sources[i]));
+		sourceSizes.push_back(1);
+	}
+
+	const D3D12_CPU_DESCRIPTOR_HANDLE destination = ToD3D12(destStart);
+	const UINT destinationSize = numDescriptors;
+	mDevice->CopyDescriptors(1, &destination, &destinationSize,
+		static_cast<UINT>(sourceStarts.size()), sourceStarts.data(), sourceSizes.data(), heapType);
+}
+
+RHICommandQueue* DX12RHIDevice::GetQueue(ERHICommandListType type)
+{
+	switch (type)
+	{
+	case ERHICommandListType::Direct:
+		return mGraphicsQueue.get();
+	case ERHICommandListType::Compute:
+		return mComputeQueue.get();
+	case ERHICommandListType::Copy:
+		return mCopyQueue.get();
+	default:
+		D3D_THROW("Bad command type lookup in DX12RHIDevice.");
+	}
+
+	return nullptr;
+}
+
+std::unique_ptr<RHIFenceEvent> DX12RHIDevice::CreateFenceEvent()
+{
+	return std::make_unique<DX12RHIFenceEvent>();
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <d3d12.h>
+#include <wrl.h>
+#include <memory>
+#include <vector>
+
+#include "RHIDevice.h"
+#include "DX12RHIResource.h"
+
+class DescriptorHeap;
+class Direct3DQueue;
+class Direct3DQueueManager;
+
+// D3D12 backend of the RHI interfaces. These are thin adapters over the objects the sample
+// already owns (ID3D12Device, Direct3DQueue, DescriptorHeap) so both paths share one queue/fence.
+
+class DX12RHIPipelineState : public RHIPipelineState
+{
+public:
+	explicit DX12RHIPipelineState(ID3D12PipelineState* pipelineState) : mPipelineState(pipelineState) {}
+	ID3D12PipelineState* Get() const { return mPipelineState.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> mPipelineState;
+};
+
+class DX12RHIRootSignature : public RHIRootSignature
+{
+public:
+	explicit DX12RHIRootSignature(ID3D12RootSignature* rootSignature, uint64_t hash = 0) : RHIRootSignature(hash), mRootSignature(rootSignature) {}
+	ID3D12RootSignature* Get() const { return mRootSignature.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> mRootSignature;
+};
+
+class DX12RHIPipelineLibrary : public RHIPipelineLibrary
+{
+public:
+	// Null library: the driver rejected the blob and could not create an empty library either.
+	DX12RHIPipelineLibrary(ID3D12PipelineLibrary* library, std::vector<uint8_t> blob);
+
+	std::unique_ptr<RHIPipelineState> LoadGraphicsPipeline(const wchar_t* name, const FRHIGraphicsPipelineDesc& desc) override;
+	bool StorePipeline(const wchar_t* name, RHIPipelineState* pipelineState) override;
+	std::vector<uint8_t> Serialize() const override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary;
+	// The library reads pipelines out of this for as long as it lives.
+	std::vector<uint8_t> mBlob;
+};
+
+class DX12RHIDescriptorHeap : public RHIDescriptorHeap
+{
+public:
+	// Wraps a heap owned elsewhere (e.g. by D3D12DynamicIndexing).
+	explicit DX12RHIDescriptorHeap(DescriptorHeap* heap);
+	// Takes ownership.
+	explicit DX12RHIDescriptorHeap(std::unique_ptr<DescriptorHeap> heap);
+	~DX12RHIDescriptorHeap() override;
+
+	FRHICpuDescriptor GetCpuHandle(uint32_t index) const override;
+	FRHIGpuDescriptor GetGpuHandle(uint32_t index) const override;
+	uint32_t GetDescriptorSize() const override;
+
+	ID3D12DescriptorHeap* GetHeap() const;
+
+private:
+	std::unique_ptr<DescriptorHeap> mOwnedHeap;
+	DescriptorHeap* mHeap;
+};
+
+class DX12RHICommandAllocator : public RHICommandAllocator
+{
+public:
+	DX12RHICommandAllocator(ID3D12Device* device, ERHICommandListType type);
+
+	void Reset() override;
+	ID3D12CommandAllocator* Get() const { return mAllocator.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> mAllocator;
+};
+
+class DX12RHICommandList : public RHICommandList
+{
+public:
+	DX12RHICommandList(ID3D12Device* device, ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState);
+
+	void Reset(RHICommandAllocator* allocator, RHIPipelineState* initialState) override;
+	void Close() override;
+
+	void SetPipelineState(RHIPipelineState* pipelineState) override;
+	void SetGraphicsRootSignature(RHIRootSignature* rootSignature) override;
+	void SetDescriptorHeaps(uint32_t numHeaps, RHIDescriptorHeap* const* heaps) override;
+
+	void IASetPrimitiveTopology(ERHIPrimitiveTopology topology) override;
+	void IASetIndexBuffer(const FRHIIndexBufferView* view) override;
+	void IASetVertexBuffers(uint32_t startSlot, uint32_t numViews, const FRHIVertexBufferView* views) override;
+
+	void SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues) override;
+	void SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, FRHIGpuDescriptor baseDescriptor) override;
+	void SetGraphicsRootConstantBufferView(uint32_t rootParameterIndex, uint64_t bufferLocation) override;
+	void SetGraphicsRootShaderResourceView(uint32_t rootParameterIndex, uint64_t bufferLocation) override;
+
+	void RSSetViewports(uint32_t numViewports, const FRHIViewport* viewports) override;
+	void RSSetScissorRects(uint32_t numRects, const FRHIRect* rects) override;
+	void OMSetRenderTargets(uint32_t numRenderTargets, const FRHICpuDescriptor* renderTargets, const FRHICpuDescriptor* depthStencil) override;
+	void ClearRenderTargetView(FRHICpuDescriptor renderTarget, const float color[4]) override;
+	void ClearDepthStencilView(FRHICpuDescriptor depthStencil, float depth, uint8_t stencil) override;
+
+	void TransitionResource(RHIResource* resource, ERHIResourceState before, ERHIResourceState after) override;
+	void ResourceBarrier(uint32_t numBarriers, const FRHIResourceBarrier* barriers) override;
+
+	void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) override;
+	void ExecuteBundle(RHICommandList* bundle) override;
+	void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) override;
+
+	void BeginEvent(const wchar_t* name) override;
+	void EndEvent() override;
+
+	ID3D12GraphicsCommandList* Get() const { return mCommandList.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> mCommandList;
+};
+
+// An auto-reset Win32 event.
+class DX12RHIFenceEvent : public RHIFenceEvent
+{
+public:
+	DX12RHIFenceEvent();
+	~DX12RHIFenceEvent() override;
+
+	void Signal() override;
+	void Wait() override;
+
+	HANDLE Get() const { return mEvent; }
+
+private:
+	HANDLE mEvent;
+};
+
+class DX12RHICommandQueue : public RHICommandQueue
+{
+public:
+	// queueManager resolves the queues that the fence values given to InsertWait() belong to.
+	DX12RHICommandQueue(Direct3DQueue* queue, Direct3DQueueManager* queueManager, ERHICommandListType type);
+
+	uint64_t ExecuteCommandLists(uint32_t count, RHICommandList* const* lists) override;
+	uint64_t SubmitCommandLists(uint32_t count, RHICommandList* const* lists) override;
+	void Flush() override;
+	void InsertWait(uint64_t fenceValue) override;
+	void SetEventOnCompletion(uint64_t fenceValue, RHIFenceEvent* event) override;
+
+	bool IsFenceComplete(uint64_t fenceValue) override;
+	void WaitForFenceCPUBlocking(uint64_t fenceValue) override;
+	uint64_t GetLastCompletedFence() override;
+	uint64_t GetNextFenceValue() override;
+
+	Direct3DQueue* Get() const { return mQueue; }
+
+private:
+	// Hands the native lists to the Direct3DQueue; flush executes them before returning.
+	uint64_t SubmitNative(uint32_t count, RHICommandList* const* lists, bool flush);
+
+	Direct3DQueue* mQueue;
+	Direct3DQueueManager* mQueueManager;
+};
+
+class DX12RHIDevice : public RHIDevice
+{
+public:
+	DX12RHIDevice(ID3D12Device* device, Direct3DQueueManager* queueManager);
+	~DX12RHIDevice() override;
+
+	std::unique_ptr<RHIResource> CreateBuffer(const FRHIBufferDesc& desc) override;
+	std::unique_ptr<RHIDescriptorHeap> CreateDescriptorHeap(ERHIDescriptorHeapType type, uint32_t numDescriptors, bool isShaderVisible) override;
+	std::unique_ptr<RHICommandAllocator> CreateCommandAllocator(ERHICommandListType type) override;
+	std::unique_ptr<RHICommandList> CreateCommandList(ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState) override;
+
+	std::unique_ptr<RHIPipelineState> CreateGraphicsPipelineState(const FRHIGraphicsPipelineDesc& desc) override;
+	std::unique_ptr<RHIPipelineLibrary> CreatePipelineLibrary(const void* blob, size_t size) override;
+
+	void CreateConstantBufferView(uint64_t bufferLocation, uint32_t sizeInBytes, FRHICpuDescriptor destDescriptor) override;
+	void CreateSampler(const FRHISamplerDesc& desc, FRHICpuDescriptor destDescriptor) override;
+	void CopyDescriptors(uint32_t numDescriptors, const FRHICpuDescriptor* sources, FRHICpuDescriptor destStart, ERHIDescriptorHeapType type) override;
+
+	RHICommandQueue* GetQueue(ERHICommandListType type) override;
+	std::unique_ptr<RHIFenceEvent> CreateFenceEvent() override;
+
+	ID3D12Device* Get() const { return mDevice; }
+
+private:
+	ID3D12Device* mDevice;
+	std::unique_ptr<DX12RHICommandQueue> mGraphicsQueue;
+	std::unique_ptr<DX12RHICommandQueue> mComputeQueue;
+	std::unique_ptr<DX12RHICommandQueue> mCopyQueue;
+};
@@ -1,6 +1,7 @@
 
-#pragma once	
+#pragma once
 #include <d3d12.h>
+#include <wrl.h>
 #include "Direct3DUtils.h"
 #include "RHIResource.h"
 
@@ -10,31 +11,76 @@ public:
 	DX12RHIResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES usageState,ERHIResourceType Type);
 	virtual ~DX12RHIResource();
 
-	ID3D12Resource* GetResource() { return mResource; }
+	ID3D12Resource* GetResource() { return mResource.Get(); }
 	D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress() { return mGPUAddress; }
-	D3D12_RESOURCE_STATES GetUsageState() { return mUsageState; }
-	void SetUsageState(D3D12_RESOURCE_STATES usageState) { mUsageState = usageState; }
+	ERHIResourceState GetUsageState() const override { return static_cast<ERHIResourceState>(mUsageState); }
+	void SetUsageState(ERHIResourceState usageState) override { mUsageState = static_cast<D3D12_RESOURCE_STATES>(usageState); }
 
 	bool GetIsReady() { return mIsReady; }
 	void SetIsReady(bool isReady) { mIsReady = isReady; }
 
+	void* Map() override;
+	void Unmap() override;
+	uint64_t GetGpuVirtualAddress() const override { return mGPUAddress; }
+	uint64_t GetSizeInBytes() const override { return mSizeInBytes; }
+
 protected:
-	ID3D12Resource* mResource;
+	// Holds its own reference; wrapping a ComPtr-owned resource (e.g. a swap chain buffer) is safe.
+	Microsoft::WRL::ComPtr<ID3D12Resource> mResource;
 	D3D12_GPU_VIRTUAL_ADDRESS mGPUAddress;
 	D3D12_RESOURCE_STATES mUsageState;
+	uint64_t mSizeInBytes;
+	void* mMappedData;
 	bool mIsReady;
 };
 
-DX12RHIResource::DX12RHIResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES usageState, ERHIResourceType Type):RHIResource(Type)
+inline DX12RHIResource::DX12RHIResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES usageState, ERHIResourceType Type):RHIResource(Type)
 {
 	mResource = resource;
 	mUsageState = usageState;
 	mGPUAddress = 0;
+	mSizeInBytes = 0;
+	mMappedData = nullptr;
 	mIsReady = false;
+
+	if (mResource)
+	{
+		const D3D12_RESOURCE_DESC desc = mResource->GetDesc();
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			mGPUAddress = mResource->GetGPUVirtualAddress();
+			mSizeInBytes = desc.Width;
+		}
+	}
+}
+
+inline DX12RHIResource::~DX12RHIResource()
+{
+	Unmap();
+	mResource.Reset();
 }
 
-DX12RHIResource::~DX12RHIResource()
+inline void* DX12RHIResource::Map()
 {
-	mResource->Release();
-	mResource = NULL;
-}
\ No newline at end of file
+	if (!mMappedData)
+	{
+		// No CPU reads will be done from the resource.
+		D3D12_RANGE readRange = { 0, 0 };
+		HRESULT hr = mResource->Map(0, &readRange, &mMappedData);
+		if (FAILED(hr))
+		{
+			mMappedData = nullptr;
+			D3D_THROW_HR("DX12RHIResource::Map failed", hr);
+		}
+	}
+	return mMappedData;
+}
+
+inline void DX12RHIResource::Unmap()
+{
+	if (mMappedData)
+	{
+		mResource->Unmap(0, nullptr);
+		mMappedData = nullptr;
+	}
+}
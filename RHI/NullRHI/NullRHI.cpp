@@ -0,0 +1,681 @@
+#include "NullRHI.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	// Keep fake GPU addresses aligned like real placed resources so alignment math stays honest.
+	const uint64_t NullResourceAlignment = 64 * 1024;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// NullRHIPipelineLibrary blobs: the magic, the name count, then each name as its length and
+	// its characters, all 32 bit so the format does not depend on the size of wchar_t.
+	const uint32_t NullPipelineLibraryMagic = 0x424C504Eu;	// "NPLB"
+
+	void AppendUint32(std::vector<uint8_t>& blob, uint32_t value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		blob.insert(blob.end(), bytes, bytes + sizeof(value));
+	}
+
+	bool ReadUint32(const uint8_t*& cursor, const uint8_t* end, uint32_t& value)
+	{
+		if (end - cursor < static_cast<ptrdiff_t>(sizeof(value)))
+		{
+			return false;
+		}
+		std::memcpy(&value, cursor, sizeof(value));
+		cursor += sizeof(value);
+		return true;
+	}
+}
+
+NullRHIResource::NullRHIResource(const FRHIBufferDesc& desc, uint64_t gpuVirtualAddress)
+	: RHIResource(ERHIResourceType::RHI_BufferType),
+	mGpuVirtualAddress(gpuVirtualAddress),
+	mSizeInBytes(desc.SizeInBytes),
+	mInitialState(desc.InitialState),
+	mUsageState(desc.InitialState)
+{
+	if (desc.HeapType != ERHIHeapType::Default)
+	{
+		mCpuData.reset(new uint8_t[static_cast<size_t>(desc.SizeInBytes)]);
+		std::memset(mCpuData.get(), 0, static_cast<size_t>(desc.SizeInBytes));
+	}
+}
+
+NullRHIPipelineLibrary::NullRHIPipelineLibrary(const void* blob, size_t size)
+{
+	const uint8_t* cursor = static_cast<const uint8_t*>(blob);
+	const uint8_t* end = cursor + size;
+	uint32_t magic = 0;
+	uint32_t nameCount = 0;
+	if (size == 0 || !ReadUint32(cursor, end, magic) || magic != NullPipelineLibraryMagic || !ReadUint32(cursor, end, nameCount))
+	{
+		return;
+	}
+
+	std::set<std::wstring> names;
+	for (uint32_t i = 0; i < nameCount; ++i)
+	{
+		uint32_t length = 0;
+		if (!ReadUint32(cursor, end, length))
+		{
+			return;
+		}
+		std::wstring name;
+		for (uint32_t c = 0; c < length; ++c)
+		{
+			uint32_t character = 0;
+			if (!ReadUint32(cursor, end, character))
+			{
+				return;
+			}
+			name.push_back(static_cast<wchar_t>(character));
+		}
+		names.insert(std::move(name));
+	}
+	mNames = std::move(names);
+}
+
+std::unique_ptr<RHIPipelineState> NullRHIPipelineLibrary::LoadGraphicsPipeline(const wchar_t* name, const FRHIGraphicsPipelineDesc& desc)
+{
+	(void)desc;
+	return mNames.count(name) ? std::make_unique<NullRHIPipelineState>() : nullptr;
+}
+
+bool NullRHIPipelineLibrary::StorePipeline(const wchar_t* name, RHIPipelineState* pipelineState)
+{
+	(void)pipelineState;
+	return mNames.insert(name).second;
+}
+
+std::vector<uint8_t> NullRHIPipelineLibrary::Serialize() const
+{
+	std::vector<uint8_t> blob;
+	AppendUint32(blob, NullPipelineLibraryMagic);
+	AppendUint32(blob, static_cast<uint32_t>(mNames.size()));
+	for (const std::wstring& name : mNames)
+	{
+		AppendUint32(blob, static_cast<uint32_t>(name.size()));
+		for (wchar_t character : name)
+		{
+			AppendUint32(blob, static_cast<uint32_t>(character));
+		}
+	}
+	return blob;
+}
+
+NullRHIDescriptorHeap::NullRHIDescriptorHeap(ERHIDescriptorHeapType type, uint32_t numDescriptors, bool isShaderVisible, uint64_t handleBase)
+	: RHIDescriptorHeap(type, numDescriptors, isShaderVisible),
+	mHandleBase(handleBase)
+{
+}
+
+FRHICpuDescriptor NullRHIDescriptorHeap::GetCpuHandle(uint32_t index) const
+{
+	FRHICpuDescriptor handle;
+	handle.ptr = mHandleBase + static_cast<uint64_t>(index) * DescriptorSize;
+	return handle;
+}
+
+FRHIGpuDescriptor NullRHIDescriptorHeap::GetGpuHandle(uint32_t index) const
+{
+	FRHIGpuDescriptor handle;
+	handle.ptr = IsShaderVisible() ? mHandleBase + static_cast<uint64_t>(index) * DescriptorSize : 0;
+	return handle;
+}
+
+NullRHICommandList::NullRHICommandList(ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState)
+	: RHICommandList(type),
+	mBarrierCount(0),
+	mIsClosed(true)
+{
+	// Command lists are created in the recording state, like ID3D12Device::CreateCommandList.
+	Reset(allocator, initialState);
+}
+
+void NullRHICommandList::Reset(RHICommandAllocator* allocator, RHIPipelineState* initialState)
+{
+	if (!mIsClosed)
+	{
+		throw std::runtime_error("NullRHICommandList::Reset: command list is still open");
+	}
+	if (allocator && allocator->GetType() != GetType())
+	{
+		throw std::runtime_error("NullRHICommandList::Reset: allocator type mismatch");
+	}
+
+	mCommands.clear();
+	mRootConstants.clear();
+	std::memset(mCommandCounts, 0, sizeof(mCommandCounts));
+	mBarrierCount = 0;
+	mIsClosed = false;
+
+	if (initialState)
+	{
+		SetPipelineState(initialState);
+	}
+}
+
+void NullRHICommandList::Close()
+{
+	if (mIsClosed)
+	{
+		throw std::runtime_error("NullRHICommandList::Close: command list is already closed");
+	}
+	mIsClosed = true;
+}
+
+void NullRHICommandList::Record(ENullRHICommand op, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint64_t payload)
+{
+	if (mIsClosed)
+	{
+		throw std::runtime_error("NullRHICommandList: recording into a closed command list");
+	}
+
+	FNullRHICommand command;
+	command.Op = op;
+	command.Arg0 = arg0;
+	command.Arg1 = arg1;
+	command.Arg2 = arg2;
+	command.Payload = payload;
+	mCommands.push_back(command);
+	++mCommandCounts[static_cast<size_t>(op)];
+}
+
+void NullRHICommandList::SetPipelineState(RHIPipelineState* pipelineState)
+{
+	Record(ENullRHICommand::SetPipelineState, 0, 0, 0, reinterpret_cast<uint64_t>(pipelineState));
+}
+
+void NullRHICommandList::SetGraphicsRootSignature(RHIRootSignature* rootSignature)
+{
+	Record(ENullRHICommand::SetGraphicsRootSignature, 0, 0, 0, reinterpret_cast<uint64_t>(rootSignature));
+}
+
+void NullRHICommandList::SetDescriptorHeaps(uint32_t numHeaps, RHIDescriptorHeap* const* heaps)
+{
+	Record(ENullRHICommand::SetDescriptorHeaps, numHeaps, 0, 0, numHeaps ? reinterpret_cast<uint64_t>(heaps[0]) : 0);
+}
+
+void NullRHICommandList::IASetPrimitiveTopology(ERHIPrimitiveTopology topology)
+{
+	Record(ENullRHICommand::IASetPrimitiveTopology, static_cast<uint32_t>(topology));
+}
+
+void NullRHICommandList::IASetIndexBuffer(const FRHIIndexBufferView* view)
+{
+	Record(ENullRHICommand::IASetIndexBuffer, view ? view->SizeInBytes : 0, view ? static_cast<uint32_t>(view->Format) : 0, 0, view ? view->BufferLocation : 0);
+}
+
+void NullRHICommandList::IASetVertexBuffers(uint32_t startSlot, uint32_t numViews, const FRHIVertexBufferView* views)
+{
+	Record(ENullRHICommand::IASetVertexBuffers, startSlot, numViews, 0, (views && numViews) ? views[0].BufferLocation : 0);
+}
+
+void NullRHICommandList::SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues)
+{
+	// Constants are copied out so the recording stays valid after the caller's data goes away.
+	const uint64_t firstConstant = mRootConstants.size();
+	const uint32_t* values = static_cast<const uint32_t*>(data);
+	mRootConstants.insert(mRootConstants.end(), values, values + num32BitValues);
+	Record(ENullRHICommand::SetGraphicsRoot32BitConstants, rootParameterIndex, num32BitValues, destOffsetIn32BitValues, firstConstant);
+}
+
+void NullRHICommandList::SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, FRHIGpuDescriptor baseDescriptor)
+{
+	Record(ENullRHICommand::SetGraphicsRootDescriptorTable, rootParameterIndex, 0, 0, baseDescriptor.ptr);
+}
+
+void NullRHICommandList::SetGraphicsRootConstantBufferView(uint32_t rootParameterIndex, uint64_t bufferLocation)
+{
+	Record(ENullRHICommand::SetGraphicsRootConstantBufferView, rootParameterIndex, 0, 0, bufferLocation);
+}
+
+void NullRHICommandList::SetGraphicsRootShaderResourceView(uint32_t rootParameterIndex, uint64_t bufferLocation)
+{
+	Record(ENullRHICommand::SetGraphicsRootShaderResourceView, rootParameterIndex, 0, 0, bufferLocation);
+}
+
+void NullRHICommandList::RSSetViewports(uint32_t numViewports, const FRHIViewport* viewports)
+{
+	(void)viewports;
+	Record(ENullRHICommand::RSSetViewports, numViewports);
+}
+
+void NullRHICommandList::RSSetScissorRects(uint32_t numRects, const FRHIRect* rects)
+{
+	(void)rects;
+	Record(ENullRHICommand::RSSetScissorRects, numRects);
+}
+
+void NullRHICommandList::OMSetRenderTargets(uint32_t numRenderTargets, const FRHICpuDescriptor* renderTargets, const FRHICpuDescriptor* depthStencil)
+{
+	Record(ENullRHICommand::OMSetRenderTargets, numRenderTargets, depthStencil ? 1u : 0u, 0, (renderTargets && numRenderTargets) ? renderTargets[0].ptr : 0);
+}
+
+void NullRHICommandList::ClearRenderTargetView(FRHICpuDescriptor renderTarget, const float color[4])
+{
+	(void)color;
+	Record(ENullRHICommand::ClearRenderTargetView, 0, 0, 0, renderTarget.ptr);
+}
+
+void NullRHICommandList::ClearDepthStencilView(FRHICpuDescriptor depthStencil, float depth, uint8_t stencil)
+{
+	uint32_t depthBits;
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	Record(ENullRHICommand::ClearDepthStencilView, depthBits, stencil, 0, depthStencil.ptr);
+}
+
+void NullRHICommandList::TransitionResource(RHIResource* resource, ERHIResourceState before, ERHIResourceState after)
+{
+	Record(ENullRHICommand::TransitionResource, before, after, 0, reinterpret_cast<uint64_t>(resource));
+	resource->SetUsageState(after);
+}
+
+void NullRHICommandList::ResourceBarrier(uint32_t numBarriers, const FRHIResourceBarrier* barriers)
+{
+	// One command per call, like the single ResourceBarrier a D3D12 list records; Arg1 counts the
+	// transitions and Arg2 the halves of split ones.
+	uint32_t transitionCount = 0;
+	uint32_t splitCount = 0;
+	for (uint32_t i = 0; i < numBarriers; ++i)
+	{
+		transitionCount += barriers[i].Type == ERHIBarrierType::Transition ? 1 : 0;
+		splitCount += barriers[i].Flags != ERHIBarrierFlags::None ? 1 : 0;
+	}
+	mBarrierCount += numBarriers;
+	Record(ENullRHICommand::ResourceBarrier, numBarriers, transitionCount, splitCount, reinterpret_cast<uint64_t>(numBarriers ? barriers[0].Resource : nullptr));
+}
+
+void NullRHICommandList::DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation)
+{
+	Record(ENullRHICommand::DrawIndexedInstanced, indexCountPerInstance, instanceCount, startIndexLocation,
+		(static_cast<uint64_t>(static_cast<uint32_t>(baseVertexLocation)) << 32) | startInstanceLocation);
+}
+
+void NullRHICommandList::ExecuteBundle(RHICommandList* bundle)
+{
+	if (!bundle || bundle->GetType() != ERHICommandListType::Bundle)
+	{
+		throw std::runtime_error("NullRHICommandList::ExecuteBundle: not a bundle");
+	}
+	Record(ENullRHICommand::ExecuteBundle, 0, 0, 0, reinterpret_cast<uint64_t>(bundle));
+}
+
+void NullRHICommandList::Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ)
+{
+	if (GetType() == ERHICommandListType::Copy)
+	{
+		throw std::runtime_error("NullRHICommandList::Dispatch: copy lists cannot dispatch");
+	}
+	Record(ENullRHICommand::Dispatch, threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+}
+
+void NullRHICommandList::BeginEvent(const wchar_t* name)
+{
+	Record(ENullRHICommand::BeginEvent, 0, 0, 0, reinterpret_cast<uint64_t>(name));
+}
+
+void NullRHICommandList::EndEvent()
+{
+	Record(ENullRHICommand::EndEvent);
+}
+
+void NullRHIFenceEvent::Signal()
+{
+	{
+		std::lock_guard<std::mutex> lockGuard(mMutex);
+		mIsSet = true;
+	}
+	mCondition.notify_one();
+}
+
+void NullRHIFenceEvent::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mCondition.wait(lock, [this]() { return mIsSet; });
+	mIsSet = false;
+}
+
+NullRHICommandQueue::NullRHICommandQueue(ERHICommandListType type, NullRHIDevice* device)
+	: RHICommandQueue(type),
+	mDevice(device),
+	mLastCompletedFenceValue(RHIMakeInitialFenceValue(type)),
+	mSimulatedLatency(0),
+	mExecuteMicroseconds(0),
+	mSubmissions(RHIMakeInitialFenceValue(type) + 1,
+		[this](uint32_t count, void* const* lists, uint64_t fenceValue) { ExecuteBatch(count, lists, fenceValue); })
+{
+}
+
+uint64_t NullRHICommandQueue::ExecuteCommandLists(uint32_t count, RHICommandList* const* lists)
+{
+	const uint64_t fenceValue = SubmitCommandLists(count, lists);
+	mSubmissions.FlushUntil(fenceValue);
+	return fenceValue;
+}
+
+uint64_t NullRHICommandQueue::SubmitCommandLists(uint32_t count, RHICommandList* const* lists)
+{
+	CloseCommandLists(count, lists);
+	return mSubmissions.Enqueue(count, reinterpret_cast<void* const*>(lists));
+}
+
+void NullRHICommandQueue::InsertWait(uint64_t fenceValue)
+{
+	NullRHICommandQueue* waitedQueue = GetWaitedQueue(fenceValue);
+	if (waitedQueue == this)
+	{
+		return;
+	}
+	if (fenceValue >= waitedQueue->GetNextFenceValue())
+	{
+		throw std::runtime_error("NullRHICommandQueue::InsertWait: fence value not submitted yet");
+	}
+
+	// As Direct3DQueue::InsertWaitForQueueFence: the waited value gets signaled, and the lists
+	// submitted here before the wait stay ahead of it.
+	waitedQueue->mSubmissions.FlushUntil(fenceValue);
+	mSubmissions.FlushUntil(GetNextFenceValue() - 1);
+
+	std::lock_guard<std::mutex> lockGuard(mFenceMutex);
+	mStats.QueueWaits++;
+	if (!waitedQueue->IsFenceComplete(fenceValue))
+	{
+		mPendingWaits.push_back(fenceValue);
+	}
+}
+
+void NullRHICommandQueue::SetEventOnCompletion(uint64_t fenceValue, RHIFenceEvent* event)
+{
+	if (RHIGetFenceQueueType(fenceValue) != GetType() || fenceValue >= GetNextFenceValue())
+	{
+		throw std::runtime_error("NullRHICommandQueue::SetEventOnCompletion: fence value not submitted to this queue");
+	}
+
+	mSubmissions.FlushUntil(fenceValue);
+	std::lock_guard<std::mutex> lockGuard(mFenceMutex);
+	if (IsFenceComplete(fenceValue))
+	{
+		event->Signal();
+	}
+	else
+	{
+		mCompletionEvents.push_back({ fenceValue, event });
+	}
+}
+
+void NullRHICommandQueue::SignalCompletionEvents()
+{
+	const uint64_t completedFenceValue = mLastCompletedFenceValue.load();
+	auto reached = std::partition(mCompletionEvents.begin(), mCompletionEvents.end(),
+		[completedFenceValue](const std::pair<uint64_t, RHIFenceEvent*>& armed) { return armed.first > completedFenceValue; });
+	for (auto it = reached; it != mCompletionEvents.end(); ++it)
+	{
+		it->second->Signal();
+	}
+	mCompletionEvents.erase(reached, mCompletionEvents.end());
+}
+
+NullRHICommandQueue* NullRHICommandQueue::GetWaitedQueue(uint64_t fenceValue)
+{
+	const ERHICommandListType type = RHIGetFenceQueueType(fenceValue);
+	if (type == GetType())
+	{
+		return this;
+	}
+	if (!mDevice)
+	{
+		throw std::runtime_error("NullRHICommandQueue::InsertWait: no device to find the queue of the fence value");
+	}
+	return mDevice->GetNullQueue(type);
+}
+
+void NullRHICommandQueue::CloseCommandLists(uint32_t count, RHICommandList* const* lists)
+{
+	if (!lists || count == 0)
+	{
+		throw std::runtime_error("NullRHICommandQueue::ExecuteCommandLists: invalid lists/count");
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		NullRHICommandList* list = static_cast<NullRHICommandList*>(lists[i]);
+		if (!list || list->GetType() == ERHICommandListType::Bundle)
+		{
+			throw std::runtime_error("NullRHICommandQueue::ExecuteCommandLists: bundles cannot be submitted directly");
+		}
+		// Same contract as Direct3DQueue: the queue closes the lists it submits.
+		if (!list->IsClosed())
+		{
+			list->Close();
+		}
+	}
+}
+
+void NullRHICommandQueue::ExecuteBatch(uint32_t count, void* const* lists, uint64_t fenceValue)
+{
+	const uint32_t executeMicroseconds = mExecuteMicroseconds.load();
+	if (executeMicroseconds > 0)
+	{
+		// Spins rather than sleeps: the driver's cost is CPU time on the submitting thread.
+		const auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(executeMicroseconds);
+		while (std::chrono::steady_clock::now() < end)
+		{
+		}
+	}
+
+	uint64_t commandCount = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		commandCount += static_cast<NullRHICommandList*>(lists[i])->GetCommands().size();
+	}
+
+	std::lock_guard<std::mutex> lockGuard(mFenceMutex);
+
+	mStats.Submissions++;
+	mStats.CommandListsExecuted += count;
+	mStats.CommandsExecuted += commandCount;
+
+	mInFlightBatches.push_back({ fenceValue, std::move(mPendingWaits), false });
+	mPendingWaits.clear();
+	RetireBatches();
+}
+
+void NullRHICommandQueue::RetireBatches()
+{
+	while (mInFlightBatches.size() > mSimulatedLatency)
+	{
+		FInFlightBatch& batch = mInFlightBatches.front();
+		for (uint64_t waitValue : batch.Waits)
+		{
+			// Only reads the other queue's completed value, so no second lock is taken.
+			if (!GetWaitedQueue(waitValue)->IsFenceComplete(waitValue))
+			{
+				if (!batch.Held)
+				{
+					batch.Held = true;
+					mStats.HeldBatches++;
+				}
+				SignalCompletionEvents();
+				return;
+			}
+		}
+		mLastCompletedFenceValue = std::max(mLastCompletedFenceValue.load(), batch.FenceValue);
+		mInFlightBatches.pop_front();
+	}
+	SignalCompletionEvents();
+}
+
+bool NullRHICommandQueue::IsFenceComplete(uint64_t fenceValue)
+{
+	return fenceValue <= mLastCompletedFenceValue;
+}
+
+void NullRHICommandQueue::WaitForFenceCPUBlocking(uint64_t fenceValue)
+{
+	if (IsFenceComplete(fenceValue))
+	{
+		return;
+	}
+
+	// There is no GPU to wait for: the "wait" finishes the outstanding work on the spot, once the
+	// lists it waits for have been executed.
+	mSubmissions.FlushUntil(fenceValue);
+
+	// The batches up to the one that signals fenceValue start only after the work they wait on,
+	// so that work is finished first, on its own queue.
+	std::vector<uint64_t> waits;
+	{
+		std::lock_guard<std::mutex> lockGuard(mFenceMutex);
+		for (const FInFlightBatch& batch : mInFlightBatches)
+		{
+			waits.insert(waits.end(), batch.Waits.begin(), batch.Waits.end());
+			if (batch.FenceValue >= fenceValue)
+			{
+				break;
+			}
+		}
+	}
+	for (uint64_t waitValue : waits)
+	{
+		GetWaitedQueue(waitValue)->WaitForFenceCPUBlocking(waitValue);
+	}
+
+	std::lock_guard<std::mutex> lockGuard(mFenceMutex);
+	mStats.BlockingWaits++;
+	if (fenceValue > mLastCompletedFenceValue)
+	{
+		mLastCompletedFenceValue = fenceValue;
+	}
+	while (!mInFlightBatches.empty() && mInFlightBatches.front().FenceValue <= fenceValue)
+	{
+		mInFlightBatches.pop_front();
+	}
+	SignalCompletionEvents();
+}
+
+FNullRHIQueueStats NullRHICommandQueue::GetStats()
+{
+	std::lock_guard<std::mutex> lockGuard(mFenceMutex);
+	return mStats;
+}
+
+NullRHIDevice::NullRHIDevice()
+	: mGraphicsQueue(std::make_unique<NullRHICommandQueue>(ERHICommandListType::Direct, this)),
+	mComputeQueue(std::make_unique<NullRHICommandQueue>(ERHICommandListType::Compute, this)),
+	mCopyQueue(std::make_unique<NullRHICommandQueue>(ERHICommandListType::Copy, this)),
+	mNextGpuVirtualAddress(NullResourceAlignment),
+	mNextDescriptorHandle(NullRHIDescriptorHeap::DescriptorSize),
+	mViewsCreated(0),
+	mDescriptorsCopied(0),
+	mSamplersCreated(0),
+	mPipelinesCreated(0),
+	mPipelineCompileMicroseconds(0)
+{
+}
+
+NullRHIDevice::~NullRHIDevice()
+{
+}
+
+std::unique_ptr<RHIResource> NullRHIDevice::CreateBuffer(const FRHIBufferDesc& desc)
+{
+	if (desc.SizeInBytes == 0)
+	{
+		throw std::runtime_error("NullRHIDevice::CreateBuffer: zero sized buffer");
+	}
+
+	const uint64_t gpuVirtualAddress = mNextGpuVirtualAddress.fetch_add(AlignUp(desc.SizeInBytes, NullResourceAlignment));
+	return std::make_unique<NullRHIResource>(desc, gpuVirtualAddress);
+}
+
+std::unique_ptr<RHIDescriptorHeap> NullRHIDevice::CreateDescriptorHeap(ERHIDescriptorHeapType type, uint32_t numDescriptors, bool isShaderVisible)
+{
+	const uint64_t handleBase = mNextDescriptorHandle.fetch_add(static_cast<uint64_t>(numDescriptors + 1) * NullRHIDescriptorHeap::DescriptorSize);
+	return std::make_unique<NullRHIDescriptorHeap>(type, numDescriptors, isShaderVisible, handleBase);
+}
+
+std::unique_ptr<RHICommandAllocator> NullRHIDevice::CreateCommandAllocator(ERHICommandListType type)
+{
+	return std::make_unique<NullRHICommandAllocator>(type);
+}
+
+std::unique_ptr<RHICommandList> NullRHIDevice::CreateCommandList(ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState)
+{
+	return std::make_unique<NullRHICommandList>(type, allocator, initialState);
+}
+
+std::unique_ptr<RHIPipelineState> NullRHIDevice::CreateGraphicsPipelineState(const FRHIGraphicsPipelineDesc& desc)
+{
+	if (desc.VS.pShaderBytecode == nullptr || desc.VS.BytecodeLength == 0)
+	{
+		throw std::runtime_error("NullRHIDevice::CreateGraphicsPipelineState: no vertex shader");
+	}
+
+	const uint32_t compileMicroseconds = mPipelineCompileMicroseconds.load();
+	if (compileMicroseconds > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(compileMicroseconds));
+	}
+	mPipelinesCreated++;
+	return std::make_unique<NullRHIPipelineState>();
+}
+
+std::unique_ptr<RHIPipelineLibrary> NullRHIDevice::CreatePipelineLibrary(const void* blob, size_t size)
+{
+	return std::make_unique<NullRHIPipelineLibrary>(blob, size);
+}
+
+void NullRHIDevice::CreateConstantBufferView(uint64_t bufferLocation, uint32_t sizeInBytes, FRHICpuDescriptor destDescriptor)
+{
+	(void)bufferLocation;
+	(void)sizeInBytes;
+	(void)destDescriptor;
+	mViewsCreated++;
+}
+
+void NullRHIDevice::CreateSampler(const FRHISamplerDesc& desc, FRHICpuDescriptor destDescriptor)
+{
+	(void)desc;
+	(void)destDescriptor;
+	mSamplersCreated++;
+}
+
+void NullRHIDevice::CopyDescriptors(uint32_t numDescriptors, const FRHICpuDescriptor* sources, FRHICpuDescriptor destStart, ERHIDescriptorHeapType type)
+{
+	(void)sources;
+	(void)destStart;
+	(void)type;
+	mDescriptorsCopied += numDescriptors;
+}
+
+RHICommandQueue* NullRHIDevice::GetQueue(ERHICommandListType type)
+{
+	return GetNullQueue(type);
+}
+
+NullRHICommandQueue* NullRHIDevice::GetNullQueue(ERHICommandListType type)
+{
+	switch (type)
+	{
+	case ERHICommandListType::Direct:
+		return mGraphicsQueue.get();
+	case ERHICommandListType::Compute:
+		return mComputeQueue.get();
+	case ERHICommandListType::Copy:
+		return mCopyQueue.get();
+	default:
+		throw std::runtime_error("Bad command type lookup in NullRHIDevice.");
+	}
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../RHIDevice.h"
+#include "../RHISubmissionBatcher.h"
+
+// Null RHI backend.
+// Nothing reaches a GPU: command lists record into a flat array, upload buffers are plain
+// CPU memory and queue fences retire on the CPU. This lets the frame loop (constant updates,
+// command recording, submission) run and be profiled headless, without a window or a driver.
+
+enum class ENullRHICommand : uint8_t
+{
+	SetPipelineState,
+	SetGraphicsRootSignature,
+	SetDescriptorHeaps,
+	IASetPrimitiveTopology,
+	IASetIndexBuffer,
+	IASetVertexBuffers,
+	SetGraphicsRoot32BitConstants,
+	SetGraphicsRootDescriptorTable,
+	SetGraphicsRootConstantBufferView,
+	SetGraphicsRootShaderResourceView,
+	RSSetViewports,
+	RSSetScissorRects,
+	OMSetRenderTargets,
+	ClearRenderTargetView,
+	ClearDepthStencilView,
+	TransitionResource,
+	ResourceBarrier,
+	DrawIndexedInstanced,
+	ExecuteBundle,
+	Dispatch,
+	BeginEvent,
+	EndEvent,
+	Count
+};
+
+struct FNullRHICommand
+{
+	ENullRHICommand Op;
+	uint32_t Arg0;
+	uint32_t Arg1;
+	uint32_t Arg2;
+	uint64_t Payload;
+};
+
+class NullRHIResource : public RHIResource
+{
+public:
+	NullRHIResource(const FRHIBufferDesc& desc, uint64_t gpuVirtualAddress);
+
+	void* Map() override { return mCpuData.get(); }
+	void Unmap() override {}
+	uint64_t GetGpuVirtualAddress() const override { return mGpuVirtualAddress; }
+	uint64_t GetSizeInBytes() const override { return mSizeInBytes; }
+
+	ERHIResourceState GetUsageState() const override { return mUsageState; }
+	void SetUsageState(ERHIResourceState state) override { mUsageState = state; }
+
+	ERHIResourceState GetInitialState() const { return mInitialState; }
+
+private:
+	// Only CPU-visible heaps get backing memory; default-heap buffers are address ranges only.
+	std::unique_ptr<uint8_t[]> mCpuData;
+	uint64_t mGpuVirtualAddress;
+	uint64_t mSizeInBytes;
+	ERHIResourceState mInitialState;
+	ERHIResourceState mUsageState;
+};
+
+class NullRHIPipelineState : public RHIPipelineState {};
+class NullRHIRootSignature : public RHIRootSignature
+{
+public:
+	explicit NullRHIRootSignature(uint64_t hash = 0) : RHIRootSignature(hash) {}
+};
+
+// Keeps pipeline names only: loading a stored name gives a new NullRHIPipelineState, whatever the
+// desc. A blob that does not parse gives an empty library, as a driver mismatch does on D3D12.
+class NullRHIPipelineLibrary : public RHIPipelineLibrary
+{
+public:
+	NullRHIPipelineLibrary(const void* blob, size_t size);
+
+	std::unique_ptr<RHIPipelineState> LoadGraphicsPipeline(const wchar_t* name, const FRHIGraphicsPipelineDesc& desc) override;
+	bool StorePipeline(const wchar_t* name, RHIPipelineState* pipelineState) override;
+	std::vector<uint8_t> Serialize() const override;
+
+private:
+	std::set<std::wstring> mNames;
+};
+
+class NullRHIDescriptorHeap : public RHIDescriptorHeap
+{
+public:
+	static const uint32_t DescriptorSize = 32;
+
+	NullRHIDescriptorHeap(ERHIDescriptorHeapType type, uint32_t numDescriptors, bool isShaderVisible, uint64_t handleBase);
+
+	FRHICpuDescriptor GetCpuHandle(uint32_t index) const override;
+	FRHIGpuDescriptor GetGpuHandle(uint32_t index) const override;
+	uint32_t GetDescriptorSize() const override { return DescriptorSize; }
+
+private:
+	uint64_t mHandleBase;
+};
+
+class NullRHICommandAllocator : public RHICommandAllocator
+{
+public:
+	explicit NullRHICommandAllocator(ERHICommandListType type) : RHICommandAllocator(type), mResetCount(0) {}
+
+	void Reset() override { ++mResetCount; }
+	uint64_t GetResetCount() const { return mResetCount; }
+
+private:
+	uint64_t mResetCount;
+};
+
+class NullRHICommandList : public RHICommandList
+{
+public:
+	NullRHICommandList(ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState);
+
+	void Reset(RHICommandAllocator* allocator, RHIPipelineState* initialState) override;
+	void Close() override;
+
+	void SetPipelineState(RHIPipelineState* pipelineState) override;
+	void SetGraphicsRootSignature(RHIRootSignature* rootSignature) override;
+	void SetDescriptorHeaps(uint32_t numHeaps, RHIDescriptorHeap* const* heaps) override;
+
+	void IASetPrimitiveTopology(ERHIPrimitiveTopology topology) override;
+	void IASetIndexBuffer(const FRHIIndexBufferView* view) override;
+	void IASetVertexBuffers(uint32_t startSlot, uint32_t numViews, const FRHIVertexBufferView* views) override;
+
+	void SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues) override;
+	void SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, FRHIGpuDescriptor baseDescriptor) override;
+	void SetGraphicsRootConstantBufferView(uint32_t rootParameterIndex, uint64_t bufferLocation) override;
+	void SetGraphicsRootShaderResourceView(uint32_t rootParameterIndex, uint64_t bufferLocation) override;
+
+	void RSSetViewports(uint32_t numViewports, const FRHIViewport* viewports) override;
+	void RSSetScissorRects(uint32_t numRects, const FRHIRect* rects) override;
+	void OMSetRenderTargets(uint32_t numRenderTargets, const FRHICpuDescriptor* renderTargets, const FRHICpuDescriptor* depthStencil) override;
+	void ClearRenderTargetView(FRHICpuDescriptor renderTarget, const float color[4]) override;
+	void ClearDepthStencilView(FRHICpuDescriptor depthStencil, float depth, uint8_t stencil) override;
+
+	void TransitionResource(RHIResource* resource, ERHIResourceState before, ERHIResourceState after) override;
+	void ResourceBarrier(uint32_t numBarriers, const FRHIResourceBarrier* barriers) override;
+
+	void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) override;
+	void ExecuteBundle(RHICommandList* bundle) override;
+	void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) override;
+
+	void BeginEvent(const wchar_t* name) override;
+	void EndEvent() override;
+
+	bool IsClosed() const { return mIsClosed; }
+	const std::vector<FNullRHICommand>& GetCommands() const { return mCommands; }
+	const std::vector<uint32_t>& GetRootConstants() const { return mRootConstants; }
+	uint32_t GetCommandCount(ENullRHICommand op) const { return mCommandCounts[static_cast<size_t>(op)]; }
+	// Barriers recorded by ResourceBarrier calls since the last Reset().
+	uint32_t GetBarrierCount() const { return mBarrierCount; }
+
+private:
+	void Record(ENullRHICommand op, uint32_t arg0 = 0, uint32_t arg1 = 0, uint32_t arg2 = 0, uint64_t payload = 0);
+
+	std::vector<FNullRHICommand> mCommands;
+	std::vector<uint32_t> mRootConstants;
+	uint32_t mCommandCounts[static_cast<size_t>(ENullRHICommand::Count)];
+	uint32_t mBarrierCount;
+	bool mIsClosed;
+};
+
+struct FNullRHIQueueStats
+{
+	uint64_t Submissions = 0;           // Batches executed: one per ExecuteCommandLists call or Flush(), at most.
+	uint64_t CommandListsExecuted = 0;
+	uint64_t CommandsExecuted = 0;
+	uint64_t BlockingWaits = 0;
+	uint64_t QueueWaits = 0;            // InsertWait() calls on another queue's fence value.
+	uint64_t HeldBatches = 0;           // Batches that were due to retire but waited on another queue.
+};
+
+class NullRHIFenceEvent : public RHIFenceEvent
+{
+public:
+	NullRHIFenceEvent() : mIsSet(false) {}
+
+	void Signal() override;
+	void Wait() override;
+
+private:
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mIsSet;
+};
+
+class NullRHIDevice;
+
+// The simulated GPU honors InsertWait(): a batch retires only once the fence values it waits on
+// have been reached on their queues, holding back the batches after it, and a blocking wait first
+// finishes the work on the other queues that the work it waits for depends on. Waiting on a value
+// not submitted yet throws, as it would hang a real GPU.
+class NullRHICommandQueue : public RHICommandQueue
+{
+public:
+	// device resolves the queues that the fence values given to InsertWait() belong to; a queue
+	// without one can only wait on itself.
+	explicit NullRHICommandQueue(ERHICommandListType type, NullRHIDevice* device = nullptr);
+
+	uint64_t ExecuteCommandLists(uint32_t count, RHICommandList* const* lists) override;
+	uint64_t SubmitCommandLists(uint32_t count, RHICommandList* const* lists) override;
+	void Flush() override { mSubmissions.Flush(); }
+	void InsertWait(uint64_t fenceValue) override;
+	// Events are set on whichever thread retires the value: the one executing a batch or waiting.
+	void SetEventOnCompletion(uint64_t fenceValue, RHIFenceEvent* event) override;
+
+	bool IsFenceComplete(uint64_t fenceValue) override;
+	void WaitForFenceCPUBlocking(uint64_t fenceValue) override;
+	uint64_t GetLastCompletedFence() override { return mLastCompletedFenceValue.load(); }
+	uint64_t GetNextFenceValue() override { return mSubmissions.GetNextFenceValue(); }
+
+	// Number of batches the simulated GPU lags behind the CPU. 0 retires every batch
+	// immediately; N keeps the last N batches in flight until a wait forces them.
+	void SetSimulatedLatency(uint32_t submissions) { mSimulatedLatency = submissions; }
+	// How long executing and signaling a batch spins, standing in for the driver's cost of an
+	// ExecuteCommandLists and a Signal.
+	void SetSimulatedExecuteTime(uint32_t microseconds) { mExecuteMicroseconds = microseconds; }
+
+	FNullRHIQueueStats GetStats();
+
+private:
+	void CloseCommandLists(uint32_t count, RHICommandList* const* lists);
+	void ExecuteBatch(uint32_t count, void* const* lists, uint64_t fenceValue);
+	// With mFenceMutex held: retires the batches older than the latency window, in order, up to the
+	// first one still waiting on another queue.
+	void RetireBatches();
+	// With mFenceMutex held: sets and drops the armed events whose value has been reached.
+	void SignalCompletionEvents();
+	NullRHICommandQueue* GetWaitedQueue(uint64_t fenceValue);
+
+	struct FInFlightBatch
+	{
+		uint64_t FenceValue;            // Signaled by the batch.
+		std::vector<uint64_t> Waits;    // Fence values of other queues it starts after.
+		bool Held;
+	};
+
+	NullRHIDevice* mDevice;
+	// The stats and the batches in flight: taken by the flushing thread, by blocking waits and by
+	// InsertWait(). Never held while another queue's is taken.
+	std::mutex mFenceMutex;
+	std::atomic<uint64_t> mLastCompletedFenceValue;
+	std::deque<FInFlightBatch> mInFlightBatches;   // Oldest first.
+	std::vector<uint64_t> mPendingWaits;            // Inserted since the last batch; the next one takes them.
+	std::vector<std::pair<uint64_t, RHIFenceEvent*>> mCompletionEvents;    // Armed, not reached yet.
+	uint32_t mSimulatedLatency;
+	std::atomic<uint32_t> mExecuteMicroseconds;
+	FNullRHIQueueStats mStats;
+	RHISubmissionBatcher mSubmissions;
+};
+
+class NullRHIDevice : public RHIDevice
+{
+public:
+	NullRHIDevice();
+	~NullRHIDevice() override;
+
+	std::unique_ptr<RHIResource> CreateBuffer(const FRHIBufferDesc& desc) override;
+	std::unique_ptr<RHIDescriptorHeap> CreateDescriptorHeap(ERHIDescriptorHeapType type, uint32_t numDescriptors, bool isShaderVisible) override;
+	std::unique_ptr<RHICommandAllocator> CreateCommandAllocator(ERHICommandListType type) override;
+	std::unique_ptr<RHICommandList> CreateCommandList(ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState) override;
+
+	std::unique_ptr<RHIPipelineState> CreateGraphicsPipelineState(const FRHIGraphicsPipelineDesc& desc) override;
+	std::unique_ptr<RHIPipelineLibrary> CreatePipelineLibrary(const void* blob, size_t size) override;
+
+	void CreateConstantBufferView(uint64_t bufferLocation, uint32_t sizeInBytes, FRHICpuDescriptor destDescriptor) override;
+	void CreateSampler(const FRHISamplerDesc& desc, FRHICpuDescriptor destDescriptor) override;
+	void CopyDescriptors(uint32_t numDescriptors, const FRHICpuDescriptor* sources, FRHICpuDescriptor destStart, ERHIDescriptorHeapType type) override;
+
+	RHICommandQueue* GetQueue(ERHICommandListType type) override;
+	NullRHICommandQueue* GetNullQueue(ERHICommandListType type);
+	std::unique_ptr<RHIFenceEvent> CreateFenceEvent() override { return std::make_unique<NullRHIFenceEvent>(); }
+
+	std::unique_ptr<RHIPipelineState> CreatePipelineState() { return std::make_unique<NullRHIPipelineState>(); }
+	std::unique_ptr<RHIRootSignature> CreateRootSignature(uint64_t hash = 0) { return std::make_unique<NullRHIRootSignature>(hash); }
+
+	// How long CreateGraphicsPipelineState() sleeps, standing in for the driver's shader compile.
+	void SetSimulatedPipelineCompileTime(uint32_t microseconds) { mPipelineCompileMicroseconds = microseconds; }
+	uint64_t GetPipelinesCreated() const { return mPipelinesCreated.load(); }
+
+	uint64_t GetViewsCreated() const { return mViewsCreated.load(); }
+	uint64_t GetDescriptorsCopied() const { return mDescriptorsCopied.load(); }
+	uint64_t GetSamplersCreated() const { return mSamplersCreated.load(); }
+
+private:
+	std::unique_ptr<NullRHICommandQueue> mGraphicsQueue;
+	std::unique_ptr<NullRHICommandQueue> mComputeQueue;
+	std::unique_ptr<NullRHICommandQueue> mCopyQueue;
+
+	std::atomic<uint64_t> mNextGpuVirtualAddress;
+	std::atomic<uint64_t> mNextDescriptorHandle;
+	std::atomic<uint64_t> mViewsCreated;
+	std::atomic<uint64_t> mDescriptorsCopied;
+	std::atomic<uint64_t> mSamplersCreated;
+	std::atomic<uint64_t> mPipelinesCreated;
+	std::atomic<uint32_t> mPipelineCompileMicroseconds;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "RHIDefinitions.h"
+
+class RHIResource;
+class RHIDescriptorHeap;
+class RHIPipelineState;
+class RHIRootSignature;
+
+// Same values as D3D12_RESOURCE_BARRIER_TYPE.
+enum class ERHIBarrierType : uint8_t
+{
+	Transition = 0,
+	Aliasing = 1,
+	UnorderedAccess = 2,
+};
+
+// Same values as D3D12_RESOURCE_BARRIER_FLAGS. A split transition is recorded twice: BeginOnly where
+// the resource's last use before it ends, EndOnly just before its next use, so the GPU can do the
+// transition in between. The two halves carry the same states.
+enum class ERHIBarrierFlags : uint8_t
+{
+	None = 0,
+	BeginOnly = 1,
+	EndOnly = 2,
+};
+
+// One entry of RHICommandList::ResourceBarrier, like D3D12_RESOURCE_BARRIER.
+// Transition: Resource goes from StateBefore to StateAfter.
+// Aliasing: Resource takes over memory that ResourceBefore (null: any resource) was using.
+// UnorderedAccess: UAV accesses to Resource (null: to any resource) finish before later ones start.
+struct FRHIResourceBarrier
+{
+	ERHIBarrierType Type = ERHIBarrierType::Transition;
+	RHIResource* Resource = nullptr;
+	RHIResource* ResourceBefore = nullptr;
+	ERHIResourceState StateBefore = RHI_STATE_COMMON;
+	ERHIResourceState StateAfter = RHI_STATE_COMMON;
+	ERHIBarrierFlags Flags = ERHIBarrierFlags::None;
+
+	static FRHIResourceBarrier Transition(RHIResource* resource, ERHIResourceState before, ERHIResourceState after, ERHIBarrierFlags flags = ERHIBarrierFlags::None)
+	{
+		FRHIResourceBarrier barrier;
+		barrier.Resource = resource;
+		barrier.StateBefore = before;
+		barrier.StateAfter = after;
+		barrier.Flags = flags;
+		return barrier;
+	}
+
+	static FRHIResourceBarrier Aliasing(RHIResource* resourceBefore, RHIResource* resourceAfter)
+	{
+		FRHIResourceBarrier barrier;
+		barrier.Type = ERHIBarrierType::Aliasing;
+		barrier.Resource = resourceAfter;
+		barrier.ResourceBefore = resourceBefore;
+		return barrier;
+	}
+
+	static FRHIResourceBarrier UnorderedAccess(RHIResource* resource)
+	{
+		FRHIResourceBarrier barrier;
+		barrier.Type = ERHIBarrierType::UnorderedAccess;
+		barrier.Resource = resource;
+		return barrier;
+	}
+};
+
+// Backing memory for command lists. Can only be reset once the GPU has finished
+// with every list recorded from it.
+class RHICommandAllocator
+{
+public:
+	explicit RHICommandAllocator(ERHICommandListType type) : mType(type) {}
+	virtual ~RHICommandAllocator() {}
+
+	ERHICommandListType GetType() const { return mType; }
+	virtual void Reset() = 0;
+
+private:
+	ERHICommandListType mType;
+};
+
+// Subset of ID3D12GraphicsCommandList used by the frame loop.
+// Lists are created open; queues close them on submission (see Direct3DQueue::ExecuteCommandLists),
+// bundles must be closed explicitly.
+class RHICommandList
+{
+public:
+	explicit RHICommandList(ERHICommandListType type) : mType(type) {}
+	virtual ~RHICommandList() {}
+
+	ERHICommandListType GetType() const { return mType; }
+
+	virtual void Reset(RHICommandAllocator* allocator, RHIPipelineState* initialState) = 0;
+	virtual void Close() = 0;
+
+	virtual void SetPipelineState(RHIPipelineState* pipelineState) = 0;
+	virtual void SetGraphicsRootSignature(RHIRootSignature* rootSignature) = 0;
+	virtual void SetDescriptorHeaps(uint32_t numHeaps, RHIDescriptorHeap* const* heaps) = 0;
+
+	virtual void IASetPrimitiveTopology(ERHIPrimitiveTopology topology) = 0;
+	virtual void IASetIndexBuffer(const FRHIIndexBufferView* view) = 0;
+	virtual void IASetVertexBuffers(uint32_t startSlot, uint32_t numViews, const FRHIVertexBufferView* views) = 0;
+
+	virtual void SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues) = 0;
+	virtual void SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, FRHIGpuDescriptor baseDescriptor) = 0;
+	virtual void SetGraphicsRootConstantBufferView(uint32_t rootParameterIndex, uint64_t bufferLocation) = 0;
+	virtual void SetGraphicsRootShaderResourceView(uint32_t rootParameterIndex, uint64_t bufferLocation) = 0;
+
+	virtual void RSSetViewports(uint32_t numViewports, const FRHIViewport* viewports) = 0;
+	virtual void RSSetScissorRects(uint32_t numRects, const FRHIRect* rects) = 0;
+	virtual void OMSetRenderTargets(uint32_t numRenderTargets, const FRHICpuDescriptor* renderTargets, const FRHICpuDescriptor* depthStencil) = 0;
+	virtual void ClearRenderTargetView(FRHICpuDescriptor renderTarget, const float color[4]) = 0;
+	virtual void ClearDepthStencilView(FRHICpuDescriptor depthStencil, float depth, uint8_t stencil) = 0;
+
+	virtual void TransitionResource(RHIResource* resource, ERHIResourceState before, ERHIResourceState after) = 0;
+	// All of barriers in one call, which lets the driver resolve them together.
+	virtual void ResourceBarrier(uint32_t numBarriers, const FRHIResourceBarrier* barriers) = 0;
+
+	virtual void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) = 0;
+	virtual void ExecuteBundle(RHICommandList* bundle) = 0;
+	// Not on copy lists.
+	virtual void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) = 0;
+
+	// Debug markers (PIX on D3D12).
+	virtual void BeginEvent(const wchar_t* name) = 0;
+	virtual void EndEvent() = 0;
+
+private:
+	ERHICommandListType mType;
+};
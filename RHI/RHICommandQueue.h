@@ -0,0 +1,63 @@
+#pragma once
+
+#include "RHIDefinitions.h"
+
+class RHICommandList;
+
+// An auto-reset event that queues set when their fence reaches a value: a Win32 event given to
+// ID3D12Fence::SetEventOnCompletion on D3D12. One event may be armed on the fences of several
+// queues at once, so a single thread can sleep until whichever of them completes first.
+class RHIFenceEvent
+{
+public:
+	virtual ~RHIFenceEvent() {}
+
+	// Sets the event from the CPU, e.g. to wake the thread waiting on it for other reasons.
+	virtual void Signal() = 0;
+	// Blocks until the event is set, then resets it.
+	virtual void Wait() = 0;
+};
+
+// Mirrors the Direct3DQueue contract: every submission returns the fence value that marks its
+// completion. Any thread may submit without taking a lock; lists run in the order they took their
+// fence values, and each batch of them is executed and signaled once (see RHISubmissionBatcher).
+//
+// A fence value names the queue it belongs to (RHIGetFenceQueueType), so it also serves as a token
+// for work on the compute or copy queue that another queue's work depends on: InsertWait() makes
+// the queue hold back its later lists on the GPU until that work is done, without the CPU waiting.
+class RHICommandQueue
+{
+public:
+	explicit RHICommandQueue(ERHICommandListType type) : mType(type) {}
+	virtual ~RHICommandQueue() {}
+
+	ERHICommandListType GetType() const { return mType; }
+
+	// Closes the lists and executes them after everything submitted before. They have been handed to
+	// the GPU on return, so they may be reset right away.
+	virtual uint64_t ExecuteCommandLists(uint32_t count, RHICommandList* const* lists) = 0;
+	// Closes the lists and queues them for the next Flush(), so that lists submitted from many threads
+	// reach the GPU in one batch. They must not be reset until it has returned. Waiting on the fence
+	// value flushes too.
+	virtual uint64_t SubmitCommandLists(uint32_t count, RHICommandList* const* lists) = 0;
+	virtual void Flush() = 0;
+
+	// Lists submitted after this call do not start on the GPU until fenceValue, of whichever queue
+	// it names, has been reached. The value must have been submitted already; a value of this queue
+	// needs no wait, as its lists run in order anyway.
+	virtual void InsertWait(uint64_t fenceValue) = 0;
+
+	// Sets event once the fence reaches fenceValue, right away if it has; the lists up to it are
+	// flushed first. The value must have been submitted, and event must outlive the arming.
+	virtual void SetEventOnCompletion(uint64_t fenceValue, RHIFenceEvent* event) = 0;
+
+	virtual bool IsFenceComplete(uint64_t fenceValue) = 0;
+	virtual void WaitForFenceCPUBlocking(uint64_t fenceValue) = 0;
+	virtual uint64_t GetLastCompletedFence() = 0;
+	virtual uint64_t GetNextFenceValue() = 0;
+
+	void WaitForIdle() { WaitForFenceCPUBlocking(GetNextFenceValue() - 1); }
+
+private:
+	ERHICommandListType mType;
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Platform-neutral types shared by every RHI backend.
+// Enum values and struct layouts intentionally mirror their D3D12 counterparts so the
+// DX12 backend can convert with a static_cast and the Null backend needs no Windows headers.
+
+enum class ERHICommandListType : uint8_t
+{
+	Direct = 0,		// D3D12_COMMAND_LIST_TYPE_DIRECT
+	Bundle = 1,		// D3D12_COMMAND_LIST_TYPE_BUNDLE
+	Compute = 2,	// D3D12_COMMAND_LIST_TYPE_COMPUTE
+	Copy = 3,		// D3D12_COMMAND_LIST_TYPE_COPY
+};
+
+enum class ERHIHeapType : uint8_t
+{
+	Default,
+	Upload,
+	Readback,
+};
+
+enum class ERHIDescriptorHeapType : uint8_t
+{
+	CbvSrvUav = 0,	// D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
+	Sampler = 1,	// D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER
+	Rtv = 2,		// D3D12_DESCRIPTOR_HEAP_TYPE_RTV
+	Dsv = 3,		// D3D12_DESCRIPTOR_HEAP_TYPE_DSV
+};
+
+enum class ERHIPrimitiveTopology : uint8_t
+{
+	TriangleList = 4,	// D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+	TriangleStrip = 5,	// D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP
+};
+
+enum class ERHIIndexFormat : uint32_t
+{
+	Uint32 = 42,	// DXGI_FORMAT_R32_UINT
+	Uint16 = 57,	// DXGI_FORMAT_R16_UINT
+};
+
+// Bit flags, same values as D3D12_RESOURCE_STATES.
+enum ERHIResourceState : uint32_t
+{
+	RHI_STATE_COMMON = 0,
+	RHI_STATE_VERTEX_AND_CONSTANT_BUFFER = 0x1,
+	RHI_STATE_INDEX_BUFFER = 0x2,
+	RHI_STATE_RENDER_TARGET = 0x4,
+	RHI_STATE_UNORDERED_ACCESS = 0x8,
+	RHI_STATE_DEPTH_WRITE = 0x10,
+	RHI_STATE_DEPTH_READ = 0x20,
+	RHI_STATE_NON_PIXEL_SHADER_RESOURCE = 0x40,
+	RHI_STATE_PIXEL_SHADER_RESOURCE = 0x80,
+	RHI_STATE_INDIRECT_ARGUMENT = 0x200,
+	RHI_STATE_COPY_DEST = 0x400,
+	RHI_STATE_COPY_SOURCE = 0x800,
+	RHI_STATE_GENERIC_READ = 0x1 | 0x2 | 0x40 | 0x80 | 0x200 | 0x800,
+	RHI_STATE_PRESENT = 0,
+};
+
+// States a resource can be in for several readers at once; combinations of them are read-only too.
+inline bool RHIIsReadOnlyState(uint32_t state)
+{
+	const uint32_t ReadOnlyStates = RHI_STATE_VERTEX_AND_CONSTANT_BUFFER | RHI_STATE_INDEX_BUFFER | RHI_STATE_DEPTH_READ |
+		RHI_STATE_NON_PIXEL_SHADER_RESOURCE | RHI_STATE_PIXEL_SHADER_RESOURCE | RHI_STATE_INDIRECT_ARGUMENT | RHI_STATE_COPY_SOURCE;
+	return state != 0 && (state & ~ReadOnlyStates) == 0;
+}
+
+// Same layout as D3D12_CPU_DESCRIPTOR_HANDLE / D3D12_GPU_DESCRIPTOR_HANDLE on x64.
+struct FRHICpuDescriptor
+{
+	uint64_t ptr = 0;
+};
+
+struct FRHIGpuDescriptor
+{
+	uint64_t ptr = 0;
+};
+
+// Same layout as D3D12_VERTEX_BUFFER_VIEW.
+struct FRHIVertexBufferView
+{
+	uint64_t BufferLocation = 0;
+	uint32_t SizeInBytes = 0;
+	uint32_t StrideInBytes = 0;
+};
+
+// Same layout as D3D12_INDEX_BUFFER_VIEW.
+struct FRHIIndexBufferView
+{
+	uint64_t BufferLocation = 0;
+	uint32_t SizeInBytes = 0;
+	ERHIIndexFormat Format = ERHIIndexFormat::Uint32;
+};
+
+// Same layout as D3D12_VIEWPORT.
+struct FRHIViewport
+{
+	float TopLeftX = 0.0f;
+	float TopLeftY = 0.0f;
+	float Width = 0.0f;
+	float Height = 0.0f;
+	float MinDepth = 0.0f;
+	float MaxDepth = 1.0f;
+};
+
+// Same layout as D3D12_RECT (LONG is 32 bit on Windows).
+struct FRHIRect
+{
+	int32_t left = 0;
+	int32_t top = 0;
+	int32_t right = 0;
+	int32_t bottom = 0;
+};
+
+// The formats the samples use; same values as DXGI_FORMAT.
+enum class ERHIFormat : uint32_t
+{
+	Unknown = 0,				// DXGI_FORMAT_UNKNOWN
+	R32G32B32A32Float = 2,		// DXGI_FORMAT_R32G32B32A32_FLOAT
+	R32G32B32Float = 6,			// DXGI_FORMAT_R32G32B32_FLOAT
+	R32G32Float = 16,			// DXGI_FORMAT_R32G32_FLOAT
+	R8G8B8A8Unorm = 28,			// DXGI_FORMAT_R8G8B8A8_UNORM
+	D32Float = 40,				// DXGI_FORMAT_D32_FLOAT
+	R32Float = 41,				// DXGI_FORMAT_R32_FLOAT
+};
+
+enum class ERHIInputClassification : uint32_t
+{
+	PerVertex = 0,		// D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA
+	PerInstance = 1,	// D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA
+};
+
+// Same layout as D3D12_INPUT_ELEMENT_DESC.
+struct FRHIInputElement
+{
+	const char* SemanticName = nullptr;
+	uint32_t SemanticIndex = 0;
+	ERHIFormat Format = ERHIFormat::Unknown;
+	uint32_t InputSlot = 0;
+	uint32_t AlignedByteOffset = 0;
+	ERHIInputClassification InputSlotClass = ERHIInputClassification::PerVertex;
+	uint32_t InstanceDataStepRate = 0;
+};
+
+// Same layout as D3D12_SHADER_BYTECODE.
+struct FRHIShaderBytecode
+{
+	const void* pShaderBytecode = nullptr;
+	size_t BytecodeLength = 0;
+};
+
+enum class ERHICullMode : uint32_t
+{
+	None = 1,	// D3D12_CULL_MODE_NONE
+	Front = 2,	// D3D12_CULL_MODE_FRONT
+	Back = 3,	// D3D12_CULL_MODE_BACK
+};
+
+enum class ERHIPrimitiveTopologyType : uint32_t
+{
+	Point = 1,		// D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT
+	Line = 2,		// D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE
+	Triangle = 3,	// D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE
+};
+
+// The filters the samples use; same values as D3D12_FILTER.
+enum class ERHIFilter : uint32_t
+{
+	MinMagMipPoint = 0,						// D3D12_FILTER_MIN_MAG_MIP_POINT
+	MinMagLinearMipPoint = 0x14,			// D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT
+	MinMagMipLinear = 0x15,					// D3D12_FILTER_MIN_MAG_MIP_LINEAR
+	Anisotropic = 0x55,						// D3D12_FILTER_ANISOTROPIC
+	ComparisonMinMagMipLinear = 0x95,		// D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR
+};
+
+enum class ERHITextureAddressMode : uint32_t
+{
+	Wrap = 1,		// D3D12_TEXTURE_ADDRESS_MODE_WRAP
+	Mirror = 2,		// D3D12_TEXTURE_ADDRESS_MODE_MIRROR
+	Clamp = 3,		// D3D12_TEXTURE_ADDRESS_MODE_CLAMP
+	Border = 4,		// D3D12_TEXTURE_ADDRESS_MODE_BORDER
+	MirrorOnce = 5,	// D3D12_TEXTURE_ADDRESS_MODE_MIRROR_ONCE
+};
+
+enum class ERHIComparisonFunc : uint32_t
+{
+	Never = 1,			// D3D12_COMPARISON_FUNC_NEVER
+	Less = 2,			// D3D12_COMPARISON_FUNC_LESS
+	Equal = 3,			// D3D12_COMPARISON_FUNC_EQUAL
+	LessEqual = 4,		// D3D12_COMPARISON_FUNC_LESS_EQUAL
+	Greater = 5,		// D3D12_COMPARISON_FUNC_GREATER
+	NotEqual = 6,		// D3D12_COMPARISON_FUNC_NOT_EQUAL
+	GreaterEqual = 7,	// D3D12_COMPARISON_FUNC_GREATER_EQUAL
+	Always = 8,			// D3D12_COMPARISON_FUNC_ALWAYS
+};
+
+// Same layout as D3D12_SAMPLER_DESC. The defaults are the trilinear wrap sampler the samples use.
+struct FRHISamplerDesc
+{
+	ERHIFilter Filter = ERHIFilter::MinMagMipLinear;
+	ERHITextureAddressMode AddressU = ERHITextureAddressMode::Wrap;
+	ERHITextureAddressMode AddressV = ERHITextureAddressMode::Wrap;
+	ERHITextureAddressMode AddressW = ERHITextureAddressMode::Wrap;
+	float MipLODBias = 0.0f;
+	uint32_t MaxAnisotropy = 1;
+	ERHIComparisonFunc ComparisonFunc = ERHIComparisonFunc::Always;
+	float BorderColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float MinLOD = 0.0f;
+	float MaxLOD = 3.402823466e+38f;	// D3D12_FLOAT32_MAX
+};
+
+struct FRHIBufferDesc
+{
+	uint64_t SizeInBytes = 0;
+	ERHIHeapType HeapType = ERHIHeapType::Default;
+	ERHIResourceState InitialState = RHI_STATE_COMMON;
+	const wchar_t* DebugName = nullptr;
+};
+
+// Fence values carry the owning queue type in the top byte, matching Direct3DQueue.
+inline uint64_t RHIMakeInitialFenceValue(ERHICommandListType type)
+{
+	return static_cast<uint64_t>(type) << 56;
+}
+
+inline ERHICommandListType RHIGetFenceQueueType(uint64_t fenceValue)
+{
+	return static_cast<ERHICommandListType>(fenceValue >> 56);
+}
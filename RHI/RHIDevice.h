@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "RHIDefinitions.h"
+#include "RHIResource.h"
+#include "RHICommandList.h"
+#include "RHICommandQueue.h"
+
+// Opaque pipeline objects. Backends derive from these and keep the native object.
+class RHIPipelineState
+{
+public:
+	virtual ~RHIPipelineState() {}
+};
+
+class RHIRootSignature
+{
+public:
+	// hash identifies the root signature from run to run, e.g. a hash of its serialized form; it is
+	// what pipeline caches key pipelines on.
+	explicit RHIRootSignature(uint64_t hash = 0) : mHash(hash) {}
+	virtual ~RHIRootSignature() {}
+
+	uint64_t GetHash() const { return mHash; }
+
+private:
+	uint64_t mHash;
+};
+
+// What a graphics pipeline is created from: the parts of D3D12_GRAPHICS_PIPELINE_STATE_DESC the
+// samples vary. Blending, when on, is straight alpha on every render target; stencil is off.
+struct FRHIGraphicsPipelineDesc
+{
+	RHIRootSignature* RootSignature = nullptr;
+	FRHIShaderBytecode VS;
+	FRHIShaderBytecode PS;
+	const FRHIInputElement* InputElements = nullptr;
+	uint32_t NumInputElements = 0;
+	ERHICullMode CullMode = ERHICullMode::Back;
+	bool DepthEnable = true;
+	bool DepthWrite = true;
+	ERHIComparisonFunc DepthFunc = ERHIComparisonFunc::Less;
+	bool BlendEnable = false;
+	ERHIPrimitiveTopologyType PrimitiveTopologyType = ERHIPrimitiveTopologyType::Triangle;
+	uint32_t NumRenderTargets = 1;
+	ERHIFormat RenderTargetFormats[8] = { ERHIFormat::R8G8B8A8Unorm };
+	ERHIFormat DepthStencilFormat = ERHIFormat::D32Float;
+	uint32_t SampleCount = 1;
+};
+
+// Compiled pipelines stored by name, serialized to a blob that a later run passes back to
+// RHIDevice::CreatePipelineLibrary (ID3D12PipelineLibrary on D3D12). Not thread-safe.
+class RHIPipelineLibrary
+{
+public:
+	virtual ~RHIPipelineLibrary() {}
+
+	// The pipeline stored under name, or null when there is none or it was created from a
+	// different desc (the driver checks; the Null RHI only matches names).
+	virtual std::unique_ptr<RHIPipelineState> LoadGraphicsPipeline(const wchar_t* name, const FRHIGraphicsPipelineDesc& desc) = 0;
+	// False when name is taken or the library cannot store pipelines.
+	virtual bool StorePipeline(const wchar_t* name, RHIPipelineState* pipelineState) = 0;
+	// Everything loaded from the blob and stored since.
+	virtual std::vector<uint8_t> Serialize() const = 0;
+};
+
+class RHIDescriptorHeap
+{
+public:
+	RHIDescriptorHeap(ERHIDescriptorHeapType type, uint32_t numDescriptors, bool isShaderVisible)
+		: mType(type), mNumDescriptors(numDescriptors), mIsShaderVisible(isShaderVisible) {}
+	virtual ~RHIDescriptorHeap() {}
+
+	ERHIDescriptorHeapType GetType() const { return mType; }
+	uint32_t GetNumDescriptors() const { return mNumDescriptors; }
+	bool IsShaderVisible() const { return mIsShaderVisible; }
+
+	virtual FRHICpuDescriptor GetCpuHandle(uint32_t index) const = 0;
+	virtual FRHIGpuDescriptor GetGpuHandle(uint32_t index) const = 0;
+	virtual uint32_t GetDescriptorSize() const = 0;
+
+private:
+	ERHIDescriptorHeapType mType;
+	uint32_t mNumDescriptors;
+	bool mIsShaderVisible;
+};
+
+// Creation interface for everything the per-frame path needs. Load-time work
+// (textures, shaders, swap chain) still lives in the D3D12 sample code.
+class RHIDevice
+{
+public:
+	virtual ~RHIDevice() {}
+
+	virtual std::unique_ptr<RHIResource> CreateBuffer(const FRHIBufferDesc& desc) = 0;
+	virtual std::unique_ptr<RHIDescriptorHeap> CreateDescriptorHeap(ERHIDescriptorHeapType type, uint32_t numDescriptors, bool isShaderVisible) = 0;
+	virtual std::unique_ptr<RHICommandAllocator> CreateCommandAllocator(ERHICommandListType type) = 0;
+	virtual std::unique_ptr<RHICommandList> CreateCommandList(ERHICommandListType type, RHICommandAllocator* allocator, RHIPipelineState* initialState) = 0;
+
+	// May be called from any thread, as ID3D12Device's creation methods may: pipelines can be
+	// compiled on job system workers.
+	virtual std::unique_ptr<RHIPipelineState> CreateGraphicsPipelineState(const FRHIGraphicsPipelineDesc& desc) = 0;
+	// A library over a copy of blob, from an earlier RHIPipelineLibrary::Serialize(). An empty blob,
+	// or one another driver or adapter wrote, gives an empty library.
+	virtual std::unique_ptr<RHIPipelineLibrary> CreatePipelineLibrary(const void* blob, size_t size) = 0;
+
+	virtual void CreateConstantBufferView(uint64_t bufferLocation, uint32_t sizeInBytes, FRHICpuDescriptor destDescriptor) = 0;
+	virtual void CreateSampler(const FRHISamplerDesc& desc, FRHICpuDescriptor destDescriptor) = 0;
+	// Copies numDescriptors descriptors of one heap type, each from its own source slot, into
+	// consecutive slots starting at destStart: a descriptor table assembled in one call. Sources
+	// must be in CPU-only heaps; the copy happens on the CPU timeline, right away.
+	virtual void CopyDescriptors(uint32_t numDescriptors, const FRHICpuDescriptor* sources, FRHICpuDescriptor destStart, ERHIDescriptorHeapType type) = 0;
+
+	virtual RHICommandQueue* GetQueue(ERHICommandListType type) = 0;
+	// For RHICommandQueue::SetEventOnCompletion.
+	virtual std::unique_ptr<RHIFenceEvent> CreateFenceEvent() = 0;
+};
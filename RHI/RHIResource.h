@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include "RHIDefinitions.h"
+
 enum class ERHIResourceType
 {
 	RHI_NoneType,
@@ -17,6 +19,20 @@ public:
 	virtual ~RHIResource()
 	{
 	};
+
+	ERHIResourceType GetResourceType() const { return ResourceType; }
+
+	// Upload/readback buffers stay persistently mapped; Map() returns the CPU pointer.
+	virtual void* Map() = 0;
+	virtual void Unmap() = 0;
+	virtual uint64_t GetGpuVirtualAddress() const = 0;
+	virtual uint64_t GetSizeInBytes() const = 0;
+
+	// The state the resource is in once everything submitted so far has run. Command lists recorded
+	// with an RHIResourceStateTracker read and update it at submission; TransitionResource() updates
+	// it as it records, which is only right when lists are submitted in the order they are recorded.
+	virtual ERHIResourceState GetUsageState() const = 0;
+	virtual void SetUsageState(ERHIResourceState state) = 0;
 private:
 	ERHIResourceType ResourceType;
-};
\ No newline at end of file
+};
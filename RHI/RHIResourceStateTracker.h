@@ -0,0 +1,274 @@
+#pragma once
+
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "RHICommandList.h"
+#include "RHIResource.h"
+
+// Resource states as one command list sees them while it records. Callers say which state they need
+// a resource in and the tracker works out the barriers:
+//
+// - A resource stays in the state the list last put it in, so asking for that state again, or for
+//   read states its current read-only state already includes, records nothing.
+// - Barriers are queued and FlushBarriers() records them in a single ResourceBarrier call; flush right
+//   before the work that needs them. A queued transition that changes again before the flush is
+//   folded into one, and dropped if it ends where it started.
+// - BeginTransition() starts a split barrier. The GPU may do the transition anywhere between the flush
+//   that begins it and the one that ends it, which is queued by the next TransitionResource() of the
+//   resource; nothing may use the resource in between. A split must end in the list that began it.
+//
+// Lists may be recorded in any order, so what state a resource is in when the list starts is only
+// known when it is submitted. The first time the list uses a resource, the tracker only remembers the
+// state it needs there; ResolvePendingBarriers() compares that with the resource's usage state at
+// submission. A list recorded after everything submitted before it, such as the first list of a frame
+// recorded on the submitting thread, can instead start from the usage states (Reset(true)) and record
+// its first transitions in place.
+//
+// Not thread-safe: one tracker per list, and submissions resolved on one thread in submission order.
+class RHIResourceStateTracker
+{
+public:
+	RHIResourceStateTracker() :
+		mStartFromUsageStates(false),
+		mBatch(0)
+	{
+		ResetCounters();
+	}
+
+	// Forgets every resource; call it along with the command list's Reset().
+	void Reset(bool startFromUsageStates = false)
+	{
+		mEntries.clear();
+		mEntryIndices.clear();
+		mBarriers.clear();
+		mStartFromUsageStates = startFromUsageStates;
+		++mBatch;
+		ResetCounters();
+	}
+
+	void TransitionResource(RHIResource* resource, ERHIResourceState state)
+	{
+		++mRequestCount;
+		FEntry* entry = FindOrAdd(resource, state);
+		if (entry)
+		{
+			Transition(*entry, state);
+		}
+	}
+
+	// Starts moving resource to state; the next TransitionResource() of it ends the move. Recorded as
+	// a plain transition when the list does not know the resource's state yet or already has a
+	// transition of it queued.
+	void BeginTransition(RHIResource* resource, ERHIResourceState state)
+	{
+		++mRequestCount;
+		FEntry* entry = FindOrAdd(resource, state);
+		if (!entry)
+		{
+			return;
+		}
+		if (entry->Splitting)
+		{
+			EndSplit(*entry);
+		}
+		if (Covers(entry->State, state) || IsQueued(*entry))
+		{
+			Transition(*entry, state);
+			return;
+		}
+		mBarriers.push_back(FRHIResourceBarrier::Transition(resource, entry->State, state, ERHIBarrierFlags::BeginOnly));
+		entry->SplitState = state;
+		entry->Splitting = true;
+	}
+
+	// Orders UAV accesses to resource (null: any resource) before the following ones.
+	void UavBarrier(RHIResource* resource)
+	{
+		++mRequestCount;
+		mBarriers.push_back(FRHIResourceBarrier::UnorderedAccess(resource));
+		StopFolding(resource);
+	}
+
+	void AliasingBarrier(RHIResource* resourceBefore, RHIResource* resourceAfter)
+	{
+		++mRequestCount;
+		mBarriers.push_back(FRHIResourceBarrier::Aliasing(resourceBefore, resourceAfter));
+		StopFolding(resourceBefore);
+		StopFolding(resourceAfter);
+	}
+
+	// Records the queued barriers, if any, in one call.
+	void FlushBarriers(RHICommandList* commandList)
+	{
+		// Transitions folded away are left with no resource.
+		uint32_t count = 0;
+		for (const FRHIResourceBarrier& barrier : mBarriers)
+		{
+			if (barrier.Type != ERHIBarrierType::Transition || barrier.Resource)
+			{
+				mBarriers[count++] = barrier;
+			}
+		}
+		if (count > 0)
+		{
+			commandList->ResourceBarrier(count, mBarriers.data());
+			mBarrierCount += count;
+			++mFlushCount;
+		}
+		mBarriers.clear();
+		++mBatch;
+	}
+
+	// At submission, in submission order, once the list has been flushed: appends to barriers the
+	// transitions from each resource's usage state to the state the list first needs it in, then sets
+	// the usage states to where the list leaves them. Record the barriers at the end of the list
+	// submitted just before this one, or in a list of their own submitted before it. Throws, changing
+	// nothing, when the list leaves a split transition begun and not ended.
+	void ResolvePendingBarriers(std::vector<FRHIResourceBarrier>& barriers)
+	{
+		for (const FEntry& entry : mEntries)
+		{
+			if (entry.Splitting)
+			{
+				throw std::runtime_error("RHIResourceStateTracker: the list ends inside a split transition");
+			}
+		}
+		for (const FEntry& entry : mEntries)
+		{
+			if (entry.Pending)
+			{
+				const ERHIResourceState usageState = entry.Resource->GetUsageState();
+				if (usageState != entry.PendingState)
+				{
+					barriers.push_back(FRHIResourceBarrier::Transition(entry.Resource, usageState, entry.PendingState));
+				}
+			}
+			entry.Resource->SetUsageState(entry.State);
+		}
+	}
+
+	// Counters since Reset(). Requests are the calls above other than flushes; skipped ones were
+	// redundant or folded into a queued transition. First uses left to submission are neither.
+	uint32_t GetRequestCount() const { return mRequestCount; }
+	uint32_t GetSkippedCount() const { return mSkippedCount; }
+	uint32_t GetBarrierCount() const { return mBarrierCount; }
+	uint32_t GetFlushCount() const { return mFlushCount; }
+
+private:
+	struct FEntry
+	{
+		RHIResource* Resource;
+		ERHIResourceState State;         // Where the list has put it so far.
+		ERHIResourceState PendingState;  // What the list needs it in when it starts, if Pending.
+		ERHIResourceState SplitState;    // Where a begun split transition goes, if Splitting.
+		uint32_t QueuedBarrier;          // Its plain transition in mBarriers, if queued in QueuedBatch.
+		uint32_t QueuedBatch;
+		bool Pending;
+		bool Splitting;
+	};
+
+	static bool Covers(ERHIResourceState current, ERHIResourceState state)
+	{
+		return current == state || (RHIIsReadOnlyState(current) && (current & state) == state);
+	}
+
+	void ResetCounters()
+	{
+		mRequestCount = 0;
+		mSkippedCount = 0;
+		mBarrierCount = 0;
+		mFlushCount = 0;
+	}
+
+	// The resource's entry, or null when this is its first use and it is left to submission.
+	FEntry* FindOrAdd(RHIResource* resource, ERHIResourceState state)
+	{
+		const auto found = mEntryIndices.find(resource);
+		if (found != mEntryIndices.end())
+		{
+			return &mEntries[found->second];
+		}
+
+		FEntry entry;
+		entry.Resource = resource;
+		entry.State = mStartFromUsageStates ? resource->GetUsageState() : state;
+		entry.PendingState = state;
+		entry.SplitState = state;
+		entry.QueuedBarrier = 0;
+		entry.QueuedBatch = mBatch - 1;
+		entry.Pending = !mStartFromUsageStates;
+		entry.Splitting = false;
+		mEntryIndices.emplace(resource, static_cast<uint32_t>(mEntries.size()));
+		mEntries.push_back(entry);
+		return entry.Pending ? nullptr : &mEntries.back();
+	}
+
+	bool IsQueued(const FEntry& entry) const
+	{
+		return entry.QueuedBatch == mBatch;
+	}
+
+	void EndSplit(FEntry& entry)
+	{
+		mBarriers.push_back(FRHIResourceBarrier::Transition(entry.Resource, entry.State, entry.SplitState, ERHIBarrierFlags::EndOnly));
+		entry.State = entry.SplitState;
+		entry.Splitting = false;
+	}
+
+	void Transition(FEntry& entry, ERHIResourceState state)
+	{
+		if (entry.Splitting)
+		{
+			EndSplit(entry);
+			if (Covers(entry.State, state))
+			{
+				return;
+			}
+		}
+		if (Covers(entry.State, state))
+		{
+			++mSkippedCount;
+			return;
+		}
+		if (IsQueued(entry))
+		{
+			FRHIResourceBarrier& queued = mBarriers[entry.QueuedBarrier];
+			queued.StateAfter = state;
+			entry.State = state;
+			if (queued.StateBefore == state)
+			{
+				queued.Resource = nullptr;
+				entry.QueuedBatch = mBatch - 1;
+			}
+			++mSkippedCount;
+			return;
+		}
+		entry.QueuedBarrier = static_cast<uint32_t>(mBarriers.size());
+		entry.QueuedBatch = mBatch;
+		mBarriers.push_back(FRHIResourceBarrier::Transition(entry.Resource, entry.State, state));
+		entry.State = state;
+	}
+
+	// A later transition must not be folded into one queued before a UAV or aliasing barrier.
+	void StopFolding(RHIResource* resource)
+	{
+		const auto found = mEntryIndices.find(resource);
+		if (found != mEntryIndices.end())
+		{
+			mEntries[found->second].QueuedBatch = mBatch - 1;
+		}
+	}
+
+	std::vector<FEntry> mEntries;
+	std::unordered_map<RHIResource*, uint32_t> mEntryIndices;
+	std::vector<FRHIResourceBarrier> mBarriers;
+	bool mStartFromUsageStates;
+	uint32_t mBatch;    // Counts flushes and resets; tells queued transitions from recorded ones.
+
+	uint32_t mRequestCount;
+	uint32_t mSkippedCount;
+	uint32_t mBarrierCount;
+	uint32_t mFlushCount;
+};
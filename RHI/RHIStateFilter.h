@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cstring>
+
+#include "RHICommandList.h"
+
+// Command list that forwards to another one, dropping the state calls that set what is already set:
+// the pipeline state, root signature, descriptor heaps, input assembler state and the graphics root
+// arguments. Record through it and submit the target list.
+//
+// The cache starts empty at Reset(), so the first call of each kind is always forwarded. Changing
+// the root signature or the descriptor heaps forgets the root arguments, and executing a bundle
+// forgets everything, since the bundle's own state changes carry over to this list. Root arguments
+// above MaxRootParameters, root constants above MaxRootConstants and vertex buffer slots above
+// MaxVertexBuffers are always forwarded.
+class RHIStateFilter : public RHICommandList
+{
+public:
+	static const uint32_t MaxRootParameters = 16;
+	static const uint32_t MaxRootConstants = 32;
+	static const uint32_t MaxVertexBuffers = 4;
+	static const uint32_t MaxDescriptorHeaps = 2;
+
+	explicit RHIStateFilter(RHICommandList* target) :
+		RHICommandList(target->GetType()),
+		mTarget(target),
+		mSkippedCount(0)
+	{
+		Invalidate();
+	}
+
+	// Without a target until SetTarget().
+	explicit RHIStateFilter(ERHICommandListType type) :
+		RHICommandList(type),
+		mTarget(nullptr),
+		mSkippedCount(0)
+	{
+		Invalidate();
+	}
+
+	RHICommandList* GetTarget() const { return mTarget; }
+	// Records into target from here on, which was just reset against initialState (as lists handed
+	// out by a pool are): the cache starts over as after Reset().
+	void SetTarget(RHICommandList* target, RHIPipelineState* initialState)
+	{
+		mTarget = target;
+		Invalidate();
+		mPipelineState = initialState;
+		mHasPipelineState = true;
+	}
+	// State calls dropped since construction.
+	uint64_t GetSkippedCount() const { return mSkippedCount; }
+
+	// Forgets all cached state, e.g. after recording into the target directly.
+	void Invalidate()
+	{
+		mPipelineState = nullptr;
+		mRootSignature = nullptr;
+		mHasPipelineState = false;
+		mHasRootSignature = false;
+		mNumHeaps = ~0u;
+		mHasTopology = false;
+		mHasIndexBuffer = false;
+		mVertexBufferMask = 0;
+		InvalidateRootArguments();
+	}
+
+	virtual void Reset(RHICommandAllocator* allocator, RHIPipelineState* initialState) override
+	{
+		mTarget->Reset(allocator, initialState);
+		Invalidate();
+		mPipelineState = initialState;
+		mHasPipelineState = true;
+	}
+
+	virtual void Close() override { mTarget->Close(); }
+
+	virtual void SetPipelineState(RHIPipelineState* pipelineState) override
+	{
+		if (Skip(mHasPipelineState && mPipelineState == pipelineState))
+		{
+			return;
+		}
+		mPipelineState = pipelineState;
+		mHasPipelineState = true;
+		mTarget->SetPipelineState(pipelineState);
+	}
+
+	virtual void SetGraphicsRootSignature(RHIRootSignature* rootSignature) override
+	{
+		// Setting the same root signature again keeps the bindings.
+		if (Skip(mHasRootSignature && mRootSignature == rootSignature))
+		{
+			return;
+		}
+		mRootSignature = rootSignature;
+		mHasRootSignature = true;
+		InvalidateRootArguments();
+		mTarget->SetGraphicsRootSignature(rootSignature);
+	}
+
+	virtual void SetDescriptorHeaps(uint32_t numHeaps, RHIDescriptorHeap* const* heaps) override
+	{
+		const bool cacheable = numHeaps <= MaxDescriptorHeaps;
+		if (Skip(cacheable && numHeaps == mNumHeaps && memcmp(mHeaps, heaps, sizeof(RHIDescriptorHeap*) * numHeaps) == 0))
+		{
+			return;
+		}
+		// Tables into the previous heaps are no longer valid.
+		InvalidateRootArguments();
+		mNumHeaps = cacheable ? numHeaps : ~0u;
+		if (cacheable)
+		{
+			memcpy(mHeaps, heaps, sizeof(RHIDescriptorHeap*) * numHeaps);
+		}
+		mTarget->SetDescriptorHeaps(numHeaps, heaps);
+	}
+
+	virtual void IASetPrimitiveTopology(ERHIPrimitiveTopology topology) override
+	{
+		if (Skip(mHasTopology && mTopology == topology))
+		{
+			return;
+		}
+		mTopology = topology;
+		mHasTopology = true;
+		mTarget->IASetPrimitiveTopology(topology);
+	}
+
+	virtual void IASetIndexBuffer(const FRHIIndexBufferView* view) override
+	{
+		const FRHIIndexBufferView current = view ? *view : FRHIIndexBufferView();
+		if (Skip(mHasIndexBuffer && mIndexBufferIsNull == !view && SameIndexBuffer(mIndexBuffer, current)))
+		{
+			return;
+		}
+		mIndexBuffer = current;
+		mIndexBufferIsNull = !view;
+		mHasIndexBuffer = true;
+		mTarget->IASetIndexBuffer(view);
+	}
+
+	virtual void IASetVertexBuffers(uint32_t startSlot, uint32_t numViews, const FRHIVertexBufferView* views) override
+	{
+		const bool cacheable = views && numViews > 0 && startSlot + numViews <= MaxVertexBuffers;
+		if (cacheable)
+		{
+			const uint32_t mask = ((1u << numViews) - 1) << startSlot;
+			bool same = (mVertexBufferMask & mask) == mask;
+			for (uint32_t i = 0; same && i < numViews; ++i)
+			{
+				same = SameVertexBuffer(mVertexBuffers[startSlot + i], views[i]);
+			}
+			if (Skip(same))
+			{
+				return;
+			}
+			for (uint32_t i = 0; i < numViews; ++i)
+			{
+				mVertexBuffers[startSlot + i] = views[i];
+			}
+			mVertexBufferMask |= mask;
+		}
+		else
+		{
+			mVertexBufferMask = 0;
+		}
+		mTarget->IASetVertexBuffers(startSlot, numViews, views);
+	}
+
+	virtual void SetGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues) override
+	{
+		if (rootParameterIndex < MaxRootParameters && num32BitValues > 0 && destOffsetIn32BitValues + num32BitValues <= MaxRootConstants)
+		{
+			FRootConstants& constants = mRootConstants[rootParameterIndex];
+			const uint32_t mask = static_cast<uint32_t>(((uint64_t(1) << num32BitValues) - 1) << destOffsetIn32BitValues);
+			const size_t size = sizeof(uint32_t) * num32BitValues;
+			if (Skip((constants.ValidMask & mask) == mask && memcmp(constants.Values + destOffsetIn32BitValues, data, size) == 0))
+			{
+				return;
+			}
+			memcpy(constants.Values + destOffsetIn32BitValues, data, size);
+			constants.ValidMask |= mask;
+		}
+		mTarget->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValues, data, destOffsetIn32BitValues);
+	}
+
+	virtual void SetGraphicsRootDescriptorTable(uint32_t rootParameterIndex, FRHIGpuDescriptor baseDescriptor) override
+	{
+		if (SkipRootArgument(rootParameterIndex, baseDescriptor.ptr))
+		{
+			return;
+		}
+		mTarget->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+	}
+
+	virtual void SetGraphicsRootConstantBufferView(uint32_t rootParameterIndex, uint64_t bufferLocation) override
+	{
+		if (SkipRootArgument(rootParameterIndex, bufferLocation))
+		{
+			return;
+		}
+		mTarget->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+	}
+
+	virtual void SetGraphicsRootShaderResourceView(uint32_t rootParameterIndex, uint64_t bufferLocation) override
+	{
+		if (SkipRootArgument(rootParameterIndex, bufferLocation))
+		{
+			return;
+		}
+		mTarget->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+	}
+
+	virtual void RSSetViewports(uint32_t numViewports, const FRHIViewport* viewports) override { mTarget->RSSetViewports(numViewports, viewports); }
+	virtual void RSSetScissorRects(uint32_t numRects, const FRHIRect* rects) override { mTarget->RSSetScissorRects(numRects, rects); }
+	virtual void OMSetRenderTargets(uint32_t numRenderTargets, const FRHICpuDescriptor* renderTargets, const FRHICpuDescriptor* depthStencil) override
+	{
+		mTarget->OMSetRenderTargets(numRenderTargets, renderTargets, depthStencil);
+	}
+	virtual void ClearRenderTargetView(FRHICpuDescriptor renderTarget, const float color[4]) override { mTarget->ClearRenderTargetView(renderTarget, color); }
+	virtual void ClearDepthStencilView(FRHICpuDescriptor depthStencil, float depth, uint8_t stencil) override { mTarget->ClearDepthStencilView(depthStencil, depth, stencil); }
+
+	virtual void TransitionResource(RHIResource* resource, ERHIResourceState before, ERHIResourceState after) override { mTarget->TransitionResource(resource, before, after); }
+	virtual void ResourceBarrier(uint32_t numBarriers, const FRHIResourceBarrier* barriers) override { mTarget->ResourceBarrier(numBarriers, barriers); }
+
+	virtual void DrawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation) override
+	{
+		mTarget->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+	}
+
+	virtual void ExecuteBundle(RHICommandList* bundle) override
+	{
+		mTarget->ExecuteBundle(bundle);
+		Invalidate();
+	}
+
+	virtual void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) override
+	{
+		mTarget->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+	}
+
+	virtual void BeginEvent(const wchar_t* name) override { mTarget->BeginEvent(name); }
+	virtual void EndEvent() override { mTarget->EndEvent(); }
+
+private:
+	struct FRootConstants
+	{
+		uint32_t Values[MaxRootConstants];
+		uint32_t ValidMask;
+	};
+
+	static bool SameIndexBuffer(const FRHIIndexBufferView& a, const FRHIIndexBufferView& b)
+	{
+		return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.Format == b.Format;
+	}
+
+	static bool SameVertexBuffer(const FRHIVertexBufferView& a, const FRHIVertexBufferView& b)
+	{
+		return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.StrideInBytes == b.StrideInBytes;
+	}
+
+	bool Skip(bool redundant)
+	{
+		mSkippedCount += redundant ? 1 : 0;
+		return redundant;
+	}
+
+	// Descriptor tables and root descriptors: one GPU address or handle per parameter. A parameter
+	// has one type for a given root signature, so the kinds can share the cache.
+	bool SkipRootArgument(uint32_t rootParameterIndex, uint64_t value)
+	{
+		if (rootParameterIndex >= MaxRootParameters)
+		{
+			return false;
+		}
+		const uint32_t bit = 1u << rootParameterIndex;
+		if (Skip((mRootArgumentMask & bit) && mRootArguments[rootParameterIndex] == value))
+		{
+			return true;
+		}
+		mRootArguments[rootParameterIndex] = value;
+		mRootArgumentMask |= bit;
+		return false;
+	}
+
+	void InvalidateRootArguments()
+	{
+		mRootArgumentMask = 0;
+		for (FRootConstants& constants : mRootConstants)
+		{
+			constants.ValidMask = 0;
+		}
+	}
+
+	RHICommandList* mTarget;
+	uint64_t mSkippedCount;
+
+	RHIPipelineState* mPipelineState;
+	RHIRootSignature* mRootSignature;
+	bool mHasPipelineState;
+	bool mHasRootSignature;
+
+	RHIDescriptorHeap* mHeaps[MaxDescriptorHeaps];
+	uint32_t mNumHeaps;    // ~0u when unknown.
+
+	ERHIPrimitiveTopology mTopology;
+	bool mHasTopology;
+	FRHIIndexBufferView mIndexBuffer;
+	bool mIndexBufferIsNull;
+	bool mHasIndexBuffer;
+	FRHIVertexBufferView mVertexBuffers[MaxVertexBuffers];
+	uint32_t mVertexBufferMask;    // Bit i is set when slot i is known.
+
+	uint64_t mRootArguments[MaxRootParameters];
+	uint32_t mRootArgumentMask;
+	FRootConstants mRootConstants[MaxRootParameters];
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+// Orders command list submissions from any number of threads into batches, for the queue backends.
+//
+// Submitting takes no lock: each list takes the next fence value from an atomic counter and is
+// stored in the slot that value names. A submission of several lists is published as one: its
+// first slot, which also holds its list count, is stored last, and a flush takes a submission whole
+// or not at all. Flushing hands every submission stored so far, in fence value order, to one
+// FExecuteFunction call, which executes them with a single ExecuteCommandLists and
+// signals the queue fence once, to the value of the last. A list's work is done when the fence
+// reaches its value; a submission of several lists takes consecutive values and its fence value is
+// that of the last. Fence values thus count lists, not submissions, and a value may be reached by
+// a later batch's signal.
+//
+// One thread flushes at a time. A thread that finds another one flushing leaves its lists to it, and
+// a submitter that has taken its values but not stored its lists yet holds back the lists after it.
+class RHISubmissionBatcher
+{
+public:
+	// Lists submitted but not flushed yet, at most. A submitter that would exceed it flushes and waits.
+	static const uint32_t Capacity = 1024;
+
+	// Called on the flushing thread, one batch at a time, fence values increasing. lists holds the
+	// batch's lists in order; count is 0 for a batch of signals only (see EnqueueSignal). Must not
+	// throw: the batch's values would never be signaled.
+	typedef std::function<void(uint32_t count, void* const* lists, uint64_t fenceValue)> FExecuteFunction;
+
+	// firstFenceValue is that of the first list; the fence must start at or below the one before it.
+	RHISubmissionBatcher(uint64_t firstFenceValue, FExecuteFunction execute) :
+		mExecute(std::move(execute)),
+		mSlots(new FSlot[Capacity]),
+		mBatch(new void*[Capacity]),
+		mNextFenceValue(firstFenceValue),
+		mFlushFenceValue(firstFenceValue),
+		mSignaledFenceValue(firstFenceValue - 1),
+		mFlushing(false)
+	{
+		for (uint32_t i = 0; i < Capacity; ++i)
+		{
+			mSlots[i].List.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	RHISubmissionBatcher(const RHISubmissionBatcher&) = delete;
+	RHISubmissionBatcher& operator=(const RHISubmissionBatcher&) = delete;
+
+	// Stores count lists for the next flush and returns the fence value of the last. The lists must
+	// not be reset until a flush has taken them, i.e. GetSignaledFenceValue() has reached it.
+	uint64_t Enqueue(uint32_t count, void* const* lists)
+	{
+		if (count == 0 || count > Capacity)
+		{
+			throw std::runtime_error("RHISubmissionBatcher::Enqueue: list count out of range");
+		}
+		const uint64_t first = mNextFenceValue.fetch_add(count);
+		const uint64_t last = first + count - 1;
+		WaitForRoom(last);
+		for (uint32_t i = 1; i < count; ++i)
+		{
+			mSlots[(first + i) % Capacity].List.store(lists[i]);
+		}
+		FSlot& firstSlot = mSlots[first % Capacity];
+		firstSlot.Count = count;
+		firstSlot.List.store(lists[0]);
+		return last;
+	}
+
+	// A fence value of its own with no list: its batch signals it after the lists before it, as
+	// ID3D12CommandQueue::Signal after work submitted outside the batcher (e.g. a Present).
+	uint64_t EnqueueSignal()
+	{
+		const uint64_t value = mNextFenceValue.fetch_add(1);
+		WaitForRoom(value);
+		mSlots[value % Capacity].Count = 1;
+		mSlots[value % Capacity].List.store(SignalOnly());
+		return value;
+	}
+
+	// Executes every submission stored so far, in order, unless another thread is flushing: that one
+	// executes them instead.
+	void Flush()
+	{
+		while (!mFlushing.exchange(true))
+		{
+			FlushBatches();
+			mFlushing.store(false);
+
+			// A submitter that stored its lists while this thread held the flag found it taken and
+			// left them here. Sequentially consistent, like the stores and the exchange: either this
+			// load sees the lists or their submitter's exchange sees the flag cleared.
+			if (!IsStored(mFlushFenceValue.load(std::memory_order_relaxed)))
+			{
+				return;
+			}
+		}
+	}
+
+	// Returns once the lists up to fenceValue have been executed, flushing them when no other
+	// thread is.
+	void FlushUntil(uint64_t fenceValue)
+	{
+		while (mSignaledFenceValue.load(std::memory_order_acquire) < fenceValue)
+		{
+			Flush();
+			if (mSignaledFenceValue.load(std::memory_order_acquire) < fenceValue)
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// The value the next list submitted will take.
+	uint64_t GetNextFenceValue() const { return mNextFenceValue.load(); }
+	// The value the last batch executed signaled; every list up to it has been handed to the queue.
+	uint64_t GetSignaledFenceValue() const { return mSignaledFenceValue.load(); }
+
+private:
+	// A slot holds null until its list is stored, and again once a flush has taken it. Count is set
+	// in a submission's first slot only, before its list is stored, and read after it is loaded.
+	struct FSlot
+	{
+		std::atomic<void*> List;
+		uint32_t Count = 0;
+	};
+
+	static void* SignalOnly() { static char marker; return &marker; }
+
+	bool IsStored(uint64_t fenceValue) const
+	{
+		return mSlots[fenceValue % Capacity].List.load() != nullptr;
+	}
+
+	// Slot fenceValue % Capacity is free once everything Capacity values back has been flushed.
+	void WaitForRoom(uint64_t fenceValue)
+	{
+		while (fenceValue - mFlushFenceValue.load(std::memory_order_acquire) >= Capacity)
+		{
+			Flush();
+			std::this_thread::yield();
+		}
+	}
+
+	// Runs with mFlushing held: executes the run of stored submissions from mFlushFenceValue on,
+	// which is always the first value of one. A batch ends at a submission boundary.
+	void FlushBatches()
+	{
+		uint64_t next = mFlushFenceValue.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			uint32_t count = 0;
+			uint64_t end = next;
+			while (IsStored(end) && end - next + mSlots[end % Capacity].Count <= Capacity)
+			{
+				const uint32_t submissionCount = mSlots[end % Capacity].Count;
+				for (uint32_t i = 0; i < submissionCount; ++i, ++end)
+				{
+					void* list = mSlots[end % Capacity].List.exchange(nullptr, std::memory_order_acquire);
+					if (list != SignalOnly())
+					{
+						mBatch[count++] = list;
+					}
+				}
+			}
+			if (end == next)
+			{
+				return;
+			}
+
+			mExecute(count, mBatch.get(), end - 1);
+			mSignaledFenceValue.store(end - 1, std::memory_order_release);
+			mFlushFenceValue.store(end, std::memory_order_release);
+			next = end;
+		}
+	}
+
+	FExecuteFunction mExecute;
+	std::unique_ptr<FSlot[]> mSlots;
+	std::unique_ptr<void*[]> mBatch;        // The batch being flushed, signals left out.
+	std::atomic<uint64_t> mNextFenceValue;
+	std::atomic<uint64_t> mFlushFenceValue;     // The first value not flushed yet.
+	std::atomic<uint64_t> mSignaledFenceValue;
+	std::atomic<bool> mFlushing;
+};
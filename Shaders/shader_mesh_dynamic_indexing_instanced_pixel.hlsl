@@ -0,0 +1,41 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Instanced variant of shader_mesh_dynamic_indexing_pixel.hlsl: the material index arrives from
+// the vertex shader (per instance) instead of the per-draw root constants.
+
+struct PSInput
+{
+    float4 position    : SV_POSITION;
+    float2 uv        : TEXCOORD0;
+    nointerpolation uint matIndex : MATINDEX;
+};
+
+struct  ConstData
+{
+    float4 bar;
+};
+
+StructuredBuffer<ConstData> g_ConstData[]: register(t0, space1);
+
+Texture2D        g_txMats[]    : register(t1,space0);
+SamplerState    g_sampler[]    : register(s0);
+
+float4 PSMain(PSInput input) : SV_TARGET
+{
+    float3 diffuse = g_txMats[0].Sample(g_sampler[0], input.uv).rgb;
+    float3 mat = g_txMats[NonUniformResourceIndex(input.matIndex+1)].Sample(g_sampler[0], input.uv).rgb;
+    uint BufferIndex = input.matIndex - (input.matIndex/4) * 4;
+    const StructuredBuffer<ConstData> StrBuffer = g_ConstData[NonUniformResourceIndex(BufferIndex)];
+    ConstData Data = StrBuffer[0];
+    float x = Data.bar.y;
+    return float4(diffuse * mat*x/255.0f, 1.0f);
+}
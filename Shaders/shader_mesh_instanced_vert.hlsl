@@ -0,0 +1,50 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Instanced variant of shader_mesh_simple_vert.hlsl: every city is one instance of a single
+// draw, and its transform and material come from the per-frame instance buffer.
+
+struct VSInput
+{
+    float3 position    : POSITION;
+    float3 normal    : NORMAL;
+    float2 uv        : TEXCOORD0;
+    float3 tangent    : TANGENT;
+};
+
+struct PSInput
+{
+    float4 position    : SV_POSITION;
+    float2 uv        : TEXCOORD0;
+    nointerpolation uint matIndex : MATINDEX;
+};
+
+// Matches FrameResource::InstanceData.
+struct InstanceData
+{
+    float4x4 worldViewProj;    // Transposed on the CPU, like g_mWorldViewProj.
+    uint matIndex;
+    uint3 padding;
+};
+
+StructuredBuffer<InstanceData> g_instances : register(t0, space2);
+
+PSInput VSMain(VSInput input, uint instanceId : SV_InstanceID)
+{
+    InstanceData instance = g_instances[instanceId];
+
+    PSInput result;
+    result.position = mul(float4(input.position, 1.0f), instance.worldViewProj);
+    result.uv = input.uv;
+    result.matIndex = instance.matIndex;
+
+    return result;
+}
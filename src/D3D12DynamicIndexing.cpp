@@ -13,6 +13,7 @@
 #include "D3D12DynamicIndexing.h"
 #include "occcity.h"
 #include "D3D12QueueManger.h"
+#include "Mesh/CookedMesh.h"
 
 #include <cstdlib> // free
 
@@ -27,8 +28,6 @@ D3D12DynamicIndexing::D3D12DynamicIndexing(UINT width, UINT height, std::wstring
     m_fenceValue(0),
     m_rtvDescriptorSize(0),
     m_cbvSrvDescriptorSize(0),
-    m_currentFrameResourceIndex(0),
-    m_pCurrentFrameResource(nullptr),
     mQueueManager(nullptr)
 {
 }
@@ -38,6 +37,8 @@ void D3D12DynamicIndexing::OnInit()
     m_camera.Init({ (CityColumnCount / 2.0f) * CitySpacingInterval - (CitySpacingInterval / 2.0f), 15, 50 });
     m_camera.SetMoveSpeed(CitySpacingInterval * 2.0f);
 
+    m_jobSystem = std::make_unique<FJobSystem>();
+
     LoadPipeline();
     LoadAssets();
 }
@@ -93,6 +94,9 @@ void D3D12DynamicIndexing::LoadPipeline()
         mQueueManager = std::make_unique<Direct3DQueueManager>(m_device.Get());
     }
 
+    m_rhiDevice = std::make_unique<DX12RHIDevice>(m_device.Get(), mQueueManager.get());
+    m_fenceWatcher = std::make_unique<FFenceWatcher>(m_rhiDevice.get());
+
     // Describe and create the command queue.
     D3D12_COMMAND_QUEUE_DESC queueDesc = {};
     queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
@@ -148,22 +152,51 @@ void D3D12DynamicIndexing::LoadPipeline()
 
         m_rtvDescriptorSize = m_rtvDescriptorHeap->GetDescriptorSize();
         m_cbvSrvDescriptorSize = m_cbvSrvDescriptorHeap->GetDescriptorSize();
+
+        m_rhiCbvSrvDescriptorHeap = std::make_unique<DX12RHIDescriptorHeap>(m_cbvSrvDescriptorHeap.get());
+        m_rhiSamplerDescriptorHeap = std::make_unique<DX12RHIDescriptorHeap>(m_samplerDescriptorHeap.get());
+
+        // Views are created once in CPU-only staging heaps; the shader-visible heaps only hold the
+        // tables assembled from them, which the caches share between identical requests.
+        RHICommandQueue* pDirectQueue = m_rhiDevice->GetQueue(ERHICommandListType::Direct);
+        m_srvStagingHeap = std::make_unique<FDescriptorStagingHeap>(m_rhiDevice.get(), ERHIDescriptorHeapType::CbvSrvUav, 4096);
+        m_samplerStagingHeap = std::make_unique<FDescriptorStagingHeap>(m_rhiDevice.get(), ERHIDescriptorHeapType::Sampler, 64);
+        m_srvTableCache = std::make_unique<FDescriptorTableCache>(m_rhiDevice.get(), pDirectQueue, m_srvStagingHeap.get(),
+            m_rhiCbvSrvDescriptorHeap.get(), 0, m_rhiCbvSrvDescriptorHeap->GetNumDescriptors());
+        m_samplerTableCache = std::make_unique<FDescriptorTableCache>(m_rhiDevice.get(), pDirectQueue, m_samplerStagingHeap.get(),
+            m_rhiSamplerDescriptorHeap.get(), 0, m_rhiSamplerDescriptorHeap->GetNumDescriptors());
+        m_samplerCache = std::make_unique<FSamplerCache>(m_rhiDevice.get(), m_samplerStagingHeap.get());
     }
 
-    ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator)));
+    FPipelineCacheDesc pipelineCacheDesc;
+    pipelineCacheDesc.Device = m_rhiDevice.get();
+    pipelineCacheDesc.JobSystem = m_jobSystem.get();
+    pipelineCacheDesc.LibraryPath = GetAssetFullPath(L"PipelineLibrary.bin");
+    m_pipelineCache = std::make_unique<FPipelineCache>(pipelineCacheDesc);
+
+    m_commandListPool = std::make_unique<FCommandListPool>(m_rhiDevice.get());
 }
 
 // Load the sample assets.
 void D3D12DynamicIndexing::LoadAssets()
 {
-    // Note: ComPtr's are CPU objects but these resources need to stay in scope until
-    // the command list that references them has finished executing on the GPU.
-    // We will flush the GPU at the end of this method to ensure the resources are not
-    // prematurely destroyed.
-    ComPtr<ID3D12Resource> vertexBufferUploadHeap;
-    ComPtr<ID3D12Resource> indexBufferUploadHeap;
-    ComPtr<ID3D12Resource> textureUploadHeap;
-    ComPtr<ID3D12Resource> materialsUploadHeap;
+    // The copies below read their data from a ring of their own, handed to the fence watcher with
+    // the submission at the end of this method: its pages, as large as all the assets, are freed
+    // once the copies have executed, and the per-frame ring stays small.
+    std::unique_ptr<FUploadRing> assetUploadRing = std::make_unique<FUploadRing>(m_rhiDevice.get(), m_rhiDevice->GetQueue(ERHICommandListType::Direct));
+    m_uploadRing = std::make_unique<FUploadRing>(m_rhiDevice.get(), m_rhiDevice->GetQueue(ERHICommandListType::Direct));
+    auto uploadHeapOf = [](const FUploadAllocation& allocation)
+    {
+        return static_cast<DX12RHIResource*>(allocation.Resource)->GetResource();
+    };
+    // Where to create the view for slot tableIndex of the city SRV table (see m_cityViews).
+    auto stageCityView = [this](UINT tableIndex)
+    {
+        m_cityViews[tableIndex] = m_srvStagingHeap->Allocate();
+        D3D12_CPU_DESCRIPTOR_HANDLE handle;
+        handle.ptr = static_cast<SIZE_T>(m_srvStagingHeap->GetCpuHandle(m_cityViews[tableIndex]).ptr);
+        return handle;
+    };
 
     // Create the root signature.
     {
@@ -177,19 +210,22 @@ void D3D12DynamicIndexing::LoadAssets()
             featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
         }
 
-        CD3DX12_DESCRIPTOR_RANGE1 ranges[4];
+        CD3DX12_DESCRIPTOR_RANGE1 ranges[3];
         // t0-t5000 texure
-        ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 5000, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE | D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);    // Diffuse texture + array of materials.
-        // space1(t0~t5000)
-        ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 5000, 0, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE | D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);    // Diffuse texture + array of materials.
-        ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 4080, 0,0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
-        ranges[3].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE | D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+        ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2 + CityMaterialCount, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE | D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);    // Unused t0, diffuse texture + array of materials.
+        // space1(t0~), right after the materials in the table: the structured buffers.
+        ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 1, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE | D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+        // s0~: the sampler cache's samplers, by cache index.
+        ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, UINT_MAX, 0,0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
 
-        CD3DX12_ROOT_PARAMETER1 rootParameters[4];
+        CD3DX12_ROOT_PARAMETER1 rootParameters[5];
         rootParameters[0].InitAsDescriptorTable(2, &ranges[0], D3D12_SHADER_VISIBILITY_PIXEL);
         rootParameters[1].InitAsDescriptorTable(1, &ranges[2], D3D12_SHADER_VISIBILITY_PIXEL);
-        rootParameters[2].InitAsDescriptorTable(1, &ranges[3], D3D12_SHADER_VISIBILITY_VERTEX);
+        // b0: per-draw MVP, bound by address so no CBV descriptors are needed.
+        rootParameters[2].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_VERTEX);
         rootParameters[3].InitAsConstants(4, 0, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+        // space2(t0): per-instance MVP + material index for the instanced path.
+        rootParameters[4].InitAsShaderResourceView(0, 2, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE, D3D12_SHADER_VISIBILITY_VERTEX);
 
         CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
         rootSignatureDesc.Init_1_1(_countof(rootParameters), rootParameters, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
@@ -200,6 +236,9 @@ void D3D12DynamicIndexing::LoadAssets()
         UINT SignatureBufferSize = signature->GetBufferSize();
         ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
         NAME_D3D12_OBJECT(m_rootSignature);
+        // Pipelines are cached by the serialized root signature, which is the same from run to run.
+        m_rhiRootSignature = std::make_unique<DX12RHIRootSignature>(m_rootSignature.Get(),
+            FPipelineCache::HashBytes(signature->GetBufferPointer(), signature->GetBufferSize()));
     }
 
     // Create the pipeline state, which includes loading shaders.
@@ -209,37 +248,32 @@ void D3D12DynamicIndexing::LoadAssets()
         UINT vertexShaderDataLength;
         UINT pixelShaderDataLength;
 
-        ThrowIfFailed(ReadDataFromFile(GetAssetFullPath(L"Shaders\\shader_mesh_simple_vert.cso").c_str(), &pVertexShaderData, &vertexShaderDataLength));
-        ThrowIfFailed(ReadDataFromFile(GetAssetFullPath(L"Shaders\\shader_mesh_dynamic_indexing_pixel.cso").c_str(), &pPixelShaderData, &pixelShaderDataLength));
-
-
-        CD3DX12_RASTERIZER_DESC rasterizerStateDesc(D3D12_DEFAULT);
-        rasterizerStateDesc.CullMode = D3D12_CULL_MODE_NONE;
-
-        // Describe and create the graphics pipeline state object (PSO).
-        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-        psoDesc.InputLayout = { SampleAssets::StandardVertexDescription, SampleAssets::StandardVertexDescriptionNumElements };
-        psoDesc.pRootSignature = m_rootSignature.Get();
-        psoDesc.VS = CD3DX12_SHADER_BYTECODE(pVertexShaderData, vertexShaderDataLength);
-        psoDesc.PS = CD3DX12_SHADER_BYTECODE(pPixelShaderData, pixelShaderDataLength);
-        psoDesc.RasterizerState = rasterizerStateDesc;
-        psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-        psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-        psoDesc.SampleMask = UINT_MAX;
-        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-        psoDesc.NumRenderTargets = 1;
-        psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
-        psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-        psoDesc.SampleDesc.Count = 1;
-
-        ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
-        NAME_D3D12_OBJECT(m_pipelineState);
+        const wchar_t* vertexShaderName = UseInstancing ? L"Shaders\\shader_mesh_instanced_vert.cso" : L"Shaders\\shader_mesh_simple_vert.cso";
+        const wchar_t* pixelShaderName = UseInstancing ? L"Shaders\\shader_mesh_dynamic_indexing_instanced_pixel.cso" : L"Shaders\\shader_mesh_dynamic_indexing_pixel.cso";
+        ThrowIfFailed(ReadDataFromFile(GetAssetFullPath(vertexShaderName).c_str(), &pVertexShaderData, &vertexShaderDataLength));
+        ThrowIfFailed(ReadDataFromFile(GetAssetFullPath(pixelShaderName).c_str(), &pPixelShaderData, &pixelShaderDataLength));
+
+
+        // Compiled on the job system while the textures and mesh load below, or loaded from the
+        // pipeline library; CreateSceneRenderer() waits for it. The cache copies the shaders.
+        FRHIGraphicsPipelineDesc pipelineDesc;
+        pipelineDesc.RootSignature = m_rhiRootSignature.get();
+        pipelineDesc.VS = { pVertexShaderData, vertexShaderDataLength };
+        pipelineDesc.PS = { pPixelShaderData, pixelShaderDataLength };
+        pipelineDesc.InputElements = reinterpret_cast<const FRHIInputElement*>(SampleAssets::StandardVertexDescription);
+        pipelineDesc.NumInputElements = SampleAssets::StandardVertexDescriptionNumElements;
+        pipelineDesc.CullMode = ERHICullMode::None;
+        pipelineDesc.RenderTargetFormats[0] = ERHIFormat::R8G8B8A8Unorm;
+        pipelineDesc.DepthStencilFormat = ERHIFormat::D32Float;
+        m_cityPipeline = m_pipelineCache->Request(pipelineDesc);
 
         free(pVertexShaderData);
         free(pPixelShaderData);
     }
 
-    ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+    RHICommandAllocator* pLoadAllocator = m_commandListPool->AcquireAllocator(ERHICommandListType::Direct);
+    RHICommandList* pLoadCommandList = m_commandListPool->AcquireCommandList(pLoadAllocator);
+    m_commandList = static_cast<DX12RHICommandList*>(pLoadCommandList)->Get();
     NAME_D3D12_OBJECT(m_commandList);
 
     // Create render target views (RTVs).
@@ -252,6 +286,7 @@ void D3D12DynamicIndexing::LoadAssets()
         rtvHandle.Offset(1, m_rtvDescriptorSize);
 
         NAME_D3D12_OBJECT_INDEXED(m_renderTargets, i);
+        m_rhiRenderTargets[i] = std::make_unique<DX12RHIResource>(m_renderTargets[i].Get(), D3D12_RESOURCE_STATE_PRESENT, ERHIResourceType::RHI_TextureType);
     }
 
     // Read in mesh data for vertex/index buffers.
@@ -259,40 +294,70 @@ void D3D12DynamicIndexing::LoadAssets()
     UINT meshDataLength;
     ThrowIfFailed(ReadDataFromFile(GetAssetFullPath(SampleAssets::DataFileName).c_str(), &pMeshData, &meshDataLength));
 
+    // Prefer the cooked mesh: it is memory-mapped and uploaded straight from the mapping.
+    // Fall back to the raw ranges in occcity.bin when it has not been cooked.
+    FCookedMesh cookedMesh;
+    std::string cookedMeshError;
+    const void* pVertexData = pMeshData + SampleAssets::VertexDataOffset;
+    UINT vertexDataSize = SampleAssets::VertexDataSize;
+    const void* pIndexData = pMeshData + SampleAssets::IndexDataOffset;
+    UINT indexDataSize = SampleAssets::IndexDataSize;
+    if (cookedMesh.Open(GetAssetFullPath(SampleAssets::CookedMeshFileName), &cookedMeshError))
+    {
+        pVertexData = cookedMesh.GetVertexData();
+        vertexDataSize = static_cast<UINT>(cookedMesh.GetVertexDataSize());
+        pIndexData = cookedMesh.GetIndexData();
+        indexDataSize = static_cast<UINT>(cookedMesh.GetIndexDataSize());
+        m_meshBoundsMin = cookedMesh.GetBoundsMin();
+        m_meshBoundsMax = cookedMesh.GetBoundsMax();
+    }
+    else
+    {
+        OutputDebugStringA(("Using occcity.bin mesh data: " + cookedMeshError + "\n").c_str());
+
+        // occcity.bin has no bounds; the position is the first element of every vertex.
+        const UINT8* pVertex = static_cast<const UINT8*>(pVertexData);
+        const UINT vertexCount = vertexDataSize / SampleAssets::StandardVertexStride;
+        FSimdVector boundsMin = XMLoadFloat3(reinterpret_cast<const FVector3*>(pVertex));
+        FSimdVector boundsMax = boundsMin;
+        for (UINT i = 1; i < vertexCount; i++)
+        {
+            const FSimdVector position = XMLoadFloat3(reinterpret_cast<const FVector3*>(pVertex + i * SampleAssets::StandardVertexStride));
+            boundsMin = XMVectorMin(boundsMin, position);
+            boundsMax = XMVectorMax(boundsMax, position);
+        }
+        XMStoreFloat3(&m_meshBoundsMin, boundsMin);
+        XMStoreFloat3(&m_meshBoundsMax, boundsMax);
+    }
+
     // Create the vertex buffer.
     {
         ThrowIfFailed(m_device->CreateCommittedResource(
             &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
             D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(SampleAssets::VertexDataSize),
+            &CD3DX12_RESOURCE_DESC::Buffer(vertexDataSize),
             D3D12_RESOURCE_STATE_COPY_DEST,
             nullptr,
             IID_PPV_ARGS(&m_vertexBuffer)));
 
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(SampleAssets::VertexDataSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&vertexBufferUploadHeap)));
+        const FUploadAllocation vertexUpload = assetUploadRing->Allocate(vertexDataSize);
 
         NAME_D3D12_OBJECT(m_vertexBuffer);
 
         // Copy data to the intermediate upload heap and then schedule a copy 
         // from the upload heap to the vertex buffer.
         D3D12_SUBRESOURCE_DATA vertexData = {};
-        vertexData.pData = pMeshData + SampleAssets::VertexDataOffset;
-        vertexData.RowPitch = SampleAssets::VertexDataSize;
+        vertexData.pData = pVertexData;
+        vertexData.RowPitch = vertexDataSize;
         vertexData.SlicePitch = vertexData.RowPitch;
 
-        UpdateSubresources<1>(m_commandList.Get(), m_vertexBuffer.Get(), vertexBufferUploadHeap.Get(), 0, 0, 1, &vertexData);
+        UpdateSubresources<1>(m_commandList.Get(), m_vertexBuffer.Get(), uploadHeapOf(vertexUpload), vertexUpload.Offset, 0, 1, &vertexData);
         m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
 
         // Initialize the vertex buffer view.
         m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
         m_vertexBufferView.StrideInBytes = SampleAssets::StandardVertexStride;
-        m_vertexBufferView.SizeInBytes = SampleAssets::VertexDataSize;
+        m_vertexBufferView.SizeInBytes = vertexDataSize;
     }
 
     // Create the index buffer.
@@ -300,37 +365,31 @@ void D3D12DynamicIndexing::LoadAssets()
         ThrowIfFailed(m_device->CreateCommittedResource(
             &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
             D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(SampleAssets::IndexDataSize),
+            &CD3DX12_RESOURCE_DESC::Buffer(indexDataSize),
             D3D12_RESOURCE_STATE_COPY_DEST,
             nullptr,
             IID_PPV_ARGS(&m_indexBuffer)));
 
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(SampleAssets::IndexDataSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&indexBufferUploadHeap)));
+        const FUploadAllocation indexUpload = assetUploadRing->Allocate(indexDataSize);
 
         NAME_D3D12_OBJECT(m_indexBuffer);
 
         // Copy data to the intermediate upload heap and then schedule a copy 
         // from the upload heap to the index buffer.
         D3D12_SUBRESOURCE_DATA indexData = {};
-        indexData.pData = pMeshData + SampleAssets::IndexDataOffset;
-        indexData.RowPitch = SampleAssets::IndexDataSize;
+        indexData.pData = pIndexData;
+        indexData.RowPitch = indexDataSize;
         indexData.SlicePitch = indexData.RowPitch;
 
-        UpdateSubresources<1>(m_commandList.Get(), m_indexBuffer.Get(), indexBufferUploadHeap.Get(), 0, 0, 1, &indexData);
+        UpdateSubresources<1>(m_commandList.Get(), m_indexBuffer.Get(), uploadHeapOf(indexUpload), indexUpload.Offset, 0, 1, &indexData);
         m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER));
 
         // Describe the index buffer view.
         m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
         m_indexBufferView.Format = SampleAssets::StandardIndexFormat;
-        m_indexBufferView.SizeInBytes = SampleAssets::IndexDataSize;
+        m_indexBufferView.SizeInBytes = indexDataSize;
 
-        m_numIndices = SampleAssets::IndexDataSize / 4;    // R32_UINT (SampleAssets::StandardIndexFormat) = 4 bytes each.
+        m_numIndices = indexDataSize / 4;    // R32_UINT (SampleAssets::StandardIndexFormat) = 4 bytes each.
     }
 
     // Create the textures and sampler.
@@ -368,47 +427,47 @@ void D3D12DynamicIndexing::LoadAssets()
 
                 NAME_D3D12_OBJECT_INDEXED(m_cityMaterialTextures, i);
 
-                // Fill the texture.
-                float t = i * materialGradStep;
                 cityTextureData[i].resize(CityMaterialTextureWidth * CityMaterialTextureHeight * CityMaterialTextureChannelCount);
-                for (int x = 0; x < CityMaterialTextureWidth; ++x)
+            }
+
+            // Fill the textures, one job per batch of materials; each only touches its own data.
+            m_jobSystem->ParallelFor(CityMaterialCount, 4, [&cityTextureData, materialGradStep](uint32_t begin, uint32_t end, FJobContext&)
+            {
+                for (uint32_t i = begin; i < end; ++i)
                 {
-                    for (int y = 0; y < CityMaterialTextureHeight; ++y)
+                    float t = i * materialGradStep;
+                    for (int x = 0; x < CityMaterialTextureWidth; ++x)
                     {
-                        // Compute the appropriate index into the buffer based on the x/y coordinates.
-                        int pixelIndex = (y * CityMaterialTextureChannelCount * CityMaterialTextureWidth) + (x * CityMaterialTextureChannelCount);
-
-                        // Determine this row's position along the rainbow gradient.
-                        float tPrime = t + ((static_cast<float>(y) / static_cast<float>(CityMaterialTextureHeight)) * materialGradStep);
-
-                        // Compute the RGB value for this position along the rainbow
-                        // and pack the pixel value.
-                        FSimdVector hsl = XMVectorSet(tPrime, 0.5f, 0.5f, 1.0f);
-                        FSimdVector rgb = XMColorHSLToRGB(hsl);
-
-                        cityTextureData[i][pixelIndex + 0] = static_cast<unsigned char>((255 * XMVectorGetX(rgb)));
-                        cityTextureData[i][pixelIndex + 1] = static_cast<unsigned char>((255 * XMVectorGetY(rgb)));
-                        cityTextureData[i][pixelIndex + 2] = static_cast<unsigned char>((255 * XMVectorGetZ(rgb)));
-                        cityTextureData[i][pixelIndex + 3] = 255;
+                        for (int y = 0; y < CityMaterialTextureHeight; ++y)
+                        {
+                            // Compute the appropriate index into the buffer based on the x/y coordinates.
+                            int pixelIndex = (y * CityMaterialTextureChannelCount * CityMaterialTextureWidth) + (x * CityMaterialTextureChannelCount);
+
+                            // Determine this row's position along the rainbow gradient.
+                            float tPrime = t + ((static_cast<float>(y) / static_cast<float>(CityMaterialTextureHeight)) * materialGradStep);
+
+                            // Compute the RGB value for this position along the rainbow
+                            // and pack the pixel value.
+                            FSimdVector hsl = XMVectorSet(tPrime, 0.5f, 0.5f, 1.0f);
+                            FSimdVector rgb = XMColorHSLToRGB(hsl);
+
+                            cityTextureData[i][pixelIndex + 0] = static_cast<unsigned char>((255 * XMVectorGetX(rgb)));
+                            cityTextureData[i][pixelIndex + 1] = static_cast<unsigned char>((255 * XMVectorGetY(rgb)));
+                            cityTextureData[i][pixelIndex + 2] = static_cast<unsigned char>((255 * XMVectorGetZ(rgb)));
+                            cityTextureData[i][pixelIndex + 3] = 255;
+                        }
                     }
                 }
-            }
+            });
 
             // Upload texture data to the default heap resources.
             {
                 const UINT subresourceCount = textureDesc.DepthOrArraySize * textureDesc.MipLevels;
                 const UINT64 uploadBufferStep = GetRequiredIntermediateSize(m_cityMaterialTextures[0].Get(), 0, subresourceCount); // All of our textures are the same size in this case.
-                const UINT64 uploadBufferSize = uploadBufferStep * CityMaterialCount;
-                ThrowIfFailed(m_device->CreateCommittedResource(
-                    &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-                    D3D12_HEAP_FLAG_NONE,
-                    &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-                    D3D12_RESOURCE_STATE_GENERIC_READ,
-                    nullptr,
-                    IID_PPV_ARGS(&materialsUploadHeap)));
-
                 for (int i = 0; i < CityMaterialCount; ++i)
                 {
+                    const FUploadAllocation textureUpload = assetUploadRing->Allocate(uploadBufferStep, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
                     // Copy data to the intermediate upload heap and then schedule 
                     // a copy from the upload heap to the appropriate texture.
                     D3D12_SUBRESOURCE_DATA textureData = {};
@@ -416,7 +475,7 @@ void D3D12DynamicIndexing::LoadAssets()
                     textureData.RowPitch = static_cast<LONG_PTR>((CityMaterialTextureChannelCount * textureDesc.Width));
                     textureData.SlicePitch = textureData.RowPitch * textureDesc.Height;
 
-                    UpdateSubresources(m_commandList.Get(), m_cityMaterialTextures[i].Get(), materialsUploadHeap.Get(), i * uploadBufferStep, 0, subresourceCount, &textureData);
+                    UpdateSubresources(m_commandList.Get(), m_cityMaterialTextures[i].Get(), uploadHeapOf(textureUpload), textureUpload.Offset, 0, subresourceCount, &textureData);
                     m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_cityMaterialTextures[i].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
                 }
             }
@@ -447,13 +506,7 @@ void D3D12DynamicIndexing::LoadAssets()
 
             const UINT subresourceCount = textureDesc.DepthOrArraySize * textureDesc.MipLevels;
             const UINT64 uploadBufferSize = GetRequiredIntermediateSize(m_cityDiffuseTexture.Get(), 0, subresourceCount);
-            ThrowIfFailed(m_device->CreateCommittedResource(
-                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-                D3D12_HEAP_FLAG_NONE,
-                &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-                D3D12_RESOURCE_STATE_GENERIC_READ,
-                nullptr,
-                IID_PPV_ARGS(&textureUploadHeap)));
+            const FUploadAllocation textureUpload = assetUploadRing->Allocate(uploadBufferSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
 
             NAME_D3D12_OBJECT(m_cityDiffuseTexture);
 
@@ -464,7 +517,7 @@ void D3D12DynamicIndexing::LoadAssets()
             textureData.RowPitch = SampleAssets::Textures[0].Data[0].Pitch;
             textureData.SlicePitch = SampleAssets::Textures[0].Data[0].Size;
 
-            UpdateSubresources(m_commandList.Get(), m_cityDiffuseTexture.Get(), textureUploadHeap.Get(), 0, 0, subresourceCount, &textureData);
+            UpdateSubresources(m_commandList.Get(), m_cityDiffuseTexture.Get(), uploadHeapOf(textureUpload), textureUpload.Offset, 0, subresourceCount, &textureData);
             m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_cityDiffuseTexture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
         }
 
@@ -483,11 +536,11 @@ void D3D12DynamicIndexing::LoadAssets()
 			// 更多数据集...
 		};
         StructBufferNum = dataSets.size();
+        m_cityViews.resize(2 + CityMaterialCount + StructBufferNum);
         // SRV
         {
             
 			//std::vector<ID3D12Resource*> structuredBuffers(dataSets.size());
-			std::vector<ID3D12Resource*> uploadBuffers(dataSets.size());
 
 			for (size_t i = 0; i < dataSets.size(); ++i) {
 				size_t elementCount = dataSets[i].size();
@@ -504,37 +557,16 @@ void D3D12DynamicIndexing::LoadAssets()
 					D3D12_RESOURCE_STATE_COPY_DEST,
 					nullptr,
 					IID_PPV_ARGS(&m_cityMaterialStructures[i]));
-
-				// 创建上传堆
-				CD3DX12_HEAP_PROPERTIES uploadHeapProps(D3D12_HEAP_TYPE_UPLOAD);
-                m_device->CreateCommittedResource(
-					&uploadHeapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&bufferDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&uploadBuffers[i]));
-			}
-
-			for (size_t i = 0; i < dataSets.size(); ++i) {
-				void* mappedData;
-				CD3DX12_RANGE readRange(0, 0);
-				uploadBuffers[i]->Map(0, &readRange, &mappedData);
-				memcpy(mappedData, dataSets[i].data(), sizeof(ConstData) * dataSets[i].size());
-				uploadBuffers[i]->Unmap(0, nullptr);
 			}
 
-
             // 使用命令列表将数据从上传堆复制到 GPU 的 StructuredBuffer
 			for (size_t i = 0; i < dataSets.size(); ++i) {
-                m_commandList->CopyBufferRegion(m_cityMaterialStructures[i].Get(), 0, uploadBuffers[i], 0, sizeof(ConstData) * dataSets[i].size());
+				const FUploadAllocation structureUpload = assetUploadRing->Upload(dataSets[i].data(), sizeof(ConstData) * dataSets[i].size());
+                m_commandList->CopyBufferRegion(m_cityMaterialStructures[i].Get(), 0, uploadHeapOf(structureUpload), structureUpload.Offset, structureUpload.Size);
 			}
 
-            StructBufferOffset = 5000;// 1 + CityMaterialCount;
-
-			// 创建每个 StructuredBuffer 的 SRV
-            UINT i = 0;
-			for (; i < dataSets.size(); ++i) {
+			// 创建每个 StructuredBuffer 的 SRV，在表中紧跟材质之后 (space1)
+			for (UINT i = 0; i < dataSets.size(); ++i) {
 				D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
                 srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -544,48 +576,45 @@ void D3D12DynamicIndexing::LoadAssets()
 				srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
 				srvDesc.Format = DXGI_FORMAT_UNKNOWN;
 
-                D3D12_CPU_DESCRIPTOR_HANDLE handle = m_cbvSrvDescriptorHeap->GetCpuHandle(StructBufferOffset + i);// (m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart(), StructBufferOffset + i, m_cbvSrvDescriptorSize);
-				m_device->CreateShaderResourceView(m_cityMaterialStructures[i].Get(), &srvDesc, handle);
+				m_device->CreateShaderResourceView(m_cityMaterialStructures[i].Get(), &srvDesc, stageCityView(2 + CityMaterialCount + i));
 			}
         }
 
-        // Describe and create a sampler.
-        D3D12_SAMPLER_DESC samplerDesc = {};
-        samplerDesc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
-        samplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-        samplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-        samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
-        samplerDesc.MinLOD = 0;
-        samplerDesc.MaxLOD = D3D12_FLOAT32_MAX;
-        samplerDesc.MipLODBias = 0.0f;
-        samplerDesc.MaxAnisotropy = 1;
-        samplerDesc.ComparisonFunc = D3D12_COMPARISON_FUNC_ALWAYS;
-        m_device->CreateSampler(&samplerDesc, m_samplerDescriptorHeap->GetCpuHandle(0));
+        // The trilinear wrap sampler (FRHISamplerDesc's defaults) that the pixel shaders read as
+        // g_sampler[0]: the first sampler the cache creates, so index 0.
+        m_samplerCache->GetSamplerIndex(FRHISamplerDesc());
+
+        // t0 is not read (g_txMats starts at t1), but it is part of the table, so give it a null view.
+        D3D12_SHADER_RESOURCE_VIEW_DESC nullSrvDesc = {};
+        nullSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        nullSrvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        nullSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        nullSrvDesc.Texture2D.MipLevels = 1;
+        m_device->CreateShaderResourceView(nullptr, &nullSrvDesc, stageCityView(0));
 
         // Create SRV for the city's diffuse texture.
-        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = m_cbvSrvDescriptorHeap->GetCpuHandle(1);// (m_cbvSrvHeap->GetCPUDescriptorHandleForHeapStart(), 1, m_cbvSrvDescriptorSize);
         D3D12_SHADER_RESOURCE_VIEW_DESC diffuseSrvDesc = {};
         diffuseSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
         diffuseSrvDesc.Format = SampleAssets::Textures->Format;
         diffuseSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
         diffuseSrvDesc.Texture2D.MipLevels = 1;
-        m_device->CreateShaderResourceView(m_cityDiffuseTexture.Get(), &diffuseSrvDesc, srvHandle);
-        
-        srvHandle = m_cbvSrvDescriptorHeap->GetCpuHandle(2);// Offset(m_cbvSrvDescriptorSize);
+        m_device->CreateShaderResourceView(m_cityDiffuseTexture.Get(), &diffuseSrvDesc, stageCityView(1));
 
-        // Create SRVs for each city material.
-        for (int i = 0; i < CityMaterialCount; ++i)
+        // Create SRVs for each city material: g_txMats[i + 1], i.e. t(i + 2).
+        for (UINT i = 0; i < CityMaterialCount; ++i)
         {
             D3D12_SHADER_RESOURCE_VIEW_DESC materialSrvDesc = {};
             materialSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
             materialSrvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
             materialSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
             materialSrvDesc.Texture2D.MipLevels = 1;
-            m_device->CreateShaderResourceView(m_cityMaterialTextures[i].Get(), &materialSrvDesc, srvHandle);
-
-            //srvHandle.Offset(m_cbvSrvDescriptorSize);
-            srvHandle = m_cbvSrvDescriptorHeap->GetCpuHandle(i + 2);
+            m_device->CreateShaderResourceView(m_cityMaterialTextures[i].Get(), &materialSrvDesc, stageCityView(2 + i));
         }
+
+        // The tables stay bound for as long as the scene renderer lives, so they are pinned.
+        m_citySrvTable = m_srvTableCache->GetTable(m_cityViews.data(), static_cast<UINT>(m_cityViews.size()), true);
+        const std::vector<FBindlessHandle> samplerViews = m_samplerCache->GetViews();
+        m_citySamplerTable = m_samplerTableCache->GetTable(samplerViews.data(), static_cast<UINT>(samplerViews.size()), true);
     }
 
     free(pMeshData);
@@ -624,12 +653,17 @@ void D3D12DynamicIndexing::LoadAssets()
     ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
     m_fenceValue = m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
-    // Create synchronization objects and wait until assets have been uploaded to the GPU.
-    {
-        m_commandQueue->WaitForFenceCPUBlocking(m_fenceValue);
-    }
+    // No need to wait for the copies: the frames go on the same queue, after them. Only the upload
+    // memory has to outlive them.
+    assetUploadRing->OnSubmit(m_fenceValue);
+    m_fenceWatcher->DeferRelease(m_fenceValue, std::move(assetUploadRing));
 
-    CreateFrameResources();
+    // The renderer's first frame picks these up again; the allocator once the copies are done.
+    m_commandList.Reset();
+    m_commandListPool->ReleaseCommandList(pLoadCommandList, m_fenceValue);
+    m_commandListPool->ReleaseAllocator(pLoadAllocator, m_fenceValue);
+
+    CreateSceneRenderer();
 }
 
 // Update frame-based values.
@@ -639,35 +673,23 @@ void D3D12DynamicIndexing::OnUpdate()
 
     if (m_frameCounter == 500)
     {
-        // Update window text with FPS value.
-        wchar_t fps[64];
-        swprintf_s(fps, L"%ufps", m_timer.GetFramesPerSecond());
+        // Update window text with FPS value and how long the CPU waited on the GPU per frame.
+        const FScenePacingStats& pacing = m_sceneRenderer->GetPacingStats();
+        const double waitMs = pacing.FrameCount ? pacing.TotalWaitMs / pacing.FrameCount : 0.0;
+        wchar_t fps[128];
+        swprintf_s(fps, L"%ufps, gpu wait %.2fms/frame (max %.2fms)", m_timer.GetFramesPerSecond(), waitMs, pacing.MaxWaitMs);
         SetCustomWindowText(fps);
+        m_sceneRenderer->ResetPacingStats();
         m_frameCounter = 0;
     }
 
     m_frameCounter++;
 
-    // Get current GPU progress against submitted workload. Resources still scheduled 
-    // for GPU execution cannot be modified or else undefined behavior will result.
-    //const UINT64 lastCompletedFence = m_fence->GetCompletedValue();
-    const UINT64 lastCompletedFence = m_commandQueue->GetLastCompletedFence();
-
-    // Move to the next frame resource.
-    m_currentFrameResourceIndex = (m_currentFrameResourceIndex + 1) % FrameCount;
-    m_pCurrentFrameResource = m_frameResources[m_currentFrameResourceIndex];
-
-    // Make sure that this frame resource isn't still in use by the GPU.
-    // If it is, wait for it to complete.
-	/*if (m_pCurrentFrameResource->m_fenceValue != 0 && m_pCurrentFrameResource->m_fenceValue > lastCompletedFence)
-	{
-		ThrowIfFailed(m_fence->SetEventOnCompletion(m_pCurrentFrameResource->m_fenceValue, m_fenceEvent));
-		WaitForSingleObject(m_fenceEvent, INFINITE);
-	}*/
-    m_commandQueue->WaitForFenceCPUBlocking(m_fenceValue);
+    // Move to the next frame resource and make sure the GPU is done with it.
+    m_sceneRenderer->BeginFrame();
 
     m_camera.Update(static_cast<float>(m_timer.GetElapsedSeconds()));
-    m_pCurrentFrameResource->UpdateConstantBuffers(m_camera.GetViewMatrix(), m_camera.GetProjectionMatrix(0.8f, m_aspectRatio));
+    m_sceneRenderer->Update(m_camera.GetViewMatrix(), m_camera.GetProjectionMatrix(0.8f, m_aspectRatio));
 }
 
 // Render the scene.
@@ -675,23 +697,20 @@ void D3D12DynamicIndexing::OnRender()
 {
     PIXBeginEvent(m_commandQueue->Get(), 0, L"Render");
 
-    // Record all the commands we need to render the scene into the command list.
-    PopulateCommandList(m_pCurrentFrameResource);
-
-    // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_fenceValue = m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    // Record all the commands we need to render the scene and execute them.
+    FSceneRenderTarget target;
+    target.pBackBuffer = m_rhiRenderTargets[m_frameIndex].get();
+    target.RenderTargetView.ptr = m_rtvDescriptorHeap->GetCpuHandle(m_frameIndex).ptr;
+    target.DepthStencilView.ptr = m_dsvDescriptorHeap->GetCpuHandle(0).ptr;
+    target.Viewport = { m_viewport.TopLeftX, m_viewport.TopLeftY, m_viewport.Width, m_viewport.Height, m_viewport.MinDepth, m_viewport.MaxDepth };
+    target.ScissorRect = { m_scissorRect.left, m_scissorRect.top, m_scissorRect.right, m_scissorRect.bottom };
+    m_fenceValue = m_sceneRenderer->Render(target);
 
     PIXEndEvent(m_commandQueue->Get());
 
     // Present and update the frame index for the next frame.
     ThrowIfFailed(m_swapChain->Present(1, 0));
     m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
-
-    // Signal and increment the fence value.
-    m_pCurrentFrameResource->m_fenceValue = m_fenceValue;
-    //ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_fenceValue));
-   // m_fenceValue++;
 }
 
 void D3D12DynamicIndexing::OnDestroy()
@@ -708,10 +727,12 @@ void D3D12DynamicIndexing::OnDestroy()
         // IMPORTANT: also wait for any GPU work queued by the last Present.
         // The fence signaled in ExecuteCommandLists() is inserted before Present().
         // If we exit right after Present, swapchain backbuffers can still be in-flight.
-        const UINT64 presentFence = m_commandQueue->GetNextFenceValue();
-        ThrowIfFailed(m_commandQueue->Get()->Signal(m_commandQueue->GetFence(), presentFence));
+        const UINT64 presentFence = m_commandQueue->Signal();
         m_commandQueue->WaitForFenceCPUBlocking(presentFence);
 
+        // Runs the releases still deferred, now that nothing is in flight.
+        m_fenceWatcher.reset();
+
         //// Signal and increment the fence value.
         //ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), m_fenceValue));
         //m_fenceValue++;
@@ -724,9 +745,13 @@ void D3D12DynamicIndexing::OnDestroy()
         //}
     }
 
-    for (UINT i = 0; i < m_frameResources.size(); i++)
+    m_sceneRenderer.reset();
+
+    // Store the pipelines compiled this run, so the next run loads them instead.
+    std::string pipelineLibraryError;
+    if (!m_pipelineCache->Save(&pipelineLibraryError))
     {
-        delete m_frameResources.at(i);
+        OutputDebugStringA(("Pipeline library not saved: " + pipelineLibraryError + "\n").c_str());
     }
 }
 
@@ -758,85 +783,36 @@ void D3D12DynamicIndexing::OnMouseMove(WPARAM btnState, int x, int y)
 
 
 // Create the resources that will be used every frame.
-void D3D12DynamicIndexing::CreateFrameResources()
-{
-    // Initialize each frame resource.
-    CD3DX12_CPU_DESCRIPTOR_HANDLE cbvSrvHandle(m_cbvSrvDescriptorHeap->GetCpuHandle(CityMaterialCount + 2));    // Move past the SRVs.
-    for (UINT i = 0; i < FrameCount; i++)
-    {
-        FrameResource* pFrameResource = new FrameResource(m_device.Get(), CityRowCount, CityColumnCount, CityMaterialCount, CitySpacingInterval);
-
-        UINT64 cbOffset = 0;
-        for (UINT j = 0; j < CityRowCount; j++)
-        {
-            for (UINT k = 0; k < CityColumnCount; k++)
-            {
-                // Describe and create a constant buffer view (CBV).
-                D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-                cbvDesc.BufferLocation = pFrameResource->m_cbvUploadHeap->GetGPUVirtualAddress() + cbOffset;
-                cbvDesc.SizeInBytes = sizeof(FrameResource::SceneConstantBuffer);
-                cbOffset += cbvDesc.SizeInBytes;
-                m_device->CreateConstantBufferView(&cbvDesc, cbvSrvHandle);
-                cbvSrvHandle.Offset(m_cbvSrvDescriptorSize);
-            }
-        }
-
-        pFrameResource->InitBundle(m_device.Get(), m_pipelineState.Get(), i, m_numIndices, &m_indexBufferView,
-            &m_vertexBufferView, m_cbvSrvDescriptorHeap->GetHeap(), m_cbvSrvDescriptorSize, m_samplerDescriptorHeap->GetHeap(), m_rootSignature.Get());
-
-        m_frameResources.push_back(pFrameResource);
-    }
-}
-
-void D3D12DynamicIndexing::PopulateCommandList(FrameResource* pFrameResource)
+void D3D12DynamicIndexing::CreateSceneRenderer()
 {
-    // Command list allocators can only be reset when the associated
-    // command lists have finished execution on the GPU; apps should use
-    // fences to determine GPU execution progress.
-    ThrowIfFailed(m_pCurrentFrameResource->m_commandAllocator->Reset());
-
-    // However, when ExecuteCommandList() is called on a particular command
-    // list, that command list can then be reset at any time and must be before
-    // re-recording.
-    ThrowIfFailed(m_commandList->Reset(m_pCurrentFrameResource->m_commandAllocator.Get(), m_pipelineState.Get()));
-
-    // Set necessary state.
-    m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-
-    ID3D12DescriptorHeap* ppHeaps[] = { m_cbvSrvDescriptorHeap->GetHeap(), m_samplerDescriptorHeap->GetHeap() };
-    m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-
-    m_commandList->RSSetViewports(1, &m_viewport);
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
-
-    // Indicate that the back buffer will be used as a render target.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvDescriptorHeap->GetCpuHandle(m_frameIndex));
-    CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(m_dsvDescriptorHeap->GetCpuHandle(0));
-    m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
-
-    // Record commands.
-    const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-    m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-    m_commandList->ClearDepthStencilView(m_dsvDescriptorHeap->GetCpuHandle(0), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-
-    PIXBeginEvent(m_commandList.Get(), 0, L"Draw cities");
-    if (UseBundles)
-    {
-        // Execute the prebuilt bundle.
-        m_commandList->ExecuteBundle(pFrameResource->m_GraphicCommandList.Get());
-    }
-    else
-    {
-        // Populate a new command list.
-        pFrameResource->PopulateCommandList(m_commandList.Get(), m_currentFrameResourceIndex, m_numIndices, &m_indexBufferView,
-            &m_vertexBufferView, m_cbvSrvDescriptorHeap->GetHeap(), m_cbvSrvDescriptorSize, m_samplerDescriptorHeap->GetHeap(), m_rootSignature.Get());
-    }
-    PIXEndEvent(m_commandList.Get());
-
-    // Indicate that the back buffer will now be used to present.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-
-    //ThrowIfFailed(m_commandList->Close());
+    FSceneRendererDesc desc;
+    desc.pDevice = m_rhiDevice.get();
+    desc.pPipelineState = m_pipelineCache->Wait(m_cityPipeline);
+    desc.pRootSignature = m_rhiRootSignature.get();
+    desc.pCbvSrvDescriptorHeap = m_rhiCbvSrvDescriptorHeap.get();
+    desc.pSamplerDescriptorHeap = m_rhiSamplerDescriptorHeap.get();
+    desc.SrvTable = m_citySrvTable;
+    desc.SamplerTable = m_citySamplerTable;
+    desc.VertexBufferView = { m_vertexBufferView.BufferLocation, m_vertexBufferView.SizeInBytes, m_vertexBufferView.StrideInBytes };
+    desc.IndexBufferView = { m_indexBufferView.BufferLocation, m_indexBufferView.SizeInBytes, static_cast<ERHIIndexFormat>(m_indexBufferView.Format) };
+    desc.NumIndices = m_numIndices;
+    desc.FrameCount = FrameCount;
+    desc.MaxFramesInFlight = MaxFramesInFlight;
+    desc.CityRowCount = CityRowCount;
+    desc.CityColumnCount = CityColumnCount;
+    desc.CityMaterialCount = CityMaterialCount;
+    desc.CitySpacingInterval = CitySpacingInterval;
+    desc.UseBundles = UseBundles;
+    desc.UseInstancing = UseInstancing;
+    desc.UseFrustumCulling = UseFrustumCulling;
+    desc.InstanceBoundsMin = m_meshBoundsMin;
+    desc.InstanceBoundsMax = m_meshBoundsMax;
+    desc.UseBvh = UseBvh;
+    desc.UseOcclusionCulling = UseOcclusionCulling;
+    desc.RecordCommandListCount = RecordCommandListCount;
+    desc.pJobSystem = m_jobSystem.get();
+    desc.pUploadRing = m_uploadRing.get();
+    desc.pCommandListPool = m_commandListPool.get();
+
+    m_sceneRenderer = std::make_unique<FSceneRenderer>(desc);
 }
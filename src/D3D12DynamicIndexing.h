@@ -13,11 +13,18 @@
 
 #include "DXSample.h"
 #include "StepTimer.h"
-#include "FrameResource.h"
+#include "SceneRenderer.h"
+#include "Jobs/JobSystem.h"
 #include "FCamera.h"
 #include "DescriptorHeapManagement.h"
+#include "Render/CommandListPool.h"
+#include "Render/DescriptorCache.h"
+#include "Render/FenceWatcher.h"
+#include "Render/PipelineCache.h"
+#include "Render/SamplerCache.h"
 
 #include "D3D12QueueManger.h"
+#include "DX12RHI.h"
 
 using namespace DirectX;
 
@@ -46,16 +53,23 @@ public:
 
 private:
     static const UINT FrameCount = 3;
+    static const UINT MaxFramesInFlight = 2;    // CPU run-ahead limit, 1..FrameCount.
     static const UINT CityRowCount = 15;
     static const UINT CityColumnCount = 8;
     static const UINT CityMaterialCount = CityRowCount * CityColumnCount;
     static const UINT CityMaterialTextureWidth = 64;
     static const UINT CityMaterialTextureHeight = 64;
     static const UINT CityMaterialTextureChannelCount = 4;
-    static const bool UseBundles = true;
+    static const bool UseBundles = false;       // Bundles bake every draw, so they exclude UseFrustumCulling.
+    static const bool UseInstancing = true;    // One instanced draw for all cities (shader_mesh_instanced_vert.hlsl).
+    static const bool UseFrustumCulling = true;
+    static const bool UseBvh = false;              // Brute-force culling is cheaper for a grid this small.
+    static const bool UseOcclusionCulling = false;   // Needs an occluder box known to lie inside the city mesh.
+    static const UINT RecordCommandListCount = 4;    // Lists the city draws are recorded into (as jobs) when UseBundles is false.
     static const float CitySpacingInterval;
 
     std::unique_ptr<Direct3DQueueManager> mQueueManager;
+    std::unique_ptr<DX12RHIDevice> m_rhiDevice;
     // Pipeline objects.
     CD3DX12_VIEWPORT m_viewport;
     CD3DX12_RECT m_scissorRect;
@@ -63,30 +77,49 @@ private:
     ComPtr<ID3D12Device> m_device;
     ComPtr<ID3D12Resource> m_renderTargets[FrameCount];
     ComPtr<ID3D12Resource> m_depthStencil;
-    ComPtr<ID3D12CommandAllocator> m_commandAllocator;
     Direct3DQueue* m_commandQueue;
     ComPtr<ID3D12RootSignature> m_rootSignature;
     //ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
    // ComPtr<ID3D12DescriptorHeap> m_cbvSrvHeap;
    // ComPtr<ID3D12DescriptorHeap> m_dsvHeap;
    // ComPtr<ID3D12DescriptorHeap> m_samplerHeap;
-    ComPtr<ID3D12PipelineState> m_pipelineState;
+    // The asset upload list, taken from m_commandListPool; the d3dx12 copy helpers want the native list.
     ComPtr<ID3D12GraphicsCommandList> m_commandList;
 
 	std::unique_ptr<DescriptorHeap> m_cbvSrvDescriptorHeap;
     std::unique_ptr<DescriptorHeap> m_rtvDescriptorHeap;
     std::unique_ptr<DescriptorHeap> m_dsvDescriptorHeap;
     std::unique_ptr<DescriptorHeap> m_samplerDescriptorHeap;
+
+    // RHI views of the objects above, consumed by the scene renderer.
+    std::unique_ptr<DX12RHIRootSignature> m_rhiRootSignature;
+    std::unique_ptr<DX12RHIDescriptorHeap> m_rhiCbvSrvDescriptorHeap;
+    std::unique_ptr<DX12RHIDescriptorHeap> m_rhiSamplerDescriptorHeap;
+
+    // Authoritative views, CPU-only, and the tables assembled from them in the heaps above.
+    std::unique_ptr<FDescriptorStagingHeap> m_srvStagingHeap;
+    std::unique_ptr<FDescriptorStagingHeap> m_samplerStagingHeap;
+    std::unique_ptr<FDescriptorTableCache> m_srvTableCache;
+    std::unique_ptr<FDescriptorTableCache> m_samplerTableCache;
+    // Every sampler the assets ask for, once each; the sampler table lists them by cache index.
+    std::unique_ptr<FSamplerCache> m_samplerCache;
+    // The city SRV table, root parameter 0: t0 (null), the diffuse texture, the CityMaterialCount
+    // materials, then the StructBufferNum structured buffers (space1).
+    std::vector<FBindlessHandle> m_cityViews;
+    FRHIGpuDescriptor m_citySrvTable;
+    FRHIGpuDescriptor m_citySamplerTable;
+    std::unique_ptr<DX12RHIResource> m_rhiRenderTargets[FrameCount];
         
     // App resources.
     UINT m_numIndices;
+    FVector3 m_meshBoundsMin;    // Local bounds of the city mesh, for frustum culling.
+    FVector3 m_meshBoundsMax;
     ComPtr<ID3D12Resource> m_vertexBuffer;
     ComPtr<ID3D12Resource> m_indexBuffer;
     ComPtr<ID3D12Resource> m_cityDiffuseTexture;
     ComPtr<ID3D12Resource> m_cityMaterialTextures[CityMaterialCount];
 
     ComPtr<ID3D12Resource> m_cityMaterialStructures[CityMaterialCount];
-    UINT32 StructBufferOffset = 0;
     UINT32 StructBufferNum = 0;
 
     // read back
@@ -100,20 +133,29 @@ private:
     FCamera m_camera;
 
 
-    // Frame resources.
-    std::vector<FrameResource*> m_frameResources;
-    FrameResource* m_pCurrentFrameResource;
-    UINT m_currentFrameResourceIndex;
+    // Shared by asset loading and the scene renderer; created first, destroyed last.
+    std::unique_ptr<FJobSystem> m_jobSystem;
+
+    // Pipelines, compiled on m_jobSystem or loaded from the pipeline library an earlier run saved.
+    std::unique_ptr<FPipelineCache> m_pipelineCache;
+    FPipelineCacheEntry* m_cityPipeline = nullptr;
+
+    // Upload memory for the renderer's per-frame data.
+    std::unique_ptr<FUploadRing> m_uploadRing;
+    // Runs the deferred releases, such as the asset copies' upload memory, as their fences complete.
+    std::unique_ptr<FFenceWatcher> m_fenceWatcher;
+    // Command allocators and lists for the asset upload and the renderer's frames.
+    std::unique_ptr<FCommandListPool> m_commandListPool;
+
+    // Per-frame update/record/submit path (owns the frame resources).
+    std::unique_ptr<FSceneRenderer> m_sceneRenderer;
 
     // Synchronization objects.
     UINT m_frameIndex;
     UINT m_frameCounter;
-    HANDLE m_fenceEvent;
-    ComPtr<ID3D12Fence> m_fence;
     UINT64 m_fenceValue;
 
     void LoadPipeline();
     void LoadAssets();
-    void CreateFrameResources();
-    void PopulateCommandList(FrameResource* pFrameResource);
+    void CreateSceneRenderer();
 };
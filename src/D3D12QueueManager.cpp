@@ -5,11 +5,12 @@
 #include "Direct3DUtils.h"
 
 Direct3DQueue::Direct3DQueue(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE commandType)
+	: mSubmissions(((uint64_t)commandType << 56) + 1,
+		[this](uint32_t count, void* const* lists, uint64_t fenceValue) { ExecuteBatch(count, lists, fenceValue); })
 {
 	mQueueType = commandType;
 	mCommandQueue = nullptr;
 	mFence = NULL;
-	mNextFenceValue = ((uint64_t)mQueueType << 56) + 1;
 	mLastCompletedFenceValue = ((uint64_t)mQueueType << 56);
 
 	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
@@ -45,8 +46,13 @@ Direct3DQueue::~Direct3DQueue()
 
 uint64 Direct3DQueue::PollCurrentFenceValue()
 {
-	mLastCompletedFenceValue = MathHelper::Max(mLastCompletedFenceValue, mFence->GetCompletedValue());
-	return mLastCompletedFenceValue;
+	// Any thread may poll: only ever move the value forward.
+	const uint64 completed = mFence->GetCompletedValue();
+	uint64 last = mLastCompletedFenceValue.load();
+	while (last < completed && !mLastCompletedFenceValue.compare_exchange_weak(last, completed))
+	{
+	}
+	return MathHelper::Max(last, completed);
 }
 
 bool Direct3DQueue::IsFenceComplete(uint64 fenceValue)
@@ -66,12 +72,21 @@ void Direct3DQueue::InsertWait(uint64 fenceValue)
 
 void Direct3DQueue::InsertWaitForQueueFence(Direct3DQueue* otherQueue, uint64 fenceValue)
 {
+	if (otherQueue == this)
+	{
+		return;
+	}
+
+	// The value must be signaled eventually, so the lists it waits for cannot stay queued; and the
+	// lists submitted here before the wait must not end up behind it.
+	otherQueue->mSubmissions.FlushUntil(fenceValue);
+	mSubmissions.FlushUntil(GetNextFenceValue() - 1);
 	mCommandQueue->Wait(otherQueue->GetFence(), fenceValue);
 }
 
 void Direct3DQueue::InsertWaitForQueue(Direct3DQueue* otherQueue)
 {
-	mCommandQueue->Wait(otherQueue->GetFence(), otherQueue->GetNextFenceValue() - 1);
+	InsertWaitForQueueFence(otherQueue, otherQueue->GetNextFenceValue() - 1);
 }
 
 void Direct3DQueue::WaitForFenceCPUBlocking(uint64 fenceValue)
@@ -81,28 +96,49 @@ void Direct3DQueue::WaitForFenceCPUBlocking(uint64 fenceValue)
 		return;
 	}
 
+	mSubmissions.FlushUntil(fenceValue);
 	{
 		std::lock_guard<std::mutex> lockGuard(mEventMutex);
 
 		mFence->SetEventOnCompletion(fenceValue, mFenceEventHandle);
 		WaitForSingleObjectEx(mFenceEventHandle, INFINITE, false);
-		mLastCompletedFenceValue = fenceValue;
 	}
+	PollCurrentFenceValue();
+}
+
+void Direct3DQueue::SetEventOnCompletion(uint64 fenceValue, HANDLE event)
+{
+	mSubmissions.FlushUntil(fenceValue);
+	ThrowIfFailed(mFence->SetEventOnCompletion(fenceValue, event));
 }
 
 uint64 Direct3DQueue::ExecuteCommandList(ID3D12CommandList* commandList)
 {
-	ThrowIfFailed(((ID3D12GraphicsCommandList*)commandList)->Close());
-	mCommandQueue->ExecuteCommandLists(1, &commandList);
+	return ExecuteCommandLists(1, &commandList);
+}
 
-	std::lock_guard<std::mutex> lockGuard(mFenceMutex);
+uint64 Direct3DQueue::ExecuteCommandLists(UINT count, ID3D12CommandList* const* lists)
+{
+	const uint64 fenceValue = SubmitCommandLists(count, lists);
+	mSubmissions.FlushUntil(fenceValue);
+	return fenceValue;
+}
 
-	mCommandQueue->Signal(mFence, mNextFenceValue);
+uint64 Direct3DQueue::SubmitCommandLists(UINT count, ID3D12CommandList* const* lists)
+{
+	// Closing is the submitter's work, so recorders close their lists in parallel.
+	CloseCommandLists(count, lists);
+	return mSubmissions.Enqueue(count, reinterpret_cast<void* const*>(lists));
+}
 
-	return mNextFenceValue++;
+uint64 Direct3DQueue::Signal()
+{
+	const uint64 fenceValue = mSubmissions.EnqueueSignal();
+	mSubmissions.FlushUntil(fenceValue);
+	return fenceValue;
 }
 
-uint64 Direct3DQueue::ExecuteCommandLists(UINT count,ID3D12CommandList* const* lists)
+void Direct3DQueue::CloseCommandLists(UINT count, ID3D12CommandList* const* lists)
 {
 	if (!lists || count == 0)
 	{
@@ -118,12 +154,18 @@ uint64 Direct3DQueue::ExecuteCommandLists(UINT count,ID3D12CommandList* const* l
 		}
 		ThrowIfFailed(gcl->Close());
 	}
+}
 
-	mCommandQueue->ExecuteCommandLists(count, lists);
-
-	std::lock_guard<std::mutex> lockGuard(mFenceMutex);
-	ThrowIfFailed(mCommandQueue->Signal(mFence, mNextFenceValue));
-	return mNextFenceValue++;
+// On the flushing thread, one batch at a time. Errors cannot be thrown from here (the batcher would
+// never signal the batch); a failed Signal means the device was removed, which the next Present or
+// wait reports.
+void Direct3DQueue::ExecuteBatch(uint32_t count, void* const* lists, uint64_t fenceValue)
+{
+	if (count > 0)
+	{
+		mCommandQueue->ExecuteCommandLists(count, reinterpret_cast<ID3D12CommandList* const*>(lists));
+	}
+	mCommandQueue->Signal(mFence, fenceValue);
 }
 
 
@@ -172,6 +214,11 @@ void Direct3DQueueManager::WaitForFenceCPUBlocking(uint64 fenceValue)
 	commandQueue->WaitForFenceCPUBlocking(fenceValue);
 }
 
+void Direct3DQueueManager::InsertWaitForFence(Direct3DQueue* waitingQueue, uint64 fenceValue)
+{
+	waitingQueue->InsertWaitForQueueFence(GetQueue((D3D12_COMMAND_LIST_TYPE)(fenceValue >> 56)), fenceValue);
+}
+
 void Direct3DQueueManager::WaitForAllIdle()
 {
 	mGraphicsQueue->WaitForIdle();
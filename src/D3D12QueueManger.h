@@ -1,6 +1,8 @@
 #pragma once
 #include "stdafx.h"
 #include "Assert.h"
+#include "RHISubmissionBatcher.h"
+#include <atomic>
 #include <mutex>
 
 // Note that while ComPtr is used to manage the lifetime of resources on the CPU,
@@ -10,6 +12,10 @@
 // An example of this can be found in the class method: OnDestroy().
 using Microsoft::WRL::ComPtr;
 
+// Submissions go through an RHISubmissionBatcher: any thread may submit without a lock, each list
+// takes the next fence value from an atomic counter, and the lists are executed in that order, one
+// ExecuteCommandLists and one Signal per batch. ExecuteCommandLists() flushes before returning;
+// SubmitCommandLists() leaves that to Flush(), so lists from many threads go to the GPU together.
 class Direct3DQueue
 {
 public:
@@ -18,11 +24,18 @@ public:
 
 	bool IsFenceComplete(uint64 fenceValue);
 	void InsertWait(uint64 fenceValue);
+	// Holds back the lists submitted here after the call until otherQueue's fence reaches
+	// fenceValue. Both queues are flushed first: the wait goes after the lists submitted here
+	// before it, and fenceValue is sure to be signaled. Nothing to do when otherQueue is this one.
 	void InsertWaitForQueueFence(Direct3DQueue* otherQueue, uint64 fenceValue);
 	void InsertWaitForQueue(Direct3DQueue* otherQueue);
 
+	// Flushes the submissions up to fenceValue first, so it never waits on lists still queued here.
 	void WaitForFenceCPUBlocking(uint64 fenceValue);
-	void WaitForIdle() { WaitForFenceCPUBlocking(mNextFenceValue - 1); }
+	// Sets event once the fence reaches fenceValue, after flushing the submissions up to it. The
+	// same event may be armed on several queues' fences to wait for whichever completes first.
+	void SetEventOnCompletion(uint64 fenceValue, HANDLE event);
+	void WaitForIdle() { WaitForFenceCPUBlocking(GetNextFenceValue() - 1); }
 
 	ID3D12CommandQueue* GetCommandQueue() { return mCommandQueue.Get(); }
 	ID3D12CommandQueue* Get() const { return mCommandQueue.Get(); }
@@ -30,23 +43,34 @@ public:
 
 	uint64 PollCurrentFenceValue();
 	uint64 GetLastCompletedFence() { return mLastCompletedFenceValue; }
-	uint64 GetNextFenceValue() { return mNextFenceValue; }
+	uint64 GetNextFenceValue() { return mSubmissions.GetNextFenceValue(); }
 	ID3D12Fence* GetFence() { return mFence; }
 
+	// Close the lists, then execute them after everything submitted before. Returns the fence
+	// value that marks their completion; the lists have been handed to the GPU on return.
 	uint64 ExecuteCommandList(ID3D12CommandList* List);
 	uint64 ExecuteCommandLists(UINT count, ID3D12CommandList* const* lists);
+	// Like ExecuteCommandLists(), but leaves the lists queued for the next Flush(): they must not be
+	// reset until it has returned.
+	uint64 SubmitCommandLists(UINT count, ID3D12CommandList* const* lists);
+	void Flush() { mSubmissions.Flush(); }
+	// Signals the fence after everything submitted so far and whatever was queued on the
+	// ID3D12CommandQueue directly since (e.g. by Present). Returns the value.
+	uint64 Signal();
 
 private:
 	ComPtr<ID3D12CommandQueue> mCommandQueue;
 	D3D12_COMMAND_LIST_TYPE mQueueType;
 
-	std::mutex mFenceMutex;
+	void CloseCommandLists(UINT count, ID3D12CommandList* const* lists);
+	void ExecuteBatch(uint32_t count, void* const* lists, uint64_t fenceValue);
+
 	std::mutex mEventMutex;
 
 	ID3D12Fence* mFence;
-	uint64 mNextFenceValue;
-	uint64 mLastCompletedFenceValue;
+	std::atomic<uint64> mLastCompletedFenceValue;
 	HANDLE mFenceEventHandle;
+	RHISubmissionBatcher mSubmissions;
 };
 
 class Direct3DQueueManager
@@ -65,6 +89,11 @@ public:
 	void WaitForFenceCPUBlocking(uint64 fenceValue);
 	void WaitForAllIdle();
 
+	// Cross-queue dependency: work submitted to the compute or copy queue returns a fence value
+	// naming that queue, and waitingQueue's later lists start only once it is reached, so culling,
+	// mip generation or uploads overlap the graphics work before them.
+	void InsertWaitForFence(Direct3DQueue* waitingQueue, uint64 fenceValue);
+
 private:
 	Direct3DQueue* mGraphicsQueue;
 	Direct3DQueue* mComputeQueue;
@@ -2,10 +2,11 @@
 #include <d3d12.h>
 #include <wrl.h>
 #include <vector>
-#include <queue>
-#include <mutex>
+#include <memory>
 #include <stdexcept>
 #include "d3dx12.h" // 微软官方辅助库
+#include "../Common/Render/BindlessSlotAllocator.h"
+#include "../Common/Render/DescriptorRing.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -13,7 +14,7 @@ using Microsoft::WRL::ComPtr;
 class DescriptorHeap {
 public:
 	DescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT numDescriptors, bool isShaderVisible,UINT NodeMask = 0u)
-		: m_Type(type), m_MaxDescriptors(numDescriptors) {
+		: m_Type(type), m_MaxDescriptors(numDescriptors), m_IsShaderVisible(isShaderVisible) {
 
 		D3D12_DESCRIPTOR_HEAP_DESC desc = {};
 		desc.Type = type;
@@ -39,6 +40,9 @@ public:
 	}
 
 	UINT GetDescriptorSize() const { return m_DescriptorSize; }
+	UINT GetNumDescriptors() const { return m_MaxDescriptors; }
+	D3D12_DESCRIPTOR_HEAP_TYPE GetType() const { return m_Type; }
+	bool IsShaderVisible() const { return m_IsShaderVisible; }
 
 	void SetName(const std::wstring& name) {
 		m_Heap->SetName(name.c_str());
@@ -50,85 +54,111 @@ private:
 	UINT m_DescriptorSize;
 	UINT m_MaxDescriptors;
 	D3D12_DESCRIPTOR_HEAP_TYPE m_Type;
+	bool m_IsShaderVisible;
 };
 
 // 适用于：SRV (纹理), UAV, 静态 CBV
-// 策略：Pre-filled / Huge Array
+// 策略：两级位图 (FBindlessSlotAllocator)，无锁分配，构造只需填位图
+// 句柄带代数 (generation)，释放后再用旧句柄会被发现；释放可延迟到 GPU fence 完成
 class BindlessAllocator {
 public:
 	BindlessAllocator(ID3D12Device* device, UINT maxDescriptors)
-		: m_Heap(std::make_unique<DescriptorHeap>(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, maxDescriptors, true))
+		: m_Heap(std::make_unique<DescriptorHeap>(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, maxDescriptors, true)),
+		m_Slots(maxDescriptors)
 	{
-		// 初始化空闲列表，所有槽位初始都是空的
-		for (UINT i = 0; i < maxDescriptors; ++i) {
-			m_FreeIndices.push(i);
-		}
 	}
 
-	// 分配一个固定的槽位
-	// 返回值：Index (用于 Shader 中的索引)
-	UINT Allocate(D3D12_CPU_DESCRIPTOR_HANDLE& outCpuHandle) {
-		std::lock_guard<std::mutex> lock(m_AllocationMutex);
-		if (m_FreeIndices.empty()) {
+	// 分配一个固定的槽位，可在任意线程调用
+	// 返回值：句柄，handle.Index 即 Shader 中的索引
+	FBindlessHandle Allocate(D3D12_CPU_DESCRIPTOR_HANDLE& outCpuHandle) {
+		return AllocateRange(1, outCpuHandle);
+	}
+
+	// 分配一段连续的槽位 (描述符表)，outCpuHandle 指向第一个，一起释放
+	FBindlessHandle AllocateRange(UINT numDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE& outCpuHandle) {
+		FBindlessHandle handle = m_Slots.AllocateRange(numDescriptors);
+		if (!handle.IsValid()) {
 			throw std::runtime_error("Bindless Heap out of memory");
 		}
 
-		UINT index = m_FreeIndices.front();
-		m_FreeIndices.pop();
+		outCpuHandle = m_Heap->GetCpuHandle(handle.Index);
+		return handle;
+	}
+
+	// 释放槽位：GPU 可能还在读，传入引用它的最后一次提交的 fence 值，
+	// 槽位在 ReleaseRetired() 看到该 fence 完成后才会被重新分配；0 表示立即释放
+	void Free(FBindlessHandle handle, UINT64 fenceValue = 0) {
+		if (!m_Slots.Free(handle, fenceValue)) {
+			throw std::runtime_error("Bindless handle freed twice or never allocated");
+		}
+	}
 
-		outCpuHandle = m_Heap->GetCpuHandle(index);
-		return index;
+	// 每帧调用，传入同一队列已完成的 fence 值
+	void ReleaseRetired(UINT64 completedFence) {
+		m_Slots.ReleaseRetired(completedFence);
 	}
 
-	// 释放槽位
-	void Free(UINT index) {
-		std::lock_guard<std::mutex> lock(m_AllocationMutex);
-		m_FreeIndices.push(index);
+	bool IsAlive(FBindlessHandle handle) const { return m_Slots.IsAlive(handle); }
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(FBindlessHandle handle) const {
+		if (!m_Slots.IsAlive(handle)) {
+			throw std::runtime_error("Bindless handle used after free");
+		}
+		return m_Heap->GetCpuHandle(handle.Index);
 	}
 
 	ID3D12DescriptorHeap* GetHeap() const { return m_Heap->GetHeap(); }
 	D3D12_GPU_DESCRIPTOR_HANDLE GetFirstGpuHandle() const { return m_Heap->GetGpuHandle(0); }
+	UINT GetUsedCount() const { return m_Slots.GetUsedCount(); }
 
 private:
 	std::unique_ptr<DescriptorHeap> m_Heap;
-	std::queue<UINT> m_FreeIndices;
-	std::mutex m_AllocationMutex;
+	FBindlessSlotAllocator m_Slots;
 };
 
 // 适用于：每帧变化的 CBV (如 Object Transform), 动态 SRV (如 UI, 粒子)
-// 策略：Basic Strategy (Linear Allocation)
+// 策略：环形缓冲 (FDescriptorRing)，按帧打上 fence 标记
+// 每帧的分配在 EndFrame() 时记上该帧提交的 fence 值，ReleaseRetired() 在 fence 完成后
+// 才把尾部前移，所以 N 帧在途时不会覆盖 GPU 还在读的描述符，堆只需容纳在途帧的总用量
 class LinearAllocator {
 public:
 	LinearAllocator(ID3D12Device* device, UINT maxDescriptors)
 		: m_Heap(std::make_unique<DescriptorHeap>(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, maxDescriptors, true)),
-		m_CurrentOffset(0), m_MaxDescriptors(maxDescriptors)
+		m_Ring(maxDescriptors)
 	{
 	}
 
-	// 每帧开始时调用，重置指针
+	// 丢弃所有分配，只能在 GPU 空闲时调用 (如等待 GPU 完成后改变窗口大小)
 	void Reset() {
-		m_CurrentOffset = 0;
+		m_Ring.Reset();
 	}
 
-	// 分配一块连续的描述符区域
+	// 分配一块连续的描述符区域，放不下堆尾剩余部分时从 0 重新开始
 	// 返回：GPU Handle (用于 SetGraphicsRootDescriptorTable)
 	D3D12_GPU_DESCRIPTOR_HANDLE Allocate(UINT numDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE& outCpuHandle) {
-		if (m_CurrentOffset + numDescriptors > m_MaxDescriptors) {
-			throw std::runtime_error("Linear Heap out of memory (increase size or optimize)");
+		const UINT startIndex = m_Ring.Allocate(numDescriptors);
+		if (startIndex == FDescriptorRing::Invalid) {
+			throw std::runtime_error("Linear Heap out of memory (increase size, or call ReleaseRetired() every frame)");
 		}
 
-		UINT startIndex = m_CurrentOffset;
 		outCpuHandle = m_Heap->GetCpuHandle(startIndex);
-		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = m_Heap->GetGpuHandle(startIndex);
+		return m_Heap->GetGpuHandle(startIndex);
+	}
 
-		m_CurrentOffset += numDescriptors;
-		return gpuHandle;
+	// 每帧提交后调用：上次 EndFrame() 以来的分配在 fenceValue 完成前保留
+	void EndFrame(UINT64 fenceValue) {
+		m_Ring.EndFrame(fenceValue);
+	}
+
+	// 每帧开始时调用，传入同一队列已完成的 fence 值，回收已完成帧的描述符
+	void ReleaseRetired(UINT64 completedFence) {
+		m_Ring.ReleaseRetired(completedFence);
 	}
 
 	ID3D12DescriptorHeap* GetHeap() const { return m_Heap->GetHeap(); }
+	UINT GetUsedCount() const { return m_Ring.GetUsedCount(); }
 
 private:
 	std::unique_ptr<DescriptorHeap> m_Heap;
-	UINT m_CurrentOffset;
-	UINT m_MaxDescriptors;
+	FDescriptorRing m_Ring;
 };
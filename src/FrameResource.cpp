@@ -9,11 +9,20 @@
 //
 //*********************************************************
 
-#include "stdafx.h"
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* pDevice, UINT cityRowCount, UINT cityColumnCount, UINT cityMaterialCount, float citySpacingInterval) :
+#include <algorithm>
+#include <cstddef>
+
+#include "Jobs/JobSystem.h"
+
+FrameResource::FrameResource(RHIDevice* pDevice, uint32_t cityRowCount, uint32_t cityColumnCount, uint32_t cityMaterialCount, const FAffineTransformArray& modelTransforms) :
+    m_pConstantBuffers(nullptr),
+    m_constantBufferGpuAddress(0),
+    m_pInstanceData(nullptr),
+    m_instanceDataGpuAddress(0),
     m_fenceValue(0),
+    m_pModelTransforms(&modelTransforms),
     m_pDevice(pDevice),
     m_cityRowCount(cityRowCount),
     m_cityColumnCount(cityColumnCount),
@@ -25,147 +34,171 @@ FrameResource::FrameResource(ID3D12Device* pDevice, UINT cityRowCount, UINT city
     m_StructBufferSize[1] = 1;
     m_StructBufferSize[2] = 3;
     m_StructBufferSize[3] = 2;
-    m_modelMatrices.resize(m_cityRowCount * m_cityColumnCount);
-
-    // The command allocator is used by the main sample class when 
-    // resetting the command list in the main update loop. Each frame 
-    // resource needs a command allocator because command allocators 
-    // cannot be reused until the GPU is done executing the commands 
-    // associated with it.
-    ThrowIfFailed(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocator)));
-    ThrowIfFailed(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_BUNDLE, IID_PPV_ARGS(&m_bundleAllocator)));
-
-    // Create an upload heap for the constant buffers.
-    ThrowIfFailed(pDevice->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(sizeof(SceneConstantBuffer) * m_cityRowCount * m_cityColumnCount),
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_cbvUploadHeap)));
-
-    // Map the constant buffers. Note that unlike D3D11, the resource 
-    // does not need to be unmapped for use by the GPU. In this sample, 
-    // the resource stays 'permenantly' mapped to avoid overhead with 
-    // mapping/unmapping each frame.
-    CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
-    ThrowIfFailed(m_cbvUploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&m_pConstantBuffers)));
-
-    // Update all of the model matrices once; our cities don't move so 
-    // we don't need to do this ever again.
-    SetCityPositions(citySpacingInterval, -citySpacingInterval);
-
-	//
-	// Initialize an upload buffer
-	//
-
-	InitializeUploadBuffer(64 * 1024);
 }
 
 FrameResource::~FrameResource()
 {
-    m_cbvUploadHeap->Unmap(0, nullptr);
-    m_pConstantBuffers = nullptr;
+    if (m_bundleConstantBuffer)
+    {
+        m_bundleConstantBuffer->Unmap();
+        m_pConstantBuffers = nullptr;
+    }
 }
 
-void FrameResource::InitBundle(ID3D12Device* pDevice, ID3D12PipelineState* pPso,
-    UINT frameResourceIndex, UINT numIndices, D3D12_INDEX_BUFFER_VIEW* pIndexBufferViewDesc, D3D12_VERTEX_BUFFER_VIEW* pVertexBufferViewDesc,
-    ID3D12DescriptorHeap* pCbvSrvDescriptorHeap, UINT cbvSrvDescriptorSize, ID3D12DescriptorHeap* pSamplerDescriptorHeap, ID3D12RootSignature* pRootSignature)
+void FrameResource::InitBundle(const DrawBindings& bindings)
 {
-    ThrowIfFailed(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE, m_bundleAllocator.Get(), pPso, IID_PPV_ARGS(&m_GraphicCommandList)));
-    NAME_D3D12_OBJECT(m_GraphicCommandList);
+    if (!bindings.useInstancing)
+    {
+        // An upload heap for the constant buffers the bundle's draws point at, one slot per city.
+        // Note that unlike D3D11, the resource does not need to be unmapped for use by the GPU. In
+        // this sample, the resource stays 'permenantly' mapped to avoid overhead with
+        // mapping/unmapping each frame.
+        FRHIBufferDesc cbvUploadDesc;
+        cbvUploadDesc.SizeInBytes = uint64_t(ConstantBufferStride) * m_cityRowCount * m_cityColumnCount;
+        cbvUploadDesc.HeapType = ERHIHeapType::Upload;
+        cbvUploadDesc.InitialState = RHI_STATE_GENERIC_READ;
+        cbvUploadDesc.DebugName = L"m_bundleConstantBuffer";
+        m_bundleConstantBuffer = m_pDevice->CreateBuffer(cbvUploadDesc);
+        SetConstantBuffers(m_bundleConstantBuffer->Map(), m_bundleConstantBuffer->GetGpuVirtualAddress());
+    }
 
-    PopulateCommandList(m_GraphicCommandList.Get(), frameResourceIndex, numIndices, pIndexBufferViewDesc,
-        pVertexBufferViewDesc, pCbvSrvDescriptorHeap, cbvSrvDescriptorSize, pSamplerDescriptorHeap, pRootSignature);
+    // The bundle is recorded once and executed every frame, so its allocator is never reset and
+    // stays with the frame resource rather than coming from the renderer's command list pool.
+    m_bundleAllocator = m_pDevice->CreateCommandAllocator(ERHICommandListType::Bundle);
+    m_bundle = m_pDevice->CreateCommandList(ERHICommandListType::Bundle, m_bundleAllocator.get(), bindings.pPipelineState);
 
-    ThrowIfFailed(m_GraphicCommandList->Close());
+    PopulateCommandList(m_bundle.get(), bindings);
+
+    m_bundle->Close();
 }
 
-void FrameResource::SetCityPositions(FLOAT intervalX, FLOAT intervalZ)
+void FrameResource::SetConstantBuffers(void* pConstantBuffers, uint64_t gpuAddress)
 {
-    for (UINT i = 0; i < m_cityRowCount; i++)
-    {
-        FLOAT cityOffsetZ = i * intervalZ;
-        for (UINT j = 0; j < m_cityColumnCount; j++)
-        {
-            FLOAT cityOffsetX = j * intervalX;
+    m_pConstantBuffers = static_cast<uint8_t*>(pConstantBuffers);
+    m_constantBufferGpuAddress = gpuAddress;
+}
 
-            // The y position is based off of the city's row and column 
-            // position to prevent z-fighting.
-            XMStoreFloat4x4(&m_modelMatrices[i * m_cityColumnCount + j], XMMatrixTranslation(cityOffsetX, 0.02f * (i * m_cityColumnCount + j), cityOffsetZ));
-        }
-    }
+void FrameResource::SetInstanceBuffer(InstanceData* pInstanceData, uint64_t gpuAddress)
+{
+    m_pInstanceData = pInstanceData;
+    m_instanceDataGpuAddress = gpuAddress;
 }
 
-void FrameResource::PopulateCommandList(ID3D12GraphicsCommandList* pCommandList,
-    UINT frameResourceIndex, UINT numIndices, D3D12_INDEX_BUFFER_VIEW* pIndexBufferViewDesc, D3D12_VERTEX_BUFFER_VIEW* pVertexBufferViewDesc,
-    ID3D12DescriptorHeap* pCbvSrvDescriptorHeap, UINT cbvSrvDescriptorSize, ID3D12DescriptorHeap* pSamplerDescriptorHeap, ID3D12RootSignature* pRootSignature)
+void FrameResource::PopulateCommandList(RHICommandList* pCommandList, const DrawBindings& bindings,
+    uint32_t firstCity, uint32_t cityCount, const uint32_t* pCityIndices)
 {
     // If the root signature matches the root signature of the caller, then
     // bindings are inherited, otherwise the bind space is reset.
-    pCommandList->SetGraphicsRootSignature(pRootSignature);
+    pCommandList->SetGraphicsRootSignature(bindings.pRootSignature);
 
-    ID3D12DescriptorHeap* ppHeaps[] = { pCbvSrvDescriptorHeap, pSamplerDescriptorHeap };
-    pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-    pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    pCommandList->IASetIndexBuffer(pIndexBufferViewDesc);
-    pCommandList->IASetVertexBuffers(0, 1, pVertexBufferViewDesc);
-    pCommandList->SetGraphicsRootDescriptorTable(0, pCbvSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-    pCommandList->SetGraphicsRootDescriptorTable(1, pSamplerDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+    RHIDescriptorHeap* ppHeaps[] = { bindings.pCbvSrvDescriptorHeap, bindings.pSamplerDescriptorHeap };
+    pCommandList->SetDescriptorHeaps(2, ppHeaps);
+    pCommandList->IASetPrimitiveTopology(ERHIPrimitiveTopology::TriangleList);
+    pCommandList->IASetIndexBuffer(bindings.pIndexBufferView);
+    pCommandList->IASetVertexBuffers(0, 1, bindings.pVertexBufferView);
+    pCommandList->SetGraphicsRootDescriptorTable(0, bindings.srvTable);
+    pCommandList->SetGraphicsRootDescriptorTable(1, bindings.samplerTable);
 
-    // Calculate the descriptor offset due to multiple frame resources.
-    // (m_cityMaterialCount + 1) SRVs + how many CBVs we have currently.
-    UINT frameResourceDescriptorOffset = (m_cityMaterialCount + 1) + (frameResourceIndex * m_cityRowCount * m_cityColumnCount);
-    CD3DX12_GPU_DESCRIPTOR_HANDLE cbvSrvHandle(pCbvSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart(), frameResourceDescriptorOffset, cbvSrvDescriptorSize);
+    if (bindings.useInstancing)
+    {
+        // The whole range in one draw; the vertex shader fetches its transform and material by
+        // SV_InstanceID. SV_InstanceID ignores StartInstanceLocation, so a sub-range is selected by
+        // offsetting the root SRV instead.
+        const uint32_t cityTotal = m_cityRowCount * m_cityColumnCount;
+        const uint32_t first = std::min(firstCity, cityTotal);
+        const uint32_t count = std::min(cityCount, cityTotal - first);
+        if (pCommandList->GetType() != ERHICommandListType::Bundle)
+        {
+            pCommandList->SetGraphicsRootShaderResourceView(4, m_instanceDataGpuAddress + uint64_t(first) * sizeof(InstanceData));
+        }
+        pCommandList->DrawIndexedInstanced(bindings.numIndices, count, 0, 0, 0);
+        return;
+    }
 
 	struct MaterialConstants
 	{
-		UINT32 matIndex;    // Dynamically set index for looking up from g_txMats[].
-		UINT32 bar[2];
-        UINT32 moo;
+		uint32_t matIndex;    // Dynamically set index for looking up from g_txMats[].
+		uint32_t bar[2];
+        uint32_t moo;
 	};
 
     MaterialConstants ConstData;
 
-    for (UINT i = 0; i < m_cityRowCount; i++)
+    // Cities are numbered row-major (i * m_cityColumnCount + j).
+    const uint32_t cityTotal = m_cityRowCount * m_cityColumnCount;
+    const uint32_t cityEnd = firstCity + std::min(cityCount, cityTotal - std::min(firstCity, cityTotal));
+
+    for (uint32_t draw = firstCity; draw < cityEnd; draw++)
     {
-        for (UINT j = 0; j < m_cityColumnCount; j++)
-        {
-            // Set the city's root constant for dynamically indexing into the material array.
-            ConstData.matIndex = (i * m_cityColumnCount) + j;
-            ConstData.bar[0] = m_cityColumnCount + 1;
-            ConstData.bar[1] = 0;
-            ConstData.moo = m_StructBufferSize[((i * m_cityColumnCount) + j)%4];
-            //pCommandList->SetComputeRoot32BitConstants(3, (i * m_cityColumnCount) + j, 0);
-            pCommandList->SetGraphicsRoot32BitConstants(3, 4, &ConstData,0);
-
-            // Set this city's CBV table and move to the next descriptor.
-            pCommandList->SetGraphicsRootDescriptorTable(2, cbvSrvHandle);
-            cbvSrvHandle.Offset(cbvSrvDescriptorSize);
-
-            pCommandList->DrawIndexedInstanced(numIndices, 1, 0, 0, 0);
-        }
+        const uint32_t city = pCityIndices ? pCityIndices[draw] : draw;
+
+        // Set the city's root constant for dynamically indexing into the material array. It only
+        // depends on the material, so consecutive draws of one material set the same constants.
+        const uint32_t material = GetCityMaterial(city);
+        ConstData.matIndex = material;
+        ConstData.bar[0] = m_cityColumnCount + 1;
+        ConstData.bar[1] = 0;
+        ConstData.moo = m_StructBufferSize[material % 4];
+        //pCommandList->SetComputeRoot32BitConstants(3, city, 0);
+        pCommandList->SetGraphicsRoot32BitConstants(3, 4, &ConstData,0);
+
+        // The draw's constants, straight from their address: no descriptor to create or switch tables for.
+        pCommandList->SetGraphicsRootConstantBufferView(2, m_constantBufferGpuAddress + uint64_t(draw) * ConstantBufferStride);
+
+        pCommandList->DrawIndexedInstanced(bindings.numIndices, 1, 0, 0, 0);
     }
 }
 
-void XM_CALLCONV FrameResource::UpdateConstantBuffers(FXMMATRIX view, CXMMATRIX projection)
+void XM_CALLCONV FrameResource::UpdateConstantBuffers(FXMMATRIX view, CXMMATRIX projection, FJobSystem* pJobSystem,
+    const uint32_t* pDrawCities, uint32_t drawCount)
 {
-    FSimdMatrix model;
-
-    FMatrix4x4 mvp;
-
-
-    for (UINT i = 0; i < m_cityRowCount; i++)
+    static_assert(offsetof(SceneConstantBuffer, mvp) == 0 && ConstantBufferStride % 16 == 0,
+        "ComputeTransposedMvpBatch writes the MVP at the start of each 16-byte aligned constant buffer");
+    static_assert(offsetof(InstanceData, mvp) == 0 && sizeof(InstanceData) % 16 == 0,
+        "ComputeTransposedMvpBatch writes the MVP at the start of each 16-byte aligned instance");
+
+    // View * projection is shared by every city; the batch kernel only multiplies the 3x4 models into it
+    // and streams the transposed results into the write-combined upload heap.
+    FMatrix4x4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, view * projection);
+
+    // The instanced path reads the matrices from the instance buffer instead of the per-draw constants.
+    void* pDestination = m_pInstanceData ? static_cast<void*>(m_pInstanceData) : static_cast<void*>(m_pConstantBuffers);
+    const size_t destinationStride = m_pInstanceData ? sizeof(InstanceData) : ConstantBufferStride;
+    const bool gather = pDrawCities != nullptr;
+
+    auto updateRange = [this, &viewProjection, pDestination, destinationStride, gather, pDrawCities](uint32_t begin, uint32_t end)
     {
-        for (UINT j = 0; j < m_cityColumnCount; j++)
+        if (!gather)
         {
-            model = XMLoadFloat4x4(&m_modelMatrices[i * m_cityColumnCount + j]);
-
-            // Compute the model-view-projection matrix.
-            XMStoreFloat4x4(&mvp, XMMatrixTranspose(model * view * projection));
+            ComputeTransposedMvpBatch(*m_pModelTransforms, begin, end, viewProjection, pDestination, destinationStride);
+            // The instance buffer is fresh memory every frame, so the materials are written again too.
+            for (uint32_t instance = begin; m_pInstanceData && instance < end; instance++)
+            {
+                m_pInstanceData[instance].matIndex = GetCityMaterial(instance);
+            }
+            return;
+        }
 
-            // Copy this matrix into the appropriate location in the upload heap subresource.
-            memcpy(&m_pConstantBuffers[i * m_cityColumnCount + j], &mvp, sizeof(mvp));
+        // Compacted: only the drawn cities, in draw order. An instance's material follows its city.
+        ComputeTransposedMvpGather(*m_pModelTransforms, pDrawCities + begin, end - begin, viewProjection,
+            static_cast<uint8_t*>(pDestination) + begin * destinationStride, destinationStride);
+        for (uint32_t instance = begin; m_pInstanceData && instance < end; instance++)
+        {
+            m_pInstanceData[instance].matIndex = GetCityMaterial(pDrawCities[instance]);
         }
+    };
+
+    const uint32_t count = gather ? drawCount : m_cityRowCount * m_cityColumnCount;
+    if (!pJobSystem)
+    {
+        updateRange(0, count);
+        return;
     }
+
+    // Batches are hundreds of instances, so neighbouring batches share at most one cache line.
+    pJobSystem->ParallelFor(count, 256, [&updateRange](uint32_t begin, uint32_t end, FJobContext&)
+    {
+        updateRange(begin, end);
+    });
 }
@@ -11,139 +11,99 @@
 
 #pragma once
 
-#include "DXSampleHelper.h"
-#include <windows.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include "../Common/MathTypes.h"
+#include "../Common/Math/TransformBatch.h"
+#include "RHIDevice.h"
 
 using namespace DirectX;
-using Microsoft::WRL::ComPtr;
+
+class FJobSystem;
 
 
 class FrameResource
 {
-private:
-    void SetCityPositions(FLOAT intervalX, FLOAT intervalZ);
-
 public:
+    // Bound per draw as a root CBV (root parameter 2). The constants are packed as they are; only
+    // their slots are ConstantBufferStride apart, since a root CBV must start on a 256-byte boundary.
     struct SceneConstantBuffer
     {
         FMatrix4x4 mvp;        // Model-view-projection (MVP) matrix.
-
-        FLOAT padding[48];
     };
 
-    ComPtr<ID3D12CommandAllocator> m_commandAllocator;
-    ComPtr<ID3D12CommandAllocator> m_bundleAllocator;
-    ComPtr<ID3D12GraphicsCommandList> m_GraphicCommandList;
-    ComPtr<ID3D12Resource> m_cbvUploadHeap;
-    SceneConstantBuffer* m_pConstantBuffers;
-    UINT64 m_fenceValue;
+    static const uint32_t ConstantBufferStride = 256;
 
-    std::vector<FMatrix4x4> m_modelMatrices;
+    // One element of the instance buffer the instanced path draws from (see shader_mesh_instanced_vert.hlsl).
+    struct InstanceData
+    {
+        FMatrix4x4 mvp;        // Model-view-projection (MVP) matrix, transposed like SceneConstantBuffer::mvp.
+        uint32_t matIndex;     // Index into g_txMats[].
+        uint32_t padding[3];
+    };
 
-    UINT m_cityRowCount;
-    UINT m_cityColumnCount;
-    UINT m_cityMaterialCount;
-    UINT m_StructureBufferCount;
-    std::vector<UINT> m_StructBufferSize;
-    ID3D12Device* m_pDevice;
+    // Everything the city draws bind, in RHI terms so the same recording code
+    // runs on the D3D12 backend and on the Null backend.
+    struct DrawBindings
+    {
+        RHIPipelineState* pPipelineState;
+        RHIRootSignature* pRootSignature;
+        RHIDescriptorHeap* pCbvSrvDescriptorHeap;
+        RHIDescriptorHeap* pSamplerDescriptorHeap;
+        FRHIGpuDescriptor srvTable;        // Root parameter 0, in pCbvSrvDescriptorHeap.
+        FRHIGpuDescriptor samplerTable;    // Root parameter 1, in pSamplerDescriptorHeap.
+        const FRHIIndexBufferView* pIndexBufferView;
+        const FRHIVertexBufferView* pVertexBufferView;
+        uint32_t numIndices;
+        bool useInstancing;            // One instanced draw from the instance buffer instead of a draw per city.
+    };
 
-    FrameResource(ID3D12Device* pDevice, UINT cityRowCount, UINT cityColumnCount, UINT cityMaterialCount, float citySpacingInterval);
+    // Direct lists are recorded from allocators the renderer's FCommandListPool hands out each frame.
+    std::unique_ptr<RHICommandAllocator> m_bundleAllocator;
+    std::unique_ptr<RHICommandList> m_bundle;
+    // Per-draw constants, slot i for draw i (SetConstantBuffers). Set every frame from the renderer's
+    // upload memory, except with a bundle, which bakes the slot addresses in and so keeps its own
+    // buffer, m_bundleConstantBuffer.
+    std::unique_ptr<RHIResource> m_bundleConstantBuffer;
+    uint8_t* m_pConstantBuffers;
+    uint64_t m_constantBufferGpuAddress;
+    // Instanced path only (SetInstanceBuffer): this frame's instances, in upload memory the renderer
+    // allocates anew every frame.
+    InstanceData* m_pInstanceData;
+    uint64_t m_instanceDataGpuAddress;
+    uint64_t m_fenceValue;
+
+    // City model transforms, SoA so UpdateConstantBuffers can compute several MVPs per instruction.
+    // Shared by every frame resource and owned by the renderer.
+    const FAffineTransformArray* m_pModelTransforms;
+
+    uint32_t m_cityRowCount;
+    uint32_t m_cityColumnCount;
+    uint32_t m_cityMaterialCount;
+    uint32_t m_StructureBufferCount;
+    std::vector<uint32_t> m_StructBufferSize;
+    RHIDevice* m_pDevice;
+
+    FrameResource(RHIDevice* pDevice, uint32_t cityRowCount, uint32_t cityColumnCount, uint32_t cityMaterialCount, const FAffineTransformArray& modelTransforms);
     ~FrameResource();
 
-    void InitBundle(ID3D12Device* pDevice, ID3D12PipelineState* pPso,
-        UINT frameResourceIndex, UINT numIndices, D3D12_INDEX_BUFFER_VIEW* pIndexBufferViewDesc, D3D12_VERTEX_BUFFER_VIEW* pVertexBufferViewDesc,
-        ID3D12DescriptorHeap* pCbvSrvDescriptorHeap, UINT cbvSrvDescriptorSize, ID3D12DescriptorHeap* pSamplerDescriptorHeap, ID3D12RootSignature* pRootSignature);
-
-    void PopulateCommandList(ID3D12GraphicsCommandList* pCommandList,
-        UINT frameResourceIndex, UINT numIndices, D3D12_INDEX_BUFFER_VIEW* pIndexBufferViewDesc, D3D12_VERTEX_BUFFER_VIEW* pVertexBufferViewDesc,
-        ID3D12DescriptorHeap* pCbvSrvDescriptorHeap, UINT cbvSrvDescriptorSize, ID3D12DescriptorHeap* pSamplerDescriptorHeap, ID3D12RootSignature* pRootSignature);
-
-    void XM_CALLCONV UpdateConstantBuffers(FXMMATRIX view, CXMMATRIX projection);
-
-
-    // Direct3D 12: One buffer to accommodate different types of resources
-	ComPtr<ID3D12Resource> m_spUploadBuffer;
-	UINT8* m_pDataBegin = nullptr;    // starting position of upload buffer
-	UINT8* m_pDataCur = nullptr;      // current position of upload buffer
-	UINT8* m_pDataEnd = nullptr;      // ending position of upload buffer
-
-	//
-    // Create an upload buffer and keep it always mapped.
-    //
-
-	HRESULT InitializeUploadBuffer(SIZE_T uSize)
-	{
-		HRESULT hr = m_pDevice->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(uSize),
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-			IID_PPV_ARGS(&m_spUploadBuffer));
-
-		if (SUCCEEDED(hr))
-		{
-			void* pData;
-			//
-			// No CPU reads will be done from the resource.
-			//
-			CD3DX12_RANGE readRange(0, 0);
-			m_spUploadBuffer->Map(0, &readRange, &pData);
-			m_pDataCur = m_pDataBegin = reinterpret_cast<UINT8*>(pData);
-			m_pDataEnd = m_pDataBegin + uSize;
-		}
-		return hr;
-	}
-
-	//
-	// Sub-allocate from the buffer, with offset aligned.
-	//
-
-	HRESULT SuballocateFromBuffer(SIZE_T uSize, UINT uAlign)
-	{
-		m_pDataCur = reinterpret_cast<UINT8*>(
-			Align(reinterpret_cast<SIZE_T>(m_pDataCur), uAlign)
-			);
-
-		return (m_pDataCur + uSize > m_pDataEnd) ? E_INVALIDARG : S_OK;
-	}
-
-	//
-	// Place and copy data to the upload buffer.
-	//
-
-	HRESULT SetDataToUploadBuffer(
-		const void* pData,
-		UINT bytesPerData,
-		UINT dataCount,
-		UINT alignment,
-		UINT& byteOffset
-	)
-	{
-		SIZE_T byteSize = bytesPerData * dataCount;
-		HRESULT hr = SuballocateFromBuffer(byteSize, alignment);
-		if (SUCCEEDED(hr))
-		{
-			byteOffset = UINT(m_pDataCur - m_pDataBegin);
-			memcpy(m_pDataCur, pData, byteSize);
-			m_pDataCur += byteSize;
-		}
-		return hr;
-	}
-
-	//
-	// Align uLocation to the next multiple of uAlign.
-	//
-
-	UINT Align(UINT uLocation, UINT uAlign)
-	{
-		if ((0 == uAlign) || (uAlign & (uAlign - 1)))
-		{
-			//ThrowException("non-pow2 alignment");
-			//throw();
-			return -1;
-		}
-
-		return ((uLocation + (uAlign - 1)) & ~(uAlign - 1));
-	}
+    void InitBundle(const DrawBindings& bindings);
+    void SetConstantBuffers(void* pConstantBuffers, uint64_t gpuAddress);
+    void SetInstanceBuffer(InstanceData* pInstanceData, uint64_t gpuAddress);
+
+    // Records draws [firstCity, firstCity + cityCount), all of them by default. Draw i is city i, or
+    // city pCityIndices[i] when given (e.g. the visible cities after culling). A bundle does not bind
+    // the instance buffer, whose address changes every frame; it inherits the caller's binding.
+    void PopulateCommandList(RHICommandList* pCommandList, const DrawBindings& bindings,
+        uint32_t firstCity = 0, uint32_t cityCount = UINT32_MAX, const uint32_t* pCityIndices = nullptr);
+
+    // The material a city is drawn with: cities take the materials in turn.
+    uint32_t GetCityMaterial(uint32_t city) const { return city % m_cityMaterialCount; }
+
+    // Writes the MVP of every draw into the constant buffer slots, or into the instance buffer once
+    // one has been set, spread over pJobSystem when given. Draw i is city pDrawCities[i] for
+    // i < drawCount when a list is given, city i of every city otherwise.
+    void XM_CALLCONV UpdateConstantBuffers(FXMMATRIX view, CXMMATRIX projection, FJobSystem* pJobSystem = nullptr,
+        const uint32_t* pDrawCities = nullptr, uint32_t drawCount = 0);
 };
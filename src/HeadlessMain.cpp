@@ -0,0 +1,551 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Headless runner: drives FSceneRenderer on the Null RHI so the CPU side of a frame
+// (constant updates, command recording, submission) can be measured without a window or GPU.
+// --threads adds T job system workers to the main thread; --lists splits the draws over N command
+// lists when bundles are off (default: one per job system thread). --instanced draws every city with
+// one instanced draw from a per-frame instance buffer. --cull draws only the cities in the view frustum
+// (needs --no-bundles); --bvh finds them through a BVH over the city bounds and --occlusion also drops
+// the cities hidden behind the nearest ones (both need --cull). --move bobs N cities up and down
+// every frame, so only their matrices and bounds are recomputed. --sort draws the cities in draw key
+// order, by material then front to back (needs --no-bundles); --materials M gives the cities M
+// materials in turn instead of one each, so that sorting has draws to group. --no-filter records
+// without the redundant state filter.
+// --pso-library loads the pipeline from a pipeline library file and saves it there, as the D3D12
+// sample does. --async-compute submits a dispatch standing in for GPU culling to the compute queue
+// every frame, and the frame's draws wait for it on the GPU rather than on the CPU.
+//
+//   MEngineHeadless [--frames N] [--rows R] [--cols C] [--latency L] [--frames-in-flight F] [--no-bundles] [--instanced] [--cull] [--bvh] [--occlusion] [--sort] [--materials M] [--no-filter] [--async-compute] [--move N] [--threads T] [--lists N] [--mesh file.mesh] [--pso-library file]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "SceneRenderer.h"
+#include "Jobs/JobSystem.h"
+#include "Mesh/CookedMesh.h"
+#include "NullRHI/NullRHI.h"
+#include "Render/CommandListPool.h"
+#include "Render/DescriptorCache.h"
+#include "Render/FenceWatcher.h"
+#include "Render/PipelineCache.h"
+#include "Render/SamplerCache.h"
+
+namespace
+{
+    // Sizes of the occcity mesh (see occcity.h); the Null RHI never reads the data.
+    const uint32_t CityVertexDataSize = 820248;
+    const uint32_t CityIndexDataSize = 74568;
+    const uint32_t CityVertexStride = 44;
+    // Rough local bounds of one occcity city, used for culling when no cooked mesh (with real bounds) is given.
+    const FVector3 CityBoundsMin = { -8.0f, 0.0f, -8.0f };
+    const FVector3 CityBoundsMax = { 8.0f, 16.0f, 8.0f };
+    // Stand-in for a box inside one city's buildings, drawn as its occluder for --occlusion.
+    const FVector3 CityOccluderMin = { -5.0f, 0.0f, -5.0f };
+    const FVector3 CityOccluderMax = { 5.0f, 8.0f, 5.0f };
+    // SampleAssets::StandardVertexDescription (see occcity.h).
+    const FRHIInputElement CityVertexElements[] =
+    {
+        { "POSITION", 0, ERHIFormat::R32G32B32Float, 0, 0,  ERHIInputClassification::PerVertex, 0 },
+        { "NORMAL",   0, ERHIFormat::R32G32B32Float, 0, 12, ERHIInputClassification::PerVertex, 0 },
+        { "TEXCOORD", 0, ERHIFormat::R32G32Float,    0, 24, ERHIInputClassification::PerVertex, 0 },
+        { "TANGENT",  0, ERHIFormat::R32G32B32Float, 0, 32, ERHIInputClassification::PerVertex, 0 },
+    };
+
+    struct FHeadlessOptions
+    {
+        uint32_t FrameCount = 1000;
+        uint32_t CityRowCount = 15;
+        uint32_t CityColumnCount = 8;
+        uint32_t GpuLatency = 0;
+        uint32_t MaxFramesInFlight = 3;
+        bool UseBundles = true;
+        bool UseInstancing = false;
+        bool UseFrustumCulling = false;
+        bool UseBvh = false;
+        bool UseOcclusionCulling = false;
+        bool UseDrawSorting = false;
+        bool UseStateFilter = true;
+        bool UseAsyncCompute = false;
+        uint32_t MovedCityCount = 0;
+        uint32_t MaterialCount = 0;         // 0: one per city.
+        uint32_t WorkerThreadCount = 0;
+        uint32_t RecordCommandListCount = UINT32_MAX;
+        const char* CookedMeshPath = nullptr;
+        const char* PipelineLibraryPath = nullptr;
+    };
+
+    bool ParseOptions(int argc, char** argv, FHeadlessOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const bool hasValue = (i + 1) < argc;
+            if (std::strcmp(argv[i], "--frames") == 0 && hasValue)
+            {
+                options.FrameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--rows") == 0 && hasValue)
+            {
+                options.CityRowCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--cols") == 0 && hasValue)
+            {
+                options.CityColumnCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--latency") == 0 && hasValue)
+            {
+                options.GpuLatency = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && hasValue)
+            {
+                options.MaxFramesInFlight = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--move") == 0 && hasValue)
+            {
+                options.MovedCityCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--materials") == 0 && hasValue)
+            {
+                options.MaterialCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            {
+                options.WorkerThreadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--lists") == 0 && hasValue)
+            {
+                options.RecordCommandListCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (std::strcmp(argv[i], "--mesh") == 0 && hasValue)
+            {
+                options.CookedMeshPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--pso-library") == 0 && hasValue)
+            {
+                options.PipelineLibraryPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--no-bundles") == 0)
+            {
+                options.UseBundles = false;
+            }
+            else if (std::strcmp(argv[i], "--instanced") == 0)
+            {
+                options.UseInstancing = true;
+            }
+            else if (std::strcmp(argv[i], "--cull") == 0)
+            {
+                options.UseFrustumCulling = true;
+            }
+            else if (std::strcmp(argv[i], "--bvh") == 0)
+            {
+                options.UseBvh = true;
+            }
+            else if (std::strcmp(argv[i], "--occlusion") == 0)
+            {
+                options.UseOcclusionCulling = true;
+            }
+            else if (std::strcmp(argv[i], "--sort") == 0)
+            {
+                options.UseDrawSorting = true;
+            }
+            else if (std::strcmp(argv[i], "--no-filter") == 0)
+            {
+                options.UseStateFilter = false;
+            }
+            else if (std::strcmp(argv[i], "--async-compute") == 0)
+            {
+                options.UseAsyncCompute = true;
+            }
+            else
+            {
+                std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+                return false;
+            }
+        }
+        return options.FrameCount > 0 && options.CityRowCount > 0 && options.CityColumnCount > 0;
+    }
+
+    // Copies a block into upload memory, as the D3D12 path does before its copy to the default heap.
+    void UploadBlock(FUploadRing& uploadRing, const void* data, uint32_t size)
+    {
+        uploadRing.Upload(data, size);
+    }
+
+    int RunFrameLoop(const FHeadlessOptions& options)
+    {
+        const uint32_t FrameCount = 3;
+        const uint32_t cityCount = options.CityRowCount * options.CityColumnCount;
+        const float citySpacingInterval = 16.0f;
+
+        // Optional cooked mesh: mapped, and the vertex/index blocks go straight into upload buffers.
+        FCookedMesh cookedMesh;
+        uint32_t vertexDataSize = CityVertexDataSize;
+        uint32_t indexDataSize = CityIndexDataSize;
+        double meshLoadMs = 0.0;
+        if (options.CookedMeshPath)
+        {
+            const auto loadBegin = std::chrono::steady_clock::now();
+            std::string error;
+            if (!cookedMesh.Open(options.CookedMeshPath, &error))
+            {
+                throw std::runtime_error(error);
+            }
+            vertexDataSize = static_cast<uint32_t>(cookedMesh.GetVertexDataSize());
+            indexDataSize = static_cast<uint32_t>(cookedMesh.GetIndexDataSize());
+            meshLoadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadBegin).count();
+        }
+
+        NullRHIDevice device;
+        NullRHICommandQueue* directQueue = device.GetNullQueue(ERHICommandListType::Direct);
+        directQueue->SetSimulatedLatency(options.GpuLatency);
+        // The compute queue lags one batch more, so the graphics waits on it have work to hold back.
+        NullRHICommandQueue* computeQueue = device.GetNullQueue(ERHICommandListType::Compute);
+        computeQueue->SetSimulatedLatency(options.GpuLatency + 1);
+
+        // The renderer's per-frame data; the mesh upload has a ring of its own, as in the D3D12 sample.
+        FUploadRing uploadRing(&device, device.GetQueue(ERHICommandListType::Direct));
+        FCommandListPool commandListPool(&device);
+        FFenceWatcher fenceWatcher(&device);
+
+        // The hash stands in for that of the serialized root signature.
+        const char RootSignatureName[] = "city root signature";
+        std::unique_ptr<RHIRootSignature> rootSignature = device.CreateRootSignature(FPipelineCache::HashBytes(RootSignatureName, sizeof(RootSignatureName)));
+
+        // As in the D3D12 sample, the views live in CPU-only staging heaps and the draws bind tables
+        // assembled from them: t0 (unused), the diffuse texture and the material SRVs, and the sampler.
+        // Constants are bound as root CBVs.
+        std::unique_ptr<RHIDescriptorHeap> cbvSrvHeap = device.CreateDescriptorHeap(ERHIDescriptorHeapType::CbvSrvUav, cityCount + 2, true);
+        std::unique_ptr<RHIDescriptorHeap> samplerHeap = device.CreateDescriptorHeap(ERHIDescriptorHeapType::Sampler, 1, true);
+        FDescriptorStagingHeap srvStagingHeap(&device, ERHIDescriptorHeapType::CbvSrvUav, cityCount + 2);
+        FDescriptorStagingHeap samplerStagingHeap(&device, ERHIDescriptorHeapType::Sampler, 1);
+        std::vector<FBindlessHandle> srvViews(cityCount + 2);
+        for (FBindlessHandle& view : srvViews)
+        {
+            view = srvStagingHeap.Allocate();
+        }
+        FSamplerCache samplerCache(&device, &samplerStagingHeap);
+        samplerCache.GetSamplerIndex(FRHISamplerDesc());
+        const std::vector<FBindlessHandle> samplerViews = samplerCache.GetViews();
+        FDescriptorTableCache srvTableCache(&device, device.GetQueue(ERHICommandListType::Direct), &srvStagingHeap, cbvSrvHeap.get(), 0, cityCount + 2);
+        FDescriptorTableCache samplerTableCache(&device, device.GetQueue(ERHICommandListType::Direct), &samplerStagingHeap, samplerHeap.get(), 0, 1);
+        std::unique_ptr<RHIDescriptorHeap> rtvHeap = device.CreateDescriptorHeap(ERHIDescriptorHeapType::Rtv, FrameCount, false);
+        std::unique_ptr<RHIDescriptorHeap> dsvHeap = device.CreateDescriptorHeap(ERHIDescriptorHeapType::Dsv, 1, false);
+
+        FRHIBufferDesc vertexBufferDesc;
+        vertexBufferDesc.SizeInBytes = vertexDataSize;
+        vertexBufferDesc.InitialState = RHI_STATE_VERTEX_AND_CONSTANT_BUFFER;
+        std::unique_ptr<RHIResource> vertexBuffer = device.CreateBuffer(vertexBufferDesc);
+
+        FRHIBufferDesc indexBufferDesc;
+        indexBufferDesc.SizeInBytes = indexDataSize;
+        indexBufferDesc.InitialState = RHI_STATE_INDEX_BUFFER;
+        std::unique_ptr<RHIResource> indexBuffer = device.CreateBuffer(indexBufferDesc);
+
+        if (cookedMesh.IsOpen())
+        {
+            const auto uploadBegin = std::chrono::steady_clock::now();
+            std::unique_ptr<FUploadRing> meshUploadRing = std::make_unique<FUploadRing>(&device, device.GetQueue(ERHICommandListType::Direct));
+            UploadBlock(*meshUploadRing, cookedMesh.GetVertexData(), vertexDataSize);
+            UploadBlock(*meshUploadRing, cookedMesh.GetIndexData(), indexDataSize);
+
+            // An empty list stands in for the copies out of the ring; the ring goes once it has run,
+            // without the frame loop waiting for it.
+            RHICommandAllocator* loadAllocator = commandListPool.AcquireAllocator(ERHICommandListType::Direct);
+            RHICommandList* loadList = commandListPool.AcquireCommandList(loadAllocator);
+            const uint64_t loadFence = device.GetQueue(ERHICommandListType::Direct)->ExecuteCommandLists(1, &loadList);
+            commandListPool.ReleaseAllocator(loadAllocator, loadFence);
+            commandListPool.ReleaseCommandList(loadList, loadFence);
+            meshUploadRing->OnSubmit(loadFence);
+            fenceWatcher.DeferRelease(loadFence, std::move(meshUploadRing));
+            meshLoadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadBegin).count();
+        }
+
+        // Stand-in for the swap chain back buffers.
+        std::unique_ptr<RHIResource> backBuffers[FrameCount];
+        for (uint32_t i = 0; i < FrameCount; ++i)
+        {
+            FRHIBufferDesc backBufferDesc;
+            backBufferDesc.SizeInBytes = 1280 * 720 * 4;
+            backBuffers[i] = device.CreateBuffer(backBufferDesc);
+        }
+
+        std::unique_ptr<FJobSystem> jobSystem;
+        if (options.WorkerThreadCount > 0)
+        {
+            FJobSystemDesc jobSystemDesc;
+            jobSystemDesc.WorkerThreadCount = options.WorkerThreadCount;
+            jobSystem = std::make_unique<FJobSystem>(jobSystemDesc);
+        }
+        // The shader names stand in for their bytecode, which the Null RHI never reads.
+        FPipelineCacheDesc pipelineCacheDesc;
+        pipelineCacheDesc.Device = &device;
+        pipelineCacheDesc.JobSystem = jobSystem.get();
+        pipelineCacheDesc.LibraryPath = options.PipelineLibraryPath ? options.PipelineLibraryPath : "";
+        FPipelineCache pipelineCache(pipelineCacheDesc);
+        const char* vertexShaderName = options.UseInstancing ? "shader_mesh_instanced_vert" : "shader_mesh_simple_vert";
+        const char* pixelShaderName = options.UseInstancing ? "shader_mesh_dynamic_indexing_instanced_pixel" : "shader_mesh_dynamic_indexing_pixel";
+        FRHIGraphicsPipelineDesc pipelineDesc;
+        pipelineDesc.RootSignature = rootSignature.get();
+        pipelineDesc.VS = { vertexShaderName, std::strlen(vertexShaderName) };
+        pipelineDesc.PS = { pixelShaderName, std::strlen(pixelShaderName) };
+        pipelineDesc.InputElements = CityVertexElements;
+        pipelineDesc.NumInputElements = static_cast<uint32_t>(sizeof(CityVertexElements) / sizeof(CityVertexElements[0]));
+        pipelineDesc.CullMode = ERHICullMode::None;
+
+        const uint32_t recordCommandListCount = (options.UseBundles || options.UseInstancing) ? 0u :
+            options.RecordCommandListCount != UINT32_MAX ? options.RecordCommandListCount : (jobSystem ? jobSystem->GetThreadCount() : 0u);
+
+        FSceneRendererDesc desc;
+        desc.pDevice = &device;
+        desc.pUploadRing = &uploadRing;
+        desc.pCommandListPool = &commandListPool;
+        desc.pPipelineState = pipelineCache.GetPipeline(pipelineDesc);
+        desc.pRootSignature = rootSignature.get();
+        desc.pCbvSrvDescriptorHeap = cbvSrvHeap.get();
+        desc.pSamplerDescriptorHeap = samplerHeap.get();
+        desc.SrvTable = srvTableCache.GetTable(srvViews.data(), static_cast<uint32_t>(srvViews.size()), true);
+        desc.SamplerTable = samplerTableCache.GetTable(samplerViews.data(), static_cast<uint32_t>(samplerViews.size()), true);
+        desc.VertexBufferView = { vertexBuffer->GetGpuVirtualAddress(), vertexDataSize, CityVertexStride };
+        desc.IndexBufferView = { indexBuffer->GetGpuVirtualAddress(), indexDataSize, ERHIIndexFormat::Uint32 };
+        desc.NumIndices = indexDataSize / 4;
+        desc.FrameCount = FrameCount;
+        desc.MaxFramesInFlight = options.MaxFramesInFlight;
+        desc.CityRowCount = options.CityRowCount;
+        desc.CityColumnCount = options.CityColumnCount;
+        desc.CityMaterialCount = options.MaterialCount != 0 ? std::min(options.MaterialCount, cityCount) : cityCount;
+        desc.CitySpacingInterval = citySpacingInterval;
+        desc.UseBundles = options.UseBundles;
+        desc.UseInstancing = options.UseInstancing;
+        desc.UseFrustumCulling = options.UseFrustumCulling;
+        desc.InstanceBoundsMin = cookedMesh.IsOpen() ? cookedMesh.GetBoundsMin() : CityBoundsMin;
+        desc.InstanceBoundsMax = cookedMesh.IsOpen() ? cookedMesh.GetBoundsMax() : CityBoundsMax;
+        desc.UseBvh = options.UseBvh;
+        desc.UseOcclusionCulling = options.UseOcclusionCulling;
+        desc.OccluderBoundsMin = CityOccluderMin;
+        desc.OccluderBoundsMax = CityOccluderMax;
+        desc.UseDrawSorting = options.UseDrawSorting;
+        desc.UseStateFilter = options.UseStateFilter;
+        desc.RecordCommandListCount = recordCommandListCount;
+        desc.pJobSystem = jobSystem.get();
+
+        FSceneRenderer renderer(desc);
+
+        FSceneRenderTarget target;
+        target.Viewport = { 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f };
+        target.ScissorRect = { 0, 0, 1280, 720 };
+        target.DepthStencilView = dsvHeap->GetCpuHandle(0);
+
+        // Fly the camera in a slow circle above the grid so every frame does real work.
+        const float centerX = (options.CityColumnCount / 2.0f) * citySpacingInterval;
+        const float centerZ = -(options.CityRowCount / 2.0f) * citySpacingInterval;
+        const FSimdMatrix projection = XMMatrixPerspectiveFovRH(0.8f, 1280.0f / 720.0f, 1.0f, 1000.0f);
+
+        double updateMs = 0.0;
+        double transformMs = 0.0;
+        double recordMs = 0.0;
+        double submitMs = 0.0;
+        double cullMs = 0.0;
+        double occlusionMs = 0.0;
+        double sortMs = 0.0;
+        uint64_t skippedStateCount = 0;
+        uint64_t barrierCount = 0;
+        uint64_t skippedBarrierCount = 0;
+        uint64_t occludedCount = 0;
+        uint64_t visibleCount = 0;
+        uint64_t movedCount = 0;
+        // Graphics fence values and the compute fence value each waits on, until the graphics one completes.
+        std::deque<std::pair<uint64_t, uint64_t>> computeWaits;
+        uint64_t earlyRetireCount = 0;
+        auto checkComputeWaits = [&]
+        {
+            while (!computeWaits.empty() && directQueue->IsFenceComplete(computeWaits.front().first))
+            {
+                earlyRetireCount += computeQueue->IsFenceComplete(computeWaits.front().second) ? 0 : 1;
+                computeWaits.pop_front();
+            }
+        };
+        for (uint32_t frame = 0; frame < options.FrameCount; ++frame)
+        {
+            const uint32_t backBufferIndex = frame % FrameCount;
+            target.pBackBuffer = backBuffers[backBufferIndex].get();
+            target.RenderTargetView = rtvHeap->GetCpuHandle(backBufferIndex);
+
+            const float angle = 0.01f * frame;
+            const FSimdVector eye = XMVectorSet(centerX + 60.0f * cosf(angle), 15.0f, centerZ + 60.0f * sinf(angle), 1.0f);
+            const FSimdVector focus = XMVectorSet(centerX, 0.0f, centerZ, 1.0f);
+            const FSimdMatrix view = XMMatrixLookAtRH(eye, focus, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+            // A different run of cities each frame, so the moved set keeps changing.
+            FTransformStore& cityTransforms = renderer.GetCityTransforms();
+            for (uint32_t i = 0; i < options.MovedCityCount; ++i)
+            {
+                const uint32_t city = (frame * options.MovedCityCount + i) % cityCount;
+                const FTransformHandle handle = renderer.GetCityHandle(city);
+                FVector3 position = cityTransforms.GetPosition(handle);
+                position.y = 0.02f * city + sinf(0.1f * (frame + city));
+                cityTransforms.SetPosition(handle, position);
+            }
+
+            renderer.BeginFrame();
+            renderer.Update(view, projection);
+            uint64_t computeFence = 0;
+            if (options.UseAsyncCompute)
+            {
+                // One thread group per 64 cities, as a culling shader would run.
+                RHICommandAllocator* computeAllocator = commandListPool.AcquireAllocator(ERHICommandListType::Compute);
+                RHICommandList* computeList = commandListPool.AcquireCommandList(computeAllocator);
+                computeList->Dispatch((cityCount + 63) / 64, 1, 1);
+                computeFence = computeQueue->ExecuteCommandLists(1, &computeList);
+                commandListPool.ReleaseAllocator(computeAllocator, computeFence);
+                commandListPool.ReleaseCommandList(computeList, computeFence);
+                renderer.WaitForQueueFence(computeFence);
+            }
+            const uint64_t graphicsFence = renderer.Render(target);
+            if (options.UseAsyncCompute)
+            {
+                computeWaits.push_back({ graphicsFence, computeFence });
+                checkComputeWaits();
+            }
+
+            const FSceneFrameStats& stats = renderer.GetFrameStats();
+            updateMs += stats.UpdateMs;
+            transformMs += stats.TransformMs;
+            movedCount += stats.MovedCount;
+            recordMs += stats.RecordMs;
+            submitMs += stats.SubmitMs;
+            cullMs += stats.CullMs;
+            occlusionMs += stats.OcclusionMs;
+            occludedCount += stats.OccludedCount;
+            sortMs += stats.SortMs;
+            skippedStateCount += stats.SkippedStateCount;
+            barrierCount += stats.BarrierCount;
+            skippedBarrierCount += stats.SkippedBarrierCount;
+            visibleCount += stats.VisibleCount;
+        }
+        renderer.WaitForIdle();
+        checkComputeWaits();
+        const FNullRHIQueueStats queueStats = directQueue->GetStats();
+
+        // A wait on a compute fence value that has already completed must not hold the batch after it.
+        uint64_t completedWaitHeldCount = 0;
+        if (options.UseAsyncCompute && options.FrameCount > 0)
+        {
+            computeQueue->WaitForIdle();
+            const uint64_t heldBefore = directQueue->GetStats().HeldBatches;
+            directQueue->SetSimulatedLatency(0);
+            directQueue->InsertWait(computeQueue->GetLastCompletedFence());
+            RHICommandAllocator* allocator = commandListPool.AcquireAllocator(ERHICommandListType::Direct);
+            RHICommandList* list = commandListPool.AcquireCommandList(allocator);
+            const uint64_t fence = directQueue->ExecuteCommandLists(1, &list);
+            commandListPool.ReleaseAllocator(allocator, fence);
+            commandListPool.ReleaseCommandList(list, fence);
+            completedWaitHeldCount = directQueue->GetStats().HeldBatches - heldBefore + (directQueue->IsFenceComplete(fence) ? 0 : 1);
+            directQueue->SetSimulatedLatency(options.GpuLatency);
+        }
+
+        const double frames = static_cast<double>(options.FrameCount);
+        std::printf("instances        : %u (%u x %u), bundles %s, instancing %s, record lists %u, job threads %u\n", cityCount, options.CityRowCount, options.CityColumnCount,
+            options.UseBundles ? "on" : "off", options.UseInstancing ? "on" : "off", recordCommandListCount, jobSystem ? jobSystem->GetThreadCount() : 1u);
+        if (options.MaterialCount != 0)
+        {
+            std::printf("materials        : %u\n", desc.CityMaterialCount);
+        }
+        if (cookedMesh.IsOpen())
+        {
+            std::printf("mesh             : %u vertices, %u indices, mapped + uploaded in %.3f ms\n", cookedMesh.GetVertexCount(), cookedMesh.GetIndexCount(), meshLoadMs);
+        }
+        std::printf("frames           : %u\n", options.FrameCount);
+        std::printf("update   ms/frame: %.4f (cull %.4f, %.1f visible)\n", updateMs / frames, cullMs / frames, visibleCount / frames);
+        if (options.MovedCityCount > 0)
+        {
+            std::printf("transforms       : %.4f ms/frame, %.1f moved\n", transformMs / frames, movedCount / frames);
+        }
+        if (options.UseOcclusionCulling)
+        {
+            std::printf("occlusion        : %.4f ms/frame, %.1f occluded\n", occlusionMs / frames, occludedCount / frames);
+        }
+        if (options.UseDrawSorting)
+        {
+            std::printf("sort             : %.4f ms/frame\n", sortMs / frames);
+        }
+        std::printf("record   ms/frame: %.4f (%.1f redundant state calls skipped)\n", recordMs / frames, skippedStateCount / frames);
+        std::printf("submit   ms/frame: %.4f\n", submitMs / frames);
+        std::printf("barriers / frame : %.1f (%.1f redundant transitions skipped)\n", barrierCount / frames, skippedBarrierCount / frames);
+        std::printf("commands / frame : %.1f in %.1f lists\n", queueStats.CommandsExecuted / frames, queueStats.CommandListsExecuted / frames);
+        const FUploadRingStats& uploadStats = uploadRing.GetStats();
+        std::printf("upload ring      : %u pages, %.1f KB, high water %.1f KB\n", uploadStats.PageCount, uploadStats.CapacityBytes / 1024.0,
+            uploadStats.HighWaterBytes / 1024.0);
+        const FCommandListPoolStats poolStats = commandListPool.GetStats();
+        std::printf("command pool     : %u allocators, %u lists, %.1f%% of allocators reused\n", poolStats.AllocatorCount, poolStats.CommandListCount,
+            poolStats.AllocatorAcquireCount ? 100.0 * poolStats.AllocatorReuseCount / poolStats.AllocatorAcquireCount : 0.0);
+        std::printf("descriptor tables: %u, %llu descriptors copied\n", srvTableCache.GetStats().TableCount + samplerTableCache.GetStats().TableCount,
+            static_cast<unsigned long long>(device.GetDescriptorsCopied()));
+        const FPipelineCacheStats pipelineStats = pipelineCache.GetStats();
+        std::printf("pipelines        : %u (%llu compiled, %llu from the library)\n", pipelineStats.PipelineCount,
+            static_cast<unsigned long long>(pipelineStats.CompileCount), static_cast<unsigned long long>(pipelineStats.LibraryLoadCount));
+        const FScenePacingStats& pacing = renderer.GetPacingStats();
+        std::printf("stalled frames   : %llu (%.4f ms/frame, max %.4f ms)\n", static_cast<unsigned long long>(pacing.StalledFrameCount),
+            pacing.TotalWaitMs / frames, pacing.MaxWaitMs);
+        std::printf("blocking waits   : %llu\n", static_cast<unsigned long long>(queueStats.BlockingWaits));
+        const FFenceWatcherStats watcherStats = fenceWatcher.GetStats();
+        std::printf("fence watcher    : %llu deferred releases run, %u pending\n", static_cast<unsigned long long>(watcherStats.CallbackCount),
+            watcherStats.PendingCount);
+        if (options.UseAsyncCompute)
+        {
+            const FNullRHIQueueStats computeStats = computeQueue->GetStats();
+            std::printf("async compute    : %.1f dispatches/frame, %llu graphics waits on it, %llu graphics batches held by them\n",
+                computeStats.CommandsExecuted / frames, static_cast<unsigned long long>(queueStats.QueueWaits),
+                static_cast<unsigned long long>(queueStats.HeldBatches));
+            std::printf("                   %llu graphics batches retired before their compute fence, %llu held by a completed one\n",
+                static_cast<unsigned long long>(earlyRetireCount), static_cast<unsigned long long>(completedWaitHeldCount));
+            if (earlyRetireCount != 0 || completedWaitHeldCount != 0)
+            {
+                throw std::runtime_error("async compute: a graphics batch ran ahead of, or was held by, the compute work it waits on");
+            }
+        }
+
+        std::string pipelineLibraryError;
+        if (!pipelineCache.Save(&pipelineLibraryError))
+        {
+            throw std::runtime_error(pipelineLibraryError);
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    FHeadlessOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "usage: %s [--frames N] [--rows R] [--cols C] [--latency L] [--frames-in-flight F] [--no-bundles] [--instanced] [--cull] [--bvh] [--occlusion] [--sort] [--materials M] [--no-filter] [--async-compute] [--move N] [--threads T] [--lists N] [--mesh file.mesh] [--pso-library file]\n", argv[0]);
+        return 1;
+    }
+
+    try
+    {
+        return RunFrameLoop(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "MEngineHeadless failed: %s\n", e.what());
+        return 1;
+    }
+}
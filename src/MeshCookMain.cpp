@@ -0,0 +1,103 @@
+// Offline mesh cook step: imports a source mesh once and writes it as a cooked .mesh container
+// (see Common/Mesh/CookedMesh.h) that the runtime memory-maps instead of importing.
+//
+//   MEngineMeshCook <input.fbx> <output.mesh>
+//   MEngineMeshCook --raw <input.bin> <vertexOffset> <vertexSize> <indexOffset> <indexSize> <output.mesh>
+//
+// --raw cooks a blob of FStaticMeshVertex/uint32 index ranges, such as occcity.bin (offsets in occcity.h).
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Jobs/JobSystem.h"
+#include "Mesh/CookedMesh.h"
+#include "Mesh/MeshBuilder.h"
+
+namespace
+{
+    bool LoadRawMesh(const char* path, uint64_t vertexOffset, uint64_t vertexSize, uint64_t indexOffset, uint64_t indexSize, FStaticMesh& outMesh, std::string* outError)
+    {
+        if (vertexSize == 0 || indexSize == 0 || vertexSize % sizeof(FStaticMeshVertex) != 0 || indexSize % sizeof(uint32_t) != 0)
+        {
+            *outError = "Vertex/index sizes must be non-zero multiples of the vertex stride and index size";
+            return false;
+        }
+
+        FMappedFile file;
+        if (!file.Open(path, outError))
+        {
+            return false;
+        }
+        if (vertexOffset + vertexSize > file.GetSize() || indexOffset + indexSize > file.GetSize())
+        {
+            *outError = "Vertex/index ranges are outside the input file";
+            return false;
+        }
+
+        const FStaticMeshVertex* vertices = reinterpret_cast<const FStaticMeshVertex*>(file.GetData() + vertexOffset);
+        const uint32_t* indices = reinterpret_cast<const uint32_t*>(file.GetData() + indexOffset);
+
+        outMesh.Clear();
+        outMesh.Vertices.assign(vertices, vertices + vertexSize / sizeof(FStaticMeshVertex));
+        outMesh.Indices.assign(indices, indices + indexSize / sizeof(uint32_t));
+
+        FStaticMeshSection section;
+        section.IndexCount = static_cast<uint32_t>(outMesh.Indices.size());
+        outMesh.Sections.push_back(section);
+        outMesh.MaterialNames.push_back("default");
+
+        outMesh.RecomputeBounds();
+        return true;
+    }
+
+    void PrintUsage(const char* exe)
+    {
+        std::fprintf(stderr,
+            "usage: %s <input.fbx> <output.mesh>\n"
+            "       %s --raw <input.bin> <vertexOffset> <vertexSize> <indexOffset> <indexSize> <output.mesh>\n", exe, exe);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    FStaticMesh mesh;
+    std::string error;
+    const char* outputPath = nullptr;
+    bool loaded = false;
+
+    const auto begin = std::chrono::steady_clock::now();
+    if (argc == 8 && std::strcmp(argv[1], "--raw") == 0)
+    {
+        outputPath = argv[7];
+        loaded = LoadRawMesh(argv[2],
+            std::strtoull(argv[3], nullptr, 10), std::strtoull(argv[4], nullptr, 10),
+            std::strtoull(argv[5], nullptr, 10), std::strtoull(argv[6], nullptr, 10), mesh, &error);
+    }
+    else if (argc == 3)
+    {
+        outputPath = argv[2];
+        FJobSystem jobSystem;
+        MeshImportOptions options;
+        options.JobSystem = &jobSystem;
+        loaded = MeshBuilder::LoadFromFBX(argv[1], mesh, &error, options);
+    }
+    else
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if (!loaded || !FCookedMesh::Write(mesh, outputPath, &error))
+    {
+        std::fprintf(stderr, "MEngineMeshCook failed: %s\n", error.c_str());
+        return 1;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::printf("%s: %zu vertices, %zu indices, %zu sections, %zu materials (%.1f ms)\n", outputPath,
+        mesh.Vertices.size(), mesh.Indices.size(), mesh.Sections.size(), mesh.MaterialNames.size(), ms);
+    return 0;
+}
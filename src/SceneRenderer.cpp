@@ -0,0 +1,689 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "SceneRenderer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+
+#include "Jobs/JobSystem.h"
+
+namespace
+{
+    typedef std::chrono::high_resolution_clock FClock;
+
+    double ElapsedMs(FClock::time_point begin, FClock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+
+    // Cities per culling job; each chunk writes its visible cities to its own slice of the list.
+    const uint32_t CullChunkSize = 16384;
+}
+
+FSceneRenderer::FSceneRenderer(const FSceneRendererDesc& desc) :
+    m_desc(desc),
+    m_pQueue(nullptr),
+    m_pCommandAllocator(nullptr),
+    m_pCommandList(nullptr),
+    m_skippedStateTotal(0),
+    m_visibleCityCount(0),
+    m_clearPass(0),
+    m_drawCitiesPass(0),
+    m_pCurrentFrameResource(nullptr),
+    m_currentFrameResourceIndex(0),
+    m_fenceValue(0),
+    m_submittedFrameCount(0)
+{
+    if (!m_desc.pDevice || !m_desc.pCbvSrvDescriptorHeap || !m_desc.pSamplerDescriptorHeap || m_desc.FrameCount == 0 || m_desc.CityMaterialCount == 0)
+    {
+        throw std::runtime_error("FSceneRenderer: incomplete renderer description");
+    }
+    if (m_desc.UseFrustumCulling && m_desc.UseBundles)
+    {
+        throw std::runtime_error("FSceneRenderer: frustum culling records the draws every frame and cannot use bundles");
+    }
+    if (m_desc.UseOcclusionCulling && !m_desc.UseFrustumCulling)
+    {
+        throw std::runtime_error("FSceneRenderer: occlusion culling tests the frustum culling survivors and needs UseFrustumCulling");
+    }
+    if (m_desc.UseBvh && !m_desc.UseFrustumCulling)
+    {
+        throw std::runtime_error("FSceneRenderer: the city BVH is only used for frustum culling and needs UseFrustumCulling");
+    }
+    if (m_desc.UseDrawSorting && m_desc.UseBundles)
+    {
+        throw std::runtime_error("FSceneRenderer: draw sorting records the draws every frame and cannot use bundles");
+    }
+
+    m_pQueue = m_desc.pDevice->GetQueue(ERHICommandListType::Direct);
+    if (!m_desc.pUploadRing)
+    {
+        m_uploadRing = std::make_unique<FUploadRing>(m_desc.pDevice, m_pQueue);
+        m_desc.pUploadRing = m_uploadRing.get();
+    }
+    if (!m_desc.pCommandListPool)
+    {
+        m_commandListPool = std::make_unique<FCommandListPool>(m_desc.pDevice);
+        m_desc.pCommandListPool = m_commandListPool.get();
+    }
+    m_desc.MaxFramesInFlight = std::min(std::max(m_desc.MaxFramesInFlight, 1u), m_desc.FrameCount);
+    m_submittedFences.assign(m_desc.FrameCount, 0);
+
+    m_drawBindings.pPipelineState = m_desc.pPipelineState;
+    m_drawBindings.pRootSignature = m_desc.pRootSignature;
+    m_drawBindings.pCbvSrvDescriptorHeap = m_desc.pCbvSrvDescriptorHeap;
+    m_drawBindings.pSamplerDescriptorHeap = m_desc.pSamplerDescriptorHeap;
+    m_drawBindings.srvTable = m_desc.SrvTable.ptr ? m_desc.SrvTable : m_desc.pCbvSrvDescriptorHeap->GetGpuHandle(0);
+    m_drawBindings.samplerTable = m_desc.SamplerTable.ptr ? m_desc.SamplerTable : m_desc.pSamplerDescriptorHeap->GetGpuHandle(0);
+    m_drawBindings.pIndexBufferView = &m_desc.IndexBufferView;
+    m_drawBindings.pVertexBufferView = &m_desc.VertexBufferView;
+    m_drawBindings.numIndices = m_desc.NumIndices;
+    m_drawBindings.useInstancing = m_desc.UseInstancing;
+    if (m_desc.UseInstancing)
+    {
+        // A single draw leaves nothing to split across lists.
+        m_desc.RecordCommandListCount = 0;
+    }
+
+    CreateCities();
+    CreateFrameResources();
+    CreateFrameGraph();
+
+    // The lists themselves are taken from the pool every frame; the filters are pointed at them then.
+    if (m_desc.UseStateFilter)
+    {
+        m_commandListFilter = std::make_unique<RHIStateFilter>(ERHICommandListType::Direct);
+    }
+
+    if (!m_desc.UseBundles)
+    {
+        m_workerCommandAllocators.assign(m_desc.RecordCommandListCount, nullptr);
+        m_workerCommandLists.assign(m_desc.RecordCommandListCount, nullptr);
+        m_workerCommandListStates.resize(m_desc.RecordCommandListCount);
+        if (m_desc.UseStateFilter)
+        {
+            for (uint32_t i = 0; i < m_desc.RecordCommandListCount; i++)
+            {
+                m_workerCommandListFilters.push_back(std::make_unique<RHIStateFilter>(ERHICommandListType::Direct));
+            }
+        }
+    }
+
+    // Until the first Update() culls, every city is visible.
+    const uint32_t cityCount = GetInstanceCount();
+    m_visibleCities.resize(cityCount);
+    std::iota(m_visibleCities.begin(), m_visibleCities.end(), 0u);
+    m_visibleCityCount = cityCount;
+    if (m_desc.UseFrustumCulling)
+    {
+        // From here on only the bounds of cities that move are recomputed (UpdateCityTransforms).
+        ComputeWorldAabbs(m_cityTransforms.GetWorldTransforms(), m_desc.InstanceBoundsMin, m_desc.InstanceBoundsMax, m_cityBounds);
+        m_cullChunkVisibleCounts.resize((cityCount + CullChunkSize - 1) / CullChunkSize);
+        if (m_desc.UseBvh)
+        {
+            m_cityBvh.Build(m_cityBounds, m_desc.pJobSystem);
+        }
+    }
+    if (m_desc.UseOcclusionCulling)
+    {
+        ComputeWorldAabbs(m_cityTransforms.GetWorldTransforms(), m_desc.OccluderBoundsMin, m_desc.OccluderBoundsMax, m_occluderBounds);
+    }
+
+    m_currentFrameResourceIndex = 0;
+    m_pCurrentFrameResource = m_frameResources[m_currentFrameResourceIndex].get();
+}
+
+// Lays the cities out in a grid, CitySpacingInterval apart.
+void FSceneRenderer::CreateCities()
+{
+    const float interval = m_desc.CitySpacingInterval;
+    m_cityHandles.reserve(GetInstanceCount());
+    for (uint32_t i = 0; i < m_desc.CityRowCount; i++)
+    {
+        for (uint32_t j = 0; j < m_desc.CityColumnCount; j++)
+        {
+            // The y position is based off of the city's row and column
+            // position to prevent z-fighting.
+            const float y = 0.02f * (i * m_desc.CityColumnCount + j);
+            m_cityHandles.push_back(m_cityTransforms.Create(FVector3(j * interval, y, i * -interval)));
+        }
+    }
+    m_cityTransforms.UpdateWorldTransforms();
+}
+
+// Create the resources that will be used every frame.
+void FSceneRenderer::CreateFrameResources()
+{
+    // Initialize each frame resource.
+    for (uint32_t i = 0; i < m_desc.FrameCount; i++)
+    {
+        std::unique_ptr<FrameResource> pFrameResource = std::make_unique<FrameResource>(m_desc.pDevice,
+            m_desc.CityRowCount, m_desc.CityColumnCount, m_desc.CityMaterialCount, m_cityTransforms.GetWorldTransforms());
+
+        if (m_desc.UseBundles)
+        {
+            pFrameResource->InitBundle(m_drawBindings);
+        }
+
+        m_frameResources.push_back(std::move(pFrameResource));
+    }
+}
+
+// Clear, then draw the cities, into the back buffer, which is handed over from and back to present.
+void FSceneRenderer::CreateFrameGraph()
+{
+    m_backBufferResource = m_frameGraph.ImportResource("Back buffer", RHI_STATE_PRESENT, RHI_STATE_PRESENT);
+    m_clearPass = m_frameGraph.AddPass("Clear");
+    m_frameGraph.Write(m_clearPass, m_backBufferResource, RHI_STATE_RENDER_TARGET);
+    m_drawCitiesPass = m_frameGraph.AddPass("Draw cities");
+    m_frameGraph.Write(m_drawCitiesPass, m_backBufferResource, RHI_STATE_RENDER_TARGET);
+    m_frameGraph.Compile();
+}
+
+void FSceneRenderer::BeginFrame()
+{
+    // Move to the next frame resource.
+    m_currentFrameResourceIndex = (m_currentFrameResourceIndex + 1) % m_desc.FrameCount;
+    m_pCurrentFrameResource = m_frameResources[m_currentFrameResourceIndex].get();
+
+    // Only wait for the submission that last used this frame resource, and for the one
+    // MaxFramesInFlight frames back; anything newer may still be queued on the GPU.
+    uint64_t waitFenceValue = m_pCurrentFrameResource->m_fenceValue;
+    if (m_submittedFrameCount >= m_desc.MaxFramesInFlight)
+    {
+        const uint64_t pacingFrame = m_submittedFrameCount - m_desc.MaxFramesInFlight;
+        waitFenceValue = std::max(waitFenceValue, m_submittedFences[pacingFrame % m_desc.FrameCount]);
+    }
+
+    m_frameStats.WaitMs = 0.0;
+    if (waitFenceValue != 0 && !m_pQueue->IsFenceComplete(waitFenceValue))
+    {
+        const FClock::time_point begin = FClock::now();
+        m_pQueue->WaitForFenceCPUBlocking(waitFenceValue);
+        m_frameStats.WaitMs = ElapsedMs(begin, FClock::now());
+
+        m_pacingStats.StalledFrameCount++;
+        m_pacingStats.TotalWaitMs += m_frameStats.WaitMs;
+        m_pacingStats.MaxWaitMs = std::max(m_pacingStats.MaxWaitMs, m_frameStats.WaitMs);
+    }
+    m_pacingStats.FrameCount++;
+}
+
+void XM_CALLCONV FSceneRenderer::Update(FXMMATRIX view, CXMMATRIX projection)
+{
+    const FClock::time_point begin = FClock::now();
+    UpdateCityTransforms();
+    m_frameStats.TransformMs = ElapsedMs(begin, FClock::now());
+
+    const FClock::time_point cullBegin = FClock::now();
+    m_frameStats.OcclusionMs = 0.0;
+    m_frameStats.OccludedCount = 0;
+    if (m_desc.UseFrustumCulling)
+    {
+        FMatrix4x4 viewProjection;
+        XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+        CullCities(FFrustum::FromViewProjection(viewProjection));
+        if (m_desc.UseOcclusionCulling)
+        {
+            const FClock::time_point occlusionBegin = FClock::now();
+            CullOccludedCities(viewProjection);
+            m_frameStats.OcclusionMs = ElapsedMs(occlusionBegin, FClock::now());
+        }
+    }
+    m_frameStats.CullMs = ElapsedMs(cullBegin, FClock::now());
+    m_frameStats.VisibleCount = m_visibleCityCount;
+
+    m_frameStats.SortMs = 0.0;
+    if (m_desc.UseDrawSorting)
+    {
+        const FClock::time_point sortBegin = FClock::now();
+        FMatrix4x4 viewProjection;
+        XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+        SortCities(viewProjection);
+        m_frameStats.SortMs = ElapsedMs(sortBegin, FClock::now());
+    }
+
+    // Read by this frame's submission only, so the per-draw data comes from the upload ring, which
+    // takes the memory back once the GPU is done with the frame. Bundles point at constants of their
+    // own frame resource instead.
+    m_desc.pUploadRing->Reclaim();
+    if (m_desc.UseInstancing)
+    {
+        const FUploadAllocation instances = m_desc.pUploadRing->Allocate(uint64_t(m_visibleCityCount) * sizeof(FrameResource::InstanceData));
+        m_pCurrentFrameResource->SetInstanceBuffer(static_cast<FrameResource::InstanceData*>(instances.CpuAddress), instances.GpuAddress);
+    }
+    else if (!m_desc.UseBundles)
+    {
+        const FUploadAllocation constants = m_desc.pUploadRing->Allocate(uint64_t(m_visibleCityCount) * FrameResource::ConstantBufferStride, FrameResource::ConstantBufferStride);
+        m_pCurrentFrameResource->SetConstantBuffers(constants.CpuAddress, constants.GpuAddress);
+    }
+
+    // Only the visible cities, in draw order.
+    const uint32_t* pDrawCities = UsesCityList() ? m_visibleCities.data() : nullptr;
+    m_pCurrentFrameResource->UpdateConstantBuffers(view, projection, m_desc.pJobSystem, pDrawCities, m_visibleCityCount);
+    m_frameStats.UpdateMs = ElapsedMs(begin, FClock::now());
+}
+
+// Recomputes the world matrices of the cities moved since the last frame, and the culling data that
+// depends on them. Every frame resource reads the same matrices, so this happens once.
+void FSceneRenderer::UpdateCityTransforms()
+{
+    const std::vector<uint32_t>& movedCities = m_cityTransforms.UpdateWorldTransforms();
+    const uint32_t movedCount = static_cast<uint32_t>(movedCities.size());
+    m_frameStats.MovedCount = movedCount;
+    if (movedCount == 0)
+    {
+        return;
+    }
+
+    const FAffineTransformArray& transforms = m_cityTransforms.GetWorldTransforms();
+    if (m_desc.UseFrustumCulling)
+    {
+        UpdateWorldAabbs(transforms, m_desc.InstanceBoundsMin, m_desc.InstanceBoundsMax, movedCities.data(), movedCount, m_cityBounds);
+        if (m_desc.UseBvh)
+        {
+            m_cityBvh.Refit(m_cityBounds, movedCities.data(), movedCount);
+        }
+    }
+    if (m_desc.UseOcclusionCulling)
+    {
+        UpdateWorldAabbs(transforms, m_desc.OccluderBoundsMin, m_desc.OccluderBoundsMax, movedCities.data(), movedCount, m_occluderBounds);
+    }
+}
+
+// Fills the front of m_visibleCities with the cities inside frustum: in tree order from the BVH, or
+// else in ascending order by testing them all. With a job system the brute-force test goes over fixed
+// chunks in parallel, then the chunks' results are packed together.
+void FSceneRenderer::CullCities(const FFrustum& frustum)
+{
+    const uint32_t cityCount = GetInstanceCount();
+    uint32_t* pVisible = m_visibleCities.data();
+    if (m_desc.UseBvh)
+    {
+        m_visibleCityCount = m_cityBvh.QueryFrustum(frustum, pVisible);
+        return;
+    }
+    if (!m_desc.pJobSystem || cityCount <= CullChunkSize)
+    {
+        m_visibleCityCount = CullAabbBatch(m_cityBounds, 0, cityCount, frustum, pVisible);
+        return;
+    }
+
+    const uint32_t chunkCount = static_cast<uint32_t>(m_cullChunkVisibleCounts.size());
+    uint32_t* pChunkVisibleCounts = m_cullChunkVisibleCounts.data();
+    m_desc.pJobSystem->ParallelFor(chunkCount, 1, [this, &frustum, pVisible, pChunkVisibleCounts, cityCount](uint32_t begin, uint32_t end, FJobContext&)
+    {
+        for (uint32_t chunk = begin; chunk < end; chunk++)
+        {
+            const uint32_t first = chunk * CullChunkSize;
+            const uint32_t last = std::min(first + CullChunkSize, cityCount);
+            pChunkVisibleCounts[chunk] = CullAabbBatch(m_cityBounds, first, last, frustum, pVisible + first);
+        }
+    });
+
+    uint32_t visibleCount = pChunkVisibleCounts[0];
+    for (uint32_t chunk = 1; chunk < chunkCount; chunk++)
+    {
+        std::memmove(pVisible + visibleCount, pVisible + chunk * CullChunkSize, pChunkVisibleCounts[chunk] * sizeof(uint32_t));
+        visibleCount += pChunkVisibleCounts[chunk];
+    }
+    m_visibleCityCount = visibleCount;
+}
+
+// Draws the occluder boxes of the nearest frustum-visible cities into the occlusion buffer, then drops
+// the visible cities whose bounds are entirely behind them.
+void FSceneRenderer::CullOccludedCities(const FMatrix4x4& viewProjection)
+{
+    // Clip w of a city's occluder center is its distance along the view direction.
+    const float* cx = m_occluderBounds.GetStream(FAabbArray::CenterX);
+    const float* cy = m_occluderBounds.GetStream(FAabbArray::CenterY);
+    const float* cz = m_occluderBounds.GetStream(FAabbArray::CenterZ);
+    m_occluderCandidates.clear();
+    for (uint32_t i = 0; i < m_visibleCityCount; i++)
+    {
+        const uint32_t city = m_visibleCities[i];
+        const float depth = cx[city] * viewProjection._14 + cy[city] * viewProjection._24 + cz[city] * viewProjection._34 + viewProjection._44;
+        m_occluderCandidates.emplace_back(depth, city);
+    }
+    const size_t occluderCount = std::min<size_t>(m_desc.MaxOccluderCount, m_occluderCandidates.size());
+    std::partial_sort(m_occluderCandidates.begin(), m_occluderCandidates.begin() + occluderCount, m_occluderCandidates.end());
+
+    m_occlusionBuffer.Clear(viewProjection);
+    for (size_t i = 0; i < occluderCount; i++)
+    {
+        const uint32_t city = m_occluderCandidates[i].second;
+        m_occlusionBuffer.RenderOccluderBox(
+            FVector3(cx[city], cy[city], cz[city]),
+            FVector3(m_occluderBounds.GetStream(FAabbArray::ExtentX)[city], m_occluderBounds.GetStream(FAabbArray::ExtentY)[city], m_occluderBounds.GetStream(FAabbArray::ExtentZ)[city]));
+    }
+    m_occlusionBuffer.BuildHierarchy();
+
+    const uint32_t frustumVisibleCount = m_visibleCityCount;
+    m_visibleCityCount = m_occlusionBuffer.CullOccludedAabbs(m_cityBounds, m_visibleCities.data(), frustumVisibleCount);
+    m_frameStats.OccludedCount = frustumVisibleCount - m_visibleCityCount;
+}
+
+// Reorders the first m_visibleCityCount entries of m_visibleCities by draw key. Every city is drawn in
+// the one pass with the same pipeline, root signature and mesh, all id 0, so the keys differ in
+// material and depth: the cities of a material end up together, which saves setting its constants
+// again, and front to back among them, which lets the depth test reject more of the farther ones.
+void FSceneRenderer::SortCities(const FMatrix4x4& viewProjection)
+{
+    const uint32_t count = m_visibleCityCount;
+    const FAffineTransformArray& transforms = m_cityTransforms.GetWorldTransforms();
+    const float* tx = transforms.GetStream(FAffineTransformArray::ElementIndex(3, 0));
+    const float* ty = transforms.GetStream(FAffineTransformArray::ElementIndex(3, 1));
+    const float* tz = transforms.GetStream(FAffineTransformArray::ElementIndex(3, 2));
+    auto viewDepth = [&](uint32_t city)
+    {
+        // Clip w of the city's origin is its distance along the view direction.
+        return tx[city] * viewProjection._14 + ty[city] * viewProjection._24 + tz[city] * viewProjection._34 + viewProjection._44;
+    };
+
+    // Quantize over the depth range actually in view so close cities still get distinct keys.
+    float nearZ = FLT_MAX;
+    float farZ = -FLT_MAX;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float depth = viewDepth(m_visibleCities[i]);
+        nearZ = std::min(nearZ, depth);
+        farZ = std::max(farZ, depth);
+    }
+    farZ = std::max(farZ, nearZ + FLT_EPSILON);
+
+    m_drawItems.resize(count);
+    m_drawItemScratch.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint32_t city = m_visibleCities[i];
+        const uint32_t material = m_frameResources[0]->GetCityMaterial(city);
+        m_drawItems[i].Key = FDrawKey::Make(0, 0, 0, material, 0, FDrawKey::QuantizeDepth(viewDepth(city), nearZ, farZ));
+        m_drawItems[i].Index = city;
+    }
+    SortDrawItems(m_drawItems.data(), m_drawItemScratch.data(), count, m_desc.pJobSystem);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_visibleCities[i] = m_drawItems[i].Index;
+    }
+}
+
+uint64_t FSceneRenderer::Render(const FSceneRenderTarget& target)
+{
+    // Record all the commands we need to render the scene into the command list(s).
+    const FClock::time_point recordBegin = FClock::now();
+    PopulateCommandList(m_pCurrentFrameResource, target);
+    if (!m_workerCommandLists.empty())
+    {
+        RecordCityChunks(target);
+    }
+    const FClock::time_point recordEnd = FClock::now();
+
+    m_frameStats.BarrierCount = m_commandListStates.GetBarrierCount();
+    m_frameStats.SkippedBarrierCount = m_commandListStates.GetSkippedCount();
+    for (const RHIResourceStateTracker& states : m_workerCommandListStates)
+    {
+        m_frameStats.BarrierCount += states.GetBarrierCount();
+        m_frameStats.SkippedBarrierCount += states.GetSkippedCount();
+    }
+
+    const uint64_t skippedStateTotal = GetSkippedStateTotal();
+    m_frameStats.SkippedStateCount = static_cast<uint32_t>(skippedStateTotal - m_skippedStateTotal);
+    m_skippedStateTotal = skippedStateTotal;
+
+    // Execute the command lists.
+    m_frameStats.CommandListCount = SubmitFrame();
+    m_desc.pUploadRing->OnSubmit(m_fenceValue);
+    ReleaseCommandLists();
+    m_frameStats.RecordMs = ElapsedMs(recordBegin, recordEnd);
+    m_frameStats.SubmitMs = ElapsedMs(recordEnd, FClock::now());
+
+    m_pCurrentFrameResource->m_fenceValue = m_fenceValue;
+    m_submittedFences[m_submittedFrameCount % m_desc.FrameCount] = m_fenceValue;
+    m_submittedFrameCount++;
+    return m_fenceValue;
+}
+
+uint32_t FSceneRenderer::SubmitFrame()
+{
+    // The main list started from the usage states, so it has nothing to resolve; it only publishes
+    // where it leaves the back buffer.
+    m_pendingBarriers.clear();
+    m_commandListStates.ResolvePendingBarriers(m_pendingBarriers);
+    for (uint64_t fenceValue : m_queueWaits)
+    {
+        m_pQueue->InsertWait(fenceValue);
+    }
+    m_queueWaits.clear();
+
+    if (m_workerCommandLists.empty())
+    {
+        RHICommandList* ppCommandLists[] = { m_pCommandList };
+        m_fenceValue = m_pQueue->ExecuteCommandLists(1, ppCommandLists);
+        return 1;
+    }
+
+    // The clear, then every worker's draws in city order: one submission, one fence. Each split
+    // list's first uses are resolved against where the lists before it leave the resources, and the
+    // transitions that takes go at the end of the list before it, which is still open.
+    std::vector<RHICommandList*> commandLists;
+    commandLists.reserve(m_workerCommandLists.size() + 1);
+    commandLists.push_back(m_pCommandList);
+    for (size_t i = 0; i < m_workerCommandLists.size(); i++)
+    {
+        m_pendingBarriers.clear();
+        m_workerCommandListStates[i].ResolvePendingBarriers(m_pendingBarriers);
+        if (!m_pendingBarriers.empty())
+        {
+            commandLists.back()->ResourceBarrier(static_cast<uint32_t>(m_pendingBarriers.size()), m_pendingBarriers.data());
+            m_frameStats.BarrierCount += static_cast<uint32_t>(m_pendingBarriers.size());
+        }
+        commandLists.push_back(m_workerCommandLists[i]);
+    }
+
+    m_fenceValue = m_pQueue->ExecuteCommandLists(static_cast<uint32_t>(commandLists.size()), commandLists.data());
+    return static_cast<uint32_t>(commandLists.size());
+}
+
+void FSceneRenderer::ReleaseCommandLists()
+{
+    FCommandListPool* pPool = m_desc.pCommandListPool;
+    pPool->ReleaseAllocator(m_pCommandAllocator, m_fenceValue);
+    pPool->ReleaseCommandList(m_pCommandList, m_fenceValue);
+    m_pCommandAllocator = nullptr;
+    m_pCommandList = nullptr;
+    for (size_t i = 0; i < m_workerCommandLists.size(); i++)
+    {
+        pPool->ReleaseAllocator(m_workerCommandAllocators[i], m_fenceValue);
+        pPool->ReleaseCommandList(m_workerCommandLists[i], m_fenceValue);
+        m_workerCommandAllocators[i] = nullptr;
+        m_workerCommandLists[i] = nullptr;
+    }
+}
+
+uint64_t FSceneRenderer::GetSkippedStateTotal() const
+{
+    uint64_t total = m_commandListFilter ? m_commandListFilter->GetSkippedCount() : 0;
+    for (const std::unique_ptr<RHIStateFilter>& filter : m_workerCommandListFilters)
+    {
+        total += filter->GetSkippedCount();
+    }
+    return total;
+}
+
+void FSceneRenderer::WaitForIdle()
+{
+    if (m_fenceValue != 0)
+    {
+        m_pQueue->WaitForFenceCPUBlocking(m_fenceValue);
+    }
+}
+
+void FSceneRenderer::PopulateCommandList(FrameResource* pFrameResource, const FSceneRenderTarget& target)
+{
+    // The pool hands out an allocator only once the GPU has finished with every list recorded from
+    // it, and the list comes reset against it, ready to record.
+    m_pCommandAllocator = m_desc.pCommandListPool->AcquireAllocator(ERHICommandListType::Direct);
+    m_pCommandList = m_desc.pCommandListPool->AcquireCommandList(m_pCommandAllocator, m_desc.pPipelineState);
+    m_commandListStates.Reset(true);
+
+    // Recorded through the state filter when there is one; the list itself is what gets submitted.
+    RHICommandList* pCommandList = m_pCommandList;
+    if (m_commandListFilter)
+    {
+        m_commandListFilter->SetTarget(m_pCommandList, m_desc.pPipelineState);
+        pCommandList = m_commandListFilter.get();
+    }
+
+    // Set necessary state.
+    pCommandList->SetGraphicsRootSignature(m_desc.pRootSignature);
+
+    RHIDescriptorHeap* ppHeaps[] = { m_desc.pCbvSrvDescriptorHeap, m_desc.pSamplerDescriptorHeap };
+    pCommandList->SetDescriptorHeaps(2, ppHeaps);
+
+    pCommandList->RSSetViewports(1, &target.Viewport);
+    pCommandList->RSSetScissorRects(1, &target.ScissorRect);
+
+    // Indicate that the back buffer will be used as a render target.
+    m_frameGraph.SetResource(m_backBufferResource, target.pBackBuffer);
+    m_frameGraph.EmitPassBarriers(m_clearPass, m_commandListStates);
+    m_commandListStates.FlushBarriers(pCommandList);
+
+    pCommandList->OMSetRenderTargets(1, &target.RenderTargetView, &target.DepthStencilView);
+
+    // Record commands.
+    const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
+    pCommandList->ClearRenderTargetView(target.RenderTargetView, clearColor);
+    pCommandList->ClearDepthStencilView(target.DepthStencilView, 1.0f, 0);
+
+    m_frameStats.DrawCount = m_desc.UseInstancing ? 1 : m_visibleCityCount;
+
+    // Split lists are submitted after this one, so it also carries the draw pass's barriers.
+    m_frameGraph.EmitPassBarriers(m_drawCitiesPass, m_commandListStates);
+    m_commandListStates.FlushBarriers(pCommandList);
+
+    if (!m_workerCommandLists.empty())
+    {
+        // The draws go into their own lists (see RecordCityChunk).
+        return;
+    }
+
+    pCommandList->BeginEvent(L"Draw cities");
+    if (m_desc.UseBundles)
+    {
+        // Execute the prebuilt bundle. It inherits the instance buffer, which moves every frame.
+        if (m_desc.UseInstancing)
+        {
+            pCommandList->SetGraphicsRootShaderResourceView(4, pFrameResource->m_instanceDataGpuAddress);
+        }
+        pCommandList->ExecuteBundle(pFrameResource->m_bundle.get());
+    }
+    else
+    {
+        // Populate a new command list.
+        pFrameResource->PopulateCommandList(pCommandList, m_drawBindings, 0, m_visibleCityCount, GetDrawCityIndices());
+    }
+    pCommandList->EndEvent();
+
+    // Indicate that the back buffer will now be used to present.
+    m_frameGraph.EmitFinalBarriers(m_commandListStates);
+    m_commandListStates.FlushBarriers(pCommandList);
+}
+
+// Records every split list, as one job each when there is a job system. Called after the main
+// list is recorded, whose barriers are recorded in place rather than resolved at submission.
+void FSceneRenderer::RecordCityChunks(const FSceneRenderTarget& target)
+{
+    const uint32_t listCount = static_cast<uint32_t>(m_workerCommandLists.size());
+    if (!m_desc.pJobSystem)
+    {
+        for (uint32_t i = 0; i < listCount; i++)
+        {
+            RecordCityChunk(i, target);
+        }
+        return;
+    }
+
+    // Jobs must not throw, so RHI errors are carried back and rethrown here.
+    std::vector<std::exception_ptr> errors(listCount);
+    std::exception_ptr* pErrors = errors.data();
+    FJobCounter counter;
+    for (uint32_t i = 0; i < listCount; i++)
+    {
+        m_desc.pJobSystem->Run([this, &target, pErrors, i]()
+        {
+            try
+            {
+                RecordCityChunk(i, target);
+            }
+            catch (...)
+            {
+                pErrors[i] = std::current_exception();
+            }
+        }, &counter);
+    }
+    m_desc.pJobSystem->Wait(counter);
+
+    for (const std::exception_ptr& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// May run on any job system thread: draws this list's contiguous slice of the visible cities.
+void FSceneRenderer::RecordCityChunk(uint32_t listIndex, const FSceneRenderTarget& target)
+{
+    const uint32_t listCount = static_cast<uint32_t>(m_workerCommandLists.size());
+    const uint32_t cityCount = m_visibleCityCount;
+    const uint32_t firstCity = static_cast<uint32_t>(uint64_t(cityCount) * listIndex / listCount);
+    const uint32_t endCity = static_cast<uint32_t>(uint64_t(cityCount) * (listIndex + 1) / listCount);
+
+    // From the pool, which any job system thread may take from.
+    RHICommandAllocator* pAllocator = m_desc.pCommandListPool->AcquireAllocator(ERHICommandListType::Direct);
+    m_workerCommandAllocators[listIndex] = pAllocator;
+    m_workerCommandLists[listIndex] = m_desc.pCommandListPool->AcquireCommandList(pAllocator, m_desc.pPipelineState);
+    RHICommandList* pCommandList = m_workerCommandLists[listIndex];
+    if (!m_workerCommandListFilters.empty())
+    {
+        m_workerCommandListFilters[listIndex]->SetTarget(pCommandList, m_desc.pPipelineState);
+        pCommandList = m_workerCommandListFilters[listIndex].get();
+    }
+    RHIResourceStateTracker& states = m_workerCommandListStates[listIndex];
+    states.Reset();
+
+    // The back buffer is a render target here; the main list, submitted before, made it one.
+    states.TransitionResource(target.pBackBuffer, RHI_STATE_RENDER_TARGET);
+
+    // Direct command lists do not inherit state from the list submitted before them.
+    pCommandList->RSSetViewports(1, &target.Viewport);
+    pCommandList->RSSetScissorRects(1, &target.ScissorRect);
+    pCommandList->OMSetRenderTargets(1, &target.RenderTargetView, &target.DepthStencilView);
+
+    pCommandList->BeginEvent(L"Draw cities");
+    m_pCurrentFrameResource->PopulateCommandList(pCommandList, m_drawBindings, firstCity, endCity - firstCity, GetDrawCityIndices());
+    pCommandList->EndEvent();
+
+    // The last list submitted returns the back buffer to present.
+    if (listIndex + 1 == listCount)
+    {
+        m_frameGraph.EmitFinalBarriers(states);
+        states.FlushBarriers(pCommandList);
+    }
+}
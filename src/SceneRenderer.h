@@ -0,0 +1,268 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+#include "FrameResource.h"
+#include "../Common/Math/Bvh.h"
+#include "../Common/Math/FrustumCulling.h"
+#include "../Common/Math/OcclusionCulling.h"
+#include "../Common/Math/TransformStore.h"
+#include "../Common/Render/CommandListPool.h"
+#include "../Common/Render/DrawSort.h"
+#include "../Common/Render/RenderGraph.h"
+#include "../Common/Render/UploadRing.h"
+#include "RHIResourceStateTracker.h"
+#include "RHIStateFilter.h"
+
+class FJobSystem;
+
+// Per-frame path of the city sample (constant updates, command recording, submission)
+// written against the RHI interfaces. D3D12DynamicIndexing drives it with the DX12 backend;
+// the headless runner drives it with the Null backend.
+
+struct FSceneRendererDesc
+{
+    RHIDevice* pDevice = nullptr;
+    RHIPipelineState* pPipelineState = nullptr;
+    RHIRootSignature* pRootSignature = nullptr;
+    RHIDescriptorHeap* pCbvSrvDescriptorHeap = nullptr;
+    RHIDescriptorHeap* pSamplerDescriptorHeap = nullptr;
+    // The tables bound to root parameters 0 (SRVs) and 1 (samplers). Null binds each heap from its
+    // first descriptor. They stay bound for the renderer's lifetime, so tables from an
+    // FDescriptorTableCache must be pinned.
+    FRHIGpuDescriptor SrvTable;
+    FRHIGpuDescriptor SamplerTable;
+    FRHIVertexBufferView VertexBufferView;
+    FRHIIndexBufferView IndexBufferView;
+    uint32_t NumIndices = 0;
+
+    uint32_t FrameCount = 3;
+    // How many frames the CPU may run ahead of the GPU, clamped to [1, FrameCount].
+    // FrameCount keeps every frame resource in flight; 1 serializes CPU and GPU.
+    uint32_t MaxFramesInFlight = 3;
+    uint32_t CityRowCount = 15;
+    uint32_t CityColumnCount = 8;
+    // City i is drawn with material i % CityMaterialCount.
+    uint32_t CityMaterialCount = CityRowCount * CityColumnCount;
+    float CitySpacingInterval = 16.0f;
+
+    bool UseBundles = true;
+    // Draw every city with one DrawIndexedInstanced that reads its MVP and material index from a
+    // per-frame instance buffer (root parameter 4, a root SRV) instead of one draw per city. The
+    // pipeline and root signature must be the instanced ones; split recording is not used.
+    bool UseInstancing = false;
+    // Draw only the cities whose world bounds intersect the view frustum of the Update() matrices.
+    // InstanceBoundsMin/Max are the city mesh's local bounds. The visible set changes every frame,
+    // so this cannot be combined with UseBundles.
+    bool UseFrustumCulling = false;
+    FVector3 InstanceBoundsMin = { 0.0f, 0.0f, 0.0f };
+    FVector3 InstanceBoundsMax = { 0.0f, 0.0f, 0.0f };
+    // With frustum culling, find the visible cities by walking a BVH over their bounds instead of
+    // testing every one. Pays off for large grids where most cities are out of view; the visible
+    // cities then come in tree order rather than ascending.
+    bool UseBvh = false;
+    // After frustum culling (which it requires), drop the cities hidden behind the MaxOccluderCount
+    // nearest ones. Each occluder is drawn into a small CPU depth buffer as the local box
+    // OccluderBoundsMin/Max, which must lie inside the city mesh: a box reaching into gaps between
+    // buildings would hide cities that are actually visible through them.
+    bool UseOcclusionCulling = false;
+    FVector3 OccluderBoundsMin = { 0.0f, 0.0f, 0.0f };
+    FVector3 OccluderBoundsMax = { 0.0f, 0.0f, 0.0f };
+    uint32_t MaxOccluderCount = 16;
+    // Draw the visible cities in FDrawKey order (pass, pipeline, root signature, material, mesh, then
+    // front to back) instead of in culling order. Every city shares one pass, pipeline, root signature
+    // and mesh, so the cities are grouped by material and drawn front to back within each; the draws
+    // of one material then set the same root constants, which the state filter drops. Like culling,
+    // this cannot be combined with UseBundles.
+    bool UseDrawSorting = false;
+    // Record through an RHIStateFilter, which drops state calls that set what is already set.
+    bool UseStateFilter = true;
+    // Command lists the city draws are split across when bundles are off, each recorded as a job on
+    // pJobSystem (or one after the other without one). 0 records everything into the main list.
+    uint32_t RecordCommandListCount = 0;
+    // Optional. Used for the constant buffer update and command list recording; must outlive the renderer.
+    FJobSystem* pJobSystem = nullptr;
+    // Optional. Per-frame data (the per-draw constants, or the instance buffer) is allocated from it; it must allocate against
+    // the device's direct queue and outlive the renderer; each frame's submission tags what it allocated with OnSubmit().
+    // The renderer creates its own when null.
+    FUploadRing* pUploadRing = nullptr;
+    // Optional. The frame's command allocators and lists come from it, and go back to it with the
+    // frame's fence; it must outlive the renderer. The renderer creates its own when null.
+    FCommandListPool* pCommandListPool = nullptr;
+};
+
+struct FSceneRenderTarget
+{
+    RHIResource* pBackBuffer = nullptr;
+    FRHICpuDescriptor RenderTargetView;
+    FRHICpuDescriptor DepthStencilView;
+    FRHIViewport Viewport;
+    FRHIRect ScissorRect;
+};
+
+// CPU cost of the most recent frame, in milliseconds.
+struct FSceneFrameStats
+{
+    double WaitMs = 0.0;        // Blocked in BeginFrame waiting for the GPU.
+    double TransformMs = 0.0;   // Part of UpdateMs: moved cities' matrices, bounds and BVH refit.
+    double CullMs = 0.0;        // Part of UpdateMs, including OcclusionMs.
+    double OcclusionMs = 0.0;
+    double SortMs = 0.0;        // Part of UpdateMs.
+    double UpdateMs = 0.0;
+    double RecordMs = 0.0;
+    double SubmitMs = 0.0;
+    uint32_t DrawCount = 0;
+    uint32_t MovedCount = 0;        // Cities whose transform changed since the previous Update().
+    uint32_t VisibleCount = 0;      // Cities that passed culling (all of them without it).
+    uint32_t OccludedCount = 0;     // Cities in the frustum dropped by occlusion culling.
+    uint32_t CommandListCount = 0;  // Submitted in the frame's single ExecuteCommandLists call.
+    uint32_t SkippedStateCount = 0; // Redundant state calls the state filter dropped while recording.
+    uint32_t BarrierCount = 0;      // Resource barriers recorded, including those resolved at submission.
+    uint32_t SkippedBarrierCount = 0;   // Transitions the state trackers found redundant.
+};
+
+// Frame pacing counters since creation (or the last ResetPacingStats()).
+struct FScenePacingStats
+{
+    uint64_t FrameCount = 0;
+    uint64_t StalledFrameCount = 0;     // Frames whose BeginFrame had to block.
+    double TotalWaitMs = 0.0;
+    double MaxWaitMs = 0.0;
+};
+
+class FSceneRenderer
+{
+public:
+    explicit FSceneRenderer(const FSceneRendererDesc& desc);
+
+    // Move to the next frame resource and wait until the GPU is done with it and no more than
+    // MaxFramesInFlight frames are outstanding.
+    void BeginFrame();
+    void XM_CALLCONV Update(FXMMATRIX view, CXMMATRIX projection);
+    // The frame's lists start on the GPU only once fenceValue is reached: work submitted to the
+    // compute or copy queue that the frame reads, such as culling or uploads, which then runs
+    // alongside the previous frames' graphics work. Call between BeginFrame() and Render().
+    void WaitForQueueFence(uint64_t fenceValue) { m_queueWaits.push_back(fenceValue); }
+    // Record and submit the frame. Returns the fence value of the submission.
+    uint64_t Render(const FSceneRenderTarget& target);
+    void WaitForIdle();
+
+    const FSceneFrameStats& GetFrameStats() const { return m_frameStats; }
+    const FScenePacingStats& GetPacingStats() const { return m_pacingStats; }
+    void ResetPacingStats() { m_pacingStats = FScenePacingStats(); }
+    RHICommandQueue* GetQueue() const { return m_pQueue; }
+    uint32_t GetInstanceCount() const { return m_desc.CityRowCount * m_desc.CityColumnCount; }
+
+    // City transforms. Cities may be moved, rotated and scaled through the store between frames; the
+    // next Update() picks up only what changed. The renderer's buffers are sized for the initial
+    // cities, so they must not be created or destroyed.
+    FTransformStore& GetCityTransforms() { return m_cityTransforms; }
+    FTransformHandle GetCityHandle(uint32_t city) const { return m_cityHandles[city]; }
+
+private:
+    void CreateCities();
+    void CreateFrameResources();
+    void CreateFrameGraph();
+    void UpdateCityTransforms();
+    void CullCities(const FFrustum& frustum);
+    void CullOccludedCities(const FMatrix4x4& viewProjection);
+    void SortCities(const FMatrix4x4& viewProjection);
+    // Whether the draws go over m_visibleCities rather than every city in ascending order.
+    bool UsesCityList() const { return m_desc.UseFrustumCulling || m_desc.UseDrawSorting; }
+    // City of each draw for FrameResource::PopulateCommandList; null when draw i is city i (no culling
+    // or sorting, or the instance buffer already holds the visible cities in order).
+    const uint32_t* GetDrawCityIndices() const { return (UsesCityList() && !m_desc.UseInstancing) ? m_visibleCities.data() : nullptr; }
+    uint64_t GetSkippedStateTotal() const;
+    void PopulateCommandList(FrameResource* pFrameResource, const FSceneRenderTarget& target);
+    void RecordCityChunks(const FSceneRenderTarget& target);
+    void RecordCityChunk(uint32_t listIndex, const FSceneRenderTarget& target);
+    uint32_t SubmitFrame();
+    // Hands the frame's allocators and lists back to the pool, the allocators with m_fenceValue.
+    void ReleaseCommandLists();
+
+    FSceneRendererDesc m_desc;
+    FrameResource::DrawBindings m_drawBindings;
+    RHICommandQueue* m_pQueue;
+    // Set when the description came without an upload ring; m_desc.pUploadRing points at it then.
+    std::unique_ptr<FUploadRing> m_uploadRing;
+    // Likewise for the command list pool.
+    std::unique_ptr<FCommandListPool> m_commandListPool;
+    // The frame's main list and its allocator, from the pool, between recording and submission.
+    RHICommandAllocator* m_pCommandAllocator;
+    RHICommandList* m_pCommandList;
+    // With UseStateFilter, one filter per list (null otherwise), and their skipped calls before this frame.
+    std::unique_ptr<RHIStateFilter> m_commandListFilter;
+    std::vector<std::unique_ptr<RHIStateFilter>> m_workerCommandListFilters;
+    uint64_t m_skippedStateTotal;
+
+    // Split recording (RecordCommandListCount > 0 and no bundles): the main list clears, then each
+    // of these draws its slice of the cities; the last one transitions the back buffer to present.
+    // Each is taken from the pool, with an allocator of its own, by the job that records it.
+    std::vector<RHICommandAllocator*> m_workerCommandAllocators;
+    std::vector<RHICommandList*> m_workerCommandLists;
+
+    // Resource states seen by the main list and each split list. The main list is recorded after the
+    // previous frame is submitted and starts from the resources' usage states; split lists resolve
+    // their first uses when the frame is submitted.
+    RHIResourceStateTracker m_commandListStates;
+    std::vector<RHIResourceStateTracker> m_workerCommandListStates;
+    std::vector<FRHIResourceBarrier> m_pendingBarriers;
+
+    // World transforms of the cities, shared by every frame resource. City i is m_cityHandles[i].
+    FTransformStore m_cityTransforms;
+    std::vector<FTransformHandle> m_cityHandles;
+
+    // Frustum culling: world bounds of every city, and the visible cities of the current frame in
+    // ascending (or BVH, or draw key) order, all of them when culling is off. The draws go over the first
+    // m_visibleCityCount.
+    FAabbArray m_cityBounds;
+    FBvh m_cityBvh;
+    std::vector<uint32_t> m_visibleCities;
+    std::vector<uint32_t> m_cullChunkVisibleCounts;
+    uint32_t m_visibleCityCount;
+
+    // Occlusion culling: the occluder box of every city, the depth buffer they are drawn into, and
+    // (view depth, city) of the frame's occluder candidates.
+    FAabbArray m_occluderBounds;
+    FOcclusionBuffer m_occlusionBuffer;
+    std::vector<std::pair<float, uint32_t>> m_occluderCandidates;
+
+    // Draw sorting: a key per visible city and the radix sort's scratch.
+    std::vector<FDrawItem> m_drawItems;
+    std::vector<FDrawItem> m_drawItemScratch;
+
+    // The frame's passes and the back buffer they render to, compiled once; the graph supplies the
+    // back buffer barriers to the state trackers, with the current back buffer bound each frame.
+    FRenderGraph m_frameGraph;
+    FRenderGraphResource m_backBufferResource;
+    uint32_t m_clearPass;
+    uint32_t m_drawCitiesPass;
+
+    // Frame resources.
+    std::vector<std::unique_ptr<FrameResource>> m_frameResources;
+    FrameResource* m_pCurrentFrameResource;
+    uint32_t m_currentFrameResourceIndex;
+
+    // Synchronization objects.
+    uint64_t m_fenceValue;
+    // Other queues' fence values the next submission waits on (WaitForQueueFence).
+    std::vector<uint64_t> m_queueWaits;
+    // Fence of each of the last FrameCount submissions, indexed by m_submittedFrameCount % FrameCount.
+    std::vector<uint64_t> m_submittedFences;
+    uint64_t m_submittedFrameCount;
+
+    FSceneFrameStats m_frameStats;
+    FScenePacingStats m_pacingStats;
+};
@@ -14,6 +14,7 @@
 namespace SampleAssets
 {
     LPCWSTR DataFileName = L"occcity.bin";
+    LPCWSTR CookedMeshFileName = L"occcity.mesh";    // Vertex/index data cooked from occcity.bin by MEngineMeshCook.
 
     const D3D12_INPUT_ELEMENT_DESC StandardVertexDescription[] =
     {